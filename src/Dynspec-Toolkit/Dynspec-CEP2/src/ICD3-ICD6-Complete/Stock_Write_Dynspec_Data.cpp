@@ -3,6 +3,8 @@
 #include <fstream>
 
 #include "Stock_Write_Dynspec_Data.h"
+#include "Dynspec_Rebin_Engine.h"
+#include "Dynspec_Pyramid.h"
 
 #include <dal/lofar/BF_File.h>
 
@@ -48,7 +50,7 @@ using namespace std;
     
   
   
-  void Stock_Write_Dynspec_Data::writeDynspecData(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex, vector<string> listOfFiles, int m, int obsNofFrequencyBand)  
+  void Stock_Write_Dynspec_Data::writeDynspecData(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex, vector<string> listOfFiles, int m, int obsNofFrequencyBand,string dynspecName, const Dynspec_Data_Layout &dataLayout)  
   {
       
     
@@ -70,6 +72,8 @@ using namespace std;
   /// \param  stokesComponent vector which contains all Stokes components
   /// \param  memoryRAM RAM memory consuption by processing
   /// \param  SAPindex Subarray pointings to process
+  /// \param  dynspecName dynamic spectrum group (DATA is created in it)
+  /// \param  dataLayout chunks, compression and storage type of DATA (Dynspec_Data_Layout)
 
       
       int mindex(m);
@@ -147,182 +151,64 @@ using namespace std;
             
       // generating the dataset
       
+      dataLayout.createData(outputFile,dynspecName,m_Ntime,m_Nspectral,obsNofStockes);	// chunked layout, then opened by DAL
       Dataset<float> data_grp(dynspec_grp, "DATA");
-      vector<ssize_t> dimensions(3);
-      dimensions[0] = m_Ntime;
-      dimensions[1] = m_Nspectral;
-      dimensions[2] = obsNofStockes;      
-      data_grp.create( dimensions );
+      Dynspec_Pyramid pyramid(m_Ntime,m_Nspectral,obsNofStockes,dataLayout.pyramidLevels());	// DATA decimated by 2, 4, 8... (PYRAMID group)
+      pyramid.create(dynspec_grp,outputFile,dynspecName,dataLayout);
       
       
       // define the time step for filling the dataset
-      int p(0),r(0),n(0);
-      int sizeTimeLimit((1.08E6*memoryRAM)/(m_Nspectral*obsNofStockes));	// time step ~ 1Go RAM memory maximum !
+      int p(0);
+      // two time steps of ICD3 data in memory (one prefetched) + the block written ~ memoryRAM Go maximum, at least 1 time bin !
+      unsigned long int timeStep(Dynspec_Rebin_Engine::timeStep(memoryRAM,obsNofStockes,m_Nspectral,1,m_Nspectral,obsNofStockes));
+      int sizeTimeLimit((m_Ntime > 0) ? m_Ntime : 1);
+      if (timeStep < (unsigned long int)sizeTimeLimit){sizeTimeLimit = timeStep;}
       int fracTime((m_Ntime/sizeTimeLimit)+1);
       int nofLastElements((m_Ntime)-((fracTime-1)*sizeTimeLimit));
       
       
-      
-      
-      
-      for (p=0;p<fracTime;p++)
-	{
-	  
-	  
-	vector<float> DATA_3D(sizeTimeLimit*m_Nspectral*obsNofStockes);    
-	if (p==fracTime-1){if (nofLastElements > 0){DATA_3D.resize(nofLastElements*m_Nspectral*obsNofStockes);}}	    
+      // Open the Stokes files once for all time steps: the engine loads and interleaves them (no rebinning)
+      Dynspec_Rebin_Engine engine(obsNofStockes,m_Nspectral);
 
-	for (l=0;l<obsNofStockes;l++)
-	  {
-	      vector<float> DATA_2D(sizeTimeLimit * m_Nspectral);
-	      if (p==fracTime-1){if (nofLastElements > 0){DATA_2D.resize(nofLastElements * m_Nspectral);}} 
-	      
-		    pathFile 	= listOfFiles[mindex*obsNofStockes*obsNofFrequencyBand+q+l*obsNofFrequencyBand];
-
-		    
-		    pathFileSize=pathFile.length();
-		    int obsNameSize(obsName.length());
-		    string pathDir(pathFile.substr(0,pathFileSize-26-obsNameSize));
-		    
-		  
-		    string index_i1,index_j1,index_l1;	    
-		    std::ostringstream oss_i;oss_i << i;string index_i(oss_i.str());
-		    if (i<10){index_i1="_SAP00"+index_i;}
-		    if (i>=10 && i<100){index_i1="_SAP0"+index_i;}
-		    if (i>=100 && i<1000){index_i1="_SAP"+index_i;}
+      for (l=0;l<obsNofStockes;l++)
+	{
+	    pathFile 	= listOfFiles[mindex*obsNofStockes*obsNofFrequencyBand+q+l*obsNofFrequencyBand];
 	    
-		    std::ostringstream oss_j;oss_j << j;string index_j(oss_j.str()); 
-		    if (j<10){index_j1="_B00"+index_j;}
-		    if (j>=10 && i<100){index_j1="_B0"+index_j;}
-		    if (j>=100 && i<1000){index_j1="_B"+index_j;}
-		    
-		    std::ostringstream oss_q;oss_q << q;string index_q(oss_q.str()); 
-		    if (q<10){index_q1="_P00"+index_q;}
-		    if (q>=10 && i<100){index_q1="_P0"+index_q;}
-		    if (q>=100 && i<1000){index_q1="_P"+index_q;}   
-		  
-		    std::ostringstream oss_l;oss_l << l;string index_l(oss_l.str());
-		    index_l1 = "_S"+index_l+index_q1+"_bf.h5";
-		
-
-		    // Load Stokes data		    
-		    pathFile = pathDir+obsName+index_i1+index_j1+index_l1;
-		    pathRaw =  pathDir+obsName+index_i1+index_j1+"_S"+index_l+index_q1+"_bf.raw";		  
-
-		    
-		    if ( is_readable( pathRaw ) ) 
-		    { 			    
-
-			    // Load Stokes data
-			    
-			    BF_File file(pathFile);  							// generate an object called file contains Root
-			    BF_SubArrayPointing SAP 		= file.subArrayPointing(i);		// generate an object called SAP contains subarray pointings
-			    BF_BeamGroup BEAM			= SAP.beam(j);      			// generate an object called BEAM contains Beams
-			    
-
-			    BF_StokesDataset STOCKES 		= BEAM.stokes(l);	
-	      
-			    //Load 2D Stockes data in a 2D array DATA0 with DAL and stock data in DATA3D for writting (by time step)     
-			    if (p!=fracTime-1)
-			      {    
-				vector<size_t> pos(2);
-				pos[0]=p*sizeTimeLimit;
-				pos[1]=0;
-			  
-				vector<size_t> size(2);
-				size[0] = sizeTimeLimit;
-				size[1] = m_Nspectral;
-			      
-				STOCKES.getMatrix( pos, &DATA_2D[0], size );
-			  
-				for (r=0;r<sizeTimeLimit;r++)
-				  {
-				    for (n=0;n<m_Nspectral;n++)
-				      {		  			  
-					if (l==0){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)]=DATA_2D[(r*m_Nspectral)+n];}
-					if (l==1){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA_2D[(r*m_Nspectral)+n];}
-					if (l==2){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA_2D[(r*m_Nspectral)+n];}
-					if (l==3){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA_2D[(r*m_Nspectral)+n];}
-								
-				      }	  
-				  }		    
-				}
-			      else
-				{
-				  if (nofLastElements > 0)
-				    {		  
-				      vector<size_t> pos(2);
-				      pos[0]=p*sizeTimeLimit;
-				      pos[1]=0;
-			    
-				      vector<size_t> size(2);
-				      size[0] = nofLastElements;
-				      size[1] = m_Nspectral;
-				  
-				      STOCKES.getMatrix( pos, &DATA_2D[0], size );
-					      
-				      for (r=0;r<sizeTimeLimit;r++)
-					{
-					  for (n=0;n<m_Nspectral;n++)
-					    {		  			  
-					      if (l==0){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)]=DATA_2D[(r*m_Nspectral)+n];}
-					      if (l==1){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA_2D[(r*m_Nspectral)+n];}
-					      if (l==2){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA_2D[(r*m_Nspectral)+n];}
-					      if (l==3){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA_2D[(r*m_Nspectral)+n];}
-								      
-					    }	  
-					}
-				    }
-			      } // end loop of else
-			} // end of Existing test 
-			else
-			{
-
-			Group process_histo_grp(dynspec_grp, "PROCESS_HISTORY");
-			Attribute<string> missedData(process_histo_grp, "MISSED DATA");
-			missedData.value = stokesComponent[l];
- 			       
-			}// end of else existing test			      
-
-	  }  //end loop on l (Stockes)// data are loaded in 3D array
-	  
-	  
-	  // Write data by time steps	
-	  if (p!=fracTime-1)
-	    {	  
-	      vector<size_t> data_grp_size(3);
-	      vector<size_t> data_grp_pos(3);
-
-	      data_grp_pos[0] = p*sizeTimeLimit;
-	      data_grp_pos[1] = 0;
-	      data_grp_pos[2] = 0;   	  
-	  
-	      data_grp_size[0] = sizeTimeLimit;
-	      data_grp_size[1] = m_Nspectral;
-	      data_grp_size[2] = obsNofStockes;
+	    pathFileSize=pathFile.length();
+	    int obsNameSize(obsName.length());
+	    string pathDir(pathFile.substr(0,pathFileSize-26-obsNameSize));
 	    
-	      data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
-	    }
-	  else
-	    {		  
-	      if (nofLastElements > 0)
-		{
-		  vector<size_t> data_grp_size(3);
-		  vector<size_t> data_grp_pos(3);
+	    std::ostringstream oss_l;oss_l << l;string index_l(oss_l.str());
 
-		  data_grp_pos[0] = p*sizeTimeLimit;
-		  data_grp_pos[1] = 0;
-		  data_grp_pos[2] = 0;   	  
-	  
-		  data_grp_size[0] = nofLastElements;
-		  data_grp_size[1] = m_Nspectral;
-		  data_grp_size[2] = obsNofStockes;
+	    // Load Stokes data		    
+	    pathFile = pathDir+obsName+index_i1+index_j1+"_S"+index_l+index_q1+"_bf.h5";
+	    pathRaw =  pathDir+obsName+index_i1+index_j1+"_S"+index_l+index_q1+"_bf.raw";		  
 	    
-		  data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );		    
-		}
+	    if ( is_readable( pathRaw ) ) 
+	    { 			    
+		engine.addPart(l,pathFile,i,j,0,m_Nspectral);
+	    }
+	    else
+	    {
+		Group process_histo_grp(dynspec_grp, "PROCESS_HISTORY");
+		Attribute<string> missedData(process_histo_grp, "MISSED DATA");
+		missedData.value = stokesComponent[l];
 	    }
+	}
+      
+      
+      // Schedule the time steps, then write them (missing Stokes are set to 0)
+      for (p=0;p<fracTime;p++)
+	{
+	  int nofRows(sizeTimeLimit);
+	  if (p==fracTime-1){nofRows = nofLastElements;}
+	  
+	  engine.addChunk(p*sizeTimeLimit,nofRows,p*sizeTimeLimit,nofRows);
 
 	} // end loop on p (time step)
+	engine.setPyramid(&pyramid);	// the levels are written with each time step
+	engine.writeChunks(data_grp);	// the next time step is loaded while the current one is written
+	pyramid.finish();
 
 	      
 	      	      
@@ -75,7 +75,8 @@ using namespace std;
 int main(int argc, char *argv[])
 {
 
-  // Usage: List-of-Files Output-dir ObsName tmax fmin fmax NofSAP nofBEAM nofStokes data-Percent
+  // Usage: List-of-Files Output-dir ObsName tmax fmin fmax NofSAP nofBEAM nofStokes data-Percent [Data-Layout]
+  //    or: pyramid ICD6-File DYNSPEC_xxx TimeResolution(s) FrequencyResolution(MHz) Output-raw-file  (quicklook read from the pyramid of an ICD6 file)
 
   ///////////////////////////////////////////////////////////////////////////////////////
   // Start Codes!
@@ -90,6 +91,28 @@ int main(int argc, char *argv[])
   //Input parameters
   
     
+  // quicklook of an ICD6 file at a given resolution: DATA is not read, the nearest level of its pyramid is rebinned (c.f Dynspec_Pyramid)
+  if (argc == 7 && string(argv[1]) == "pyramid")
+    {
+      Reader_Dynspec_Quick reader;
+      vector<float> DATA_3D;
+      vector<size_t> dimensions;
+      double timeIncrement(0);
+      vector<double> AXIS_VALUE_WORLD_SPECTRAL;
+      int level(reader.readPyramid(argv[2],argv[3],atof(argv[4]),atof(argv[5]),DATA_3D,dimensions,timeIncrement,AXIS_VALUE_WORLD_SPECTRAL));
+      if (level < 0){return 1;}
+
+      ofstream rawFile(argv[6],ios::binary);
+      if (!DATA_3D.empty()){rawFile.write((const char*)&DATA_3D[0],DATA_3D.size()*sizeof(float));}
+      rawFile.close();
+
+      cout << "Pyramid level: " << level << " (0: DATA)" << endl;
+      cout << "Dimensions [time][frequency][Stokes]: " << dimensions[0] << " x " << dimensions[1] << " x " << dimensions[2] << " (float32 written in " << argv[6] << ")" << endl;
+      cout << "Time increment: " << timeIncrement << " s" << endl;
+      if (!AXIS_VALUE_WORLD_SPECTRAL.empty()){cout << "Frequencies: " << AXIS_VALUE_WORLD_SPECTRAL[0] << " to " << AXIS_VALUE_WORLD_SPECTRAL.back() << " Hz" << endl;}
+      return 0;
+    }
+
   string pathListFile(argv[1]);
   string outputDir(argv[2]);
   string obsName(argv[3]);
@@ -103,6 +126,11 @@ int main(int argc, char *argv[])
   float dataSpectralPercent(atof(argv[11]));
   float nofPart(atof(argv[12]));
   
+  string dataLayoutOption("");		// ICD6's DATA layout (c.f Dynspec_Data_Layout; facultative, default: chunked, not compressed)
+  if (argc > 13){dataLayoutOption = argv[13];}
+  Dynspec_Data_Layout dataLayout(dataLayoutOption);
+  cout << "DATA layout: " << dataLayout.description() << endl;
+  
   obsNofStockes = 1;
   
   // Default paramters
@@ -223,7 +251,7 @@ int main(int argc, char *argv[])
 		    delete dynspecMetadata;
 
 		    //WRITE DATA
-		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,q,obsNofStockes,stokesComponent,SAPindex, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin, dataTimePercent,dataSpectralPercent);
+		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,q,obsNofStockes,stokesComponent,SAPindex, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin, dataTimePercent,dataSpectralPercent,"DYNSPEC_"+index_k1,dataLayout);
 		    delete dynspecData;
 
 		    k++;m++;
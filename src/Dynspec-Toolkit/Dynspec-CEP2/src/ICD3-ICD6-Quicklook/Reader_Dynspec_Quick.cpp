@@ -404,6 +404,36 @@ using namespace std;
     }  // end of the Reader_Dynspec object 
 
 
+
+  int Reader_Dynspec_Quick::readPyramid(string icd6File,string dynspecName,float timeResolution,float frequencyResolution,vector<float> &DATA_3D,vector<size_t> &dimensions,double &timeIncrement,vector<double> &AXIS_VALUE_WORLD_SPECTRAL)
+    {
+
+/// <br /> Usage:
+/// <br />   int Reader_Dynspec_Quick::readPyramid(string icd6File,string dynspecName,float timeResolution,float frequencyResolution,vector<float> &DATA_3D,vector<size_t> &dimensions,double &timeIncrement,vector<double> &AXIS_VALUE_WORLD_SPECTRAL)
+
+/// \param  icd6File ICD6 file to read
+/// \param  dynspecName dynamic spectrum group (DYNSPEC_xxx)
+/// \param  timeResolution time resolution asked (s)
+/// \param  frequencyResolution frequency resolution asked (MHz)
+/// \param  DATA_3D dynamic spectrum read [time][frequency][Stokes]
+/// \param  dimensions its dimensions
+/// \param  timeIncrement its time increment (s)
+/// \param  AXIS_VALUE_WORLD_SPECTRAL its frequencies (Hz)
+
+/// \return the pyramid level read (0: DATA)
+
+      File file(icd6File);
+      Group dynspec_grp(file,dynspecName);
+      if (!dynspec_grp.exists())
+	{
+	  cout << "ERROR: " << dynspecName << " doesn't exist in " << icd6File << endl;
+	  return -1;
+	}
+
+      return Dynspec_Pyramid::read(dynspec_grp,timeResolution,frequencyResolution,DATA_3D,dimensions,timeIncrement,AXIS_VALUE_WORLD_SPECTRAL);
+    }
+
+
       
       
       
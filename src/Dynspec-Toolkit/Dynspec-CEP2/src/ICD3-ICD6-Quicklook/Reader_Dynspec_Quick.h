@@ -5,6 +5,7 @@
 #include<iostream>
 
 #include <dal/lofar/BF_File.h>
+#include "Dynspec_Pyramid.h"
 #include "Stock_Write_Dynspec_Metadata_Quick.h"
 #include "Stock_Write_Dynspec_Data_Quick.h"
 
@@ -21,6 +22,7 @@
 ///  In fact this class is very similar to Reader_Root_Quick class, the only difference is: this class is for dynspec metadata, 
 ///  so, the main code (DynspecQuick.cpp) loop on dynspec to process and use this class several times (at the opposite of 
 ///  Reader_Root_Quick class which is called only once)
+/// <br /> readPyramid reads back a dynamic spectrum of an ICD6 file at a given resolution, from the nearest level of its pyramid (c.f Dynspec_Pyramid)
 
 
 class Reader_Dynspec_Quick
@@ -34,6 +36,8 @@ class Reader_Dynspec_Quick
   
   void readDynspec(std::string pathFile,Stock_Write_Dynspec_Metadata_Quick *dynspecMetadata,Stock_Write_Dynspec_Data_Quick *dynspecData,int i, int j, int q,int obsNofSAP,int obsNofStockes,std::vector<std::string> stokesComponent, int SAPindex, float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin);
     
+  int readPyramid(std::string icd6File,std::string dynspecName,float timeResolution,float frequencyResolution,std::vector<float> &DATA_3D,std::vector<size_t> &dimensions,double &timeIncrement,std::vector<double> &AXIS_VALUE_WORLD_SPECTRAL);
+    
   // Private Attributes
   private:
        
@@ -91,7 +91,7 @@ using namespace std;
 int main(int argc, char *argv[])
 {
 
-/// <br />Usage: DynspecPart Observation-Path-DIRObservation-Number(ex:Lxxxxx) Output-hdf5-DIR TimeMin TimeMax TimeRebin(s/pixel) FrequencyMin FrequencyMax FrequencyRebin(MHz/pixel) RebinAll(yes or no) [Facultative: Dataset-RAM-allocation (in Go; default value: 1Go) NumberOfSAP(if No, number of SAP to rebin/ if yes put 0 as default Value))] 
+/// <br />Usage: DynspecPart Observation-Path-DIRObservation-Number(ex:Lxxxxx) Output-hdf5-DIR TimeMin TimeMax TimeRebin(s/pixel) FrequencyMin FrequencyMax FrequencyRebin(MHz/pixel) RebinAll(yes or no) [Facultative: Dataset-RAM-allocation (in Go; default value: 1Go) NumberOfSAP(if No, number of SAP to rebin/ if yes put 0 as default Value))] [Facultative: Data-Layout (ex: "chunk=0x0,filter=deflate:1,type=float32"; c.f Dynspec_Data_Layout)]
 
 /// \param argc Number of arguments
 /// \param argv Table of arguments(see above c.f Usage)
@@ -170,6 +170,11 @@ int main(int argc, char *argv[])
   int obsNofStockes(atof(argv[15]));
   int obsNofFrequencyBand(atof(argv[16]));
   
+  string dataLayoutOption("");		// ICD6's DATA layout (c.f Dynspec_Data_Layout; facultative, default: chunked, not compressed)
+  if (argc > 17){dataLayoutOption = argv[17];}
+  Dynspec_Data_Layout dataLayout(dataLayoutOption);
+  cout << "DATA layout: " << dataLayout.description() << endl;
+  
  
 
 	int i(0);
@@ -332,7 +337,7 @@ int main(int argc, char *argv[])
 		    delete dynspecMetadata;
 
 		    //WRITE DATA
-		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,q,obsNofStockes,stokesComponent,memoryRAM,SAPindex, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin, listOfFiles, m, obsNofFrequencyBand);
+		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,q,obsNofStockes,stokesComponent,memoryRAM,SAPindex, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin, listOfFiles, m, obsNofFrequencyBand,"DYNSPEC_"+index_k1,dataLayout);
 		    delete dynspecData;
 
 		    k++;m++;
@@ -449,7 +454,7 @@ int main(int argc, char *argv[])
 		    
 		    
  		    //WRITE DATA
-		    dynspecData->writeDynspecDataPartionned(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,q,obsNofStockes,stokesComponent,memoryRAM,SAPindex, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin,  listOfFiles, m, obsNofFrequencyBand);
+		    dynspecData->writeDynspecDataPartionned(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,q,obsNofStockes,stokesComponent,memoryRAM,SAPindex, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin,  listOfFiles, m, obsNofFrequencyBand,"DYNSPEC_"+index_k1,dataLayout);
 		    delete dynspecData;
 			    
 		
@@ -7,6 +7,8 @@
 
 #include <dal/lofar/BF_File.h>
 
+#include "Dynspec_Data_Layout.h"
+
 
 /// \class Stock_Write_Dynspec_Data_Part
 ///  \brief Class object for stocking data parameters, processing the (select or rebin) and write data Matrix in the ICD6's Dynspec Groups 
@@ -32,7 +34,7 @@ class Stock_Write_Dynspec_Data_Part
     void stockDynspecData(int Ntime,int Nspectral, int NtimeReal, int NspectralReal);
     
     void writeDynspecData(Group &dynspec_grp,std::string obsName,std::string pathFile,std::string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,std::vector<std::string> stokesComponent,
-			      float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin,  std::vector<std::string> listOfFiles, int m, int obsNofFrequencyBand);
+			      float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin,  std::vector<std::string> listOfFiles, int m, int obsNofFrequencyBand,std::string dynspecName, const Dynspec_Data_Layout &dataLayout);
 
 
 
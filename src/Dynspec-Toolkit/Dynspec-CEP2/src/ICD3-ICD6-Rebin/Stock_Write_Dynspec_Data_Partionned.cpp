@@ -1,8 +1,11 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <algorithm>
 
 #include "Stock_Write_Dynspec_Data_Partionned.h"
+#include "Dynspec_Rebin_Engine.h"
+#include "Dynspec_Pyramid.h"
 
 #include <dal/lofar/BF_File.h>
 
@@ -52,7 +55,7 @@ using namespace std;
   } 
   
   
-  void Stock_Write_Dynspec_Data_Partionned::writeDynspecDataPartionned(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin, vector<string> listOfFiles, int m, int obsNofFrequencyBand)
+  void Stock_Write_Dynspec_Data_Partionned::writeDynspecDataPartionned(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin, vector<string> listOfFiles, int m, int obsNofFrequencyBand,string dynspecName, const Dynspec_Data_Layout &dataLayout)
   {
   /// <br /> Usage:
   /// <br />   void Stock_Write_Dynspec_Data_Partionned::writeDynspecData(Group &dynspec_grp,string pathDir,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin)  
@@ -77,6 +80,8 @@ using namespace std;
   /// \param  frequencyMin frequency minimum selected
   /// \param  frequencyMax frequency maximum selected
   /// \param  frequencyRebin frequency binning
+  /// \param  dynspecName dynamic spectrum group (DATA is created in it)
+  /// \param  dataLayout chunks, compression and storage type of DATA (Dynspec_Data_Layout)
 
       int mindex(m);
 
@@ -230,9 +235,10 @@ using namespace std;
 		
 	    ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	    // define the time step for filling the dataset
-	    unsigned long int p(0),n(0),r(0);
+	    unsigned long int p(0);
 
-	    unsigned long int sizeTimeLimit((1.08E6*memoryRAM)/((spectralIndexStop-spectralIndexStart+1)*obsNofStockes));	// time step ~ 1Go RAM memory maximum !        
+	    // two time steps of ICD3 data in memory (one prefetched) + the rebinned block ~ memoryRAM Go maximum !
+	    unsigned long int sizeTimeLimit(Dynspec_Rebin_Engine::timeStep(memoryRAM,obsNofStockes,spectralIndexStop-spectralIndexStart+1,timeIndexIncrementRebin,Nspectral,obsNofStockes));
 	    
 	    // SizeTimeLimit must be a multiple of Time Rebin for well cycling and avoid to lost data
 	    unsigned long int timeFactor(sizeTimeLimit/timeIndexIncrementRebin);
@@ -257,424 +263,83 @@ using namespace std;
             
       // generating the dataset
 
-      unsigned long int m_Nspectral_longversion(m_Nspectral);
-      
+      dataLayout.createData(outputFile,dynspecName,m_Ntime,m_Nspectral,obsNofStockes);	// chunked layout, then opened by DAL
       Dataset<float> data_grp(dynspec_grp, "DATA");
-      vector<ssize_t> dimensions(3);
-      dimensions[0] = m_Ntime;
-      dimensions[1] = m_Nspectral;
-      dimensions[2] = obsNofStockes;      
-      data_grp.create( dimensions );
+      Dynspec_Pyramid pyramid(m_Ntime,m_Nspectral,obsNofStockes,dataLayout.pyramidLevels());	// DATA decimated by 2, 4, 8... (PYRAMID group)
+      pyramid.create(dynspec_grp,outputFile,dynspecName,dataLayout);
 	
-      
-	    for (p=0;p<fracTime;p++)
-	      {
-
 
-	      vector<float> DATA_3D(sizeTimeLimit*m_Nspectral*obsNofStockes/timeIndexIncrementRebin);
-	      if (p==fracTime-1){if (nofLastElements > 0){DATA_3D.resize(nofLastElements*m_Nspectral*obsNofStockes/timeIndexIncrementRebin);}}	    
- 	      
+      // Open the Part Pxxx files once for all time steps: each one fills its subbands of the selected band
+      Dynspec_Rebin_Engine engine(obsNofStockes,spectralIndexStop-spectralIndexStart+1);
+      engine.setRebin(timeIndexIncrementRebin,m_Nspectral,spectralIndexIncrementRebin);
 
-	      for (l=0;l<obsNofStockes;l++)
-		{
-		    
-		  int qiterator(0);
-		  int squareAtStart(0);
-		    
-		  vector<float> DATA_2D(sizeTimeLimit*(spectralIndexStop-spectralIndexStart+1));
-		    vector<float> DATA2DRebin(sizeTimeLimit/timeIndexIncrementRebin*m_Nspectral);
-		    
-		    
-		    // Initialization of DATA2D Matrixes to 0 
-		    for (r=0;r<sizeTimeLimit*(spectralIndexStop-spectralIndexStart+1);r++){DATA_2D[r]=0;}
-		    for (r=0;r<sizeTimeLimit/timeIndexIncrementRebin*m_Nspectral;r++){DATA2DRebin[r]=0;}
-		    
-		    if (p==fracTime-1){if (nofLastElements > 0){DATA_2D.resize(nofLastElements * m_NspectralReal);}}
-		    
-				
-		    // reading the different Part Pxxx and store them in the matrix !!
-		    for (q=0;q<obsNofFrequencyBand;q++)
-			  {    
-			      int qbreak(0);
-			    
-			      pathFile 	= listOfFiles[mindex*obsNofStockes*obsNofFrequencyBand+q+l*obsNofFrequencyBand];			      
-			      				      
-			      pathFileSize=pathFile.length();
-			      int obsNameSize(obsName.length());
-			      string pathDir(pathFile.substr(0,pathFileSize-26-obsNameSize));
-			      
-			    
-			      string index_i1,index_j1,index_l1;	    
-			      std::ostringstream oss_i;oss_i << i;string index_i(oss_i.str());
-			      if (i<10){index_i1="_SAP00"+index_i;}
-			      if (i>=10 && i<100){index_i1="_SAP0"+index_i;}
-			      if (i>=100 && i<1000){index_i1="_SAP"+index_i;}
+      for (l=0;l<obsNofStockes;l++)
+	{
+	    for (q=0;q<obsNofFrequencyBand;q++)
+		  {    
+		      int tempmin(q*NOF_SUBBANDS_TEMP);
+		      int tempmax(q*NOF_SUBBANDS_TEMP+NOF_SUBBANDS_TEMP-1);
 		      
-			      std::ostringstream oss_j;oss_j << j;string index_j(oss_j.str()); 
-			      if (j<10){index_j1="_B00"+index_j;}
-			      if (j>=10 && i<100){index_j1="_B0"+index_j;}
-			      if (j>=100 && i<1000){index_j1="_B"+index_j;}
-			      
-			      std::ostringstream oss_q;oss_q << q;string index_q(oss_q.str()); 
-			      if (q<10){index_q1="_P00"+index_q;}
-			      if (q>=10 && i<100){index_q1="_P0"+index_q;}
-			      if (q>=100 && i<1000){index_q1="_P"+index_q;}   
-			    
-			      std::ostringstream oss_l;oss_l << l;string index_l(oss_l.str());
-			      index_l1 = "_S"+index_l+index_q1+"_bf.h5";
-			  
-
-			      //Load Stokes data		    
-			      pathFile = pathDir+obsName+index_i1+index_j1+index_l1;
-			      pathRaw =  pathDir+obsName+index_i1+index_j1+"_S"+index_l+index_q1+"_bf.raw";	
-			      
-			      
-			      int tempmin(q*NOF_SUBBANDS_TEMP);
-			      int tempmax(q*NOF_SUBBANDS_TEMP+NOF_SUBBANDS_TEMP-1);
-			      
-			      
-			      // Definition of data Matrix 2d Part
-			      vector<float> DATA2DPart(sizeTimeLimit*NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP);
-			      if (p==fracTime-1){if (nofLastElements > 0){DATA2DPart.resize(nofLastElements*NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP);}}
-			    
-			      
-			      
-			      if ((tempmax < index_fmin) && (tempmin < index_fmin))
-				{
-				 qbreak++;
-				}
-				 
-			      
-			      if ((tempmin > index_fmax) && (tempmax > index_fmax))
-				{
-				 qbreak++;
-				}
-				 				
-			      if (qbreak ==0)
-			      {
-				    
-				    if (is_readablePartionned(pathRaw)) 
-				      { 	
-										
-					BF_File file(pathFile);  							// generate an object called file contains Root
-					BF_SubArrayPointing SAP 		= file.subArrayPointing(i);		// generate an object called SAP contains subarray pointings
-					BF_BeamGroup BEAM			= SAP.beam(j);      			// generate an object called BEAM contains Beams				
-					BF_StokesDataset STOCKES 		= BEAM.stokes(l);					
-				      
-					
-					
-					////////////////////////////////////////////////////					
-					// if we take all data from the Partxxx
-					if ((tempmin >= index_fmin) && (tempmax <= index_fmax))
-					  {
-					    
-					    //Load 2D Stockes data in a 2D array DATA0 with DAL and stock data in DATA3D for writting (by time step)     					       
-					    vector<size_t> pos(2);
-					    pos[0]=p*sizeTimeLimit;
-					    pos[1]=0;
-					    
-					    vector<size_t> size(2);
-					    size[0] = sizeTimeLimit;	
-					    if (p==fracTime-1){if (nofLastElements > 0){size[0] = nofLastElements;}}				    					    
-					    size[1] = (NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP);					
-					    
-					    STOCKES.getMatrix( pos, &DATA2DPart[0], size );
-					    
-					    
-					    if (p==fracTime-1)
-					      {
-						if (nofLastElements > 0)
-						  {				    
-						    for (unsigned long int y=0; y<nofLastElements;y++)							      
-						      {
-							for (int z=0; z<NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP;z++)
-							  {
-							    DATA_2D[(qiterator*NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP)+squareAtStart+z+(spectralIndexStop-spectralIndexStart+1)*y] = DATA2DPart[y*(NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP-1)+z];	    
-							    
-							  }
-						      }
-						  }
-					      }
-					      else
-					      {
-						
-						    for (unsigned long int y=0; y<sizeTimeLimit;y++)					      						      
-						      {
-							for (int z=0; z<NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP;z++)
-							  {
-
-							    
-							    DATA_2D[(qiterator*NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP)+squareAtStart+z+(spectralIndexStop-spectralIndexStart+1)*y] = DATA2DPart[y*(NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP-1)+z];	    
-							    
-							  }
-						      }
-					      }					    
-					   
-					      qiterator++;
-					      
-					  } //end if tempmin >index_fmin && tempmax<index_fmax
-					  
-					  
-					  
-					  
-					//////////////////////////////////////////////////// 
-					// If take only the last portion of the Partxxx ( frequency minimum is in the middle of the Partxxx)
-					if ((tempmin < index_fmin) && (tempmax > index_fmin))
-					  {
-					    					    
-					    squareAtStart = ((tempmax-index_fmin+1)*CHANNELS_PER_SUBANDS_TEMP);
-					    
-					    
-					    DATA2DPart.resize(sizeTimeLimit*(tempmax-index_fmin+1)*CHANNELS_PER_SUBANDS_TEMP);
-					    if (p==fracTime-1){if (nofLastElements > 0){DATA2DPart.resize(nofLastElements*(tempmax-index_fmin+1)*CHANNELS_PER_SUBANDS_TEMP);}}
-					    
-					    
-					    vector<size_t> pos(2);
-					    pos[0]=p*sizeTimeLimit;
-					    pos[1]=(index_fmin-tempmin)*CHANNELS_PER_SUBANDS_TEMP;	
-					    
-					    vector<size_t> size(2);
-					    size[0] = sizeTimeLimit;
-					    if (p==fracTime-1){if (nofLastElements > 0){size[0] = nofLastElements;}}
-					    size[1] = (tempmax-index_fmin+1)*CHANNELS_PER_SUBANDS_TEMP;					
-					    
-					    STOCKES.getMatrix( pos, &DATA2DPart[0], size );
-					    
-					    
-					    if (p==fracTime-1)
-					      {
-						if (nofLastElements > 0)
-						  {				    
-						    for (unsigned long int y=0; y<nofLastElements;y++)							      
-						      {
-							for (int z=0; z<(tempmax-index_fmin+1)*CHANNELS_PER_SUBANDS_TEMP;z++)
-							  {
-							    DATA_2D[z+(spectralIndexStop-spectralIndexStart+1)*y] = DATA2DPart[y*((tempmax-index_fmin)*CHANNELS_PER_SUBANDS_TEMP-1)+z];	    
-							  }
-						      }
-						  }
-					      }
-					      else
-					      {
-						    for (unsigned long int y=0; y<sizeTimeLimit-1;y++)					      						      
-						      {
-							for (int z=0; z<(tempmax-index_fmin+1)*CHANNELS_PER_SUBANDS_TEMP-1;z++)
-							  {
-
-							    DATA_2D[z+(spectralIndexStop-spectralIndexStart+1)*y] = DATA2DPart[y*((tempmax-index_fmin)*CHANNELS_PER_SUBANDS_TEMP-1)+z];
-							  }
-						      }
-					      }
-						    
-						    
-						    
-					  } //end if tempmin >index_fmin && tempmax<index_fmax					    
-					    
-					 
-					 
-					 
-					////////////////////////////////////////////////////					 
-					// If take only the first on of the Partxxx ( frequency maximum is in the middle of the Partxxx)
-					if ((tempmin > index_fmin) && (tempmax > index_fmax))
-					  {					  
-					    DATA2DPart.resize(sizeTimeLimit*(index_fmax-tempmin+1)*CHANNELS_PER_SUBANDS_TEMP);
-					    if (p==fracTime-1){if (nofLastElements > 0){DATA2DPart.resize(nofLastElements*(index_fmax-tempmin+1)*CHANNELS_PER_SUBANDS_TEMP);}}
-					    					    
-					    vector<size_t> pos(2);
-					    pos[0]=p*sizeTimeLimit;
-					    pos[1]=0;	
-					    
-					    vector<size_t> size(2);
-					    size[0] = sizeTimeLimit;
-					    if (p==fracTime-1){if (nofLastElements > 0){size[0] = nofLastElements;}}
-					    size[1] = (index_fmax-tempmin+1)*CHANNELS_PER_SUBANDS_TEMP;					
-					    
-					    STOCKES.getMatrix( pos, &DATA2DPart[0], size );
-					    
-					    
-					    
-					    if (p==fracTime-1)
-					      {
-						if (nofLastElements > 0)
-						  {				    
-						    for (unsigned long int y=0; y<nofLastElements;y++)							      
-						      {
-							for (int z=0; z<(index_fmax-tempmin+1)*CHANNELS_PER_SUBANDS_TEMP;z++)
-							  {
-							    
-							    DATA_2D[(qiterator*NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP)+squareAtStart+z+(spectralIndexStop-spectralIndexStart+1)*y] = DATA2DPart[y*(index_fmax-tempmin)*CHANNELS_PER_SUBANDS_TEMP-1+z];	    
-							    
-							  }
-						      }
-						  }
-					      }
-					      else
-					      {
-						    for (unsigned long int y=0; y<sizeTimeLimit;y++)					      						      
-						      {
-							for (int z=0; z<(index_fmax-tempmin+1)*CHANNELS_PER_SUBANDS_TEMP;z++)
-							  {
-							    DATA_2D[(qiterator*NOF_SUBBANDS_TEMP*CHANNELS_PER_SUBANDS_TEMP)+squareAtStart+z+(spectralIndexStop-spectralIndexStart+1)*y] = DATA2DPart[y*(index_fmax-tempmin)*CHANNELS_PER_SUBANDS_TEMP-1+z];	    
-							    							    
-							  }
-						      }
-					      }						    
-
-					      
-					      
-					  } //end if tempmin >index_fmin && tempmax<index_fmax					    
-					   					 
-					   
-					
-					
-					
-				    } // end of if existing test
-				    else
-				    {
-				    Group process_histo_grp(dynspec_grp, "PROCESS_HISTORY");
-				    Attribute<string> missedData(process_histo_grp, "MISSED DATA");
-				    missedData.value = stokesComponent[l];
-				    cout << "RAW DATA are missing for SAP: " << i  << "  BEAM: " << j << " Stokes: " << l << " and Part: " << q << endl;
-				    cout << "  " << endl;       
-				    }// end of else existing test				      
-			      
-			      
-			      } // end of if qbreak =0
-
-			      
-			  } //end of loop on q 
-		
-
-			    if (p!=fracTime-1)
-			      {  
-
-				for (unsigned long int I=0;I<sizeTimeLimit/timeIndexIncrementRebin;I++)
-				  {
-				    for (unsigned long int J=0;J<m_Nspectral_longversion;J++)
-				      { 
-					float rebinPixel = 0;
-					for (unsigned long int K=0;K<timeIndexIncrementRebin;K++)
-					  {
-					    for (unsigned long int L=0;L<spectralIndexIncrementRebin;L++)
-					      {			
-						  
-						rebinPixel = rebinPixel+DATA_2D[L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1)];
-					      }
-					  }			    
-					DATA2DRebin[I*m_Nspectral+J] = rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);
-				      }
-				  }
-				
-
-				for (r=0;r<sizeTimeLimit/timeIndexIncrementRebin;r++)
-				  {
-				    for (n=0; n<m_Nspectral_longversion;n++)
-				      {		  	
-				       	if (l==0){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)]=DATA2DRebin[(r*m_Nspectral)+n];}
-					if (l==1){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA2DRebin[(r*m_Nspectral)+n];}
-					if (l==2){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA2DRebin[(r*m_Nspectral)+n];}
-					if (l==3){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA2DRebin[(r*m_Nspectral)+n];}
-					       
-				      }	  
-				  }
-
-			      }
- 			      
-			    else
-			      {
-				if (nofLastElements > 0)
-				  {		  
-				    				    
-				    for (unsigned long int I=0;I<nofLastElements/timeIndexIncrementRebin;I++)
-				      {
-					for (unsigned long int J=0;J<m_Nspectral_longversion;J++)
-					  { 
-					    float rebinPixel = 0;
-					    for (unsigned long int K=0;K<timeIndexIncrementRebin;K++)
-					      {
-						for (unsigned long int L=0;L<spectralIndexIncrementRebin;L++)
-						  {				  
-						    rebinPixel = rebinPixel+DATA_2D[L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1)];
-						  }
-					      }			    
-					    DATA2DRebin[I*m_Nspectral+J] = rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);
-					  }
-				      }		      
-    				     for (r=0;r<nofLastElements/timeIndexIncrementRebin;r++)
-    				  	{
-    				    	   for (n=0; n<m_Nspectral_longversion;n++)
-    				      	     {		  			  
-						  if (l==0){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)]=DATA2DRebin[(r*m_Nspectral)+n];}
-						  if (l==1){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA2DRebin[(r*m_Nspectral)+n];}
-						  if (l==2){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA2DRebin[(r*m_Nspectral)+n];}
-						  if (l==3){DATA_3D[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA2DRebin[(r*m_Nspectral)+n];}
-				      	     }	  
-    				  	}
-				  }
-				  
-				  
-			      } // end loop of else
- 
-
-			  		
-		}  //end loop on l (Stockes)// data are loaded in 3D array
-				
-			  
-
-		//Write data by time steps	
-		if (p!=fracTime-1)
-		  {	  
+		      // Partxxx outside the frequency selection
+		      if ((tempmax < index_fmin) || (tempmin > index_fmax)){continue;}
+		      
+		      pathFile 	= listOfFiles[mindex*obsNofStockes*obsNofFrequencyBand+q+l*obsNofFrequencyBand];			      
+		      
+		      pathFileSize=pathFile.length();
+		      int obsNameSize(obsName.length());
+		      string pathDir(pathFile.substr(0,pathFileSize-26-obsNameSize));
+		      
+		      std::ostringstream oss_q;oss_q << q;string index_q(oss_q.str()); 
+		      if (q<10){index_q1="_P00"+index_q;}
+		      if (q>=10 && i<100){index_q1="_P0"+index_q;}
+		      if (q>=100 && i<1000){index_q1="_P"+index_q;}   
 		    
-		    vector<size_t> data_grp_size(3);
-		    vector<size_t> data_grp_pos(3);
+		      std::ostringstream oss_l;oss_l << l;string index_l(oss_l.str());
 
-		    data_grp_pos[0] = p*sizeTimeLimit/timeIndexIncrementRebin;
-		    data_grp_pos[1] = 0;
-		    data_grp_pos[2] = 0;   	  
-		
-		    data_grp_size[0] = sizeTimeLimit/timeIndexIncrementRebin;
-		    data_grp_size[1] = m_Nspectral;
-		    data_grp_size[2] = obsNofStockes;
-		  
-
-		    data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
-
-		  }
-		else
-		  {	
-		    if (nofLastElements > 0)
-		      {
-			vector<size_t> data_grp_size(3);
-			vector<size_t> data_grp_pos(3);
-
-			data_grp_pos[0] = p*sizeTimeLimit/timeIndexIncrementRebin;
-			
-			data_grp_pos[1] = 0;
-			data_grp_pos[2] = 0;   	  
-		
-
-			if (  (m_Ntime-(p*sizeTimeLimit/timeIndexIncrementRebin)) == (nofLastElements/timeIndexIncrementRebin) )
+		      //Load Stokes data		    
+		      pathFile = pathDir+obsName+index_i1+index_j1+"_S"+index_l+index_q1+"_bf.h5";
+		      pathRaw =  pathDir+obsName+index_i1+index_j1+"_S"+index_l+index_q1+"_bf.raw";	
+		      
+		      if (is_readablePartionned(pathRaw)) 
 			{
-			
-			    data_grp_size[0] = (nofLastElements/timeIndexIncrementRebin);
-			    data_grp_size[1] = m_Nspectral;
-			    data_grp_size[2] = obsNofStockes;
-			    			    
-			    data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
+			  // subbands of the Partxxx in the frequency selection
+			  int firstSubband(max(tempmin,index_fmin));
+			  int lastSubband(min(tempmax,index_fmax));
+			  
+			  engine.addPart(l,pathFile,i,j,(firstSubband-tempmin)*CHANNELS_PER_SUBANDS_TEMP,(lastSubband-firstSubband+1)*CHANNELS_PER_SUBANDS_TEMP,(firstSubband-index_fmin)*CHANNELS_PER_SUBANDS_TEMP);
 			}
-			else
+		      else
 			{
-			    data_grp_size[0] = m_Ntime-(p*sizeTimeLimit/timeIndexIncrementRebin);
-			    data_grp_size[1] = m_Nspectral;
-			    data_grp_size[2] = obsNofStockes;
-			    			    
-			    data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
+			  Group process_histo_grp(dynspec_grp, "PROCESS_HISTORY");
+			  Attribute<string> missedData(process_histo_grp, "MISSED DATA");
+			  missedData.value = stokesComponent[l];
+			  cout << "RAW DATA are missing for SAP: " << i  << "  BEAM: " << j << " Stokes: " << l << " and Part: " << q << endl;
+			  cout << "  " << endl;       
 			}
-			
-		      }
-		  }    
+		  } //end of loop on q 
+	}
+
+
+	    //Schedule the time steps, then write them (missing Parts are set to 0)
+	    for (p=0;p<fracTime;p++)
+	      {
+		unsigned long int timePosition(p*sizeTimeLimit/timeIndexIncrementRebin);
+		unsigned long int nofRows(sizeTimeLimit/timeIndexIncrementRebin);
+		unsigned long int nofRowsWritten(nofRows);
+
+		if (p==fracTime-1)
+		  {
+		    if (nofLastElements == 0 || timePosition >= (unsigned long int)m_Ntime){break;}
+		    nofRows = nofLastElements/timeIndexIncrementRebin;
+		    nofRowsWritten = m_Ntime-timePosition;
+		  }
+
+		engine.addChunk(timePosition,nofRowsWritten,p*sizeTimeLimit+timeIndexStart,nofRows);
 	      
 	      } // end loop on p (time step)
+	      engine.setPyramid(&pyramid);	// the levels are written with each time step
+	      engine.writeChunks(data_grp);	// the next time step is loaded while the current one is rebinned and written
+	      pyramid.finish();
 	      
 	      	      
 	    //META-DATA in DATA  writter
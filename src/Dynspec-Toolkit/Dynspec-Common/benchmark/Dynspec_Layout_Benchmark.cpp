@@ -0,0 +1,193 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <hdf5.h>
+
+#include "Dynspec_Data_Layout.h"
+
+
+/// \file Dynspec_Layout_Benchmark.cpp
+///  \brief Benchmark of the ICD6's DATA layouts (Dynspec_Data_Layout): write throughput, file size and partial read speed
+///  \details
+/// <br /> Usage: Dynspec_Layout_Benchmark [Output-DIR (default: /tmp/)] [NofTime (default: 16384)] [NofSpectral (default: 2048)] [NofStokes (default: 4)] [Layout ...]
+/// <br /> A synthetic dynamic spectrum (bandpass, noise, RFI channels and a burst) is written by time steps of 4096 time bins,
+/// as the Dynspec writers do, for each layout (default: a set of representative layouts). The file is then flushed and dropped
+/// from the page cache, and read back with 3 selections: a time window (256 time bins, all frequencies), a frequency band
+/// (64 frequency bins, all times) and a tile (256 time bins x 64 frequency bins). The largest read error is given for the lossy types.
+
+
+using namespace std;
+
+
+static double now()
+{
+  struct timeval t;
+  gettimeofday(&t,NULL);
+  return t.tv_sec+1E-6*t.tv_usec;
+}
+
+// drop the file from the page cache, so the reads come from the disk
+static void dropCache(string path)
+{
+  int fd = open(path.c_str(),O_RDONLY);
+  if (fd < 0){return;}
+  fdatasync(fd);
+  posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// read a [time][frequency][Stokes] box, return the time in s and the largest difference with the source
+static double readBox(hid_t dataset, const vector<float> &source, unsigned long int nofSpectral, int nofStokes,
+		      unsigned long int time0, unsigned long int nofTime, unsigned long int spectral0, unsigned long int nofBox, float &error)
+{
+  vector<hsize_t> pos(3),size(3);
+  pos[0] = time0;pos[1] = spectral0;pos[2] = 0;
+  size[0] = nofTime;size[1] = nofBox;size[2] = nofStokes;
+
+  vector<float> box(nofTime*nofBox*nofStokes);
+  double start(now());
+  hid_t space = H5Dget_space(dataset);
+  H5Sselect_hyperslab(space,H5S_SELECT_SET,&pos[0],NULL,&size[0],NULL);
+  hid_t memory = H5Screate_simple(3,&size[0],NULL);
+  H5Dread(dataset,H5T_NATIVE_FLOAT,memory,space,H5P_DEFAULT,&box[0]);
+  H5Sclose(memory);
+  H5Sclose(space);
+  double seconds(now()-start);
+
+  for (unsigned long int I=0;I<nofTime;I++)
+    {
+      for (unsigned long int J=0;J<nofBox;J++)
+	{
+	  for (int l=0;l<nofStokes;l++)
+	    {
+	      float value(source[((time0+I)*nofSpectral+spectral0+J)*nofStokes+l]);
+	      float difference(fabs(box[(I*nofBox+J)*nofStokes+l]-value)/max(fabs(value),1.0f));
+	      if (difference > error){error = difference;}
+	    }
+	}
+    }
+  return seconds;
+}
+
+
+int main(int argc, char *argv[])
+{
+  string outputDir((argc > 1) ? argv[1] : "/tmp/");
+  unsigned long int nofTime((argc > 2) ? atol(argv[2]) : 16384);
+  unsigned long int nofSpectral((argc > 3) ? atol(argv[3]) : 2048);
+  int nofStokes((argc > 4) ? atoi(argv[4]) : 4);
+  unsigned long int timeStep(4096);
+
+  vector<string> layouts;
+  for (int i=5;i<argc;i++){layouts.push_back(argv[i]);}
+  if (layouts.empty())
+    {
+      layouts.push_back("chunk=contiguous,filter=none");
+      layouts.push_back("");
+      layouts.push_back("filter=deflate:1");
+      layouts.push_back("filter=deflate:4");
+      layouts.push_back("filter=deflate:1,shuffle=no");
+      layouts.push_back("filter=lzf");
+      layouts.push_back("filter=blosc");
+      layouts.push_back("type=float16,filter=deflate");
+      layouts.push_back("type=scaled:2,filter=deflate");
+      layouts.push_back("chunk=64x2048");
+      layouts.push_back("chunk=4096x32");
+    }
+
+  // synthetic dynamic spectrum: bandpass x (1 + noise), a few RFI channels, a dispersed burst
+  vector<float> source(nofTime*nofSpectral*nofStokes);
+  unsigned int seed(12345);
+  for (unsigned long int I=0;I<nofTime;I++)
+    {
+      for (unsigned long int J=0;J<nofSpectral;J++)
+	{
+	  float bandpass(1E6*(1.0+0.5*sin(3.0*J/nofSpectral))*exp(-pow((J-0.5*nofSpectral)/(0.6*nofSpectral),2.0)));
+	  float rfi((J%397 == 13) ? 5.0 : 1.0);
+	  float burst((labs((long int)I-(long int)(nofTime/2)-(long int)(J/4)) < 3) ? 1.5 : 1.0);
+	  for (int l=0;l<nofStokes;l++)
+	    {
+	      // sum of 4 uniforms ~ gaussian noise of 5 %
+	      float noise(0);
+	      for (int n=0;n<4;n++){seed = seed*1103515245+12345;noise += ((seed>>8)&0xFFFF)/65536.0-0.5;}
+	      float level((l == 0) ? 1.0 : 0.05);
+	      source[(I*nofSpectral+J)*nofStokes+l] = bandpass*rfi*burst*level*(1.0+0.05*noise*1.7);
+	    }
+	}
+    }
+  double megaBytes(source.size()*sizeof(float)/1E6);
+  cout << "DATA: " << nofTime << " x " << nofSpectral << " x " << nofStokes << " (" << megaBytes << " Mo), time steps of " << timeStep << endl;
+  printf("%-50s %9s %8s %10s %10s %10s %10s %9s\n","layout","write Mo/s","ratio","time ms","band ms","tile ms","full ms","max error");
+
+  for (unsigned int k=0;k<layouts.size();k++)
+    {
+      try
+	{
+	  Dynspec_Data_Layout layout(layouts[k]);
+	  string path(outputDir+"Dynspec_Layout_Benchmark.h5");
+
+	  // write by time steps, as the writers
+	  double start(now());
+	  hid_t file = H5Fcreate(path.c_str(),H5F_ACC_TRUNC,H5P_DEFAULT,H5P_DEFAULT);
+	  hid_t group = H5Gcreate2(file,"DYNSPEC_000",H5P_DEFAULT,H5P_DEFAULT,H5P_DEFAULT);
+	  hid_t dataset = layout.createData(group,"DATA",nofTime,nofSpectral,nofStokes);
+	  for (unsigned long int p=0;p<nofTime;p+=timeStep)
+	    {
+	      vector<hsize_t> pos(3),size(3);
+	      pos[0] = p;pos[1] = 0;pos[2] = 0;
+	      size[0] = min(timeStep,nofTime-p);size[1] = nofSpectral;size[2] = nofStokes;
+	      hid_t space = H5Dget_space(dataset);
+	      H5Sselect_hyperslab(space,H5S_SELECT_SET,&pos[0],NULL,&size[0],NULL);
+	      hid_t memory = H5Screate_simple(3,&size[0],NULL);
+	      H5Dwrite(dataset,H5T_NATIVE_FLOAT,memory,space,H5P_DEFAULT,&source[p*nofSpectral*nofStokes]);
+	      H5Sclose(memory);
+	      H5Sclose(space);
+	    }
+	  H5Dclose(dataset);
+	  H5Gclose(group);
+	  H5Fclose(file);
+	  dropCache(path);
+	  double writeSeconds(now()-start);
+
+	  struct stat info;
+	  stat(path.c_str(),&info);
+
+	  // partial reads, each on a file just opened and out of the page cache
+	  double seconds[4] = {0,0,0,0};
+	  float error(0);
+	  for (int r=0;r<4;r++)
+	    {
+	      dropCache(path);
+	      file = H5Fopen(path.c_str(),H5F_ACC_RDONLY,H5P_DEFAULT);
+	      dataset = H5Dopen2(file,"DYNSPEC_000/DATA",H5P_DEFAULT);
+	      if (r == 0){seconds[r] = readBox(dataset,source,nofSpectral,nofStokes,nofTime/3,256,0,nofSpectral,error);}
+	      if (r == 1){seconds[r] = readBox(dataset,source,nofSpectral,nofStokes,0,nofTime,nofSpectral/3,64,error);}
+	      if (r == 2){seconds[r] = readBox(dataset,source,nofSpectral,nofStokes,nofTime/3,256,nofSpectral/3,64,error);}
+	      if (r == 3){seconds[r] = readBox(dataset,source,nofSpectral,nofStokes,0,nofTime,0,nofSpectral,error);}
+	      H5Dclose(dataset);
+	      H5Fclose(file);
+	    }
+
+	  string name(layouts[k].empty() ? "(default) "+layout.description() : layout.description());
+	  printf("%-50s %9.0f %8.2f %10.1f %10.1f %10.1f %10.1f %9.2g\n",name.c_str(),megaBytes/writeSeconds,
+		 (double)source.size()*sizeof(float)/info.st_size,1E3*seconds[0],1E3*seconds[1],1E3*seconds[2],1E3*seconds[3],error);
+	  remove(path.c_str());
+	}
+      catch (exception &e)
+	{
+	  cout << layouts[k] << ": " << e.what() << endl;
+	}
+    }
+
+  return 0;
+}
@@ -0,0 +1,339 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+
+#include "Dynspec_Data_Layout.h"
+
+
+/// \file Dynspec_Data_Layout.cpp
+///  \brief File C++ (associated to Dynspec_Data_Layout.h) for creating the ICD6's DATA dataset with a chunked and compressed HDF5 layout
+///  \details
+/// <br /> Overview:
+/// <br /> DATA is [time][frequency][Stokes]. The chunks are tiles of a few hundred time bins by a few hundred frequency bins (all
+/// Stokes), so that a reader which selects a time window or a frequency band only reads and decompresses the tiles it needs.
+/// The writers fill DATA by time steps of many time bins, so every tile is written entirely by one or two setMatrix.
+
+
+using namespace std;
+
+
+// HDF5 filters registered for the plugins (see https://support.hdfgroup.org/services/contributions.html)
+static const H5Z_filter_t FILTER_LZF(32000);
+static const H5Z_filter_t FILTER_BLOSC(32001);
+
+// Size of the automatic chunks
+static const unsigned long int CHUNK_BYTES(1<<20);
+static const unsigned long int CHUNK_SPECTRAL(256);
+
+
+// float to IEEE half precision, rounded to the nearest (even): the soft conversion of HDF5 1.10 doesn't carry the rounding
+// into the exponent (1.9997 is written 1), so this conversion is registered for the float16 storage
+static unsigned short floatToHalf(float value)
+{
+  unsigned int x;
+  memcpy(&x,&value,sizeof(x));
+  unsigned int sign((x>>16) & 0x8000);
+  unsigned int absolute(x & 0x7FFFFFFF);
+
+  if (absolute >= 0x7F800000){return sign | 0x7C00 | ((absolute > 0x7F800000) ? 0x200 : 0);}	// inf, nan
+  if (absolute >= 0x477FF000){return sign | 0x7C00;}						// rounded above 65504
+  if (absolute < 0x38800000)
+    {
+      // subnormal half
+      if (absolute < 0x33000000){return sign;}
+      unsigned int exponent(absolute>>23);
+      unsigned int mantissa((absolute & 0x7FFFFF) | 0x800000);
+      unsigned int shift(126-exponent);
+      unsigned int half(mantissa>>shift);
+      unsigned int rest(mantissa & ((1u<<shift)-1));
+      unsigned int halfway(1u<<(shift-1));
+      if (rest > halfway || (rest == halfway && (half & 1))){half++;}
+      return sign | half;
+    }
+
+  unsigned int half((absolute-0x38000000)>>13);
+  unsigned int rest(absolute & 0x1FFF);
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))){half++;}
+  return sign | half;
+}
+
+static herr_t convertFloatToHalf(hid_t src_id, hid_t dst_id, H5T_cdata_t *cdata, size_t nelmts, size_t buf_stride, size_t, void *buf, void *, hid_t)
+{
+  if (cdata->command == H5T_CONV_INIT)
+    {
+      cdata->need_bkg = H5T_BKG_NO;
+      return (H5Tget_size(src_id) == sizeof(float) && H5Tget_size(dst_id) == 2) ? 0 : -1;
+    }
+  if (cdata->command != H5T_CONV_CONV){return 0;}
+
+  // in place: the half i is written over bytes of the floats already read
+  unsigned char *data = (unsigned char*)buf;
+  size_t srcStride(buf_stride ? buf_stride : sizeof(float));
+  size_t dstStride(buf_stride ? buf_stride : 2);
+  for (size_t i=0;i<nelmts;i++)
+    {
+      float value;
+      memcpy(&value,data+i*srcStride,sizeof(float));
+      unsigned short half(floatToHalf(value));
+      data[i*dstStride] = half & 0xFF;
+      data[i*dstStride+1] = half>>8;
+    }
+  return 0;
+}
+
+
+  Dynspec_Data_Layout::Dynspec_Data_Layout(string option)
+  {
+  /// <br /> Usage:
+  /// <br />   Dynspec_Data_Layout::Dynspec_Data_Layout(string option)
+  /// \param   option comma separated list of key=value (see Dynspec_Data_Layout.h), empty for the default layout
+
+    m_contiguous = false;
+    m_chunkTime = 0;
+    m_chunkSpectral = 0;
+    m_chunkStokes = 0;
+    m_filter = NONE;
+    m_level = 1;
+    m_shuffle = true;
+    m_storage = FLOAT32;
+    m_digits = 3;
+    m_pyramidLevels = -1;
+
+    stringstream options(option);
+    string item;
+    while (getline(options,item,','))
+      {
+	if (item.empty()){continue;}
+
+	size_t equal(item.find('='));
+	if (equal == string::npos){throw runtime_error("Dynspec_Data_Layout: option "+item+" is not key=value");}
+	string key(item.substr(0,equal));
+	string value(item.substr(equal+1));
+	string argument;
+	size_t colon(value.find(':'));
+	if (colon != string::npos)
+	  {
+	    argument = value.substr(colon+1);
+	    value = value.substr(0,colon);
+	  }
+
+	if (key == "chunk")
+	  {
+	    if (value == "contiguous"){m_contiguous = true;}
+	    else
+	      {
+		// TIMExFREQUENCY[xSTOKES]
+		replace(value.begin(),value.end(),'x',' ');
+		stringstream shape(value);
+		m_chunkTime = 0;m_chunkSpectral = 0;m_chunkStokes = 0;
+		shape >> m_chunkTime >> m_chunkSpectral >> m_chunkStokes;
+	      }
+	  }
+	else if (key == "filter")
+	  {
+	    if (value == "none"){m_filter = NONE;}
+	    else if (value == "deflate"){m_filter = DEFLATE;m_level = 1;}
+	    else if (value == "lzf"){m_filter = LZF;}
+	    else if (value == "blosc"){m_filter = BLOSC;m_level = 5;}
+	    else {throw runtime_error("Dynspec_Data_Layout: unknown filter "+value);}
+	    if (!argument.empty()){m_level = atoi(argument.c_str());}
+	  }
+	else if (key == "shuffle")
+	  {
+	    m_shuffle = (value == "yes" || value == "1");
+	  }
+	else if (key == "type")
+	  {
+	    if (value == "float32"){m_storage = FLOAT32;}
+	    else if (value == "float16"){m_storage = FLOAT16;}
+	    else if (value == "scaled"){m_storage = SCALED;}
+	    else {throw runtime_error("Dynspec_Data_Layout: unknown type "+value);}
+	    if (!argument.empty()){m_digits = atoi(argument.c_str());}
+	  }
+	else if (key == "pyramid")
+	  {
+	    if (value == "auto"){m_pyramidLevels = -1;}
+	    else if (value == "none" || value == "no"){m_pyramidLevels = 0;}
+	    else if (value.find_first_not_of("0123456789") == string::npos){m_pyramidLevels = atoi(value.c_str());}
+	    else {throw runtime_error("Dynspec_Data_Layout: unknown pyramid "+value);}
+	  }
+	else
+	  {
+	    throw runtime_error("Dynspec_Data_Layout: unknown option "+key);
+	  }
+      }
+  }
+
+
+  vector<hsize_t> Dynspec_Data_Layout::chunkShape(unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes) const
+  {
+  /// <br /> Usage:
+  /// <br />   vector<hsize_t> Dynspec_Data_Layout::chunkShape(unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes) const
+  /// \param   nofTime, nofSpectral, nofStokes dimensions of DATA
+  /// \return  chunk dimensions (clamped to the dimensions of DATA)
+
+    vector<hsize_t> chunk(3);
+    chunk[2] = (m_chunkStokes > 0) ? m_chunkStokes : nofStokes;
+    chunk[1] = (m_chunkSpectral > 0) ? m_chunkSpectral : CHUNK_SPECTRAL;
+    chunk[2] = max<hsize_t>(1,min<hsize_t>(chunk[2],nofStokes));
+    chunk[1] = max<hsize_t>(1,min<hsize_t>(chunk[1],nofSpectral));
+    if (m_chunkSpectral == 0 && nofSpectral > 0)
+      {
+	// the same number of tiles, of equal size (no tile almost empty at the end of the band)
+	hsize_t nofTiles((nofSpectral+chunk[1]-1)/chunk[1]);
+	chunk[1] = (nofSpectral+nofTiles-1)/nofTiles;
+      }
+
+    chunk[0] = m_chunkTime;
+    if (chunk[0] == 0){chunk[0] = max<hsize_t>(1,CHUNK_BYTES/(sizeof(float)*chunk[1]*chunk[2]));}
+    chunk[0] = max<hsize_t>(1,min<hsize_t>(chunk[0],nofTime));
+    if (m_chunkTime == 0 && nofTime > 0)
+      {
+	hsize_t nofTiles((nofTime+chunk[0]-1)/chunk[0]);
+	chunk[0] = (nofTime+nofTiles-1)/nofTiles;
+      }
+
+    return chunk;
+  }
+
+
+  hid_t Dynspec_Data_Layout::createData(hid_t dynspec_grp, string name, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes) const
+  {
+  /// <br /> Usage:
+  /// <br />   hid_t Dynspec_Data_Layout::createData(hid_t dynspec_grp, string name, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes) const
+  /// \param   dynspec_grp HDF5 group of the dynamic spectrum
+  /// \param   name name of the dataset (DATA)
+  /// \param   nofTime, nofSpectral, nofStokes dimensions of DATA
+  /// \return  HDF5 dataset (to be closed by the caller)
+
+    vector<hsize_t> dimensions(3);
+    dimensions[0] = nofTime;
+    dimensions[1] = nofSpectral;
+    dimensions[2] = nofStokes;
+    hid_t space = H5Screate_simple(3,&dimensions[0],NULL);
+
+    // storage type: the values are converted by HDF5 when they are written and read
+    hid_t type = H5Tcopy(H5T_IEEE_F32LE);
+    if (m_storage == FLOAT16)
+      {
+	H5Tset_fields(type,15,10,5,0,10);
+	H5Tset_size(type,2);
+	H5Tset_ebias(type,15);
+	H5Tset_precision(type,16);
+
+	static bool registered(false);
+	if (!registered)
+	  {
+	    H5Tregister(H5T_PERS_HARD,"Dynspec_float_to_half",H5T_NATIVE_FLOAT,type,convertFloatToHalf);
+	    registered = true;
+	  }
+      }
+
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    if (!m_contiguous && nofTime > 0 && nofSpectral > 0 && nofStokes > 0)
+      {
+	vector<hsize_t> chunk(chunkShape(nofTime,nofSpectral,nofStokes));
+	H5Pset_chunk(dcpl,3,&chunk[0]);
+
+	if (m_storage == SCALED){H5Pset_scaleoffset(dcpl,H5Z_SO_FLOAT_DSCALE,m_digits);}
+
+	Filter filter(m_filter);
+	if ((filter == LZF && H5Zfilter_avail(FILTER_LZF) <= 0) || (filter == BLOSC && H5Zfilter_avail(FILTER_BLOSC) <= 0))
+	  {
+	    cout << "Dynspec_Data_Layout: " << (filter == LZF ? "lzf" : "blosc") << " filter is not installed, deflate is used" << endl;
+	    filter = DEFLATE;
+	  }
+
+	if (filter == BLOSC)
+	  {
+	    // blosc shuffles itself: cd_values 0-3 are filled by the filter, then level, shuffle, compressor (blosclz)
+	    unsigned int cd_values[7] = {0,0,0,0,(unsigned int)m_level,m_shuffle ? 1u : 0u,0};
+	    H5Pset_filter(dcpl,FILTER_BLOSC,H5Z_FLAG_OPTIONAL,7,cd_values);
+	  }
+	else if (filter != NONE)
+	  {
+	    if (m_shuffle){H5Pset_shuffle(dcpl);}
+	    if (filter == DEFLATE){H5Pset_deflate(dcpl,m_level);}
+	    else {H5Pset_filter(dcpl,FILTER_LZF,H5Z_FLAG_OPTIONAL,0,NULL);}
+	  }
+      }
+
+    hid_t dataset = H5Dcreate2(dynspec_grp,name.c_str(),type,space,H5P_DEFAULT,dcpl,H5P_DEFAULT);
+
+    H5Pclose(dcpl);
+    H5Tclose(type);
+    H5Sclose(space);
+
+    if (dataset < 0){throw runtime_error("Dynspec_Data_Layout: cannot create "+name+" ("+description()+")");}
+    return dataset;
+  }
+
+  void Dynspec_Data_Layout::createData(string outputFile, string dynspecName, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, string name) const
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Data_Layout::createData(string outputFile, string dynspecName, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, string name) const
+  /// \param   outputFile ICD6 file (already opened by the writer: HDF5 shares the open file)
+  /// \param   dynspecName dynamic spectrum group (DYNSPEC_xxx, or a path in it as DYNSPEC_xxx/PYRAMID), the dataset is created in it
+  /// \param   nofTime, nofSpectral, nofStokes dimensions of the dataset
+  /// \param   name name of the dataset (default: DATA)
+
+    hid_t file = H5Fopen(outputFile.c_str(),H5F_ACC_RDWR,H5P_DEFAULT);
+    if (file < 0){throw runtime_error("Dynspec_Data_Layout: cannot open "+outputFile);}
+
+    hid_t group = H5Gopen2(file,dynspecName.c_str(),H5P_DEFAULT);
+    if (group < 0)
+      {
+	H5Fclose(file);
+	throw runtime_error("Dynspec_Data_Layout: no group "+dynspecName+" in "+outputFile);
+      }
+
+    try
+      {
+	H5Dclose(createData(group,name,nofTime,nofSpectral,nofStokes));
+      }
+    catch (...)
+      {
+	H5Gclose(group);
+	H5Fclose(file);
+	throw;
+      }
+
+    H5Gclose(group);
+    H5Fclose(file);
+  }
+
+
+  string Dynspec_Data_Layout::description() const
+  {
+    /// \return layout as an option string
+    ostringstream description;
+
+    if (m_contiguous){description << "chunk=contiguous";}
+    else {description << "chunk=" << m_chunkTime << "x" << m_chunkSpectral << "x" << m_chunkStokes;}
+
+    const char *filters[4] = {"none","deflate","lzf","blosc"};
+    description << ",filter=" << filters[m_filter];
+    if (m_filter == DEFLATE || m_filter == BLOSC){description << ":" << m_level;}
+    description << ",shuffle=" << (m_shuffle ? "yes" : "no");
+
+    const char *storages[3] = {"float32","float16","scaled"};
+    description << ",type=" << storages[m_storage];
+    if (m_storage == SCALED){description << ":" << m_digits;}
+
+    description << ",pyramid=";
+    if (m_pyramidLevels < 0){description << "auto";}
+    else if (m_pyramidLevels == 0){description << "none";}
+    else {description << m_pyramidLevels;}
+
+    return description.str();
+  }
+
+  int Dynspec_Data_Layout::pyramidLevels() const
+  {
+    /// \return number of pyramid levels asked (-1: automatic, 0: no pyramid; c.f Dynspec_Pyramid)
+    return m_pyramidLevels;
+  }
@@ -0,0 +1,78 @@
+#ifndef DEF_DYNSPEC_DATA_LAYOUT
+#define DEF_DYNSPEC_DATA_LAYOUT
+
+#include<string>
+#include<iostream>
+#include<vector>
+
+#include <hdf5.h>
+
+
+/// \class Dynspec_Data_Layout
+///  \brief Class object for creating the ICD6's DATA dataset with a chunked and compressed HDF5 layout
+///  \details
+/// <br /> Usage:
+/// <br /> This class is shared by the Complete, Rebin (Part and Partionned) and Quicklook writers of Dynspec-CEP2 and Dynspec-Standalone,
+/// so that the DATA of all ICD6 files have the same layout by default. The layout is given by an option string (last argument of
+/// the programs), a comma separated list of key=value, for example "chunk=512x128,filter=deflate:4,type=float16":
+/// <br />   chunk=contiguous | chunk=TIMExFREQUENCY[xSTOKES]  (0 or missing: automatic, tiles of about 1 Mo with about 256 frequency bins and all Stokes)
+/// <br />   filter=none | deflate[:level] | lzf | blosc[:level]  (lzf and blosc are HDF5 plugins: deflate is used if they are not installed)
+/// <br />   shuffle=yes | no  (byte shuffle before the compression)
+/// <br />   type=float32 | float16 | scaled[:digits]  (float16 overflows above 65504: for normalized data only;
+/// scaled: HDF5 scale-offset filter, values rounded to 10^-digits)
+/// <br />   pyramid=auto | none | LEVELS  (decimated copies of DATA by 2, 4, 8... in time and frequency, c.f Dynspec_Pyramid)
+/// <br /> The default is "chunk=0x0,filter=none,type=float32,pyramid=auto": the chunks alone make the partial reads fast, while the compression
+/// of noisy dynamic spectra gains little (about 1.4 with shuffle+deflate) for a much slower writing (see benchmark/).
+/// Readers need nothing more than HDF5 (and the plugin for lzf or blosc): the data are converted back to float when they are read.
+/// <br /> createData creates the dataset with the HDF5 C API; the writers then open it with dal::Dataset<float> as before.
+
+
+class Dynspec_Data_Layout
+{
+  // Public Methods
+  public:
+
+    /// Compression filter of the chunks
+    enum Filter
+    {
+      NONE,
+      DEFLATE,		///< gzip (built in HDF5)
+      LZF,		///< LZF plugin (HDF5 filter 32000)
+      BLOSC		///< Blosc plugin (HDF5 filter 32001)
+    };
+
+    /// Storage type of the values in the file
+    enum Storage
+    {
+      FLOAT32,		///< no loss
+      FLOAT16,		///< IEEE half precision (11 significant bits)
+      SCALED		///< scale-offset filter: values rounded to 10^-digits and packed on the bits needed by each chunk
+    };
+
+    Dynspec_Data_Layout(std::string option="");
+
+    std::vector<hsize_t> chunkShape(unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes) const;
+
+    hid_t createData(hid_t dynspec_grp, std::string name, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes) const;
+    void createData(std::string outputFile, std::string dynspecName, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, std::string name="DATA") const;
+
+    std::string description() const;
+    int pyramidLevels() const;
+
+
+  // Private Attributes
+  private:
+
+    bool m_contiguous;
+    unsigned long int m_chunkTime;		///< 0: automatic
+    unsigned long int m_chunkSpectral;	///< 0: automatic
+    int m_chunkStokes;			///< 0: all Stokes
+    Filter m_filter;
+    int m_level;
+    bool m_shuffle;
+    Storage m_storage;
+    int m_digits;
+    int m_pyramidLevels;			///< -1: automatic, 0: no pyramid
+};
+
+#endif
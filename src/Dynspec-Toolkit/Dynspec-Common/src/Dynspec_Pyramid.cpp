@@ -0,0 +1,468 @@
+#include <iostream>
+#include <string>
+#include <sstream>
+#include <algorithm>
+
+#include "Dynspec_Pyramid.h"
+
+#include <dal/lofar/BF_File.h>
+
+
+/// \file Dynspec_Pyramid.cpp
+///  \brief File C++ (associated to Dynspec_Pyramid.h) for building the multi-resolution pyramid of the ICD6's DATA and reading it back
+///  \details
+/// <br /> Overview:
+/// <br /> Each level keeps at most one row in memory (the first row of a time pair) and one block of rows: the time step given
+/// to addRows is decimated level by level and each level writes its new rows with one setMatrix. Writing all levels costs
+/// about a third of DATA (1/4 + 1/16 + ...), so a quicklook at a coarser resolution no longer reprocesses the ICD3 data.
+
+
+using namespace dal;
+using namespace std;
+
+
+// a dimension is no longer halved at or below PYRAMID_MIN_BINS, the automatic pyramid stops at PYRAMID_TOP_BINS
+static const unsigned long int PYRAMID_MIN_BINS(64);
+static const unsigned long int PYRAMID_TOP_BINS(1024);
+static const int PYRAMID_MAX_LEVELS(16);
+
+
+static string levelName(int k)
+{
+  ostringstream name;
+  name << "LEVEL_" << k;
+  return name.str();
+}
+
+// read a whole [time][frequency][Stokes] dataset
+static void readDataset(Dataset<float> &data, vector<float> &DATA_3D, vector<size_t> &dimensions)
+{
+  vector<ssize_t> dims(data.dims());
+  dimensions.assign(3,0);
+  for (unsigned int n=0;n<dims.size() && n<3;n++){dimensions[n] = dims[n];}
+
+  DATA_3D.resize(dimensions[0]*dimensions[1]*dimensions[2]);
+  if (DATA_3D.empty()){return;}
+
+  vector<size_t> data_pos(3,0);
+  data.getMatrix(data_pos,&DATA_3D[0],dimensions);
+}
+
+// mean of the frequencies of each group of spectralRebin bins
+static vector<double> rebinAxis(const vector<double> &AXIS_VALUE_WORLD, unsigned long int spectralRebin)
+{
+  vector<double> axis((AXIS_VALUE_WORLD.size()+spectralRebin-1)/spectralRebin,0);
+  for (unsigned long int J=0;J<axis.size();J++)
+    {
+      unsigned long int start(J*spectralRebin);
+      unsigned long int stop(min<unsigned long int>(start+spectralRebin,AXIS_VALUE_WORLD.size()));
+      for (unsigned long int j=start;j<stop;j++){axis[J] += AXIS_VALUE_WORLD[j];}
+      axis[J] /= (stop-start);
+    }
+  return axis;
+}
+
+
+  Dynspec_Pyramid::Dynspec_Pyramid(unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, int nofLevels)
+  {
+  /// <br /> Usage:
+  /// <br />   Dynspec_Pyramid::Dynspec_Pyramid(unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, int nofLevels)
+  /// \param   nofTime, nofSpectral, nofStokes dimensions of DATA
+  /// \param   nofLevels number of levels (-1: automatic, 0: no pyramid; Dynspec_Data_Layout::pyramidLevels)
+
+    m_nofStokes = nofStokes;
+    m_pyramid_grp = NULL;
+
+    Level level;
+    level.nofTime = nofTime;
+    level.nofSpectral = nofSpectral;
+    level.halveTime = false;
+    level.halveSpectral = false;
+    level.timeFactor = 1;
+    level.spectralFactor = 1;
+    level.data = NULL;
+    level.hasPending = false;
+    level.nofWritten = 0;
+    m_levels.push_back(level);
+
+    int maxLevels((nofLevels < 0) ? PYRAMID_MAX_LEVELS : min(nofLevels,PYRAMID_MAX_LEVELS));
+    while ((int)m_levels.size() <= maxLevels && nofStokes > 0)
+      {
+	Level below(m_levels.back());
+	if (nofLevels < 0 && below.nofTime <= PYRAMID_TOP_BINS && below.nofSpectral <= PYRAMID_TOP_BINS){break;}
+
+	level = below;
+	level.halveTime = (below.nofTime > PYRAMID_MIN_BINS);
+	level.halveSpectral = (below.nofSpectral > PYRAMID_MIN_BINS);
+	if (!level.halveTime && !level.halveSpectral){break;}
+
+	if (level.halveTime){level.nofTime = (below.nofTime+1)/2;level.timeFactor *= 2;}
+	if (level.halveSpectral){level.nofSpectral = (below.nofSpectral+1)/2;level.spectralFactor *= 2;}
+	m_levels.push_back(level);
+      }
+  }
+
+  Dynspec_Pyramid::~Dynspec_Pyramid()
+  {
+    for (unsigned int k=1;k<m_levels.size();k++){delete m_levels[k].data;}
+    delete m_pyramid_grp;
+  }
+
+
+  int Dynspec_Pyramid::nofLevels() const
+  {
+    /// \return number of levels (without DATA)
+    return m_levels.size()-1;
+  }
+
+  unsigned long int Dynspec_Pyramid::nofTime(int level) const
+  {
+    /// \return number of time bins of the level (0: DATA)
+    return m_levels[level].nofTime;
+  }
+
+  unsigned long int Dynspec_Pyramid::nofSpectral(int level) const
+  {
+    /// \return number of frequency bins of the level (0: DATA)
+    return m_levels[level].nofSpectral;
+  }
+
+
+  void Dynspec_Pyramid::create(Group &dynspec_grp, string outputFile, string dynspecName, const Dynspec_Data_Layout &dataLayout)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Pyramid::create(Group &dynspec_grp, string outputFile, string dynspecName, const Dynspec_Data_Layout &dataLayout)
+  /// \param   &dynspec_grp Group Object(Dynamic spectrum object), its COORDINATES are already written
+  /// \param   outputFile output file
+  /// \param   dynspecName dynamic spectrum group (DYNSPEC_xxx)
+  /// \param   dataLayout chunks, compression and storage type of the levels (the same as DATA)
+
+    if (nofLevels() == 0){return;}
+
+    // time increment and frequencies of DATA
+    Group coords_grp(dynspec_grp, "COORDINATES");
+    Group time_grp(coords_grp, "TIME");
+    Group spectral_grp(coords_grp, "SPECTRAL");
+
+    double timeIncrement(0);
+    Attribute< vector<double> > obj_INCREMENT_TIME(time_grp, "INCREMENT");
+    if (obj_INCREMENT_TIME.exists())
+      {
+	vector<double> INCREMENT_TIME(obj_INCREMENT_TIME.value);
+	if (!INCREMENT_TIME.empty()){timeIncrement = INCREMENT_TIME[0];}
+      }
+
+    vector<double> AXIS_VALUE_WORLD_SPECTRAL;
+    Attribute< vector<double> > obj_AXIS_VALUE_WORLD_SPECTRAL(spectral_grp, "AXIS_VALUE_WORLD");
+    if (obj_AXIS_VALUE_WORLD_SPECTRAL.exists()){AXIS_VALUE_WORLD_SPECTRAL = obj_AXIS_VALUE_WORLD_SPECTRAL.value;}
+    if (AXIS_VALUE_WORLD_SPECTRAL.size() != m_levels[0].nofSpectral){AXIS_VALUE_WORLD_SPECTRAL.clear();}
+
+
+    m_pyramid_grp = new Group(dynspec_grp, "PYRAMID");
+    m_pyramid_grp->create();
+
+    string GROUPE_TYPE_PYRAMID("Pyramid");
+    int NOF_LEVELS(nofLevels());
+    Attribute<string> attr_GROUPE_TYPE(*m_pyramid_grp, "GROUPE_TYPE");
+    Attribute<int> attr_NOF_LEVELS(*m_pyramid_grp, "NOF_LEVELS");
+    attr_GROUPE_TYPE.value = GROUPE_TYPE_PYRAMID;
+    attr_NOF_LEVELS.value = NOF_LEVELS;
+
+    for (unsigned int k=1;k<m_levels.size();k++)
+      {
+	Level &level = m_levels[k];
+	string name(levelName(k));
+
+	dataLayout.createData(outputFile,dynspecName+"/PYRAMID",level.nofTime,level.nofSpectral,m_nofStokes,name);
+	level.data = new Dataset<float>(*m_pyramid_grp, name);
+	level.pending.resize(level.nofSpectral*m_nofStokes);
+
+	string GROUPE_TYPE_DATA("Data");
+	int LEVEL(k);
+	unsigned long int TIME_REBIN_FACTOR(level.timeFactor);
+	unsigned long int SPECTRAL_REBIN_FACTOR(level.spectralFactor);
+	double TIME_INCREMENT(timeIncrement*level.timeFactor);
+	unsigned long int DATASET_NOF_AXIS(3);
+
+	Attribute<string> attr_GROUPE_TYPE_DATA(*level.data, "GROUPE_TYPE");
+	Attribute<int> attr_LEVEL(*level.data, "LEVEL");
+	Attribute<unsigned long int> attr_TIME_REBIN_FACTOR(*level.data, "TIME_REBIN_FACTOR");
+	Attribute<unsigned long int> attr_SPECTRAL_REBIN_FACTOR(*level.data, "SPECTRAL_REBIN_FACTOR");
+	Attribute<double> attr_TIME_INCREMENT(*level.data, "TIME_INCREMENT");
+	Attribute<unsigned long int> attr_DATASET_NOF_AXIS(*level.data, "DATASET_NOF_AXIS");
+
+	attr_GROUPE_TYPE_DATA.value = GROUPE_TYPE_DATA;
+	attr_LEVEL.value = LEVEL;
+	attr_TIME_REBIN_FACTOR.value = TIME_REBIN_FACTOR;
+	attr_SPECTRAL_REBIN_FACTOR.value = SPECTRAL_REBIN_FACTOR;
+	attr_TIME_INCREMENT.value = TIME_INCREMENT;
+	attr_DATASET_NOF_AXIS.value = DATASET_NOF_AXIS;
+
+	if (!AXIS_VALUE_WORLD_SPECTRAL.empty())
+	  {
+	    Attribute< vector<double> > attr_AXIS_VALUE_WORLD(*level.data, "AXIS_VALUE_WORLD");
+	    attr_AXIS_VALUE_WORLD.create().set(rebinAxis(AXIS_VALUE_WORLD_SPECTRAL,level.spectralFactor));
+	  }
+      }
+  }
+
+
+  void Dynspec_Pyramid::decimateRow(int k, const float *row, float *rowLevel) const
+  {
+    // frequency bins of a row of the level k-1 paired (the last one alone if their number is odd)
+    const Level &level = m_levels[k];
+    unsigned long int nofSpectralBelow(m_levels[k-1].nofSpectral);
+
+    if (!level.halveSpectral)
+      {
+	copy(row,row+nofSpectralBelow*m_nofStokes,rowLevel);
+	return;
+      }
+
+    for (unsigned long int J=0;J<level.nofSpectral;J++)
+      {
+	const float *bins = row+2*J*m_nofStokes;
+	float *bin = rowLevel+J*m_nofStokes;
+	if (2*J+1 < nofSpectralBelow)
+	  {
+	    for (int l=0;l<m_nofStokes;l++){bin[l] = 0.5f*(bins[l]+bins[m_nofStokes+l]);}
+	  }
+	else
+	  {
+	    for (int l=0;l<m_nofStokes;l++){bin[l] = bins[l];}
+	  }
+      }
+  }
+
+  void Dynspec_Pyramid::addLevelRows(int k, const float *rows, unsigned long int nofRows)
+  {
+    // rows of the level k-1 -> rows of the level k
+    Level &level = m_levels[k];
+    unsigned long int rowSizeBelow(m_levels[k-1].nofSpectral*m_nofStokes);
+    unsigned long int rowSize(level.nofSpectral*m_nofStokes);
+
+    unsigned long int nofRowsLevel(level.halveTime ? (nofRows+1)/2 : nofRows);
+    if (level.block.size() < nofRowsLevel*rowSize){level.block.resize(nofRowsLevel*rowSize);}
+
+    unsigned long int nofRowsDone(0);
+    for (unsigned long int I=0;I<nofRows;I++)
+      {
+	float *rowLevel = &level.block[nofRowsDone*rowSize];
+
+	if (!level.halveTime)
+	  {
+	    decimateRow(k,rows+I*rowSizeBelow,rowLevel);
+	    nofRowsDone++;
+	  }
+	else if (!level.hasPending)
+	  {
+	    decimateRow(k,rows+I*rowSizeBelow,&level.pending[0]);
+	    level.hasPending = true;
+	  }
+	else
+	  {
+	    decimateRow(k,rows+I*rowSizeBelow,rowLevel);
+	    for (unsigned long int n=0;n<rowSize;n++){rowLevel[n] = 0.5f*(rowLevel[n]+level.pending[n]);}
+	    level.hasPending = false;
+	    nofRowsDone++;
+	  }
+      }
+
+    if (nofRowsDone > 0){writeLevelRows(k,&level.block[0],nofRowsDone);}
+  }
+
+  void Dynspec_Pyramid::writeLevelRows(int k, const float *rows, unsigned long int nofRows)
+  {
+    Level &level = m_levels[k];
+
+    vector<size_t> data_grp_pos(3);
+    data_grp_pos[0] = level.nofWritten;
+    data_grp_pos[1] = 0;
+    data_grp_pos[2] = 0;
+
+    vector<size_t> data_grp_size(3);
+    data_grp_size[0] = nofRows;
+    data_grp_size[1] = level.nofSpectral;
+    data_grp_size[2] = m_nofStokes;
+
+    level.data->setMatrix( data_grp_pos, rows, data_grp_size );
+    level.nofWritten += nofRows;
+
+    if (k+1 < (int)m_levels.size()){addLevelRows(k+1,rows,nofRows);}
+  }
+
+
+  void Dynspec_Pyramid::addRows(const float *DATA_3D, unsigned long int nofRows)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Pyramid::addRows(const float *DATA_3D, unsigned long int nofRows)
+  /// \param   DATA_3D next time bins written in DATA ([nofRows][nofSpectral][nofStokes]), given in the time order
+  /// \param   nofRows number of time bins
+
+    if (nofLevels() == 0 || m_pyramid_grp == NULL || nofRows == 0){return;}
+    addLevelRows(1,DATA_3D,nofRows);
+  }
+
+  void Dynspec_Pyramid::finish()
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Pyramid::finish()
+  /// <br /> Writes the rows still waiting for their time pair (when the number of time bins of a level is odd)
+
+    if (m_pyramid_grp == NULL){return;}
+
+    for (unsigned int k=1;k<m_levels.size();k++)
+      {
+	Level &level = m_levels[k];
+	if (!level.hasPending){continue;}
+	level.hasPending = false;
+	writeLevelRows(k,&level.pending[0],1);
+      }
+  }
+
+
+  int Dynspec_Pyramid::read(Group &dynspec_grp, float timeResolution, float frequencyResolution, vector<float> &DATA_3D,
+			    vector<size_t> &dimensions, double &timeIncrement, vector<double> &AXIS_VALUE_WORLD_SPECTRAL)
+  {
+  /// <br /> Usage:
+  /// <br />   int Dynspec_Pyramid::read(Group &dynspec_grp, float timeResolution, float frequencyResolution, vector<float> &DATA_3D, vector<size_t> &dimensions, double &timeIncrement, vector<double> &AXIS_VALUE_WORLD_SPECTRAL)
+  /// \param   &dynspec_grp Group Object(Dynamic spectrum object) of an ICD6 file
+  /// \param   timeResolution time resolution asked (s)
+  /// \param   frequencyResolution frequency resolution asked (MHz)
+  /// \param   DATA_3D [time][frequency][Stokes] data given
+  /// \param   dimensions dimensions of DATA_3D
+  /// \param   timeIncrement time resolution given (s)
+  /// \param   AXIS_VALUE_WORLD_SPECTRAL frequencies of the bins given (Hz)
+  /// \return  level read (0: DATA)
+
+    // resolution of DATA: the frequency axis is given by bins (the band can be non continuous), its increment is the smallest gap
+    Group coords_grp(dynspec_grp, "COORDINATES");
+    Group time_grp(coords_grp, "TIME");
+    Group spectral_grp(coords_grp, "SPECTRAL");
+
+    Attribute< vector<double> > obj_INCREMENT_TIME(time_grp, "INCREMENT");
+    Attribute< vector<double> > obj_AXIS_VALUE_WORLD_SPECTRAL(spectral_grp, "AXIS_VALUE_WORLD");
+    vector<double> INCREMENT_TIME(obj_INCREMENT_TIME.value);
+    vector<double> AXIS_VALUE_WORLD_DATA(obj_AXIS_VALUE_WORLD_SPECTRAL.value);
+
+    double timeIncrementData(INCREMENT_TIME.empty() ? 0 : INCREMENT_TIME[0]);
+    double spectralIncrementData(0);
+    for (unsigned long int J=1;J<AXIS_VALUE_WORLD_DATA.size();J++)
+      {
+	double gap(AXIS_VALUE_WORLD_DATA[J]-AXIS_VALUE_WORLD_DATA[J-1]);
+	if (gap > 0 && (spectralIncrementData == 0 || gap < spectralIncrementData)){spectralIncrementData = gap;}
+      }
+
+    double timeRebin((timeIncrementData > 0) ? timeResolution/timeIncrementData : 1);
+    double spectralRebin((spectralIncrementData > 0) ? frequencyResolution*1E6/spectralIncrementData : 1);
+
+
+    // nearest level: the coarsest one which is not coarser than the resolution asked
+    int level(0);
+    unsigned long int timeFactor(1),spectralFactor(1);
+    Group pyramid_grp(dynspec_grp, "PYRAMID");
+    if (pyramid_grp.exists())
+      {
+	Attribute<int> obj_NOF_LEVELS(pyramid_grp, "NOF_LEVELS");
+	int NOF_LEVELS(obj_NOF_LEVELS.value);
+	for (int k=1;k<=NOF_LEVELS;k++)
+	  {
+	    Dataset<float> data_grp(pyramid_grp, levelName(k));
+	    Attribute<unsigned long int> obj_TIME_REBIN_FACTOR(data_grp, "TIME_REBIN_FACTOR");
+	    Attribute<unsigned long int> obj_SPECTRAL_REBIN_FACTOR(data_grp, "SPECTRAL_REBIN_FACTOR");
+	    unsigned long int TIME_REBIN_FACTOR(obj_TIME_REBIN_FACTOR.value);
+	    unsigned long int SPECTRAL_REBIN_FACTOR(obj_SPECTRAL_REBIN_FACTOR.value);
+	    if (TIME_REBIN_FACTOR <= timeRebin*(1+1E-6) && SPECTRAL_REBIN_FACTOR <= spectralRebin*(1+1E-6))
+	      {
+		level = k;
+		timeFactor = TIME_REBIN_FACTOR;
+		spectralFactor = SPECTRAL_REBIN_FACTOR;
+	      }
+	  }
+      }
+
+    vector<float> DATA_3D_level;
+    vector<size_t> dimensionsLevel;
+    if (level == 0)
+      {
+	Dataset<float> data_grp(dynspec_grp, "DATA");
+	readDataset(data_grp,DATA_3D_level,dimensionsLevel);
+	AXIS_VALUE_WORLD_SPECTRAL = AXIS_VALUE_WORLD_DATA;
+      }
+    else
+      {
+	Dataset<float> data_grp(pyramid_grp, levelName(level));
+	readDataset(data_grp,DATA_3D_level,dimensionsLevel);
+	Attribute< vector<double> > obj_AXIS_VALUE_WORLD(data_grp, "AXIS_VALUE_WORLD");
+	AXIS_VALUE_WORLD_SPECTRAL.clear();
+	if (obj_AXIS_VALUE_WORLD.exists()){AXIS_VALUE_WORLD_SPECTRAL = obj_AXIS_VALUE_WORLD.value;}
+      }
+
+
+    // remaining rebinning
+    unsigned long int timeRebinLevel(max(1.0,timeRebin/timeFactor+1E-6));
+    unsigned long int spectralRebinLevel(max(1.0,spectralRebin/spectralFactor+1E-6));
+    timeIncrement = timeIncrementData*timeFactor*timeRebinLevel;
+
+    if (timeRebinLevel == 1 && spectralRebinLevel == 1)
+      {
+	DATA_3D.swap(DATA_3D_level);
+	dimensions = dimensionsLevel;
+	return level;
+      }
+
+    dimensions.resize(3);
+    dimensions[0] = (dimensionsLevel[0]+timeRebinLevel-1)/timeRebinLevel;
+    dimensions[1] = (dimensionsLevel[1]+spectralRebinLevel-1)/spectralRebinLevel;
+    dimensions[2] = dimensionsLevel[2];
+    DATA_3D.resize(dimensions[0]*dimensions[1]*dimensions[2]);
+    if (!DATA_3D.empty())
+      {
+	rebin(&DATA_3D_level[0],dimensionsLevel[0],dimensionsLevel[1],dimensionsLevel[2],timeRebinLevel,spectralRebinLevel,&DATA_3D[0]);
+      }
+    if (!AXIS_VALUE_WORLD_SPECTRAL.empty()){AXIS_VALUE_WORLD_SPECTRAL = rebinAxis(AXIS_VALUE_WORLD_SPECTRAL,spectralRebinLevel);}
+
+    return level;
+  }
+
+
+  void Dynspec_Pyramid::rebin(const float *DATA_3D, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes,
+			      unsigned long int timeRebin, unsigned long int spectralRebin, float *DATA_3D_rebin)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Pyramid::rebin(const float *DATA_3D, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, unsigned long int timeRebin, unsigned long int spectralRebin, float *DATA_3D_rebin)
+  /// \param   DATA_3D [nofTime][nofSpectral][nofStokes] data
+  /// \param   timeRebin, spectralRebin number of bins averaged in time and frequency (the last bins average the ones left)
+  /// \param   DATA_3D_rebin [nofTime/timeRebin][nofSpectral/spectralRebin][nofStokes] data (rounded up)
+
+    unsigned long int nofTimeRebin((nofTime+timeRebin-1)/timeRebin);
+    unsigned long int nofSpectralRebin((nofSpectral+spectralRebin-1)/spectralRebin);
+
+    for (unsigned long int I=0;I<nofTimeRebin;I++)
+      {
+	unsigned long int timeStart(I*timeRebin);
+	unsigned long int timeStop(min(timeStart+timeRebin,nofTime));
+	float *row = DATA_3D_rebin+I*nofSpectralRebin*nofStokes;
+	fill(row,row+nofSpectralRebin*nofStokes,0);
+
+	for (unsigned long int t=timeStart;t<timeStop;t++)
+	  {
+	    const float *rowData = DATA_3D+t*nofSpectral*nofStokes;
+	    for (unsigned long int J=0;J<nofSpectralRebin;J++)
+	      {
+		unsigned long int spectralStop(min((J+1)*spectralRebin,nofSpectral));
+		for (unsigned long int s=J*spectralRebin;s<spectralStop;s++)
+		  {
+		    for (int l=0;l<nofStokes;l++){row[J*nofStokes+l] += rowData[s*nofStokes+l];}
+		  }
+	      }
+	  }
+
+	for (unsigned long int J=0;J<nofSpectralRebin;J++)
+	  {
+	    unsigned long int spectralStop(min((J+1)*spectralRebin,nofSpectral));
+	    float scale(1.0/((timeStop-timeStart)*(spectralStop-J*spectralRebin)));
+	    for (int l=0;l<nofStokes;l++){row[J*nofStokes+l] *= scale;}
+	  }
+      }
+  }
@@ -0,0 +1,88 @@
+#ifndef DEF_DYNSPEC_PYRAMID
+#define DEF_DYNSPEC_PYRAMID
+
+#include<string>
+#include<iostream>
+#include<vector>
+
+#include <dal/lofar/BF_File.h>
+
+#include "Dynspec_Data_Layout.h"
+
+
+/// \class Dynspec_Pyramid
+///  \brief Class object for building the multi-resolution pyramid of the ICD6's DATA (2x, 4x, 8x... in time and frequency) and reading it back
+///  \details
+/// <br /> Usage:
+/// <br /> The pyramid is stored in the dynamic spectrum group, next to DATA: PYRAMID/LEVEL_1, PYRAMID/LEVEL_2... Each level is
+/// [time][frequency][Stokes], the mean of 2 time bins and 2 frequency bins of the level below (a dimension is no longer
+/// halved when it has 64 bins or less). Levels are built in the same pass as DATA: addRows is called with each time step
+/// written in DATA (Dynspec_Rebin_Engine::setPyramid does it in writeChunks) and finish writes the last odd rows.
+/// By default (pyramid=auto in Dynspec_Data_Layout) levels are added until the last one has at most 1024 x 1024 bins.
+/// <br /> Each level has the attributes LEVEL, TIME_REBIN_FACTOR and SPECTRAL_REBIN_FACTOR (relative to DATA),
+/// TIME_INCREMENT (s) and AXIS_VALUE_WORLD (Hz, frequencies of its bins); the group PYRAMID has NOF_LEVELS.
+/// <br /> read gives a requested resolution from the nearest level (the coarsest one which is not coarser than the
+/// resolution asked), rebinned by the remaining integer factors: a quicklook at any resolution reads the ICD6 file only.
+
+
+using namespace dal;
+
+class Dynspec_Pyramid
+{
+  // Public Methods
+  public:
+
+    Dynspec_Pyramid(unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes, int nofLevels=-1);
+    ~Dynspec_Pyramid();
+
+    int nofLevels() const;
+    unsigned long int nofTime(int level) const;
+    unsigned long int nofSpectral(int level) const;
+
+    void create(Group &dynspec_grp, std::string outputFile, std::string dynspecName, const Dynspec_Data_Layout &dataLayout);
+    void addRows(const float *DATA_3D, unsigned long int nofRows);
+    void finish();
+
+    static int read(Group &dynspec_grp, float timeResolution, float frequencyResolution, std::vector<float> &DATA_3D,
+		    std::vector<size_t> &dimensions, double &timeIncrement, std::vector<double> &AXIS_VALUE_WORLD_SPECTRAL);
+
+    static void rebin(const float *DATA_3D, unsigned long int nofTime, unsigned long int nofSpectral, int nofStokes,
+		      unsigned long int timeRebin, unsigned long int spectralRebin, float *DATA_3D_rebin);
+
+
+  // Private Methods
+  private:
+
+    Dynspec_Pyramid(const Dynspec_Pyramid &);
+    Dynspec_Pyramid &operator=(const Dynspec_Pyramid &);
+
+    void decimateRow(int k, const float *row, float *rowLevel) const;
+    void addLevelRows(int k, const float *rows, unsigned long int nofRows);
+    void writeLevelRows(int k, const float *rows, unsigned long int nofRows);
+
+
+  // Private Attributes
+  private:
+
+    /// One level of the pyramid (level 0 is DATA, written by the caller)
+    struct Level
+    {
+      unsigned long int nofTime;
+      unsigned long int nofSpectral;
+      bool halveTime;				///< time bins of the level below are paired
+      bool halveSpectral;			///< frequency bins of the level below are paired
+      unsigned long int timeFactor;		///< time bins of DATA in one bin
+      unsigned long int spectralFactor;		///< frequency bins of DATA in one bin
+      Dataset<float> *data;
+      std::vector<float> pending;		///< first row of a time pair, waiting for the second one
+      bool hasPending;
+      std::vector<float> block;			///< rows written by addLevelRows
+      unsigned long int nofWritten;
+    };
+
+    int m_nofStokes;
+    std::vector<Level> m_levels;
+    Group *m_pyramid_grp;
+};
+
+#endif
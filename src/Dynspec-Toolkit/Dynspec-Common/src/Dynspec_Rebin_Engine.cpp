@@ -0,0 +1,589 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+
+#include "Dynspec_Rebin_Engine.h"
+#include "Dynspec_Pyramid.h"
+
+#include <dal/lofar/BF_File.h>
+
+
+/// \file Dynspec_Rebin_Engine.cpp
+///  \brief File C++ (associated to Dynspec_Rebin_Engine.h) for loading ICD3 Stokes data, rebinning them and writing them in the ICD6's DATA
+///  \details
+/// <br /> Overview:
+/// <br /> The rebinning is separable: for each new time bin, the rows of the time bin are summed channel by channel (contiguous,
+/// vectorized by the compiler), then this sum is reduced over the frequency windows. The result is written directly at its place
+/// in the interleaved [time][frequency][Stokes] block, so no intermediate 2D rebinned matrix is needed.
+/// <br /> Prefetch:
+/// <br /> Each part has two ICD3 buffers (64 bytes aligned). The time step being rebinned uses the buffer set m_front; the reader
+/// thread loads the next time step given by addChunk in the other set. A prefetched block which doesn't match the time step
+/// finally processed (or which failed) is discarded and the time step is loaded again by the calling thread.
+
+
+using namespace dal;
+using namespace std;
+
+
+// HDF5 is not thread safe: one call at a time for all the engines (reader threads and writing threads)
+static pthread_mutex_t s_HDF5Lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+  Dynspec_Rebin_Engine::Dynspec_Rebin_Engine(int nofComponents, unsigned long int nofChannels, Conversion conversion)
+  {
+  /// <br /> Usage:
+  /// <br />   Dynspec_Rebin_Engine::Dynspec_Rebin_Engine(int nofComponents, unsigned long int nofChannels, Conversion conversion)
+  /// \param   nofComponents number of components (Stokes or Xr, Xi, Yr, Yi) loaded
+  /// \param   nofChannels number of channels of the band processed (before rebinning)
+  /// \param   conversion conversion of the components before rebinning
+
+    if (conversion != STOKES && nofComponents != 4)
+      {throw runtime_error("Dynspec_Rebin_Engine: conversion of complex voltages needs 4 components (Xr, Xi, Yr, Yi)");}
+
+    m_nofComponents = nofComponents;
+    m_nofChannels = nofChannels;
+    m_conversion = conversion;
+    m_parts.resize(nofComponents);
+    m_front = 0;
+    m_pyramid = NULL;
+
+    m_readerStarted = false;
+    m_stop = false;
+    m_prefetchRequested = false;
+    m_prefetchDone = false;
+    m_prefetchTimeIndex = 0;
+    m_prefetchNofRows = 0;
+    pthread_mutex_init(&m_readerLock,NULL);
+    pthread_cond_init(&m_readerCond,NULL);
+
+    setRebin(1,nofChannels,1);
+  }
+
+  Dynspec_Rebin_Engine::~Dynspec_Rebin_Engine()
+  {
+    // the reader finishes the block it is loading, then stops
+    if (m_readerStarted)
+      {
+	pthread_mutex_lock(&m_readerLock);
+	m_stop = true;
+	pthread_cond_broadcast(&m_readerCond);
+	pthread_mutex_unlock(&m_readerLock);
+	pthread_join(m_reader,NULL);
+      }
+    pthread_cond_destroy(&m_readerCond);
+    pthread_mutex_destroy(&m_readerLock);
+
+    for (unsigned int l=0;l<m_parts.size();l++)
+      {
+	for (unsigned int s=0;s<m_parts[l].size();s++)
+	  {
+	    free(m_parts[l][s]->DATA_2D[0]);
+	    free(m_parts[l][s]->DATA_2D[1]);
+	    delete m_parts[l][s]->stokes;
+	    delete m_parts[l][s]->file;
+	    delete m_parts[l][s];
+	  }
+      }
+  }
+
+
+  void Dynspec_Rebin_Engine::setRebin(unsigned long int timeRebin, unsigned long int nofSpectral, unsigned long int spectralRebin, unsigned long int spectralStep, unsigned long int spectralOffset)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::setRebin(unsigned long int timeRebin, unsigned long int nofSpectral, unsigned long int spectralRebin, unsigned long int spectralStep, unsigned long int spectralOffset)
+  /// \param   timeRebin number of time samples summed in a new time bin
+  /// \param   nofSpectral number of new frequency bins
+  /// \param   spectralRebin number of channels summed in a new frequency bin
+  /// \param   spectralStep distance (in channels) between two new frequency bins, 0 for spectralRebin (contiguous bins)
+  /// \param   spectralOffset first channel of the first new frequency bin
+
+    if (timeRebin == 0){timeRebin=1;}
+    if (spectralRebin == 0){spectralRebin=1;}
+    if (spectralStep == 0){spectralStep=spectralRebin;}
+
+    m_timeRebin = timeRebin;
+    m_nofSpectral = nofSpectral;
+    m_spectralRebin = spectralRebin;
+    m_spectralStep = spectralStep;
+    m_spectralOffset = spectralOffset;
+
+    // Frequency bins outside the band processed are not computed (they stay at 0)
+    m_nofSpectralLoaded = 0;
+    if (spectralOffset+spectralRebin <= m_nofChannels)
+      {m_nofSpectralLoaded = min(nofSpectral,(m_nofChannels-spectralOffset-spectralRebin)/spectralStep+1);}
+  }
+
+
+  void Dynspec_Rebin_Engine::addPart(int l, string pathFile, int SAP, int BEAM, unsigned long int channelStart, unsigned long int nofChannels, unsigned long int bandOffset)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::addPart(int l, string pathFile, int SAP, int BEAM, unsigned long int channelStart, unsigned long int nofChannels, unsigned long int bandOffset)
+  /// \param   l component index (Stokes index in the ICD3 file)
+  /// \param   pathFile ICD3 file (opened here, closed with the engine)
+  /// \param   SAP Subarray pointing index
+  /// \param   BEAM Beam index
+  /// \param   channelStart first channel read in the ICD3 file
+  /// \param   nofChannels number of channels read
+  /// \param   bandOffset position of channelStart in the band processed
+
+    if (bandOffset+nofChannels > m_nofChannels)
+      {throw runtime_error("Dynspec_Rebin_Engine: part of "+pathFile+" is outside the band processed");}
+
+    Part *part = new Part;
+    part->file = new BF_File(pathFile);
+    part->stokes = new BF_StokesDataset(part->file->subArrayPointing(SAP).beam(BEAM).stokes(l));
+    part->channelStart = channelStart;
+    part->nofChannels = nofChannels;
+    part->bandOffset = bandOffset;
+    for (int set=0;set<2;set++)
+      {
+	part->DATA_2D[set] = NULL;
+	part->capacity[set] = 0;
+      }
+
+    m_parts[l].push_back(part);
+  }
+
+
+  bool Dynspec_Rebin_Engine::isMissing(int l) const
+  {
+    /// \return true if no file has been added for the component l
+    return m_parts[l].empty();
+  }
+
+  int Dynspec_Rebin_Engine::nofOutputs() const
+  {
+    /// \return number of Stokes components in the ICD6's DATA
+    if (m_conversion == XY_TO_I){return 1;}
+    return m_nofComponents;
+  }
+
+
+  void Dynspec_Rebin_Engine::sumTime(const float *DATA_2D, unsigned long int nofChannels, unsigned long int nofTime, float *rowSum)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::sumTime(const float *DATA_2D, unsigned long int nofChannels, unsigned long int nofTime, float *rowSum)
+  /// \param   DATA_2D nofTime rows of nofChannels channels
+  /// \param   rowSum  the rows are added to it, channel by channel
+
+    for (unsigned long int K=0;K<nofTime;K++)
+      {
+	const float *row = DATA_2D+K*nofChannels;
+	for (unsigned long int L=0;L<nofChannels;L++){rowSum[L] += row[L];}
+      }
+  }
+
+  void Dynspec_Rebin_Engine::sumSpectral(const float *rowSum, unsigned long int nofSpectral, unsigned long int spectralRebin, unsigned long int spectralStep, float scale, float *DATA_3D, int stride)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::sumSpectral(const float *rowSum, unsigned long int nofSpectral, unsigned long int spectralRebin, unsigned long int spectralStep, float scale, float *DATA_3D, int stride)
+  /// \param   rowSum  channels summed over the time bin (from the first channel of the first frequency bin)
+  /// \param   DATA_3D new frequency bin J is written at DATA_3D[J*stride]
+
+    for (unsigned long int J=0;J<nofSpectral;J++)
+      {
+	const float *window = rowSum+J*spectralStep;
+	float rebinPixel(0);
+	for (unsigned long int L=0;L<spectralRebin;L++){rebinPixel += window[L];}
+	DATA_3D[J*stride] = rebinPixel*scale;
+      }
+  }
+
+
+  unsigned long int Dynspec_Rebin_Engine::timeStep(float memoryRAM, int nofComponents, unsigned long int nofChannels, unsigned long int timeRebin, unsigned long int nofSpectral, int nofOutputs)
+  {
+  /// <br /> Usage:
+  /// <br />   unsigned long int Dynspec_Rebin_Engine::timeStep(float memoryRAM, int nofComponents, unsigned long int nofChannels, unsigned long int timeRebin, unsigned long int nofSpectral, int nofOutputs)
+  /// \param   memoryRAM RAM memory consuption by processing (Go)
+  /// \param   nofComponents number of components loaded
+  /// \param   nofChannels number of channels of the band processed (before rebinning)
+  /// \param   timeRebin number of time samples summed in a new time bin
+  /// \param   nofSpectral number of frequency bins after rebinning
+  /// \param   nofOutputs number of Stokes written
+  /// \return  number of ICD3 time samples of a time step: a multiple of timeRebin, at least timeRebin
+
+    if (timeRebin == 0){timeRebin = 1;}
+
+    // a time step holds the ICD3 data of all components in both buffer sets (2 x nofComponents x nofChannels floats by time sample)
+    // and its rebinned block (nofSpectral x nofOutputs floats by new time bin)
+    double bytesPerRow(sizeof(float)*(2.0*nofComponents*nofChannels*timeRebin+(double)nofSpectral*nofOutputs));
+    double nofRows((memoryRAM*1E9)/bytesPerRow);
+
+    unsigned long int timeFactor(1);
+    if (nofRows > 1){timeFactor = (nofRows < 1E12) ? (unsigned long int)nofRows : (unsigned long int)1E12;}
+
+    return timeFactor*timeRebin;
+  }
+
+
+  void Dynspec_Rebin_Engine::loadComponent(int l, int set, unsigned long int timeIndex, unsigned long int nofTime)
+  {
+    for (unsigned int s=0;s<m_parts[l].size();s++)
+      {
+	Part *part = m_parts[l][s];
+	unsigned long int nofPixels(nofTime*part->nofChannels);
+
+	// the buffers only grow: after the first (largest) time step, no allocation
+	if (part->capacity[set] < nofPixels)
+	  {
+	    void *buffer(NULL);
+	    if (posix_memalign(&buffer,64,nofPixels*sizeof(float)) != 0)
+	      {throw runtime_error("Dynspec_Rebin_Engine: not enough memory for the ICD3 data");}
+	    free(part->DATA_2D[set]);
+	    part->DATA_2D[set] = (float*)buffer;
+	    part->capacity[set] = nofPixels;
+	  }
+
+	vector<size_t> pos(2);
+	pos[0] = timeIndex;
+	pos[1] = part->channelStart;
+
+	vector<size_t> size(2);
+	size[0] = nofTime;
+	size[1] = part->nofChannels;
+
+	pthread_mutex_lock(&s_HDF5Lock);
+	try
+	  {
+	    part->stokes->getMatrix( pos, part->DATA_2D[set], size );
+	  }
+	catch (...)
+	  {
+	    pthread_mutex_unlock(&s_HDF5Lock);
+	    throw;
+	  }
+	pthread_mutex_unlock(&s_HDF5Lock);
+      }
+  }
+
+  bool Dynspec_Rebin_Engine::isConvertible() const
+  {
+    /// \return true if the 4 components are read from the same parts (needed by the conversion of complex voltages)
+    for (int l=0;l<m_nofComponents;l++)
+      {
+	if (m_parts[l].size() != m_parts[0].size()){return false;}
+	for (unsigned int s=0;s<m_parts[l].size();s++)
+	  {
+	    if (m_parts[l][s]->nofChannels != m_parts[0][s]->nofChannels || m_parts[l][s]->bandOffset != m_parts[0][s]->bandOffset){return false;}
+	  }
+      }
+    return true;
+  }
+
+  void Dynspec_Rebin_Engine::loadChunk(int set, unsigned long int timeIndex, unsigned long int nofRows)
+  {
+    // HDF5 reads are serialized: the components are loaded one after the other
+    if (m_conversion != STOKES && !isConvertible()){return;}
+    for (int l=0;l<m_nofComponents;l++)
+      {loadComponent(l,set,timeIndex,nofRows*m_timeRebin);}
+  }
+
+  void *Dynspec_Rebin_Engine::runReader(void *engine)
+  {
+    Dynspec_Rebin_Engine *self = (Dynspec_Rebin_Engine*)engine;
+
+    pthread_mutex_lock(&self->m_readerLock);
+    while (true)
+      {
+	while (!self->m_stop && !(self->m_prefetchRequested && !self->m_prefetchDone))
+	  {pthread_cond_wait(&self->m_readerCond,&self->m_readerLock);}
+	if (self->m_stop){break;}
+
+	// the calling thread doesn't touch the back buffer set until the block is done
+	int set(1-self->m_front);
+	unsigned long int timeIndex(self->m_prefetchTimeIndex);
+	unsigned long int nofRows(self->m_prefetchNofRows);
+	pthread_mutex_unlock(&self->m_readerLock);
+
+	string error;
+	try
+	  {
+	    self->loadChunk(set,timeIndex,nofRows);
+	  }
+	catch (exception &e)
+	  {
+	    error = e.what();
+	  }
+
+	pthread_mutex_lock(&self->m_readerLock);
+	self->m_prefetchError = error;
+	self->m_prefetchDone = true;
+	pthread_cond_broadcast(&self->m_readerCond);
+      }
+    pthread_mutex_unlock(&self->m_readerLock);
+    return NULL;
+  }
+
+  void Dynspec_Rebin_Engine::prefetchChunk(unsigned long int timeIndex, unsigned long int nofRows)
+  {
+    // without reader thread, the time steps are loaded by the calling thread (takePrefetch returns false)
+    if (!m_readerStarted)
+      {
+	if (pthread_create(&m_reader,NULL,runReader,this) != 0){return;}
+	m_readerStarted = true;
+      }
+
+    pthread_mutex_lock(&m_readerLock);
+    m_prefetchTimeIndex = timeIndex;
+    m_prefetchNofRows = nofRows;
+    m_prefetchError.clear();
+    m_prefetchDone = false;
+    m_prefetchRequested = true;
+    pthread_cond_broadcast(&m_readerCond);
+    pthread_mutex_unlock(&m_readerLock);
+  }
+
+  bool Dynspec_Rebin_Engine::takePrefetch(unsigned long int timeIndex, unsigned long int nofRows)
+  {
+    /// \return true if the time step has been loaded by the reader: it becomes the front buffer set
+    if (!m_readerStarted){return false;}
+
+    pthread_mutex_lock(&m_readerLock);
+    if (!m_prefetchRequested)
+      {
+	pthread_mutex_unlock(&m_readerLock);
+	return false;
+      }
+    while (!m_prefetchDone){pthread_cond_wait(&m_readerCond,&m_readerLock);}
+    m_prefetchRequested = false;
+    bool loaded(m_prefetchError.empty() && m_prefetchTimeIndex == timeIndex && m_prefetchNofRows == nofRows);
+    pthread_mutex_unlock(&m_readerLock);
+
+    if (loaded){m_front = 1-m_front;}
+    return loaded;
+  }
+
+
+  void Dynspec_Rebin_Engine::rebinComponent(int l, unsigned long int nofRows, float *DATA_3D)
+  {
+    int nofStokes(nofOutputs());
+    float scale(1.0/(m_timeRebin*m_spectralRebin));
+    vector<float> rowSum(m_nofChannels);
+
+    for (unsigned long int I=0;I<nofRows;I++)
+      {
+	float *DATA_3D_row = DATA_3D+I*m_nofSpectral*nofStokes+l;
+	fill(rowSum.begin(),rowSum.end(),0);
+
+	for (unsigned int s=0;s<m_parts[l].size();s++)
+	  {
+	    Part *part = m_parts[l][s];
+	    sumTime(part->DATA_2D[m_front]+I*m_timeRebin*part->nofChannels,part->nofChannels,m_timeRebin,&rowSum[part->bandOffset]);
+	  }
+
+	sumSpectral(&rowSum[m_spectralOffset],m_nofSpectralLoaded,m_spectralRebin,m_spectralStep,scale,DATA_3D_row,nofStokes);
+	for (unsigned long int J=m_nofSpectralLoaded;J<m_nofSpectral;J++){DATA_3D_row[J*nofStokes]=0;}
+      }
+  }
+
+  void Dynspec_Rebin_Engine::convertRow(unsigned long int I, vector<float> &rowSum, float *DATA_3D)
+  {
+    int nofStokes(nofOutputs());
+    float scale(1.0/(m_timeRebin*m_spectralRebin));
+    float *DATA_3D_row = DATA_3D+I*m_nofSpectral*nofStokes;
+    fill(rowSum.begin(),rowSum.end(),0);
+
+    // Xr, Xi, Yr, Yi are read from the same parts for the 4 components (checked by isConvertible)
+    float *sumI = &rowSum[0];
+    float *sumQ = &rowSum[m_nofChannels];
+    float *sumU = &rowSum[2*m_nofChannels];
+    float *sumV = &rowSum[3*m_nofChannels];
+
+    for (unsigned int s=0;s<m_parts[0].size();s++)
+      {
+	unsigned long int nofChannels(m_parts[0][s]->nofChannels);
+	unsigned long int offset(m_parts[0][s]->bandOffset);
+	for (unsigned long int K=0;K<m_timeRebin;K++)
+	  {
+	    unsigned long int start((I*m_timeRebin+K)*nofChannels);
+	    const float *Xr = m_parts[0][s]->DATA_2D[m_front]+start;
+	    const float *Xi = m_parts[1][s]->DATA_2D[m_front]+start;
+	    const float *Yr = m_parts[2][s]->DATA_2D[m_front]+start;
+	    const float *Yi = m_parts[3][s]->DATA_2D[m_front]+start;
+
+	    if (m_conversion == XY_TO_I)
+	      {
+		for (unsigned long int L=0;L<nofChannels;L++)
+		  {sumI[offset+L] += (Xr[L]*Xr[L]+Xi[L]*Xi[L]+Yr[L]*Yr[L]+Yi[L]*Yi[L])*0.5f;}
+	      }
+	    else
+	      {
+		for (unsigned long int L=0;L<nofChannels;L++)
+		  {
+		    float X2(Xr[L]*Xr[L]+Xi[L]*Xi[L]);
+		    float Y2(Yr[L]*Yr[L]+Yi[L]*Yi[L]);
+		    sumI[offset+L] += (X2+Y2)*0.5f;
+		    sumQ[offset+L] += (X2-Y2)*0.5f;
+		    sumU[offset+L] += Xr[L]*Yr[L]+Xi[L]*Yi[L];
+		    sumV[offset+L] += Xr[L]*Yi[L]-Xi[L]*Yr[L];
+		  }
+	      }
+	  }
+      }
+
+    for (int l=0;l<nofStokes;l++)
+      {
+	sumSpectral(&rowSum[l*m_nofChannels+m_spectralOffset],m_nofSpectralLoaded,m_spectralRebin,m_spectralStep,scale,DATA_3D_row+l,nofStokes);
+	for (unsigned long int J=m_nofSpectralLoaded;J<m_nofSpectral;J++){DATA_3D_row[J*nofStokes+l]=0;}
+      }
+  }
+
+  void Dynspec_Rebin_Engine::rebinChunk(unsigned long int nofRows, float *DATA_3D)
+  {
+    if (m_conversion == STOKES)
+      {
+	// one thread by Stokes component
+	#pragma omp parallel for schedule(dynamic,1)
+	for (int l=0;l<m_nofComponents;l++)
+	  {rebinComponent(l,nofRows,DATA_3D);}
+      }
+    else if (!isConvertible())
+      {
+	fill(DATA_3D,DATA_3D+nofRows*m_nofSpectral*nofOutputs(),0);
+      }
+    else
+      {
+	// the conversion needs the 4 components of a time sample: threads by time bins
+	#pragma omp parallel
+	{
+	  vector<float> rowSum(4*m_nofChannels);
+	  #pragma omp for schedule(static)
+	  for (long int I=0;I<(long int)nofRows;I++)
+	    {convertRow(I,rowSum,DATA_3D);}
+	}
+      }
+  }
+
+
+  void Dynspec_Rebin_Engine::processChunk(unsigned long int timeIndex, unsigned long int nofRows, float *DATA_3D)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::processChunk(unsigned long int timeIndex, unsigned long int nofRows, float *DATA_3D)
+  /// \param   timeIndex first time sample loaded in the ICD3 files
+  /// \param   nofRows number of new time bins (nofRows*timeRebin time samples are loaded)
+  /// \param   DATA_3D [nofRows][nofSpectral][nofOutputs()] block; missing components are set to 0
+
+    try
+      {
+	loadChunk(m_front,timeIndex,nofRows);
+      }
+    catch (exception &e)
+      {
+	throw runtime_error("Dynspec_Rebin_Engine: "+string(e.what()));
+      }
+    rebinChunk(nofRows,DATA_3D);
+  }
+
+
+  void Dynspec_Rebin_Engine::addChunk(unsigned long int timePosition, unsigned long int nofRowsWritten, unsigned long int timeIndex, unsigned long int nofRows)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::addChunk(unsigned long int timePosition, unsigned long int nofRowsWritten, unsigned long int timeIndex, unsigned long int nofRows)
+  /// \param   timePosition first new time bin written (in the DATA dataset or in the block of processChunks)
+  /// \param   nofRowsWritten number of new time bins written (the ones after nofRows are set to 0)
+  /// \param   timeIndex first time sample loaded in the ICD3 files
+  /// \param   nofRows number of new time bins processed
+
+    if (nofRowsWritten == 0){return;}
+
+    Chunk chunk;
+    chunk.timePosition = timePosition;
+    chunk.nofRowsWritten = nofRowsWritten;
+    chunk.timeIndex = timeIndex;
+    chunk.nofRows = min(nofRows,nofRowsWritten);
+    m_chunks.push_back(chunk);
+  }
+
+  void Dynspec_Rebin_Engine::runChunks(Dataset<float> *data_grp, float *DATA_3D)
+  {
+    unsigned long int rowSize(m_nofSpectral*nofOutputs());
+    vector<Chunk> chunks;
+    chunks.swap(m_chunks);
+
+    for (unsigned int i=0;i<chunks.size();i++)
+      {
+	const Chunk &chunk = chunks[i];
+
+	if (!takePrefetch(chunk.timeIndex,chunk.nofRows))
+	  {
+	    try
+	      {
+		loadChunk(m_front,chunk.timeIndex,chunk.nofRows);
+	      }
+	    catch (exception &e)
+	      {
+		throw runtime_error("Dynspec_Rebin_Engine: "+string(e.what()));
+	      }
+	  }
+
+	// the next time step is read while this one is rebinned and written
+	if (i+1 < chunks.size()){prefetchChunk(chunks[i+1].timeIndex,chunks[i+1].nofRows);}
+
+	if (data_grp == NULL)
+	  {
+	    float *DATA_3D_chunk = DATA_3D+chunk.timePosition*rowSize;
+	    rebinChunk(chunk.nofRows,DATA_3D_chunk);
+	    fill(DATA_3D_chunk+chunk.nofRows*rowSize,DATA_3D_chunk+chunk.nofRowsWritten*rowSize,0);
+	    continue;
+	  }
+
+	// the block is kept from a time step to the next one
+	if (m_DATA_3D.size() < chunk.nofRowsWritten*rowSize){m_DATA_3D.resize(chunk.nofRowsWritten*rowSize);}
+
+	rebinChunk(chunk.nofRows,&m_DATA_3D[0]);
+	fill(m_DATA_3D.begin()+chunk.nofRows*rowSize,m_DATA_3D.begin()+chunk.nofRowsWritten*rowSize,0);
+
+	vector<size_t> data_grp_pos(3);
+	data_grp_pos[0] = chunk.timePosition;
+	data_grp_pos[1] = 0;
+	data_grp_pos[2] = 0;
+
+	vector<size_t> data_grp_size(3);
+	data_grp_size[0] = chunk.nofRowsWritten;
+	data_grp_size[1] = m_nofSpectral;
+	data_grp_size[2] = nofOutputs();
+
+	pthread_mutex_lock(&s_HDF5Lock);
+	try
+	  {
+	    data_grp->setMatrix( data_grp_pos, &m_DATA_3D[0], data_grp_size );
+	    if (m_pyramid != NULL){m_pyramid->addRows(&m_DATA_3D[0],chunk.nofRowsWritten);}
+	  }
+	catch (...)
+	  {
+	    pthread_mutex_unlock(&s_HDF5Lock);
+	    throw;
+	  }
+	pthread_mutex_unlock(&s_HDF5Lock);
+      }
+  }
+
+  void Dynspec_Rebin_Engine::setPyramid(Dynspec_Pyramid *pyramid)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::setPyramid(Dynspec_Pyramid *pyramid)
+  /// \param   pyramid pyramid of DATA (or NULL): writeChunks gives it each time step written, the caller calls finish after.
+  /// processChunks doesn't: the caller gives the whole block to the pyramid.
+
+    m_pyramid = pyramid;
+  }
+
+  void Dynspec_Rebin_Engine::writeChunks(Dataset<float> &data_grp)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::writeChunks(Dataset<float> &data_grp)
+  /// \param   &data_grp ICD6's DATA dataset ([time][frequency][Stokes]); each time step given by addChunk is written with one setMatrix
+
+    runChunks(&data_grp,NULL);
+  }
+
+  void Dynspec_Rebin_Engine::processChunks(float *DATA_3D)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Rebin_Engine::processChunks(float *DATA_3D)
+  /// \param   DATA_3D [time][nofSpectral][nofOutputs()] block; each time step given by addChunk is written at its timePosition
+
+    runChunks(NULL,DATA_3D);
+  }
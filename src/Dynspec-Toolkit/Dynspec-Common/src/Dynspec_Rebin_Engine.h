@@ -0,0 +1,144 @@
+#ifndef DEF_DYNSPEC_REBIN_ENGINE
+#define DEF_DYNSPEC_REBIN_ENGINE
+
+#include<string>
+#include<iostream>
+#include<vector>
+
+#include <pthread.h>
+
+#include <dal/lofar/BF_File.h>
+
+
+/// \class Dynspec_Rebin_Engine
+///  \brief Class object for loading ICD3 Stokes data, rebinning them in time and frequency and writing them interleaved in the ICD6's DATA
+///  \details
+/// <br /> Usage:
+/// <br /> This class is shared by the Complete, Rebin (Part and Partionned) and Quicklook writers of Dynspec-CEP2 and Dynspec-Standalone.
+/// ICD3 files are opened once with addPart (one or more frequency parts by Stokes component) and stay open until the engine is destroyed.
+/// processChunk loads a time block of each component, sums it over the time bins and then over the frequency windows, and
+/// interleaves the result in a [time][frequency][Stokes] block.
+/// <br /> Time steps are given with addChunk, then writeChunks writes each of them with a single hyperslab (setMatrix) in the DATA
+/// dataset (processChunks fills a block in memory instead). While a time step is rebinned and written, the next one is loaded
+/// by a background thread in a second set of buffers: the two buffer sets are allocated once and reused, so a time step holds
+/// two blocks of ICD3 data of all components plus its rebinned block. timeStep gives the number of time samples of a time step
+/// which fits in memoryRAM (Go). With setPyramid, each time step written also feeds the
+/// multi-resolution pyramid of DATA (Dynspec_Pyramid), so all its levels are built in the same pass.
+/// Rebinning runs on OpenMP threads; all HDF5 calls of the engine (both threads) are serialized, HDF5 is not thread safe.
+
+
+using namespace dal;
+
+class Dynspec_Pyramid;
+
+class Dynspec_Rebin_Engine
+{
+  // Public Methods
+  public:
+
+    /// Conversion of the loaded components before rebinning
+    enum Conversion
+    {
+      STOKES,		///< components are Stokes parameters, no conversion
+      XY_TO_IQUV,	///< components are Xr, Xi, Yr, Yi (complex voltages), converted to I, Q, U, V
+      XY_TO_I		///< components are Xr, Xi, Yr, Yi (complex voltages), converted to I only
+    };
+
+    Dynspec_Rebin_Engine(int nofComponents, unsigned long int nofChannels, Conversion conversion=STOKES);
+    ~Dynspec_Rebin_Engine();
+
+    void setRebin(unsigned long int timeRebin, unsigned long int nofSpectral, unsigned long int spectralRebin, unsigned long int spectralStep=0, unsigned long int spectralOffset=0);
+
+    void addPart(int l, std::string pathFile, int SAP, int BEAM, unsigned long int channelStart, unsigned long int nofChannels, unsigned long int bandOffset=0);
+
+    bool isMissing(int l) const;
+    int nofOutputs() const;
+
+    void processChunk(unsigned long int timeIndex, unsigned long int nofRows, float *DATA_3D);
+
+    void addChunk(unsigned long int timePosition, unsigned long int nofRowsWritten, unsigned long int timeIndex, unsigned long int nofRows);
+    void setPyramid(Dynspec_Pyramid *pyramid);
+    void writeChunks(Dataset<float> &data_grp);
+    void processChunks(float *DATA_3D);
+
+    static unsigned long int timeStep(float memoryRAM, int nofComponents, unsigned long int nofChannels, unsigned long int timeRebin, unsigned long int nofSpectral, int nofOutputs);
+
+    static void sumTime(const float *DATA_2D, unsigned long int nofChannels, unsigned long int nofTime, float *rowSum);
+
+    static void sumSpectral(const float *rowSum, unsigned long int nofSpectral, unsigned long int spectralRebin, unsigned long int spectralStep, float scale, float *DATA_3D, int stride);
+
+
+  // Private Methods
+  private:
+
+    Dynspec_Rebin_Engine(const Dynspec_Rebin_Engine &);
+    Dynspec_Rebin_Engine &operator=(const Dynspec_Rebin_Engine &);
+
+    void loadComponent(int l, int set, unsigned long int timeIndex, unsigned long int nofTime);
+    bool isConvertible() const;
+    void loadChunk(int set, unsigned long int timeIndex, unsigned long int nofRows);
+    void prefetchChunk(unsigned long int timeIndex, unsigned long int nofRows);
+    bool takePrefetch(unsigned long int timeIndex, unsigned long int nofRows);
+    void rebinChunk(unsigned long int nofRows, float *DATA_3D);
+    void rebinComponent(int l, unsigned long int nofRows, float *DATA_3D);
+    void convertRow(unsigned long int I, std::vector<float> &rowSum, float *DATA_3D);
+    void runChunks(Dataset<float> *data_grp, float *DATA_3D);
+
+    static void *runReader(void *engine);
+
+
+  // Private Attributes
+  private:
+
+    /// One frequency part of a component: an ICD3 Stokes dataset which stays open
+    struct Part
+    {
+      BF_File *file;
+      BF_StokesDataset *stokes;
+      unsigned long int channelStart;		///< first channel read in the ICD3 file
+      unsigned long int nofChannels;		///< number of channels read
+      unsigned long int bandOffset;		///< position of the first channel in the band processed
+      float *DATA_2D[2];			///< time blocks loaded (2 buffer sets: rebinned and prefetched)
+      unsigned long int capacity[2];		///< size of the buffers (they only grow)
+    };
+
+    /// One time step given by addChunk
+    struct Chunk
+    {
+      unsigned long int timePosition;		///< first new time bin written
+      unsigned long int nofRowsWritten;		///< number of new time bins written
+      unsigned long int timeIndex;		///< first time sample loaded
+      unsigned long int nofRows;		///< number of new time bins processed
+    };
+
+    int m_nofComponents;
+    unsigned long int m_nofChannels;
+    Conversion m_conversion;
+
+    unsigned long int m_timeRebin;
+    unsigned long int m_nofSpectral;
+    unsigned long int m_spectralRebin;
+    unsigned long int m_spectralStep;
+    unsigned long int m_spectralOffset;
+    unsigned long int m_nofSpectralLoaded;	///< frequency bins covered by the band processed (the others stay at 0)
+
+    std::vector< std::vector<Part*> > m_parts;
+    std::vector<Chunk> m_chunks;
+    std::vector<float> m_DATA_3D;
+    int m_front;				///< buffer set of the time block being rebinned
+    Dynspec_Pyramid *m_pyramid;			///< levels written with each time step (not owned)
+
+    // Background reader: loads the next time block in the buffer set 1-m_front
+    pthread_t m_reader;
+    bool m_readerStarted;
+    pthread_mutex_t m_readerLock;
+    pthread_cond_t m_readerCond;
+    bool m_stop;
+    bool m_prefetchRequested;			///< a time block is asked or being loaded
+    bool m_prefetchDone;			///< the time block asked is loaded (or failed)
+    unsigned long int m_prefetchTimeIndex;
+    unsigned long int m_prefetchNofRows;
+    std::string m_prefetchError;
+};
+
+#endif
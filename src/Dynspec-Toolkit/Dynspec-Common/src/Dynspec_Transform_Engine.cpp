@@ -0,0 +1,222 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "Dynspec_Transform_Engine.h"
+
+#include <dal/lofar/BF_File.h>
+
+
+/// \file Dynspec_Transform_Engine.cpp
+///  \brief File C++ (associated to Dynspec_Transform_Engine.h) for applying per-pixel operations to the ICD6's DATA in one pass
+///  \details
+/// <br /> Overview:
+/// <br /> A time bin of the block ([frequency][Stokes], nofSpectral x nofStokes floats) is the unit of work: all the steps are applied
+/// to it one after the other while it is in cache, each step being a loop on the frequency bins with precomputed strides
+/// (Stokes l of the frequency bin J is at J*nofStokes+l) that the compiler vectorizes. The polarization step loads Q, U, V once
+/// and computes contiguous rows of L, P (and PA) which are then written in the Stokes asked; L and P are computed in double precision,
+/// PA with atanf as the previous code did, so the results are unchanged (the loop of L and P is vectorized with -fno-math-errno,
+/// c.f How-to-Compile.txt).
+/// The data are transformed in place: no second block is allocated.
+
+
+using namespace dal;
+using namespace std;
+
+
+  Dynspec_Transform_Engine::Dynspec_Transform_Engine(unsigned long int nofSpectral, int nofStokes)
+  {
+  /// <br /> Usage:
+  /// <br />   Dynspec_Transform_Engine::Dynspec_Transform_Engine(unsigned long int nofSpectral, int nofStokes)
+  /// \param   nofSpectral number of frequency bins of the dynamic spectrum
+  /// \param   nofStokes number of Stokes components of the dynamic spectrum
+
+    m_nofSpectral = nofSpectral;
+    m_nofStokes = nofStokes;
+  }
+
+  Dynspec_Transform_Engine::~Dynspec_Transform_Engine(){}
+
+
+  void Dynspec_Transform_Engine::addSubtraction(float kfactor)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Transform_Engine::addSubtraction(float kfactor)
+  /// \param   kfactor factor of the background subtracted (DATA - kfactor x BACKGROUND)
+
+    Step step;
+    step.operation = SUBTRACTION;
+    step.kfactor = kfactor;
+    step.outputL = step.outputPA = step.outputP = -1;
+    m_steps.push_back(step);
+  }
+
+  void Dynspec_Transform_Engine::addNormalization(const vector<float> &reference)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Transform_Engine::addNormalization(const vector<float> &reference)
+  /// \param   reference [frequency][Stokes] values the data are divided by (a null value gives 0)
+
+    if (reference.size() != m_nofSpectral*m_nofStokes)
+      {throw runtime_error("Dynspec_Transform_Engine: the normalization needs a value by frequency bin and Stokes");}
+
+    Step step;
+    step.operation = NORMALIZATION;
+    step.kfactor = 1;
+    step.outputL = step.outputPA = step.outputP = -1;
+    step.inverse.resize(reference.size());
+    for (unsigned long int i=0;i<reference.size();i++){step.inverse[i] = (reference[i] != 0) ? 1/reference[i] : 0;}
+    m_steps.push_back(step);
+  }
+
+  void Dynspec_Transform_Engine::addPolarization(Operation operation, int stokesOutput)
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Transform_Engine::addPolarization(Operation operation, int stokesOutput)
+  /// \param   operation LINEAR_POLARIZATION, POLARIZATION_ANGLE or TOTAL_POLARIZATION
+  /// \param   stokesOutput Stokes component where the result is written (0 to nofStokes-1)
+
+    if (m_nofStokes < 4){throw runtime_error("Dynspec_Transform_Engine: the polarization needs the 4 Stokes I, Q, U, V");}
+    if (stokesOutput < 0 || stokesOutput >= m_nofStokes){throw runtime_error("Dynspec_Transform_Engine: no such Stokes for the polarization");}
+
+    // consecutive polarizations are computed from the same Q, U, V
+    if (m_steps.empty() || m_steps.back().operation != LINEAR_POLARIZATION)
+      {
+	Step step;
+	step.operation = LINEAR_POLARIZATION;
+	step.kfactor = 1;
+	step.outputL = step.outputPA = step.outputP = -1;
+	m_steps.push_back(step);
+      }
+
+    Step &step(m_steps.back());
+    if (operation == LINEAR_POLARIZATION){step.outputL = stokesOutput;}
+    else if (operation == POLARIZATION_ANGLE){step.outputPA = stokesOutput;}
+    else if (operation == TOTAL_POLARIZATION){step.outputP = stokesOutput;}
+    else {throw runtime_error("Dynspec_Transform_Engine: not a polarization operation");}
+  }
+
+  bool Dynspec_Transform_Engine::needsBackground() const
+  {
+    for (unsigned int s=0;s<m_steps.size();s++)
+      {if (m_steps[s].operation == SUBTRACTION){return true;}}
+    return false;
+  }
+
+
+  void Dynspec_Transform_Engine::transformRow(float *row, const float *background, vector<float> &scratch) const
+  {
+    const unsigned long int nofValues(m_nofSpectral*m_nofStokes);
+    const long int S(m_nofStokes);
+    const long int N(m_nofSpectral);
+
+    for (unsigned int s=0;s<m_steps.size();s++)
+      {
+	const Step &step(m_steps[s]);
+
+	if (step.operation == SUBTRACTION)
+	  {
+	    const float kfactor(step.kfactor);
+	    #pragma omp simd
+	    for (unsigned long int i=0;i<nofValues;i++){row[i] = row[i]-(kfactor*background[i]);}
+	  }
+	else if (step.operation == NORMALIZATION)
+	  {
+	    const float *inverse(&step.inverse[0]);
+	    #pragma omp simd
+	    for (unsigned long int i=0;i<nofValues;i++){row[i] = row[i]*inverse[i];}
+	  }
+	else
+	  {
+	    // Q, U, V are read once in contiguous rows (vectorized), the results are written after (Q, U, V can be overwritten)
+	    float *linear(&scratch[0]);
+	    float *total(&scratch[N]);
+	    float *angle(&scratch[2*N]);
+	    #pragma omp simd
+	    for (long int J=0;J<N;J++)
+	      {
+		double Q(row[J*S+1]),U(row[J*S+2]),V(row[J*S+3]);
+		linear[J] = sqrt(Q*Q+U*U);
+		total[J] = sqrt(Q*Q+U*U+V*V);
+	      }
+	    if (step.outputPA >= 0)
+	      {
+		for (long int J=0;J<N;J++){angle[J] = 0.5*atanf(row[J*S+2]/row[J*S+1]);}
+	      }
+
+	    if (step.outputL >= 0){float *output(row+step.outputL); for (long int J=0;J<N;J++){output[J*S] = linear[J];}}
+	    if (step.outputPA >= 0){float *output(row+step.outputPA); for (long int J=0;J<N;J++){output[J*S] = angle[J];}}
+	    if (step.outputP >= 0){float *output(row+step.outputP); for (long int J=0;J<N;J++){output[J*S] = total[J];}}
+	  }
+      }
+  }
+
+
+  void Dynspec_Transform_Engine::transformChunk(float *DATA_3D, const float *BACKGROUND_3D, unsigned long int nofRows) const
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Transform_Engine::transformChunk(float *DATA_3D, const float *BACKGROUND_3D, unsigned long int nofRows) const
+  /// \param   DATA_3D [nofRows][nofSpectral][nofStokes] block, transformed in place
+  /// \param   BACKGROUND_3D block of the same shape subtracted (NULL if there is no subtraction)
+  /// \param   nofRows number of time bins of the block
+
+    if (needsBackground() && BACKGROUND_3D == NULL){throw runtime_error("Dynspec_Transform_Engine: the subtraction needs a background");}
+
+    const unsigned long int nofValues(m_nofSpectral*m_nofStokes);
+
+    // threads by time bins
+    #pragma omp parallel
+    {
+      vector<float> scratch(3*m_nofSpectral+1);	// L, P and PA of a time bin
+      #pragma omp for schedule(static)
+      for (long int I=0;I<(long int)nofRows;I++)
+	{
+	  transformRow(DATA_3D+I*nofValues,(BACKGROUND_3D != NULL) ? BACKGROUND_3D+I*nofValues : NULL,scratch);
+	}
+    }
+  }
+
+
+  void Dynspec_Transform_Engine::transform(Dataset<float> &input_grp, Dataset<float> *background_grp, Dataset<float> &data_grp, unsigned long int nofTime, float memoryRAM) const
+  {
+  /// <br /> Usage:
+  /// <br />   void Dynspec_Transform_Engine::transform(Dataset<float> &input_grp, Dataset<float> *background_grp, Dataset<float> &data_grp, unsigned long int nofTime, float memoryRAM) const
+  /// \param   &input_grp ICD6's DATA read
+  /// \param   *background_grp ICD6's DATA subtracted (NULL if there is no subtraction)
+  /// \param   &data_grp ICD6's DATA written (already created, same shape)
+  /// \param   nofTime number of time bins
+  /// \param   memoryRAM RAM memory consuption by processing (Go)
+
+    if (needsBackground() && background_grp == NULL){throw runtime_error("Dynspec_Transform_Engine: the subtraction needs a background");}
+
+    // define the time step for filling the dataset
+    unsigned long int sizeTimeLimit((1.08E6*memoryRAM)/(m_nofSpectral*m_nofStokes));	// time step ~ 1Go RAM memory maximum !
+    if (sizeTimeLimit < 1){sizeTimeLimit = 1;}
+    sizeTimeLimit = min(sizeTimeLimit,max(nofTime,1UL));
+
+    // the blocks are allocated once and transformed in place
+    vector<float> DATA_3D(sizeTimeLimit*m_nofSpectral*m_nofStokes);
+    vector<float> BACKGROUND_3D((background_grp != NULL) ? DATA_3D.size() : 0);
+
+    for (unsigned long int timePosition=0;timePosition<nofTime;timePosition+=sizeTimeLimit)
+      {
+	vector<size_t> pos(3);
+	pos[0] = timePosition;
+	pos[1] = 0;
+	pos[2] = 0;
+
+	vector<size_t> size(3);
+	size[0] = min(sizeTimeLimit,nofTime-timePosition);
+	size[1] = m_nofSpectral;
+	size[2] = m_nofStokes;
+
+	input_grp.getMatrix( pos, &DATA_3D[0], size );
+	if (background_grp != NULL){background_grp->getMatrix( pos, &BACKGROUND_3D[0], size );}
+
+	transformChunk(&DATA_3D[0],(background_grp != NULL) ? &BACKGROUND_3D[0] : NULL,size[0]);
+
+	data_grp.setMatrix( pos, &DATA_3D[0], size );
+      }
+  }
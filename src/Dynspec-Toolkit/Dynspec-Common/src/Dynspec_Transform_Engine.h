@@ -0,0 +1,83 @@
+#ifndef DEF_DYNSPEC_TRANSFORM_ENGINE
+#define DEF_DYNSPEC_TRANSFORM_ENGINE
+
+#include<string>
+#include<iostream>
+#include<vector>
+
+#include <dal/lofar/BF_File.h>
+
+
+/// \class Dynspec_Transform_Engine
+///  \brief Class object for applying a list of per-pixel operations (subtraction, normalization, polarization) to the ICD6's DATA in one pass
+///  \details
+/// <br /> Usage:
+/// <br /> This class is shared by the Dynspec-Tool transforms (ICD6-Linear-Polar, ICD6-Substraction). The operations are added in the
+/// order they are applied:
+/// <br />   addSubtraction(k): DATA - k x BACKGROUND (a second dynamic spectrum of the same shape, all Stokes)
+/// <br />   addNormalization(reference): DATA / reference, a value by frequency bin and Stokes ([frequency][Stokes], ex: a bandpass)
+/// <br />   addPolarization(LINEAR_POLARIZATION | POLARIZATION_ANGLE | TOTAL_POLARIZATION, stokesOutput): L = sqrt(Q^2+U^2),
+/// PA = 0.5 atan(U/Q) or P = sqrt(Q^2+U^2+V^2) written in the Stokes stokesOutput (Stokes I, Q, U, V are 0, 1, 2, 3).
+/// Consecutive polarization operations are computed together from the same Q, U, V.
+/// <br /> transformChunk applies the whole list to a [time][frequency][Stokes] block in place: each time bin is loaded once in
+/// cache and all operations are done on it by vectorized loops (OpenMP simd), the time bins being shared between OpenMP threads.
+/// transform reads an ICD6's DATA by time steps (memoryRAM), transforms them and writes them in the output DATA.
+
+
+using namespace dal;
+
+class Dynspec_Transform_Engine
+{
+  // Public Methods
+  public:
+
+    /// Per-pixel operation
+    enum Operation
+    {
+      SUBTRACTION,		///< DATA - k x BACKGROUND
+      NORMALIZATION,		///< DATA / reference
+      LINEAR_POLARIZATION,	///< L = sqrt(Q^2+U^2)
+      POLARIZATION_ANGLE,	///< PA = 0.5 atan(U/Q)
+      TOTAL_POLARIZATION	///< P = sqrt(Q^2+U^2+V^2)
+    };
+
+    Dynspec_Transform_Engine(unsigned long int nofSpectral, int nofStokes);
+    ~Dynspec_Transform_Engine();
+
+    void addSubtraction(float kfactor);
+    void addNormalization(const std::vector<float> &reference);
+    void addPolarization(Operation operation, int stokesOutput);
+
+    bool needsBackground() const;
+
+    void transformChunk(float *DATA_3D, const float *BACKGROUND_3D, unsigned long int nofRows) const;
+
+    void transform(Dataset<float> &input_grp, Dataset<float> *background_grp, Dataset<float> &data_grp, unsigned long int nofTime, float memoryRAM) const;
+
+
+  // Private Methods
+  private:
+
+    void transformRow(float *row, const float *background, std::vector<float> &scratch) const;
+
+
+  // Private Attributes
+  private:
+
+    /// One step of the list (consecutive polarization operations are one step)
+    struct Step
+    {
+      Operation operation;			///< SUBTRACTION, NORMALIZATION or LINEAR_POLARIZATION for all polarizations
+      float kfactor;
+      std::vector<float> inverse;		///< 1/reference ([frequency][Stokes])
+      int outputL;				///< Stokes written (-1: not computed)
+      int outputPA;
+      int outputP;
+    };
+
+    unsigned long int m_nofSpectral;
+    int m_nofStokes;
+    std::vector<Step> m_steps;
+};
+
+#endif
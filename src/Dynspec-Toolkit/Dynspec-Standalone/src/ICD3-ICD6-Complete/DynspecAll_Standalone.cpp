@@ -84,7 +84,7 @@ int main(int argc, char *argv[])
 {
   
   
-/// <br />Usage: Dynspec  Observation-Path-DIR  Observation-Number(ex:Lxxxxx) Output-hdf5-DIR [Facultative:Dataset-RAM-allocation (in Go; default value: 1Go)]
+/// <br />Usage: Dynspec  Observation-Path-DIR  Observation-Number(ex:Lxxxxx) Output-hdf5-DIR [Facultative:Dataset-RAM-allocation (in Go; default value: 1Go)] [Facultative: Data-Layout (ex: "chunk=0x0,filter=deflate:1,type=float32"; c.f Dynspec_Data_Layout)]
 
 /// \param argc Number of arguments
 /// \param argv Table of arguments(see above c.f Usage)
@@ -143,6 +143,11 @@ int main(int argc, char *argv[])
   int obsNofBeam(atof(argv[6]));    
   int obsNofStockes(atof(argv[7]));
   
+  string dataLayoutOption("");		// ICD6's DATA layout (c.f Dynspec_Data_Layout; facultative, default: chunked, not compressed)
+  if (argc > 8){dataLayoutOption = argv[8];}
+  Dynspec_Data_Layout dataLayout(dataLayoutOption);
+  cout << "DATA layout: " << dataLayout.description() << endl;
+  
   
 
   
@@ -255,7 +260,7 @@ int main(int argc, char *argv[])
 		    delete dynspecMetadata;
 		    
 		    //WRITE DATA
-		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,obsNofStockes,stokesComponent,memoryRAM,listOfFiles);
+		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,l,obsNofStockes,stokesComponent,memoryRAM,listOfFiles,"DYNSPEC_"+index_k1,dataLayout);
 		    delete dynspecData;	
 		    
 		    k++;
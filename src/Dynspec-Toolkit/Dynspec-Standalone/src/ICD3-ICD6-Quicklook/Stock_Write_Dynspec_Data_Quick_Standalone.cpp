@@ -4,6 +4,8 @@
 #include <unistd.h>
 
 #include "Stock_Write_Dynspec_Data_Quick_Standalone.h"
+#include "Dynspec_Rebin_Engine.h"
+#include "Dynspec_Pyramid.h"
 
 #include <dal/lofar/BF_File.h>
 
@@ -53,7 +55,7 @@ using namespace std;
   } 
   
   
-  void Stock_Write_Dynspec_Data_Quick_Standalone::writeDynspecData(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int obsNofStockes,vector<string> stokesComponent,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin, float dataTimePercent, float dataSpectralPercent,  vector<string> listOfFiles)  
+  void Stock_Write_Dynspec_Data_Quick_Standalone::writeDynspecData(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int obsNofStockes,vector<string> stokesComponent,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin, float dataTimePercent, float dataSpectralPercent,  vector<string> listOfFiles,string dynspecName, const Dynspec_Data_Layout &dataLayout)  
   {
   /// <br /> Usage:
   /// <br />   void Stock_Write_Dynspec_Data_Quick_Standalone::writeDynspecData(Group &dynspec_grp,string pathDir,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin)  
@@ -78,6 +80,8 @@ using namespace std;
   /// \param  frequencyMin frequency minimum selected
   /// \param  frequencyMax frequency maximum selected
   /// \param  frequencyRebin frequency binning
+  /// \param  dynspecName dynamic spectrum group (DATA is created in it)
+  /// \param  dataLayout chunks, compression and storage type of DATA (Dynspec_Data_Layout)
 
 
 	    int pathFileSize(pathFile.length());			// to be sure  
@@ -201,93 +205,35 @@ using namespace std;
             
       // generating the dataset
       
+      dataLayout.createData(outputFile,dynspecName,m_Ntime,m_Nspectral,obsNofStockes);	// chunked layout, then opened by DAL
       Dataset<float> data_grp(dynspec_grp, "DATA");
-      vector<ssize_t> dimensions(3);
-      dimensions[0] = m_Ntime;
-      dimensions[1] = m_Nspectral;
-      dimensions[2] = obsNofStockes;      
-      data_grp.create( dimensions );
+      Dynspec_Pyramid pyramid(m_Ntime,m_Nspectral,obsNofStockes,dataLayout.pyramidLevels());	// DATA decimated by 2, 4, 8... (PYRAMID group)
+      pyramid.create(dynspec_grp,outputFile,dynspecName,dataLayout);
       
      
       
-      // generating the quick look
+      // generating the quick look: the 4 polarization files (Xr, Xi, Yr, Yi) are opened once and converted to I,
+      // every second gives one time bin (nofTimeToSumEverySecond samples and nofSpectralToSumEverySubband channels
+      // around the middle of each subband are summed)
 
-      vector<float> DATA_3DPol(nofTimeToSumEverySecond*CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP*4);
+      int spectralOffset((middlesubband-nofSpectralToSumEverySubband/2)-1);
+      if (spectralOffset < 0){spectralOffset=0;}
+
+      Dynspec_Rebin_Engine engine(4,CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP,Dynspec_Rebin_Engine::XY_TO_I);
+      engine.setRebin(nofTimeToSumEverySecond,m_Nspectral,nofSpectralToSumEverySubband,CHANNELS_PER_SUBANDS_TEMP,spectralOffset);
+      for (int l=0;l<4;l++) 
+	{
+	  pathFile 	= listOfFiles[l+j*l];
+	  engine.addPart(l,pathFile,i,j,0,CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP);
+	}
       
       vector<float> DATA_3D(m_Ntime*m_Nspectral*obsNofStockes);
-      vector<float> DATA_2D(nofTimeToSumEverySecond*CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP);
-      
       
       for (p=0;p<m_Ntime;p++)
 	     {	      
-	      
-	      for (int l=0;l<4;l++) 
-		{
-		    pathFile 	= listOfFiles[l+j*l];
-		  
-		    BF_File file(pathFile);  							// generate an object called file contains Root
-		    BF_SubArrayPointing SAP 		= file.subArrayPointing(i);		// generate an object called SAP contains subarray pointings
-		    BF_BeamGroup BEAM			= SAP.beam(j);      	       
-		      
-		    BF_StokesDataset STOCKES 	= BEAM.stokes(l);	// generate an object called STOCKES contains stockes data  
-      
-		    
-		    vector<size_t> pos(2);
-		    pos[0]=p*stepForOneSecond;
-		    pos[1]=0;	       
-		    
-		    
-		    vector<size_t> size(2);
-		    size[0] = nofTimeToSumEverySecond;
-		    size[1] = CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP;
-	
-	      
-	      
-		    STOCKES.getMatrix( pos, &DATA_2D[0], size );
-	      
-		    
-		    for (int r=0;r<nofTimeToSumEverySecond;r++)
-			{
-			  for (int n=0;n<nofSpectralToSumEverySubband;n++)
-			    {		  			  
-				if (l==0){DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)]=DATA_2D[(r*m_Nspectral)+n];}
-				if (l==1){DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA_2D[(r*m_Nspectral)+n];}
-				if (l==2){DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA_2D[(r*m_Nspectral)+n];}
-				if (l==3){DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA_2D[(r*m_Nspectral)+n];}
-			    }	  
-			}
-				  
-		    
-		}
-		
-		
-		
-		for (int r=0;r<nofTimeToSumEverySecond;r++)
-		  {
-		    for (int n=0;n<nofSpectralToSumEverySubband;n++)
-		      {		  			  
-			  DATA_2D[(r*m_Nspectral)+n]	= (pow(DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)],2) + pow(DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)+1],2) + pow(DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)+2],2) + pow(DATA_3DPol[obsNofStockes*((m_Nspectral*r)+n)+3],2))/2.0;	
-		      }	  
-		  }		
-		    
-	      
-	      
-	      float rebinPixel(0);
-	      for (int J=0;J<m_Nspectral;J++)
-		  {
-		    rebinPixel=0;
-		    
-		    for (int K=0;K<nofTimeToSumEverySecond;K++)
-		      {
-			  for (int L=0;L<nofSpectralToSumEverySubband;L++)
-			      {
-				rebinPixel = rebinPixel+DATA_2D[(middlesubband-nofSpectralToSumEverySubband/2)-1+L+K*CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP+J*CHANNELS_PER_SUBANDS_TEMP];
- 		      		//cout << (middlesubband-nofSpectralToSumEverySubband/2)-1+L+K*CHANNELS_PER_SUBANDS_TEMP*NOF_SUBBANDS_TEMP+J*CHANNELS_PER_SUBANDS_TEMP << endl;
-			      }
-		      }
-		      DATA_3D[p*m_Nspectral+J]=rebinPixel/(nofTimeToSumEverySecond*nofSpectralToSumEverySubband);	      
-		  }
+	      engine.addChunk(p,1,p*stepForOneSecond,1);
 	     }
+      engine.processChunks(&DATA_3D[0]);	// the next second is loaded while the current one is rebinned
 	     
 	     vector<size_t> data_grp_size(3);
 	     vector<size_t> data_grp_pos(3);
@@ -302,6 +248,8 @@ using namespace std;
 		  
 
 	     data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );	     
+	     pyramid.addRows(&DATA_3D[0],m_Ntime);
+	     pyramid.finish();
 	     
 
 	    //META-DATA in DATA  writter
@@ -325,12 +273,8 @@ using namespace std;
 	    }
 	    else  // if .raw don't exists
 	    {  
+	        dataLayout.createData(outputFile,dynspecName,m_Ntime,m_Nspectral,obsNofStockes);	// chunked layout, then opened by DAL
 	        Dataset<float> data_grp(dynspec_grp, "DATA");
-		vector<ssize_t> dimensions(3);
-		dimensions[0] = m_Ntime;
-		dimensions[1] = m_Nspectral;
-		dimensions[2] = obsNofStockes;      
-		data_grp.create( dimensions );
 	    }
 	    
 	  	    
@@ -87,7 +87,7 @@ using namespace std;
 int main(int argc, char *argv[])
 {
 
-/// <br />Usage: DynspecPart Observation-Path-DIRObservation-Number(ex:Lxxxxx) Output-hdf5-DIR TimeMin TimeMax TimeRebin(s/pixel) FrequencyMin FrequencyMax FrequencyRebin(MHz/pixel) RebinAll(yes or no) [Facultative: Dataset-RAM-allocation (in Go; default value: 1Go) NumberOfSAP(if No, number of SAP to rebin/ if yes put 0 as default Value))] 
+/// <br />Usage: DynspecPart Observation-Path-DIRObservation-Number(ex:Lxxxxx) Output-hdf5-DIR TimeMin TimeMax TimeRebin(s/pixel) FrequencyMin FrequencyMax FrequencyRebin(MHz/pixel) RebinAll(yes or no) [Facultative: Dataset-RAM-allocation (in Go; default value: 1Go) NumberOfSAP(if No, number of SAP to rebin/ if yes put 0 as default Value))] [Facultative: Data-Layout (ex: "chunk=0x0,filter=deflate:1,type=float32"; c.f Dynspec_Data_Layout)]
 
 /// \param argc Number of arguments
 /// \param argv Table of arguments(see above c.f Usage)
@@ -164,6 +164,11 @@ int main(int argc, char *argv[])
   int obsNofBeam(atof(argv[12]));    
   int obsNofStockes(atof(argv[13]));
   
+  string dataLayoutOption("");		// ICD6's DATA layout (c.f Dynspec_Data_Layout; facultative, default: chunked, not compressed)
+  if (argc > 14){dataLayoutOption = argv[14];}
+  Dynspec_Data_Layout dataLayout(dataLayoutOption);
+  cout << "DATA layout: " << dataLayout.description() << endl;
+  
  
 
   int i(0);
@@ -280,7 +285,7 @@ int main(int argc, char *argv[])
 		    delete dynspecMetadata;
 
 		    //WRITE DATA
-		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,obsNofStockes,stokesComponent,memoryRAM, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin, listOfFiles);
+		    dynspecData->writeDynspecData(dynspec_grp,obsName,pathFile,outputFile,root_grp,i,j,k,obsNofStockes,stokesComponent,memoryRAM, timeMinSelect, timeMaxSelect, timeRebin, frequencyMin, frequencyMax, frequencyRebin, listOfFiles,"DYNSPEC_"+index_k1,dataLayout);
 		    delete dynspecData;
 
 		    k++;
@@ -3,6 +3,8 @@
 #include <fstream>
 
 #include "Stock_Write_Dynspec_Data_Part_Standalone.h"
+#include "Dynspec_Rebin_Engine.h"
+#include "Dynspec_Pyramid.h"
 
 #include <dal/lofar/BF_File.h>
 
@@ -52,7 +54,7 @@ using namespace std;
   } 
   
   
-  void Stock_Write_Dynspec_Data_Part_Standalone::writeDynspecData(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int obsNofStockes,vector<string> stokesComponent,float memoryRAM,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin, vector<string> listOfFiles)
+  void Stock_Write_Dynspec_Data_Part_Standalone::writeDynspecData(Group &dynspec_grp,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int obsNofStockes,vector<string> stokesComponent,float memoryRAM,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin, vector<string> listOfFiles,string dynspecName, const Dynspec_Data_Layout &dataLayout)
   {
   /// <br /> Usage:
   /// <br />   void Stock_Write_Dynspec_Data_Part_Standalone::writeDynspecData(Group &dynspec_grp,string pathDir,string obsName,string pathFile,string outputFile,File &root_grp,int i,int j,int k,int l,int q,int obsNofStockes,vector<string> stokesComponent,float memoryRAM, int SAPindex,float timeMinSelect,float timeMaxSelect,float timeRebin,float frequencyMin,float frequencyMax,float frequencyRebin)  
@@ -77,6 +79,8 @@ using namespace std;
   /// \param  frequencyMin frequency minimum selected
   /// \param  frequencyMax frequency maximum selected
   /// \param  frequencyRebin frequency binning
+  /// \param  dynspecName dynamic spectrum group (DATA is created in it)
+  /// \param  dataLayout chunks, compression and storage type of DATA (Dynspec_Data_Layout)
 
 
 
@@ -171,10 +175,11 @@ using namespace std;
       
       ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
       // define the time step for filling the dataset
-      int l(0),n(0);
-      unsigned long int p(0),r(0);
+      int l(0);
+      unsigned long int p(0);
       
-      unsigned long int sizeTimeLimit((1.08E6*memoryRAM)/((spectralIndexStop-spectralIndexStart+1)*obsNofStockes));	// time step ~ 1Go RAM memory maximum !        
+      // two time steps of ICD3 data in memory (one prefetched) + the rebinned block ~ memoryRAM Go maximum !
+      unsigned long int sizeTimeLimit(Dynspec_Rebin_Engine::timeStep(memoryRAM,obsNofStockes,spectralIndexStop-spectralIndexStart+1,timeIndexIncrementRebin,Nspectral,obsNofStockes));
       
       // SizeTimeLimit must be a multiple of Time Rebin for well cycling and avoid to lost data
       unsigned long int timeFactor(sizeTimeLimit/timeIndexIncrementRebin);
@@ -198,311 +203,59 @@ using namespace std;
             
       // generating the dataset
 
-      unsigned long int m_Nspectral_longversion(m_Nspectral);
-      
+      dataLayout.createData(outputFile,dynspecName,m_Ntime,m_Nspectral,obsNofStockes);	// chunked layout, then opened by DAL
       Dataset<float> data_grp(dynspec_grp, "DATA");
-      vector<ssize_t> dimensions(3);
-      dimensions[0] = m_Ntime;
-      dimensions[1] = m_Nspectral;
-      dimensions[2] = obsNofStockes;      
-      data_grp.create( dimensions );
+      Dynspec_Pyramid pyramid(m_Ntime,m_Nspectral,obsNofStockes,dataLayout.pyramidLevels());	// DATA decimated by 2, 4, 8... (PYRAMID group)
+      pyramid.create(dynspec_grp,outputFile,dynspecName,dataLayout);
 
       
+      // Open the polarization files (Xr, Xi, Yr, Yi) once for all time steps: the engine converts them to I, Q, U & V 
+      // for each sample, and does NOW (and not before) the rebinning
+      Dynspec_Rebin_Engine engine(obsNofStockes,spectralIndexStop-spectralIndexStart+1,Dynspec_Rebin_Engine::XY_TO_IQUV);
+      engine.setRebin(timeIndexIncrementRebin,m_Nspectral,spectralIndexIncrementRebin);
 
-      
-      
+      for (l=0;l<obsNofStockes;l++)
+	{
+	    pathFile 	= listOfFiles[l+j*l];
+	    
+	    int pathFileSize(pathFile.length());
+	    string pathDir(pathFile.substr(0,pathFileSize-2));
+	    string pathRaw(pathDir+"raw");	  
+	    
+	    if ( is_readable( pathRaw ) ) 
+	    { 			    
+		engine.addPart(l,pathFile,i,j,spectralIndexStart,spectralIndexStop-spectralIndexStart+1);
+	    }
+	    else
+	    {
+		Group process_histo_grp(dynspec_grp, "PROCESS_HISTORY");
+		Attribute<string> missedData(process_histo_grp, "MISSED DATA");
+		missedData.value = stokesComponent[l];
+		cout << "RAW DATA are missing for SAP: " << i  << "  BEAM: " << j << " Stokes: " << l << endl;
+	    }
+	}
+      
+      
+      //Schedule the time steps, then write them (set to 0 if a polarization is missing)
       for (p=0;p<fracTime;p++)
       {
-	      // Final vector for 3D DataSet
-	      vector<float> DATA_3D(sizeTimeLimit*m_Nspectral*obsNofStockes/timeIndexIncrementRebin);
-	      
-	      // Vector for store 2D matrixes in 3D matrix with Stokes Parameters
-	      vector<float> DATA_Pol_Norebin(sizeTimeLimit*(spectralIndexStop-spectralIndexStart+1)*obsNofStockes);
-	      // Vector for store 2D matrixes in 3D matrix with Polarization Parameters
-	      vector<float> DATA_3D_NoRebin(sizeTimeLimit*(spectralIndexStop-spectralIndexStart+1)*obsNofStockes);
-	      
-	      
-	      if (p==fracTime-1)
-	      {
-		  if (nofLastElements > 0)
-		    {	// Resizing for last time data serie
-			DATA_3D.resize(nofLastElements*m_Nspectral*obsNofStockes/timeIndexIncrementRebin);
-			
-			DATA_Pol_Norebin.resize(nofLastElements*(spectralIndexStop-spectralIndexStart+1)*obsNofStockes);			  
-			DATA_3D_NoRebin.resize(nofLastElements*(spectralIndexStop-spectralIndexStart+1)*obsNofStockes);
-		    }
-	      }	    
- 	      
-
- 	      // Start loop on Stokes
-	      for (l=0;l<obsNofStockes;l++)
-		{
-		    double size3D(sizeTimeLimit*(spectralIndexStop-spectralIndexStart+1));
-
-		    // Vector for storing Polarization matrix without rebinning
-		    vector<float> DATA_2D(size3D);
-		    
-
-		    // Resizing for last time data serie
-		    if (p==fracTime-1){
-			if (nofLastElements > 0){
-				DATA_2D.resize(nofLastElements * m_NspectralReal);
-				for (r=0;r<nofLastElements * m_NspectralReal;r++){DATA_2D[r]=0;}}} 
-		    
-		    
-		    pathFile 	= listOfFiles[l+j*l];
-		    
- 		    int pathFileSize(pathFile.length());
-		    string pathDir(pathFile.substr(0,pathFileSize-2));
-		    string pathRaw(pathDir+"raw");	  
-		    
-		    if ( is_readable( pathRaw ) ) 
-		    { 			    
-
-			    //Load Stokes data
-			    
-			    BF_File file(pathFile);  							// generate an object called file contains Root
-			    BF_SubArrayPointing SAP 		= file.subArrayPointing(i);		// generate an object called SAP contains subarray pointings
-			    BF_BeamGroup BEAM			= SAP.beam(j);      			// generate an object called BEAM contains Beams
-			    
-
-			    BF_StokesDataset STOCKES 		= BEAM.stokes(l);			// generate an object called STOCKES contains stockes data  
-			  
- 
-			    //Load 2D Stockes data in a 2D array DATA0 with DAL and stock data in DATA3D for writting (by time step)     
-			    if (p!=fracTime-1)
-			      {    
-				vector<size_t> pos(2);
-				pos[0]=p*sizeTimeLimit+timeIndexStart;
-				pos[1]=spectralIndexStart;
-			  
-				vector<size_t> size(2);
-				size[0] = sizeTimeLimit;
-				size[1] = (spectralIndexStop-spectralIndexStart+1);
-			      		
-				STOCKES.getMatrix( pos, &DATA_2D[0], size );
-				
-				for (r=0;r<sizeTimeLimit;r++)
-				  {
-				    for (n=0;n<m_Nspectral;n++)
-				      {		  			  
-					if (l==0){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)]=DATA_2D[(r*m_Nspectral)+n];}
-					if (l==1){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA_2D[(r*m_Nspectral)+n];}
-					if (l==2){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA_2D[(r*m_Nspectral)+n];}
-					if (l==3){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA_2D[(r*m_Nspectral)+n];}					
-				      }	  
-				  }
-				}
-			      else
-				{
-				  if (nofLastElements > 0)
-				    {		  
-				      vector<size_t> pos(2);
-				      pos[0]=p*sizeTimeLimit;
-				      pos[1]=0;
-			    
-				      vector<size_t> size(2);
-				      size[0] = nofLastElements;
-				      size[1] = m_Nspectral;
-				  
-				      STOCKES.getMatrix( pos, &DATA_2D[0], size );
-					      
-				      for (r=0;r<nofLastElements;r++)
-					{
-					  for (n=0;n<m_Nspectral;n++)
-					    {		  			  
-					      if (l==0){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)]=DATA_2D[(r*m_Nspectral)+n];}
-					      if (l==1){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1]=DATA_2D[(r*m_Nspectral)+n];}
-					      if (l==2){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2]=DATA_2D[(r*m_Nspectral)+n];}
-					      if (l==3){DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3]=DATA_2D[(r*m_Nspectral)+n];}
-								      
-					    }	  
-					}
-				    }
-			      } // end loop of else
-				
-
- 
-			} // end of Existing test 
-			else
-			{
-
-			Group process_histo_grp(dynspec_grp, "PROCESS_HISTORY");
-			Attribute<string> missedData(process_histo_grp, "MISSED DATA");
-			missedData.value = stokesComponent[l];
-			cout << "RAW DATA are missing for SAP: " << i  << "  BEAM: " << j << " Stokes: " << l << endl;
- 			       
-			}// end of else existing test			      
-
-		   }  //end loop on l (Stockes)// data are loaded in 3DNoRebin array
-		   
-		   
-		   
-		  
-	      //Convert to I,U,Q & V
- 
-	      for (l=0;l<obsNofStockes;l++)
-		{ 
-		    if (p!=fracTime-1)
-		      {    				    
-			for (r=0;r<sizeTimeLimit;r++)
-			  {
-			    for (n=0;n<m_Nspectral;n++)
-			      {		  
-			      if (l==0){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)]   = ( pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3],2.0)       )/2.0;}									 
-			      if (l==1){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)+1] = ( pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1],2.0) - pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2],2.0) - pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3],2.0)       )/2.0;}
-			      if (l==2){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)+2] = ((DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2])+(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3]));}
-			      if (l==3){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)+3] = ((DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3])-(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2]));}				
-			      				
-			      }
-			  }
-		      }
-			      
-		      else
-			{
-			  if (nofLastElements > 0)
-			    {		  
-			      for (r=0;r<nofLastElements;r++)
-				  {
-				    for (n=0;n<m_Nspectral;n++)
-					{		  			  
-					    if (l==0){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)]   = ( pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3],2.0)       )/2.0;}									 
-					    if (l==1){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)+1] = ( pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)],2.0) + pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1],2.0) - pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2],2.0) - pow(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3],2.0)       )/2.0;}
-					    if (l==2){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)+2] = ((DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2])+(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3]));}
-					    if (l==3){DATA_Pol_Norebin[obsNofStockes*((m_Nspectral*r)+n)+3] = ((DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+3])-(DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+1]*DATA_3D_NoRebin[obsNofStockes*((m_Nspectral*r)+n)+2]));}				
-											
-					}
-				  }
-			    }
-			} // end loop of else 
- 
-		} // end loop on l
-		
-		
- 
-		// Do NOW (and not before) the rebinning !!
-		
-		for (l=0;l<obsNofStockes;l++)
-		  { 
-		      if (p!=fracTime-1)
-			{		
-				for (unsigned long int I=0;I<sizeTimeLimit/timeIndexIncrementRebin;I++)
-				  {
-				    for (unsigned long int J=0;J<m_Nspectral_longversion;J++)
-				      { 
-					float rebinPixel = 0;
-					for (unsigned long int K=0;K<timeIndexIncrementRebin;K++)
-					    {
-					      for (unsigned long int L=0;L<spectralIndexIncrementRebin;L++)
-						{	 
-						  if (l==0){rebinPixel = rebinPixel + DATA_Pol_Norebin[(L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4];}						
-						  if (l==1){rebinPixel = rebinPixel + DATA_Pol_Norebin[((L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4)+1];}
-						  if (l==2){rebinPixel = rebinPixel + DATA_Pol_Norebin[((L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4)+2];}
-						  if (l==3){rebinPixel = rebinPixel + DATA_Pol_Norebin[((L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4)+3];}
-						}
-					    }	
-					    if (l==0){DATA_3D[(I*m_Nspectral+J)*4]	= rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					    if (l==1){DATA_3D[((I*m_Nspectral+J)*4)+1]	= rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					    if (l==2){DATA_3D[((I*m_Nspectral+J)*4)+2] = rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					    if (l==3){DATA_3D[((I*m_Nspectral+J)*4)+3]	= rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					 }
-				  }
-			}// end if p!=fracTime-1)
-		      else
-		      {
-			if (nofLastElements > 0)
-			    {
-				for (unsigned long int I=0;I<nofLastElements/timeIndexIncrementRebin;I++)
-				  {
-				    for (unsigned long int J=0;J<m_Nspectral_longversion;J++)
-				      { 
-					float rebinPixel = 0;
-					for (unsigned long int K=0;K<timeIndexIncrementRebin;K++)
-					  {
-					    for (unsigned long int L=0;L<spectralIndexIncrementRebin;L++)
-						{	 
-						  if (l==0){rebinPixel = rebinPixel + DATA_Pol_Norebin[(L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4];}						
-						  if (l==1){rebinPixel = rebinPixel + DATA_Pol_Norebin[((L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4)+1];}
-						  if (l==2){rebinPixel = rebinPixel + DATA_Pol_Norebin[((L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4)+2];}
-						  if (l==3){rebinPixel = rebinPixel + DATA_Pol_Norebin[((L+K*(spectralIndexStop-spectralIndexStart+1)+J*spectralIndexIncrementRebin+I*timeIndexIncrementRebin*(spectralIndexStop-spectralIndexStart+1))*4)+3];}
-						}
-					    }	
-					    if (l==0){DATA_3D[(I*m_Nspectral+J)*4]	= rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					    if (l==1){DATA_3D[((I*m_Nspectral+J)*4)+1]	= rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					    if (l==2){DATA_3D[((I*m_Nspectral+J)*4)+2] = rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					    if (l==3){DATA_3D[((I*m_Nspectral+J)*4)+3]	= rebinPixel/(timeIndexIncrementRebin*spectralIndexIncrementRebin);}
-					 }
-				  }			
-			    }
-		      }
-				  
-	  
-				  
-			
-		  } // end loop on l for rebinning
-		  
-
-		  
-		
-		//Write data by time steps	
-		if (p!=fracTime-1)
-		  {	  
-		    
-		    vector<size_t> data_grp_size(3);
-		    vector<size_t> data_grp_pos(3);
-
-		    data_grp_pos[0] = p*sizeTimeLimit/timeIndexIncrementRebin;
-		    data_grp_pos[1] = 0;
-		    data_grp_pos[2] = 0;   	  
-		
-		    data_grp_size[0] = sizeTimeLimit/timeIndexIncrementRebin;
-		    data_grp_size[1] = m_Nspectral;
-		    data_grp_size[2] = obsNofStockes;
-		  
-
-		    data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
-
-		  }
-		else
-		  {	
-		    if (nofLastElements > 0)
-		      {
-			vector<size_t> data_grp_size(3);
-			vector<size_t> data_grp_pos(3);
-
-			data_grp_pos[0] = p*sizeTimeLimit/timeIndexIncrementRebin;
-			
-			data_grp_pos[1] = 0;
-			data_grp_pos[2] = 0;   	  
-		
-			
-			if (  (m_Ntime-(p*sizeTimeLimit/timeIndexIncrementRebin)) == (nofLastElements/timeIndexIncrementRebin) )
-			{
-			
-			    data_grp_size[0] = (nofLastElements/timeIndexIncrementRebin);
-			    data_grp_size[1] = m_Nspectral;
-			    data_grp_size[2] = obsNofStockes;
-			    			    
-			    data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
-			}
-			else
-			{
-			    data_grp_size[0] = m_Ntime-(p*sizeTimeLimit/timeIndexIncrementRebin);
-			    data_grp_size[1] = m_Nspectral;
-			    data_grp_size[2] = obsNofStockes;
-			    			    
-			    data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
-			}
-			    
-			
-			
-		      }
-		  }    
-	
-
-	
-	
-	      } // end loop on p (time step)
+	unsigned long int timePosition(p*sizeTimeLimit/timeIndexIncrementRebin);
+	unsigned long int nofRows(sizeTimeLimit/timeIndexIncrementRebin);
+	unsigned long int nofRowsWritten(nofRows);
+
+	if (p==fracTime-1)
+	  {
+	    if (nofLastElements == 0 || timePosition >= (unsigned long int)m_Ntime){break;}
+	    nofRows = nofLastElements/timeIndexIncrementRebin;
+	    nofRowsWritten = m_Ntime-timePosition;
+	  }
+
+	engine.addChunk(timePosition,nofRowsWritten,p*sizeTimeLimit+timeIndexStart,nofRows);
+
+      } // end loop on p (time step)
+      engine.setPyramid(&pyramid);	// the levels are written with each time step
+      engine.writeChunks(data_grp);	// the next time step is loaded while the current one is rebinned and written
+      pyramid.finish();
 	      
 	      	      
 	    //META-DATA in DATA  writter
@@ -4,6 +4,7 @@
 #include <math.h>
 
 #include "Stock_Write_Dynspec_Data_Linear_Polar.h"
+#include "Dynspec_Transform_Engine.h"
 
 #include <dal/lofar/BF_File.h>
 
@@ -106,133 +107,12 @@ using namespace std;
       
       
 
-  // define the time step for filling the dataset
-  int p(0),r(0),n(0);
-  
-  
-  int sizeTimeLimit((1.08E6*memoryRAM)/(m_Nspectral*nbSTOkES));	// time step ~ 1Go RAM memory maximum !
-  int fracTime((m_Ntime/sizeTimeLimit)+1);
-  int nofLastElements((m_Ntime)-((fracTime-1)*sizeTimeLimit));
-      
-            
-      for (p=0;p<fracTime;p++)
-	{
-	 
-	  vector<float> DATA_3D_File1(sizeTimeLimit*m_Nspectral*nbSTOkES);    
-	  vector<float> DATA_3D_Linear(sizeTimeLimit*m_Nspectral*nbSTOkES);
-
-	  if (p==fracTime-1){if (nofLastElements > 0){DATA_3D_File1.resize(nofLastElements*m_Nspectral*nbSTOkES);}}	  
-	  if (p==fracTime-1){if (nofLastElements > 0){DATA_3D_Linear.resize(nofLastElements*m_Nspectral*nbSTOkES);}}	  
-	  
-
-	  
-	  // Get matrixes NOW!!
-	  
-	      if (p!=fracTime-1)
-		{ 	  
-		  vector<size_t> pos(3);
-		  pos[0]=p*sizeTimeLimit;
-		  pos[1]=0;
-		  pos[2]=0;
-	    
-		  vector<size_t> size(3);
-		  size[0] = sizeTimeLimit;
-		  size[1] = m_Nspectral;
-		  size[2] = nbSTOkES;
-     
-		  STOCKES1.get3D( pos, &DATA_3D_File1[0], size[0],size[1],size[2] );	  
-		    
-		}
-	      else
-		{
-		  if (nofLastElements > 0)
-		    {	
-		      
-			vector<size_t> pos(3);
-			pos[0]=p*sizeTimeLimit;
-			pos[1]=0;
-			pos[2]=0;
-		  
-			vector<size_t> size(3);
-			size[0] = nofLastElements;
-			size[1] = m_Nspectral;
-			size[2] = nbSTOkES;
-	  
-			STOCKES1.get3D( pos, &DATA_3D_File1[0], size[0],size[1],size[2] );	
-		    }
-		}
-		 		 
-	  // Convert to I,Lin, PA, TOTAL
-	  
-	  
-	  if (p!=fracTime-1)
-	    {    	  
-	      for (r=0;r<sizeTimeLimit;r++)
-		  {
-		    for (n=0;n<m_Nspectral;n++)
-		      {		  			  			
-			
-			DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)] 	= DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)];			
-			DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)+1]	= sqrt(pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+1],2)+pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+2],2));			
-			DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)+2]	= 0.5*atan((DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+2])/(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+1]));			
-			DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)+3]	= sqrt(pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+1],2)+pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+2],2)+pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+3],2));					
-		      }
-		  }
-	    }			
-	   else
-	     {
-		if (nofLastElements > 0)
-		    {		  
-		      for (r=0;r<nofLastElements;r++)
-			{
-			  for (n=0;n<m_Nspectral;n++)
-			    {		  			  			      
-			      DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)] 	= DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)];			      
-			      DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)+1]	= sqrt(pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+1],2)+pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+2],2));			      
-			      DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)+2]	= 0.5*atan((DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+2])/(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+1]));			      
-			      DATA_3D_Linear[nbSTOkES*((m_Nspectral*r)+n)+3]	= sqrt(pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+1],2)+pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+2],2)+pow(DATA_3D_File1[nbSTOkES*((m_Nspectral*r)+n)+3],2));		      
-			    }
-			}
-		    }
-	     }		 
-		 
-
-	  // Write data by time steps	
-	  if (p!=fracTime-1)
-	    {	  
-	      vector<size_t> data_grp_size(3);
-	      vector<size_t> data_grp_pos(3);
-
-	      data_grp_pos[0] = p*sizeTimeLimit;
-	      data_grp_pos[1] = 0;
-	      data_grp_pos[2] = 0;   	  
-	  
-	      data_grp_size[0] = sizeTimeLimit;
-	      data_grp_size[1] = m_Nspectral;
-	      data_grp_size[2] = nbSTOkES;
-	    
-	      data_grp.setMatrix( data_grp_pos, &DATA_3D_Linear[0], data_grp_size );
-	    }
-	  else
-	    {		  
-	      if (nofLastElements > 0)
-		{
-		  vector<size_t> data_grp_size(3);
-		  vector<size_t> data_grp_pos(3);
-
-		  data_grp_pos[0] = p*sizeTimeLimit;
-		  data_grp_pos[1] = 0;
-		  data_grp_pos[2] = 0;   	  
-	  
-		  data_grp_size[0] = nofLastElements;
-		  data_grp_size[1] = m_Nspectral;
-		  data_grp_size[2] = nbSTOkES;
-	    
-		  data_grp.setMatrix( data_grp_pos, &DATA_3D_Linear[0], data_grp_size );		    
-		}
-	    }
-
-	} // end loop on p (time step)
+  // Convert to I, Lin, PA, TOTAL by time steps: one read of DATA, all operations in one pass (c.f Dynspec_Transform_Engine)
+  Dynspec_Transform_Engine engine(m_Nspectral,nbSTOkES);
+  engine.addPolarization(Dynspec_Transform_Engine::LINEAR_POLARIZATION,1);
+  engine.addPolarization(Dynspec_Transform_Engine::POLARIZATION_ANGLE,2);
+  engine.addPolarization(Dynspec_Transform_Engine::TOTAL_POLARIZATION,3);
+  engine.transform(STOCKES1,NULL,data_grp,m_Ntime,memoryRAM);
 
 	      
 	      	      
@@ -3,6 +3,7 @@
 #include <fstream>
 
 #include "Stock_Write_Dynspec_Data_Substraction.h"
+#include "Dynspec_Transform_Engine.h"
 
 #include <dal/lofar/BF_File.h>
 
@@ -113,116 +114,10 @@ using namespace std;
       
       
 
-  // define the time step for filling the dataset
-  int p(0),i(0);
-  
-  
-  int sizeTimeLimit((1.08E6*memoryRAM)/(m_Nspectral*nbSTOkES));	// time step ~ 1Go RAM memory maximum !
-  int fracTime((m_Ntime/sizeTimeLimit)+1);
-  int nofLastElements((m_Ntime)-((fracTime-1)*sizeTimeLimit));
-      
-            
-      for (p=0;p<fracTime;p++)
-	{
-	 
-	  vector<float> DATA_3D_File1(sizeTimeLimit*m_Nspectral*nbSTOkES);    
-	  vector<float> DATA_3D_File2(sizeTimeLimit*m_Nspectral*nbSTOkES);
-	  vector<float> DATA_3D(sizeTimeLimit*m_Nspectral*nbSTOkES);	  
-
-	  if (p==fracTime-1){if (nofLastElements > 0){DATA_3D_File1.resize(nofLastElements*m_Nspectral*nbSTOkES);}}	  
-	  if (p==fracTime-1){if (nofLastElements > 0){DATA_3D_File2.resize(nofLastElements*m_Nspectral*nbSTOkES);}}	  
-	  if (p==fracTime-1){if (nofLastElements > 0){DATA_3D.resize(nofLastElements*m_Nspectral*nbSTOkES);}}	  
-	  
-
-	  
-	  // Get matrixes NOW!!
-	  
-	      if (p!=fracTime-1)
-		{ 	  
-		  vector<size_t> pos(3);
-		  pos[0]=p*sizeTimeLimit;
-		  pos[1]=0;
-		  pos[2]=0;
-	    
-		  vector<size_t> size(3);
-		  size[0] = sizeTimeLimit;
-		  size[1] = m_Nspectral;
-		  size[2] = nbSTOkES;
-     
-		  STOCKES1.get3D( pos, &DATA_3D_File1[0], size[0],size[1],size[2] );	  
-		  STOCKES2.get3D( pos, &DATA_3D_File2[0], size[0],size[1],size[2] );
-		  
-		  for (i=0;i<sizeTimeLimit*m_Nspectral*nbSTOkES;i++)	    
-		    {
-		      DATA_3D[i] = DATA_3D_File1[i]-(kfactor*DATA_3D_File2[i]);
-		    }		  
-		  
-		}
-	      else
-		{
-		  if (nofLastElements > 0)
-		    {	
-		      
-			vector<size_t> pos(3);
-			pos[0]=p*sizeTimeLimit;
-			pos[1]=0;
-			pos[2]=0;
-		  
-			vector<size_t> size(3);
-			size[0] = nofLastElements;
-			size[1] = m_Nspectral;
-			size[2] = nbSTOkES;
-	  
-			STOCKES1.get3D( pos, &DATA_3D_File1[0], size[0],size[1],size[2] );
-			STOCKES2.get3D( pos, &DATA_3D_File2[0], size[0],size[1],size[2] );
-			
-			for (i=0;i<nofLastElements*m_Nspectral*nbSTOkES;i++)	    
-			  {
-			    DATA_3D[i] = DATA_3D_File1[i]-(kfactor*DATA_3D_File2[i]);
-			  }		  
-		  			
-			
-		    }
-		}
-		 
-	  
-
-	  // Write data by time steps	
-	  if (p!=fracTime-1)
-	    {	  
-	      vector<size_t> data_grp_size(3);
-	      vector<size_t> data_grp_pos(3);
-
-	      data_grp_pos[0] = p*sizeTimeLimit;
-	      data_grp_pos[1] = 0;
-	      data_grp_pos[2] = 0;   	  
-	  
-	      data_grp_size[0] = sizeTimeLimit;
-	      data_grp_size[1] = m_Nspectral;
-	      data_grp_size[2] = nbSTOkES;
-	    
-	      data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );
-	    }
-	  else
-	    {		  
-	      if (nofLastElements > 0)
-		{
-		  vector<size_t> data_grp_size(3);
-		  vector<size_t> data_grp_pos(3);
-
-		  data_grp_pos[0] = p*sizeTimeLimit;
-		  data_grp_pos[1] = 0;
-		  data_grp_pos[2] = 0;   	  
-	  
-		  data_grp_size[0] = nofLastElements;
-		  data_grp_size[1] = m_Nspectral;
-		  data_grp_size[2] = nbSTOkES;
-	    
-		  data_grp.setMatrix( data_grp_pos, &DATA_3D[0], data_grp_size );		    
-		}
-	    }
-
-	} // end loop on p (time step)
+  // Substraction by time steps: DATA_1 - kfactor x DATA_2, in one pass (c.f Dynspec_Transform_Engine)
+  Dynspec_Transform_Engine engine(m_Nspectral,nbSTOkES);
+  engine.addSubtraction(kfactor);
+  engine.transform(STOCKES1,&STOCKES2,data_grp,m_Ntime,memoryRAM);
 
 	      
 	      	      
@@ -28,9 +28,10 @@ using namespace std;
 int main(int argc , char *argv[])
 {
 
-         if(argc<4){
-             
-             cout << "usage: " << argv[4] << " <CoincidenceNumber> <CoincidenceTime> <nrbeams> <nrDMs>" << endl;
+         if(argc<5){
+
+             cout << "usage: " << argv[0] << " <CoincidenceNumber> <CoincidenceTime> <nrbeams> <nrDMs> [recordfile]" << endl;
+             cout << "       recordfile: write all received triggers to this file, to replay them with FRATStestTriggers" << endl;
              return 200;
          }
          int CoinNr=atoi(argv[1]);
@@ -52,14 +53,18 @@ int main(int argc , char *argv[])
 	     }
 	    
         
-	    int sock, out_sock;
-        int bytes_read;
-        socklen_t addr_len;
-        char recv_data[sizeof(struct triggerEvent)];
-        struct sockaddr_in server_addr , client_addr, out_server_addr;
+	    int out_sock;
+        struct sockaddr_in out_server_addr;
         triggerEvent * trigger;
-        trigger = new triggerEvent;
         int latestindex;
+        FILE* recordFile=NULL;
+        if(argc>5){
+            recordFile=fopen(argv[5],"wb");
+            if(recordFile==NULL){
+                perror("recordfile");
+                exit(1);
+            }
+        }
 	    
 	    typedef std::map<float,int> FloatToIntMap;
 	    FloatToIntMap DMtoID;
@@ -98,15 +103,6 @@ int main(int argc , char *argv[])
 
 
 
-        if ((sock = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
-            perror("Socket");
-            exit(1);
-        }
-
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(FRAT_TRIGGER_PORT_0);
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        bzero(&(server_addr.sin_zero),8);
         struct hostent *out_host;
         out_host= (struct hostent *) gethostbyname(out_hostname);
         out_server_addr.sin_family = AF_INET;
@@ -114,14 +110,15 @@ int main(int argc , char *argv[])
         out_server_addr.sin_addr = *((struct in_addr *)out_host->h_addr);
         bzero(&(out_server_addr.sin_zero),8);
 
-        if (bind(sock,(struct sockaddr *)&server_addr,
-            sizeof(struct sockaddr)) == -1)
+        // receives the triggers on its own thread in batches, this thread only does the coincidence checks
+        TriggerAggregator aggregator(FRAT_TRIGGER_PORT_0);
+        if (!aggregator.start())
         {
-            perror("Bind");
             exit(1);
         }
-
-        addr_len = sizeof(struct sockaddr);
+        vector<triggerEvent> triggers; // batch of triggers from the aggregator
+        unsigned int nextTrigger=0; // next trigger of the batch to check
+        time_t lastSummary=time(NULL);
 	
 	    int obsID=-1;
 		
@@ -130,14 +127,21 @@ int main(int argc , char *argv[])
 
 	while (1)
 	{
-          cout << " Waiting for new event ..." << endl;
-
-          bytes_read = recvfrom(sock,recv_data,sizeof(struct triggerEvent),0, (struct sockaddr *)&client_addr, &addr_len);
-	  
-          
-	      recv_data[bytes_read] = '\0';
-         
-          trigger = (triggerEvent*) recv_data;
+          if(nextTrigger==triggers.size()){
+              if(!aggregator.next(triggers)){
+                  break;
+              }
+              nextTrigger=0;
+              if(recordFile!=NULL){
+                  fwrite(&triggers[0],sizeof(struct triggerEvent),triggers.size(),recordFile);
+                  fflush(recordFile);
+              }
+              if(time(NULL)-lastSummary>=10){
+                  lastSummary=time(NULL);
+                  cout << lastSummary << " " << aggregator.summary() << endl;
+              }
+          }
+          trigger = &triggers[nextTrigger++];
 		  if(obsID!=trigger->obsID){
 		     if(obsID < 0) {
 			    obsID=trigger->obsID;
@@ -147,10 +151,10 @@ int main(int argc , char *argv[])
 				continue; 
 			 }
 	      }
-          /*if(trigger->beam >= nrbeams) {
-              cerr << "Receiving trigger from a higher beam number than expected, discarding trigger" << trigger->beam << " > " nrbeams << endl;
+          if(trigger->beam < 0 || trigger->beam >= nrbeams) {
+              cerr << "Receiving trigger from a higher beam number than expected, discarding trigger " << trigger->beam << " >= " << nrbeams << endl;
               continue;
-          }*/
+          }
 		  
 		  iter=DMtoID.find(trigger->DM);
 		  if ( iter==DMtoID.end() ) {
@@ -160,15 +164,16 @@ int main(int argc , char *argv[])
               }
               else{
                  cout << "Adding DM " << trigger->DM << " at ID " << DMid << endl;
-			     DMtoID[trigger->DM]=DMid;
+			     iter=DMtoID.insert(std::make_pair(trigger->DM,DMid)).first;
 			     DMid++;
               }
 		  }
 
 		 
+          int DMindex=iter->second;
 		  printf("%d \n",trigger->subband);
-          latestindex=cc[trigger->beam][  DMtoID[trigger->DM]   ]->add2buffer(*trigger);
-          if(cc[trigger->beam][  DMtoID[trigger->DM]   ]->coincidenceCheck(latestindex, CoinNr, CoinTime)) {
+          latestindex=cc[trigger->beam][DMindex]->add2buffer(*trigger);
+          if(cc[trigger->beam][DMindex]->coincidenceCheck(latestindex, CoinNr, CoinTime)) {
                 timeval t;
                 gettimeofday (&t, NULL);
 
@@ -204,8 +209,8 @@ int main(int argc , char *argv[])
                 //cout << cc->printEvent();
 			  if(nrbeams > mincoinbeams) {
 			    trigger->subband=trigger->beam;
-			    latestindex=RFIcc[  DMtoID[trigger->DM]   ]->add2buffer(*trigger);
-			    if(RFIcc[  DMtoID[trigger->DM]   ]->coincidenceCheck(latestindex, coinbeams, CoinTime)){
+			    latestindex=RFIcc[DMindex]->add2buffer(*trigger);
+			    if(RFIcc[DMindex]->coincidenceCheck(latestindex, coinbeams, CoinTime)){
 					cout << _timestamp << "." << _timestamp_msec << " Trigger is probably RFI at time " << trigger->time << " and DM " << trigger->DM << endl;
 				}
 			  }
@@ -216,6 +221,10 @@ int main(int argc , char *argv[])
 	  fflush(stdout);
 
     }
+    cout << aggregator.summary() << endl;
+    if(recordFile!=NULL){
+        fclose(recordFile);
+    }
     return 0;
 }
 
@@ -0,0 +1,149 @@
+ /*-------------------------------------------------------------------------*
+ | $Id:: FRATSbenchBoxcar.cc                                           $ |
+ *-------------------------------------------------------------------------*
+ ***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <iostream>
+#include <cstdlib>
+#include <time.h>
+#include "FRATcoincidence.h"
+#include "FRATcoincidence.cc"
+#include <stdio.h>
+#include <math.h>
+
+using namespace std;
+using namespace FRAT::analysis;
+
+/*
+ \file FRATSbenchBoxcar.cc
+
+ \brief Microbenchmark of the boxcar search of runTrigger against BoxcarSearch
+
+ \date 2013/06/17
+
+ For every block size a set of dedispersed series (one per DM) with white noise and a few
+ pulses is searched for all widths, once with sliding sums per width as in runTrigger and
+ once with BoxcarSearch. In the first block (no history yet) both have to find the same
+ samples above the threshold.
+
+ usage: FRATSbenchBoxcar [nDMs] [blocks]
+ */
+
+
+// Gaussian noise with mean 100 and stddev 10
+float noise(){
+    float u1=(rand()+1.0)/(RAND_MAX+2.0);
+    float u2=(rand()+1.0)/(RAND_MAX+2.0);
+    return 100.0+10.0*sqrt(-2.0*log(u1))*cos(2*M_PI*u2);
+}
+
+// Sliding sums per width, as in SubbandTrigger::runTrigger: returns the number of samples above the threshold
+int slidingSearch(const float* series, int nrSamples, const vector<int>& widths, float average, float stddev, float triggerlevel){
+    int above=0;
+    for(unsigned int i=0; i<widths.size(); i++){
+        int IntegrationLength=widths[i];
+        float SBaverage=average*IntegrationLength;
+        float SBstdev=stddev*sqrt(1.0*IntegrationLength);
+        float TriggerThreshold=SBaverage+triggerlevel*SBstdev;
+        for(int time=IntegrationLength-1; time<nrSamples; time++){
+            float subsum=0;
+            for(int it=time; it>time-IntegrationLength; it--){
+                subsum+=series[it];
+            }
+            if(subsum>TriggerThreshold) {
+                above++;
+            }
+        }
+    }
+    return above;
+}
+
+int main(int argc, char* argv[]){
+    int nDMs=(argc>1) ? atoi(argv[1]) : 500;
+    int nblocks=(argc>2) ? atoi(argv[2]) : 4;
+    int blocksizes[3]={768, 2768, 16384};
+    float triggerlevel=5;
+    vector<int> widths;
+    for(int w=1; w<=64; w*=2){
+        widths.push_back(w);
+    }
+
+    cout << "DMs " << nDMs << ", blocks " << nblocks << ", widths 1 - 64, ";
+#ifdef __SSE__
+    cout << "SSE" << endl;
+#else
+    cout << "scalar" << endl;
+#endif
+
+    for(int b=0; b<3; b++){
+        int samples=blocksizes[b];
+        vector<float> series((long)nDMs*samples);
+        for(long i=0; i<(long)series.size(); i++){
+            series[i]=noise();
+        }
+        for(int dm=0; dm<nDMs; dm+=7){ // pulses of different widths
+            int width=1+dm%40;
+            int start=(dm*131)%(samples-width);
+            for(int i=start; i<start+width; i++){
+                series[(long)dm*samples+i]+=60.0/sqrt(1.0*width);
+            }
+        }
+
+        int slidingAbove=0;
+        clock_t time_a=clock();
+        for(int block=0; block<nblocks; block++){
+            for(int dm=0; dm<nDMs; dm++){
+                int above=slidingSearch(&series[(long)dm*samples], samples, widths, 100.0, 10.0, triggerlevel);
+                if(block==0){
+                    slidingAbove+=above;
+                }
+            }
+        }
+        clock_t time_b=clock();
+
+        // one BoxcarSearch per DM, as in SubbandTrigger::runBoxcarTrigger
+        int boxcarAbove=0;
+        int nrCandidates=0;
+        vector<boxcarCandidate> candidates;
+        vector<BoxcarSearch*> searches(nDMs);
+        for(int dm=0; dm<nDMs; dm++){
+            searches[dm]=new BoxcarSearch(samples, widths);
+        }
+        clock_t time_c=clock();
+        for(int block=0; block<nblocks; block++){
+            for(int dm=0; dm<nDMs; dm++){
+                searches[dm]->search(&series[(long)dm*samples], 100.0, 10.0, triggerlevel, candidates);
+                if(block==0){
+                    nrCandidates+=candidates.size();
+                    for(unsigned int i=0; i<candidates.size(); i++){
+                        boxcarAbove+=candidates[i].length;
+                    }
+                }
+            }
+        }
+        clock_t time_d=clock();
+        for(int dm=0; dm<nDMs; dm++){
+            delete searches[dm];
+        }
+
+        double slidingTime=1000.0*(time_b-time_a)/CLOCKS_PER_SEC/nblocks;
+        double boxcarTime=1000.0*(time_d-time_c)/CLOCKS_PER_SEC/nblocks;
+        printf("samples %6i: sliding sums %9.3f ms/block, boxcar search %9.3f ms/block, speedup %6.1f, above threshold %i / %i, candidates %i\n",
+               samples, slidingTime, boxcarTime, slidingTime/std::max(boxcarTime,1e-3), slidingAbove, boxcarAbove, nrCandidates);
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+ /*-------------------------------------------------------------------------*
+ | $Id:: FRATSbenchDedispersion.cc                                     $ |
+ *-------------------------------------------------------------------------*
+ ***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <iostream>
+#include <cstdlib>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "FRATcoincidence.h"
+#include "FRATcoincidence.cc"
+#include <stdio.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace FRAT::analysis;
+
+/*
+ \file FRATSbenchDedispersion.cc
+
+ \brief Microbenchmark of SubbandDedispersion against one SubbandTrigger::dedisperseData2 per DM
+
+ \date 2013/07/01
+
+ A stream of 256 channels (16 subbands of 16 channels) with white noise is dedispersed for nDMs
+ DM trials from 0 to maxDM, once with the brute-force dedisperseData2 of one SubbandTrigger per DM
+ as in FRATStrigger without channel frequencies, and once with the two-stage SubbandDedispersion
+ (OpenMP threads, OMP_NUM_THREADS). The time is the wall clock time per block.
+
+ usage: FRATSbenchDedispersion [nDMs] [blocks] [maxDM]
+ */
+
+const int nrChannels=256;
+const int channelsPerSubband=16;
+const float timeResolution=5.12e-6*256;
+
+double now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC,&t);
+    return t.tv_sec+1e-9*t.tv_nsec;
+}
+
+// the SubbandTrigger reports its settings (and, when verbose, every block) on stdout: hide them during the brute force
+int hideStdout(){
+    fflush(stdout);
+    cout.flush();
+    int saved=dup(1);
+    int devnull=open("/dev/null",O_WRONLY);
+    dup2(devnull,1);
+    close(devnull);
+    return saved;
+}
+
+void restoreStdout(int saved){
+    fflush(stdout);
+    cout.flush();
+    dup2(saved,1);
+    close(saved);
+}
+
+int main(int argc, char* argv[]){
+    int nDMs=(argc>1) ? atoi(argv[1]) : 200;
+    int nblocks=(argc>2) ? atoi(argv[2]) : 4;
+    float maxDM=(argc>3) ? atof(argv[3]) : 100.0;
+    int blocksizes[3]={768, 2768, 16384};
+
+    // 150 MHz, 3 kHz channels
+    vector<float> FREQvalues(nrChannels);
+    for(int channel=0; channel<nrChannels; channel++){
+        FREQvalues[channel]=150.0e6+channel*3051.7578125;
+    }
+    vector<float> DMvalues(nDMs);
+    for(int dm=0; dm<nDMs; dm++){
+        DMvalues[dm]=maxDM*dm/std::max(nDMs-1,1);
+    }
+    vector<int> widths(1,1);
+
+    int threads=1;
+#ifdef _OPENMP
+    threads=omp_get_max_threads();
+#endif
+    cout << "channels " << nrChannels << ", DMs " << nDMs << " (0 - " << maxDM << "), blocks " << nblocks << ", threads " << threads << endl;
+
+    for(int b=0; b<3; b++){
+        int samples=blocksizes[b];
+        vector<float> data((long)nblocks*samples*nrChannels);
+        for(long i=0; i<(long)data.size(); i++){
+            data[i]=100.0+(rand()%2001-1000)*0.01;
+        }
+
+        int saved=hideStdout();
+        vector<SubbandTrigger*> triggers(nDMs);
+        for(int dm=0; dm<nDMs; dm++){
+            triggers[dm]=new SubbandTrigger(0,channelsPerSubband,samples,DMvalues[dm],5.0,FREQvalues[0],FREQvalues,0,nrChannels,nrChannels,0.0,timeResolution,0,0,NULL,0,widths,false,false,false,true);
+        }
+
+        double time_a=now();
+        for(int block=0; block<nblocks; block++){
+            for(int dm=0; dm<nDMs; dm++){
+                triggers[dm]->dedisperseData2(&data[(long)block*samples*nrChannels],block,NULL,0,0);
+            }
+        }
+        double time_b=now();
+        restoreStdout(saved);
+        for(int dm=0; dm<nDMs; dm++){
+            delete triggers[dm];
+        }
+
+        SubbandDedispersion engine(FREQvalues,0,nrChannels,nrChannels,channelsPerSubband,samples,timeResolution,DMvalues);
+        double time_c=now();
+        for(int block=0; block<nblocks; block++){
+            engine.dedisperse(&data[(long)block*samples*nrChannels]);
+        }
+        double time_d=now();
+
+        double bruteForceTime=1000.0*(time_b-time_a)/nblocks;
+        double subbandTime=1000.0*(time_d-time_c)/nblocks;
+        printf("samples %6i: dedisperseData2 %9.3f ms/block, SubbandDedispersion %9.3f ms/block, speedup %6.1f, nominal DMs %i, max delay %i samples\n",
+               samples, bruteForceTime, subbandTime, bruteForceTime/std::max(subbandTime,1e-3), engine.nrNominalDMs(), engine.maxDelay());
+    }
+    return 0;
+}
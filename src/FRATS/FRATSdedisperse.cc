@@ -674,6 +674,15 @@ int main (int argc,
 		}
 		StreamCounter++;
 	}
+    // Dedispersion of all DMs of a stream at once, the SubbandTriggers only get the dedispersed blocks
+    SubbandDedispersion* dedispersers[nstreams];
+    for(int stream=0; stream<nstreams; stream++){
+        dedispersers[stream]=NULL;
+        if(nFreqs>=1) {
+            dedispersers[stream] = new SubbandDedispersion(FREQvalues, stream*NrChannels, NrChannels, TotNrChannels, NrChPerSB, samples, TimeResolution, DMvalues);
+            dedispersers[stream]->summary();
+        }
+    }
     std::cout << "initialization done.";
    
 	
@@ -799,55 +808,27 @@ int main (int argc,
         int validsamples=samples;
         bool doFlagging=true;
 if(doFlagging){
-        cout << "Flagging channels in bewtween " << data << " " << data_end << endl; ;
-        vector<chanIdVal> badChans15=CalcBadChannels(data,data_end,TotNrChannels,samples,15,validsamples);
-        // printing found bad channels
-        cout << "\n  bad channels ";
-        for(int i=0; i<badChans15.size(); i++){
-            cout << badChans15[i].id << " " << badChans15[i].val << " ";
-        }
-        cout << "\n";
-        
-        RFIcleaner.calcBaseline();
-        RFIcleaner.divideBaseline();
-        RFIcleaner.calcBaseline();
-        //RFIcleaner.printBaseline();
-        RFIcleaner.calcSqrBaseline();
-        RFIcleaner.calcBadChannels(15);
+        // Two passes over the block: the statistics, and the normalisation by the baseline together with the
+        // statistics of the normalised data. The flags go into RFIcleaner.mask, flagged data is not overwritten.
+        RFIcleaner.clearMask();
+        RFIcleaner.calcStatistics();
+        RFIcleaner.calcStatistics(true);
+        cout << "Flagging channels ";
+        RFIcleaner.flagChannels(15);
         RFIcleaner.printBadChannels();
-        RFIcleaner.cleanChannels("1");
 
         // flagging bad samples
-        vector<int> badSamples=CalcBadSamples(data,data_end,TotNrChannels,samples,4);
-
-        cout << "Flagging bad samples " ;
-        for(int i=0; i<badSamples.size(); i++){
-            cout << badSamples[i] << " ";
-        }
-        cout << "\n ";
-
-        RFIcleaner.calcBadSamples(4);
+        RFIcleaner.flagSamples(4);
         RFIcleaner.printBadSamples();
-        RFIcleaner.cleanSamples("1");
-
 
         // flagging remaining bad channels
-        RFIcleaner.calcBaseline();
-        RFIcleaner.calcSqrBaseline();
-        RFIcleaner.calcBadChannels(6);
+        RFIcleaner.flagChannels(6);
         RFIcleaner.printBadChannels();
-
-        //vector<chanIdVal> badChans=CalcBadChannels(data,data_end,TotNrChannels,samples,5,validsamples);
-        cout << "\n";
-        cout << "Flagging channels " ;
-        vector<chanIdVal> badChans=CalcBadChannels(data,data_end,TotNrChannels,samples,6,validsamples);
-        for(int i=0; i<badChans.size(); i++){
-            cout << badChans[i].id << " " << badChans[i].val << " ";
+        RFIcleaner.flagChannel0();
+        RFIcleaner.calcFill("1"); // flagged data read as 1, as cleanChannels("1") and cleanSamples("1") did
+        if(nstreams>0 && dedispersers[0]==NULL){
+            RFIcleaner.applyMask(); // the SubbandTriggers dedisperse the data themselves
         }
-        cout << "\n";
-
-        RFIcleaner.cleanChannels("1");
-        RFIcleaner.cleanChannel0("1");
 
 
 /*
@@ -885,6 +866,9 @@ if(doFlagging){
    cout << " We are here now . 2 " << endl;     
 
 		for(int sc=0; sc < nstreams; sc++){
+            if(dedispersers[sc]!=NULL) {
+                dedispersers[sc]->dedisperse(data, doFlagging ? &RFIcleaner.mask : NULL); // all DMs of this stream
+            }
             
             #ifdef _OPENMP
                 std::cout<<"Running in parallel mode"<<std::endl;
@@ -895,7 +879,12 @@ if(doFlagging){
 		    
         	for(int DMcounter=0; DMcounter<nDMs; DMcounter++){	//analyse data of one stream for all DMs
 				cout << "Processing " << sc << " " << DMcounter << endl;
-				foundpulse=SBTs[sc][DMcounter]->dedisperseData(data, blockNr, &cc[DMcounter], CoinNr, CoinTime,Transposed);
+                if(dedispersers[sc]!=NULL) {
+                    SBTs[sc][DMcounter]->setDedispersedData(dedispersers[sc]->dedispersedData(DMcounter), blockNr);
+                    foundpulse=SBTs[sc][DMcounter]->calcAverageStddev(blockNr);
+                } else {
+                    foundpulse=SBTs[sc][DMcounter]->dedisperseData(data, blockNr, &cc[DMcounter], CoinNr, CoinTime,Transposed);
+                }
                 cout << "f" <<  foundpulse << endl;
                 if(nDMs <3){
 						stringstream pulselogfn;
@@ -0,0 +1,257 @@
+ /*-------------------------------------------------------------------------*
+ | $Id:: FRATStestDedispersion.cc                                      $ |
+ *-------------------------------------------------------------------------*
+ ***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <unistd.h>
+#include <fcntl.h>
+#include "FRATcoincidence.h"
+#include "FRATcoincidence.cc"
+#include <stdio.h>
+#include <math.h>
+
+using namespace std;
+using namespace FRAT::analysis;
+
+/*
+ \file FRATStestDedispersion.cc
+
+ \brief Test of the two-stage SubbandDedispersion against the brute-force dedisperseData2
+
+ \date 2013/07/01
+
+ Pulse injection: block c of the stream has a single spike of height c+1 in channel c, so every
+ output sample that is c+1 is the spike of channel c and gives the delay used for that channel.
+ For all DM trials the delays of SubbandDedispersion and of SubbandTrigger::dedisperseData2 (one
+ SubbandTrigger per DM) may differ by at most one sample.
+
+ Exact match: a DM trial equal to the nominal DM of its subbands (an engine with a single DM) has
+ to give exactly the brute-force sum with the truncated delay of every channel, for integer valued
+ random data (exact float sums), over several blocks.
+
+ The SubbandTriggers get a frequency resolution of 0, so their delays are relative to the lowest
+ channel of the stream, like those of SubbandDedispersion.
+
+ usage: FRATStestDedispersion [nDMs] [maxDM]
+ */
+
+const int nrChannels=64; // channels of the stream
+const int startChannel=16; // first channel of the stream in the data
+const int totNrChannels=96; // channels of all streams
+const int channelsPerSubband=16;
+const int nrSamples=1024;
+const float timeResolution=1e-3;
+const char* tmpname="FRATStestDedispersion.tmp";
+
+// frequency of each channel in Hz, increasing with the channel number
+vector<float> frequencies(){
+    vector<float> FREQvalues(totNrChannels);
+    for(int channel=0; channel<totNrChannels; channel++){
+        FREQvalues[channel]=130.0e6+channel*61035.15625;
+    }
+    return FREQvalues;
+}
+
+// truncated delay in samples of a channel of the stream w.r.t. the lowest frequency of the stream, as in dedisperseData2
+int truncatedDelay(const vector<float>& FREQvalues, float DM, int channel){
+    double f0=FREQvalues[startChannel]/1e9;
+    double f=FREQvalues[startChannel+channel]/1e9;
+    return (int)floor(DM_CONSTANT*DM*(1.0/(f0*f0)-1.0/(f*f))/timeResolution);
+}
+
+// the SubbandTrigger reports its settings (and, when verbose, every block) on stdout: hide them during the brute force
+int hideStdout(){
+    fflush(stdout);
+    cout.flush();
+    int saved=dup(1);
+    int devnull=open("/dev/null",O_WRONLY);
+    dup2(devnull,1);
+    close(devnull);
+    return saved;
+}
+
+void restoreStdout(int saved){
+    fflush(stdout);
+    cout.flush();
+    dup2(saved,1);
+    close(saved);
+}
+
+// block of the brute-force dedispersion, read back from the dedispersed buffer of the trigger
+void bruteForceBlock(SubbandTrigger* trigger, float* data, unsigned int block, float* out){
+    trigger->dedisperseData2(data,block,NULL,0,0);
+    ofstream file(tmpname, ios::out | ios::binary);
+    trigger->makeplotDedispBlock(&file);
+    file.close();
+    FILE* in=fopen(tmpname,"rb");
+    if(in==NULL || fread(out,sizeof(float),nrSamples,in)!=(size_t)nrSamples) {
+        cerr << "cannot read back " << tmpname << endl;
+        exit(1);
+    }
+    fclose(in);
+}
+
+// position of the only sample equal to value, -1 if none or several
+long findSpike(const vector<float>& series, float value){
+    long position=-1;
+    for(long i=0; i<(long)series.size(); i++){
+        if(series[i]==value) {
+            if(position>=0) {
+                return -1;
+            }
+            position=i;
+        }
+    }
+    return position;
+}
+
+int pulseInjection(const vector<float>& DMvalues){
+    vector<float> FREQvalues=frequencies();
+    int nDMs=DMvalues.size();
+    int nblocks=nrChannels+1; // one block per channel, the last one for the largest delays
+    int spikeSample=nrSamples/2;
+
+    SubbandDedispersion engine(FREQvalues,startChannel,nrChannels,totNrChannels,channelsPerSubband,nrSamples,timeResolution,DMvalues);
+    engine.summary();
+    if(engine.maxDelay()>=nrSamples/2) {
+        cerr << "maximum delay " << engine.maxDelay() << " too large for blocks of " << nrSamples << " samples" << endl;
+        return 1;
+    }
+    int saved=hideStdout();
+    vector<int> widths(1,1);
+    vector<SubbandTrigger*> triggers(nDMs);
+    for(int dm=0; dm<nDMs; dm++){
+        triggers[dm]=new SubbandTrigger(0,channelsPerSubband,nrSamples,DMvalues[dm],5.0,FREQvalues[0],FREQvalues,startChannel,nrChannels,totNrChannels,0.0,timeResolution,0,0,NULL,0,widths,false,false,false,true);
+    }
+
+    // dedispersed series of all blocks
+    vector< vector<float> > subband(nDMs,vector<float>((long)nblocks*nrSamples));
+    vector< vector<float> > bruteForce(nDMs,vector<float>((long)nblocks*nrSamples));
+    vector<float> data((long)nrSamples*totNrChannels);
+    for(int block=0; block<nblocks; block++){
+        std::fill(data.begin(),data.end(),0.0);
+        if(block<nrChannels) {
+            data[(long)spikeSample*totNrChannels+startChannel+block]=block+1;
+        }
+        engine.dedisperse(&data[0]);
+        for(int dm=0; dm<nDMs; dm++){
+            float* out=engine.dedispersedData(dm);
+            std::copy(out,out+nrSamples,subband[dm].begin()+(long)block*nrSamples);
+            bruteForceBlock(triggers[dm],&data[0],block,&bruteForce[dm][(long)block*nrSamples]);
+        }
+    }
+    restoreStdout(saved);
+
+    int failures=0;
+    int maxDifference=0;
+    for(int dm=0; dm<nDMs; dm++){
+        for(int channel=0; channel<nrChannels; channel++){
+            long injected=(long)channel*nrSamples+spikeSample;
+            long subbandSpike=findSpike(subband[dm],channel+1);
+            long bruteForceSpike=findSpike(bruteForce[dm],channel+1);
+            if(subbandSpike<0 || bruteForceSpike<0) {
+                cout << "DM " << DMvalues[dm] << " channel " << channel << ": spike lost" << endl;
+                failures++;
+                continue;
+            }
+            int difference=abs((int)(subbandSpike-bruteForceSpike));
+            maxDifference=std::max(maxDifference,difference);
+            if(difference>1) {
+                cout << "DM " << DMvalues[dm] << " channel " << channel << ": delay " << subbandSpike-injected
+                     << " samples, brute force " << bruteForceSpike-injected << endl;
+                failures++;
+            }
+        }
+    }
+    for(int dm=0; dm<nDMs; dm++){
+        delete triggers[dm];
+    }
+    remove(tmpname);
+    cout << "pulse injection, " << nDMs << " DM trials: largest difference of the delays " << maxDifference
+         << " samples, " << failures << " failures" << endl;
+    return failures;
+}
+
+int exactMatch(float DM, int nblocks){
+    vector<float> FREQvalues=frequencies();
+    vector<float> DMvalues(1,DM);
+    SubbandDedispersion engine(FREQvalues,startChannel,nrChannels,totNrChannels,channelsPerSubband,nrSamples,timeResolution,DMvalues);
+    if(engine.nrNominalDMs()!=1) {
+        cout << "DM " << DM << ": " << engine.nrNominalDMs() << " nominal DMs for one DM trial" << endl;
+        return 1;
+    }
+
+    vector<int> delay(nrChannels);
+    int maxDelay=0;
+    for(int channel=0; channel<nrChannels; channel++){
+        delay[channel]=truncatedDelay(FREQvalues,DM,channel);
+        maxDelay=std::max(maxDelay,delay[channel]);
+    }
+
+    // brute force with the truncated delays over the whole series
+    long length=(long)nblocks*nrSamples;
+    vector<float> data(length*totNrChannels);
+    for(long i=0; i<(long)data.size(); i++){
+        data[i]=rand()%100;
+    }
+    vector<float> reference(length+maxDelay,0.0);
+    for(long time=0; time<length; time++){
+        for(int channel=0; channel<nrChannels; channel++){
+            reference[time+delay[channel]]+=data[time*totNrChannels+startChannel+channel];
+        }
+    }
+
+    int failures=0;
+    for(int block=0; block<nblocks; block++){
+        engine.dedisperse(&data[(long)block*nrSamples*totNrChannels]);
+        float* out=engine.dedispersedData(0);
+        for(int time=0; time<nrSamples; time++){
+            if(out[time]!=reference[(long)block*nrSamples+time]) {
+                if(failures<10) {
+                    cout << "DM " << DM << " block " << block << " sample " << time << ": " << out[time]
+                         << " instead of " << reference[(long)block*nrSamples+time] << endl;
+                }
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char* argv[]){
+    int nDMs=(argc>1) ? atoi(argv[1]) : 200; // 0.1 DM apart: several DM trials per nominal DM
+    float maxDM=(argc>2) ? atof(argv[2]) : 20.0;
+
+    vector<float> DMvalues(nDMs);
+    for(int dm=0; dm<nDMs; dm++){
+        DMvalues[dm]=maxDM*dm/std::max(nDMs-1,1);
+    }
+    int failures=pulseInjection(DMvalues);
+
+    int exactFailures=0;
+    for(int dm=0; dm<nDMs; dm+=std::max(nDMs/8,1)){
+        exactFailures+=exactMatch(DMvalues[dm],3);
+    }
+    cout << "exact match at the nominal DM: " << exactFailures << " failures" << endl;
+    failures+=exactFailures;
+
+    cout << (failures==0 ? "OK" : "FAILED") << endl;
+    return failures;
+}
@@ -0,0 +1,222 @@
+ /*-------------------------------------------------------------------------*
+ | $Id:: FRATStestInput.cc                                             $ |
+ *-------------------------------------------------------------------------*
+ ***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <iostream>
+#include <cstdlib>
+#include "FRATcoincidence.h"
+#include "FRATcoincidence.cc"
+#include <stdio.h>
+#include <math.h>
+
+using namespace std;
+using namespace FRAT::analysis;
+
+/*
+ \file FRATStestInput.cc
+
+ \brief Test of the input layer: BlockReader, BlockRing, FileSource and UDPSource
+
+ \date 2013/06/24
+
+ Writes two files in the stokes data format of TransientTriggerV11 (big endian sequence number,
+ padding, big endian data[CHANNELS][SAMPLES|2]) with one block missing, and checks that several
+ consumer threads all get every block transposed to data[sample][channel] with the gap flagged.
+ The same data is then sent over UDP to the local host, in reordered packets.
+
+ usage: FRATStestInput [nrConsumers] [nrBlocks]
+ */
+
+const int nrChannels=16;
+const int nrSamples=300;
+const int stride=nrSamples|2;
+const int headerBytes=512;
+
+// format of the files of TransientTriggerV11
+inputBlockFormat stokesFormat(){
+    inputBlockFormat format={headerBytes,nrChannels,nrSamples,stride,true,true};
+    return format;
+}
+
+// value of a sample in the test data
+float testValue(int file, unsigned int sequenceNumber, int channel, int sample){
+    return file*1000.0+channel+sample*0.5+(sequenceNumber%100)*0.125;
+}
+
+// raw block of file in the stokes data format
+void makeBlock(vector<char>& raw, int file, unsigned int sequenceNumber){
+    raw.assign(BlockReader::rawBlockBytes(stokesFormat()),0);
+    unsigned int bigEndian=htonl(sequenceNumber);
+    memcpy(&raw[0],&bigEndian,sizeof(bigEndian));
+    float* data=(float*)&raw[headerBytes];
+    for(int ch=0; ch<nrChannels; ch++){
+        for(int sa=0; sa<nrSamples; sa++){
+            data[ch*stride+sa]=FloatSwap(testValue(file,sequenceNumber,ch,sa));
+        }
+    }
+}
+
+struct consumerTask {
+    BlockRing* ring;
+    int consumer;
+    int nrFiles;
+    long blocks; // blocks received
+    long gaps; // blocks with a gap
+    long errors; // wrong values or sequence numbers
+};
+
+void* consume(void* arg){
+    consumerTask* task=(consumerTask*)arg;
+    unsigned int sequenceNumber;
+    unsigned int previous=0;
+    bool gap;
+    float* data;
+    int totNrChannels=task->nrFiles*nrChannels;
+    while((data=task->ring->acquire(task->consumer,sequenceNumber,gap))!=NULL){
+        if(task->blocks>0 && sequenceNumber<=previous) { task->errors++; }
+        for(int sa=0; sa<nrSamples; sa++){
+            for(int ch=0; ch<totNrChannels; ch++){
+                if(data[sa*totNrChannels+ch]!=testValue(ch/nrChannels,sequenceNumber,ch%nrChannels,sa)) {
+                    task->errors++;
+                }
+            }
+        }
+        if(gap) { task->gaps++; }
+        previous=sequenceNumber;
+        task->blocks++;
+        if(task->consumer==0) { usleep(200); } // one slow consumer, the others have to wait for it
+        task->ring->release(task->consumer);
+    }
+    return NULL;
+}
+
+// read nrBlocks blocks (0: all) from the sources with nrConsumers threads, returns the number of failures
+int runConsumers(vector<BlockSource*> sources, int nrConsumers, long nrBlocks, long expectedBlocks, long expectedGaps, string name){
+    inputBlockFormat format=stokesFormat();
+    BlockRing ring((long)sources.size()*nrChannels*nrSamples,4,nrConsumers);
+    BlockReader reader(sources,format,&ring);
+    vector<consumerTask> tasks(nrConsumers);
+    vector<pthread_t> threads(nrConsumers);
+    for(int c=0; c<nrConsumers; c++){
+        consumerTask task={&ring,c,(int)sources.size(),0,0,0};
+        tasks[c]=task;
+        pthread_create(&threads[c],NULL,consume,&tasks[c]);
+    }
+    reader.start(nrBlocks);
+    for(int c=0; c<nrConsumers; c++){
+        pthread_join(threads[c],NULL);
+    }
+    ring.summary();
+    int failures=0;
+    for(int c=0; c<nrConsumers; c++){
+        cout << name << " consumer " << c << ": " << tasks[c].blocks << " blocks, " << tasks[c].gaps << " gaps, "
+             << tasks[c].errors << " errors" << endl;
+        if(tasks[c].blocks!=expectedBlocks || tasks[c].gaps!=expectedGaps || tasks[c].errors!=0) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// send the blocks of one file over UDP, swapping every two packets
+void* sendBlocks(void* arg){
+    long nrBlocks=*(long*)arg;
+    int sock=socket(AF_INET,SOCK_DGRAM,0);
+    struct sockaddr_in address;
+    memset(&address,0,sizeof(address));
+    address.sin_family=AF_INET;
+    address.sin_addr.s_addr=inet_addr("127.0.0.1");
+    address.sin_port=htons(31700);
+    const int payload=1000;
+    vector<char> stream;
+    vector<char> raw;
+    for(long b=0; b<nrBlocks; b++){
+        makeBlock(raw,0,b);
+        stream.insert(stream.end(),raw.begin(),raw.end());
+    }
+    vector<unsigned long long> offsets;
+    for(unsigned long long offset=0; offset<stream.size(); offset+=payload){
+        offsets.push_back(offset);
+    }
+    for(unsigned int i=0; i+1<offsets.size(); i+=2){
+        swap(offsets[i],offsets[i+1]);
+    }
+    char packet[8+payload];
+    for(unsigned int i=0; i<offsets.size(); i++){
+        for(int b=0; b<8; b++){ packet[b]=(offsets[i]>>(56-8*b))&0xff; }
+        long length=std::min((unsigned long long)payload,stream.size()-offsets[i]);
+        memcpy(packet+8,&stream[offsets[i]],length);
+        sendto(sock,packet,8+length,0,(struct sockaddr*)&address,sizeof(address));
+        if(i%16==0) { usleep(100); } // stay within the socket buffer
+    }
+    close(sock);
+    return NULL;
+}
+
+int main(int argc, char* argv[]){
+    int nrConsumers=(argc>1) ? atoi(argv[1]) : 3;
+    long nrBlocks=(argc>2) ? atol(argv[2]) : 50;
+    int failures=0;
+
+    // two files, block nrBlocks/2 is missing in both
+    string filenames[2]={"FRATStestInput_SB0.raw","FRATStestInput_SB1.raw"};
+    for(int f=0; f<2; f++){
+        FILE* file=fopen(filenames[f].c_str(),"wb");
+        vector<char> raw;
+        for(long b=0; b<=nrBlocks; b++){
+            if(b==nrBlocks/2) { continue; }
+            makeBlock(raw,f,b);
+            fwrite(&raw[0],raw.size(),1,file);
+        }
+        fclose(file);
+    }
+    long rawBytes=BlockReader::rawBlockBytes(stokesFormat());
+    vector<BlockSource*> sources;
+    for(int f=0; f<2; f++){
+        sources.push_back(new FileSource(filenames[f],0,rawBytes,false));
+    }
+    failures+=runConsumers(sources,nrConsumers,0,nrBlocks,1,"files");
+    for(int f=0; f<2; f++){
+        delete sources[f];
+        remove(filenames[f].c_str());
+    }
+
+    // reading past the end of a file that is not followed ends the data
+    FILE* file=fopen(filenames[0].c_str(),"wb");
+    vector<char> raw;
+    makeBlock(raw,0,0);
+    fwrite(&raw[0],raw.size(),1,file);
+    fclose(file);
+    sources.assign(1,new FileSource(filenames[0],0,rawBytes,false));
+    failures+=runConsumers(sources,nrConsumers,0,1,0,"end of file");
+    delete sources[0];
+    remove(filenames[0].c_str());
+
+    // UDP, reordered packets
+    UDPSource* udp=new UDPSource(31700,rawBytes);
+    sources.assign(1,udp);
+    pthread_t sender;
+    pthread_create(&sender,NULL,sendBlocks,&nrBlocks);
+    failures+=runConsumers(sources,nrConsumers,nrBlocks-1,nrBlocks-1,0,"UDP"); // the last block has no later packet to complete it if one was lost
+    pthread_join(sender,NULL);
+    cout << "UDP lost bytes " << udp->lostBytes() << endl;
+    delete udp;
+
+    cout << (failures==0 ? "OK" : "FAILED") << endl;
+    return failures;
+}
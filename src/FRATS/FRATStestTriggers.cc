@@ -0,0 +1,222 @@
+ /*-------------------------------------------------------------------------*
+ | $Id:: FRATStestTriggers.cc                                          $ |
+ *-------------------------------------------------------------------------*
+ ***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+#include <iostream>
+#include <cstdlib>
+#include "FRATcoincidence.h"
+#include "FRATcoincidence.cc"
+#include <stdio.h>
+#include <time.h>
+
+using namespace std;
+using namespace FRAT::analysis;
+using namespace FRAT::coincidence;
+
+/*
+ \file FRATStestTriggers.cc
+
+ \brief Loopback test of the trigger messages: UDPsend (sendmmsg) to TriggerAggregator (recvmmsg)
+
+ \date 2013/06/28
+
+ Replays a stream of trigger messages to the local host at a given rate, as the SubbandTriggers
+ send them, and receives them with the TriggerAggregator of CoincidenceDetectionUDP, which puts
+ them in a CoinCheck per DM. Every trigger has to arrive unchanged and in order, or be counted as
+ dropped (by the kernel or the sender). The counters of the aggregator are printed for every rate.
+
+ The stream is a file recorded by CoincidenceDetectionUDP (raw triggerEvents), or random triggers.
+
+ usage: FRATStestTriggers [recordfile|-] [triggers/s, 0 for as fast as possible] [nrTriggers]
+ */
+
+const int testPort=31710;
+
+struct senderTask {
+    const vector<triggerEvent>* triggers;
+    double rate; // triggers per second, 0 for no limit
+    TriggerAggregator* aggregator;
+    long sent; // triggers sent
+    long failed; // triggers the sender could not send
+    double seconds; // time to send all triggers
+};
+
+double now(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC,&t);
+    return t.tv_sec+1e-9*t.tv_nsec;
+}
+
+// send the triggers in chunks of 1 ms, then stop the aggregator
+void* sendTriggers(void* arg){
+    senderTask* task=(senderTask*) arg;
+    const vector<triggerEvent>& triggers=*task->triggers;
+    UDPsend sender("127.0.0.1",testPort);
+    double start=now();
+    unsigned int next=0;
+    while(next<triggers.size()){
+        unsigned int due=triggers.size();
+        if(task->rate>0){
+            due=std::min((double)triggers.size(),(now()-start+1e-3)*task->rate);
+        }
+        for( ; next<due; next++){
+            sender.QueueTriggerMessage(triggers[next]);
+        }
+        sender.FlushTriggerMessages();
+        if(next<triggers.size()){
+            usleep(1000);
+        }
+    }
+    task->seconds=now()-start;
+    task->sent=sender.sent();
+    task->failed=sender.failed();
+    // wait until all packets in the socket buffer are received, then send a packet that is not a
+    // trigger: the kernel reports the drops with the next packet received
+    long packets=-1;
+    while(task->aggregator->received()!=packets){
+        packets=task->aggregator->received();
+        usleep(200000);
+    }
+    int sock=socket(AF_INET,SOCK_DGRAM,0);
+    struct sockaddr_in address;
+    memset(&address,0,sizeof(address));
+    address.sin_family=AF_INET;
+    address.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    address.sin_port=htons(testPort);
+    char marker=0;
+    sendto(sock,&marker,1,0,(struct sockaddr*)&address,sizeof(address));
+    close(sock);
+    usleep(100000);
+    task->aggregator->stop();
+    return NULL;
+}
+
+// one replay of the stream, returns the number of failures
+int replay(const vector<triggerEvent>& triggers, double rate){
+    TriggerAggregator aggregator(testPort);
+    if(!aggregator.start()){
+        cerr << "cannot start the aggregator" << endl;
+        return 1;
+    }
+    map<float,CoinCheck*> coincidence; // one CoinCheck per DM, as in CoincidenceDetectionUDP
+    senderTask task={&triggers,rate,&aggregator,0,0,0};
+    streambuf* coutBuffer=cout.rdbuf(NULL); // CoinCheck reports every trigger
+    pthread_t thread;
+    pthread_create(&thread,NULL,sendTriggers,&task);
+
+    vector<triggerEvent> batch;
+    unsigned int expected=0; // index in triggers of the next trigger expected
+    long received=0;
+    long skipped=0; // triggers not received
+    long wrong=0; // received triggers that are not in the stream (at that position)
+    long coincidences=0;
+    while(aggregator.next(batch)){
+        for(unsigned int i=0; i<batch.size(); i++){
+            unsigned int match=expected;
+            while(match<triggers.size() && memcmp(&triggers[match],&batch[i],sizeof(triggerEvent))!=0){
+                match++;
+            }
+            if(match==triggers.size()){
+                wrong++;
+                continue;
+            }
+            skipped+=match-expected;
+            expected=match+1;
+            received++;
+            CoinCheck*& cc=coincidence[batch[i].DM];
+            if(cc==NULL){
+                cc=new CoinCheck();
+            }
+            unsigned int latestindex=cc->add2buffer(batch[i]);
+            if(cc->coincidenceCheck(latestindex,4,20)){
+                coincidences++;
+            }
+        }
+    }
+    pthread_join(thread,NULL);
+    cout.rdbuf(coutBuffer);
+    skipped+=triggers.size()-expected;
+    for(map<float,CoinCheck*>::iterator it=coincidence.begin(); it!=coincidence.end(); it++){
+        delete it->second;
+    }
+
+    int failures=0;
+    if(wrong>0){
+        cerr << wrong << " triggers received that were not sent (in that order)" << endl;
+        failures++;
+    }
+    if(received!=aggregator.received() || received+aggregator.kernelDrops()+task.failed!=(long)triggers.size() || aggregator.badPackets()!=1){
+        cerr << "lost triggers not counted: received " << received << " of " << triggers.size() << ", dropped by the kernel "
+             << aggregator.kernelDrops() << ", not sent " << task.failed << endl;
+        failures++;
+    }
+    printf("rate %9.0f/s: %8.0f triggers/s sent, %li received, %li missing, %li coincidences\n",
+           rate, task.sent/std::max(task.seconds,1e-3), received, skipped, coincidences);
+    cout << "    " << aggregator.summary() << endl;
+    return failures;
+}
+
+int main(int argc, char* argv[]){
+    vector<triggerEvent> triggers;
+    string recordfile=(argc>1) ? argv[1] : "-";
+    double rate=(argc>2) ? atof(argv[2]) : -1;
+    int nrTriggers=(argc>3) ? atoi(argv[3]) : 200000;
+
+    if(recordfile!="-"){
+        FILE* file=fopen(recordfile.c_str(),"rb");
+        if(file==NULL){
+            perror(recordfile.c_str());
+            return 1;
+        }
+        triggerEvent trigger;
+        while(fread(&trigger,sizeof(triggerEvent),1,file)==1){
+            triggers.push_back(trigger);
+        }
+        fclose(file);
+    } else {
+        // triggers of 16 subbands and 4 DMs with some pulses seen in all subbands
+        unsigned long int time=0;
+        for(int i=0; i<nrTriggers; i++){
+            triggerEvent trigger;
+            memset(&trigger,0,sizeof(trigger));
+            time+=(i%500<32) ? 0 : 1+rand()%8;
+            trigger.time=time;
+            trigger.subband=(i%500<32) ? i%16 : rand()%16;
+            trigger.DM=10.0*(1+rand()%4);
+            trigger.sum=100+rand()%50;
+            trigger.max=5+0.01*(rand()%500);
+            trigger.block=time/768;
+            trigger.sample=time%768;
+            trigger.length=1<<(rand()%6);
+            triggers.push_back(trigger);
+        }
+    }
+    cout << triggers.size() << " triggers" << endl;
+
+    int failures=0;
+    if(rate>=0){
+        failures+=replay(triggers,rate);
+    } else {
+        double rates[3]={1e5,1e6,0};
+        for(int r=0; r<3; r++){
+            failures+=replay(triggers,rates[r]);
+        }
+    }
+    cout << (failures==0 ? "OK" : "FAILED") << endl;
+    return failures;
+}
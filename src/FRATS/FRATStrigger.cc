@@ -216,6 +216,8 @@ int main (int argc,
 	int HBAmode = 1;
 	string pulsedir = "pulses";
     int sleeptime = 0;
+    int udpport = 0; // read from UDP instead of the input file
+    int ringblocks = 8; // blocks buffered between the reader thread and the analysis
     unsigned long int starttime_sec=0;
     unsigned long int starttime_ns=0;
 	
@@ -252,6 +254,8 @@ int main (int argc,
 			"-tInt <time integration>"
 			"-LBA LBA mode"
             "-sleep <sleeptime (sec)>"
+            "-udp <port> read the blocks from UDP packets instead of the input file\n"
+            "-ring <number of blocks buffered by the reader thread>\n"
 			"Examples:\n"
 			"./TransientTrigger -i ~/Astro/data/pulsars/obs/ -FSB 0 -LSB 10 -il 20 -tl 50 -n 51 \n"
 			"./TransientTrigger -i ~/Astro/data/pulsars/L2009_13298/ -FSB 0 -LSB 10 -il 20 -tl 50 -n 3595 \n; open /Users/STV/Documents/GiantPulse/excesslog_pdt.txt\n"
@@ -346,6 +350,14 @@ int main (int argc,
 		} else if(topic == "-pad"){
 			DoPadding = true;
 			cout << "using padding output" << endl;
+		} else if(topic == "-udp"){
+			argcounter++;
+			udpport = atoi(argv[argcounter]);
+			cout << "reading from UDP port " << udpport << endl;
+		} else if(topic == "-ring"){
+			argcounter++;
+			ringblocks = atoi(argv[argcounter]);
+			cout << "buffering " << ringblocks << " blocks" << endl;
 		} else if(topic == "-ext"){
 			argcounter++;
 			extension = argv[argcounter];
@@ -492,6 +504,15 @@ int main (int argc,
 		}
 		StreamCounter++;
 	}
+    // Dedispersion of all DMs of a stream at once, the SubbandTriggers only get the dedispersed blocks
+    SubbandDedispersion* dedispersers[nstreams];
+    for(int stream=0; stream<nstreams; stream++){
+        dedispersers[stream]=NULL;
+        if(nFreqs>=1) {
+            dedispersers[stream] = new SubbandDedispersion(FREQvalues, stream*NrChannels, NrChannels, TotNrChannels, NrChPerSB, samples, TimeResolution, DMvalues);
+            dedispersers[stream]->summary();
+        }
+    }
     std::cout << "initialization done.";
    
 	
@@ -499,14 +520,27 @@ int main (int argc,
 	
 	
 	//--------------READ IN THE FILES----------------------------------	
-    FILE * pFile;
-    pFile = new FILE;
-    pFile = fopen(inputfile.c_str(),"rb");
-    while (pFile==NULL) {
-        cout << "File not there yet" << endl;
-        usleep(500000);
-        pFile = fopen(inputfile.c_str(),"rb");
-    } 	
+    // A reader thread reads the blocks (data[sample][channel], all channels) from the file or UDP
+    // port and swaps the bytes, the blocks are taken from the ring by the analysis loop below.
+    inputBlockFormat format;
+    format.headerBytes=0;
+    format.nrChannels=nFreqs;
+    format.nrSamples=samples;
+    format.sampleStride=samples;
+    format.channelMajor=false;
+    format.swapBytes=DoPadding;
+    long rawblockbytes=BlockReader::rawBlockBytes(format);
+    vector<BlockSource*> sources;
+    if(udpport>0){
+        sources.push_back(new UDPSource(udpport, rawblockbytes));
+    } else {
+        sources.push_back(new FileSource(inputfile, startpos, rawblockbytes));
+    }
+    BlockRing ring((long)nFreqs*samples, ringblocks, 1);
+    BlockReader reader(sources, format, &ring);
+    if(!reader.start(nrblocks)){
+        return 1;
+    }
         
         
     
@@ -601,26 +635,22 @@ int main (int argc,
 	}
 	char pad[508];
 */
-	unsigned num;
-	fpos_t pos;
     // New datasize, allchannels for the samples of the integration time, no header anymore
-    long totValuesPerBlock=nFreqs*samples;
-	long blockdatasize=totValuesPerBlock*sizeof(float);
-	long stokesdatasize=blockdatasize;
-	float *data=(float*)calloc(totValuesPerBlock,sizeof(float));
+	float *data;
+    unsigned int sequenceNumber;
+    bool gap;
     bool Transposed=true;
 
-	if (data==NULL)
-	{
-		cerr << "Memory could not be allocated\n";
-		return 1;
-	}
-	
-	cout << "stokesdatasize " << stokesdatasize << endl;
+	cout << "stokesdatasize " << rawblockbytes << endl;
 	
     int ch;
-	fseek(pFile, startpos*blockdatasize, SEEK_SET);
-    cout << "Current positions before reading " <<  startpos << " " << ftell(pFile)/blockdatasize << " " << startpos*blockdatasize <<  endl;
+    rfiMask badChannelMask; // the bad channels given on the command line
+    badChannelMask.resize(TotNrChannels, samples);
+    for(unsigned int i=0; i<BadChannels.size(); i++){
+        if( BadChannels[i] < TotNrChannels ){
+            badChannelMask.flagChannel(BadChannels[i]);
+        }
+    }
     unsigned int process_total_time_ticks;
     clock_t time_a;
     clock_t time_b;
@@ -629,60 +659,24 @@ int main (int argc,
 
     time_e = clock();
 	for(int blockNr = 0; blockNr< nrblocks; blockNr++){
-        // Read data
-        fgetpos(pFile,&pos);
-        cout << "Current positions " << blockNr << " " << startpos << " " << ftell(pFile)/blockdatasize << endl;
-        
-        num = fread( &(data[0]), blockdatasize, 1, pFile); //read data
-        //flagdata
-        
-        /*
-        float FloatSwap( float f )
-        {
-            union
-            {
-                float f;
-                unsigned char b[4];
-            } dat1, dat2;
-            
-            dat1.f = f;
-            dat2.b[0] = dat1.b[3];
-            dat2.b[1] = dat1.b[2];
-            dat2.b[2] = dat1.b[1];
-            dat2.b[3] = dat1.b[0];
-            return dat2.f;
-        }*/
-    
-        
-        if( !num) {
-            cout << "*";
-            usleep(50000);
-            fsetpos(pFile,&pos);
-            blockNr--;
-            
-            //i--; //1 file k--
-            continue;
+        // Take the next block from the reader thread, already swapped
+        data=ring.acquire(0, sequenceNumber, gap);
+        if(data==NULL) {
+            cout << "End of the data after " << blockNr << " blocks" << endl;
+            break;
         }
-        cout << "About to swap " << blockdatasize << " floats" << endl;
-                unsigned char *datachar=(unsigned char*) data;
-        
-        if(DoPadding){
-            SwapFloats(datachar,nFreqs*samples);
-            /*
-            for(int i=0;i<nFreqs*samples;i++) 
-            {
-              data[i] = FloatSwap(data[i]);
-            }  
-             */
+        if(gap) {
+            cout << "Data missing before block " << blockNr << endl;
         }
-        cout << "Done swapping floats" << endl;
         
-        for(int i=0; i<BadChannels.size(); i++){
-            ch=BadChannels[i];
-//            cout << "Flagging channel " << ch << endl;
-            if( ch < TotNrChannels ){
-                for(int sa; sa<samples ; sa++){ 
-                    data[sa*TotNrChannels+ch]=0.0;
+        
+        if(nstreams>0 && dedispersers[0]==NULL){ // the SubbandTriggers dedisperse the data themselves
+            for(unsigned int i=0; i<BadChannels.size(); i++){
+                ch=BadChannels[i];
+                if( ch < TotNrChannels ){
+                    for(int sa=0; sa<samples ; sa++){ 
+                        data[sa*TotNrChannels+ch]=0.0;
+                    }
                 }
             }
         }
@@ -694,6 +688,9 @@ int main (int argc,
         std::cout<<"Running in serial mode"<<std::endl;
 #endif // _OPENMP        
 		for(int sc=0; sc < nstreams; sc++){
+            if(dedispersers[sc]!=NULL) {
+                dedispersers[sc]->dedisperse(data, &badChannelMask); // all DMs of this stream, bad channels read as 0
+            }
         #ifdef _OPENMP
             std::cout<<"Running in parallel mode"<<std::endl;
             #pragma omp parallel for 
@@ -708,7 +705,13 @@ int main (int argc,
                 
 
                 
-				foundpulse[sc][DMcounter]=SBTs[sc][DMcounter]->processData(data, blockNr, &cc[DMcounter], CoinNr, CoinTime,Transposed);
+                if(dedispersers[sc]!=NULL) {
+                    SBTs[sc][DMcounter]->setDedispersedData(dedispersers[sc]->dedispersedData(DMcounter), blockNr);
+                    SBTs[sc][DMcounter]->calcAverageStddev(blockNr);
+                    foundpulse[sc][DMcounter]=SBTs[sc][DMcounter]->runBoxcarTrigger(blockNr, &cc[DMcounter], CoinNr, CoinTime);
+                } else {
+                    foundpulse[sc][DMcounter]=SBTs[sc][DMcounter]->processData(data, blockNr, &cc[DMcounter], CoinNr, CoinTime,Transposed);
+                }
                 
                 time_b = clock();
                 datamonitor[sc][DMcounter] << SBTs[sc][DMcounter]->blockAnalysisSummary() << "\n";
@@ -765,8 +768,14 @@ int main (int argc,
 			
 
         }
+        ring.release(0);
         //usleep(sleeptime);
 	}
+    reader.stop();
+    ring.summary();
+    for(unsigned int i=0; i<sources.size(); i++){
+        delete sources[i];
+    }
     
     alltriggerlogfile.close();
     triggerlogfile.close();
@@ -9,23 +9,19 @@ namespace FRAT {
 
 		CoinCheck::CoinCheck() :
 		itsNrTriggers (0),
-		itsInitialized (false) {
+		itsInitialized (false),
+		itsNrBuffered (0),
+		itsNrAdded (0) {
 			// set default parameters for coincidence
 			std::cout << FRAT_TASK_BUFFER_LENGTH << std::endl;
 			itsNoCoincidenceChannels = 8;
 			itsCoincidenceTime = 10.3e-6;
-			// Initialize the trigger messages buffer
+			for (unsigned int i=0; i<FRAT_COINCIDENCE_SHARDS; i++){
+				pthread_mutex_init(&itsShards[i].lock, NULL);
+			}
 			for (unsigned int i=0; i<FRAT_TASK_BUFFER_LENGTH; i++){
-				trigBuffer[i].next = i+1;
-				trigBuffer[i].prev = i-1;
-				trigBuffer[i].Time = 0;
-				trigBuffer[i].SampleNr = 0;
-				trigBuffer[i].date = 0.;
-				trigBuffer[i].SBnr = 0;
-			};
-			first = 0;
-			last = FRAT_TASK_BUFFER_LENGTH-1;
-			trigBuffer[first].prev = FRAT_TASK_BUFFER_LENGTH; //This means "not there"
+				itsAddedTime[i] = 0;
+			}
             std::cout << "Coincheck constructed" << std::endl;
 			// LOG_DEBUG ("FRAT construction");
 		}
@@ -36,126 +32,369 @@ namespace FRAT {
 		//
 		CoinCheck::~CoinCheck()
 		{
+			for (unsigned int i=0; i<FRAT_COINCIDENCE_SHARDS; i++){
+				pthread_mutex_destroy(&itsShards[i].lock);
+			}
 			// LOG_DEBUG ("FRAT destruction");
 		}
 
 
+		// Collect the triggers of all shards with startTime <= Time <= endTime, sorted by time
+		void CoinCheck::collect(unsigned long int startTime, unsigned long int endTime, std::vector<std::pair<unsigned long int, unsigned int> >& found){
+			found.clear();
+			for (unsigned int s=0; s<FRAT_COINCIDENCE_SHARDS; s++){
+				pthread_mutex_lock(&itsShards[s].lock);
+				std::multimap<unsigned long int, triggerBuffElem>::const_iterator it=itsShards[s].triggers.lower_bound(startTime);
+				std::multimap<unsigned long int, triggerBuffElem>::const_iterator end=itsShards[s].triggers.upper_bound(endTime);
+				for ( ; it!=end; it++){
+					found.push_back(std::make_pair(it->first, it->second.SBnr));
+				}
+				pthread_mutex_unlock(&itsShards[s].lock);
+			}
+			std::sort(found.begin(), found.end());
+		}
+
+
 		// Check the contents of the buffer if a coincidence is found
-		// make timewindow a double?
-		// could also be int
+		// Coincident are triggers of at least nChannles different subbands within timeWindow, in a
+		// window that contains the time of the trigger latestindex. With triggers arriving in time order
+		// this gives the same result as the scan of the former linked list; a late trigger no longer
+		// reports coincidences of only later triggers that were reported already.
 		bool CoinCheck::coincidenceCheck(unsigned int latestindex, unsigned int nChannles, int timeWindow){
-			unsigned int i,foundSBs[nChannles],nfound;
-			unsigned int startindex,runindex;
-			int reftime;
-
-			startindex = first;
-			while ((startindex!=trigBuffer[latestindex].next) && (startindex < FRAT_TASK_BUFFER_LENGTH)) {
-				runindex = trigBuffer[startindex].next;
-				reftime=trigBuffer[startindex].Time-timeWindow; //earliest time for coincidence events
-				nfound=1;
-				foundSBs[0]=trigBuffer[startindex].SBnr;
-				while ((runindex < FRAT_TASK_BUFFER_LENGTH) && (trigBuffer[runindex].Time>= reftime))
-                {
-					//check if current time is higher than the reftime. Stop if that is not the case
-					if(trigBuffer[runindex].Time!=0)
-                    {
-						for (i=0; i<nfound; i++)
-                        {
-							if (foundSBs[i] == trigBuffer[runindex].SBnr)
-                            {
-								//i; //prevents i to be nfound so you would trigger on one less.
-								//if(i==nfound-1){i++;};
-								//std::cout << "i = " << i << std::endl;
-								break; //break the for-loop;
-							};
-						};
-						if (i == nfound)
-                        {
-							if (nfound+2 > nChannles)
-                            {
-								std::cout << "Subbands found:" ;
-								for (i=0; i<nfound; i++)
-                                {
-									std::cout << " " << foundSBs[i];
-								}
-								std::cout << " " << trigBuffer[runindex].SBnr << std::endl;
-								return true;
-							}; //startindex;
-							foundSBs[nfound] = trigBuffer[runindex].SBnr;
-							std::cout << "Subbands found:" ;
-							for (i=0; i<nfound; i++)
-                            {
-								std::cout << " " << foundSBs[i];
-							}
-							std::cout << " " << trigBuffer[runindex].SBnr << std::endl;
-							std::cout << "Not enough. Continuing...." << std::endl;
-							nfound++;
-						};
-						runindex = trigBuffer[runindex].next;
-					};
-				}; //endwhile
-				startindex = trigBuffer[startindex].next;
-			};
+			unsigned long int latestTime=itsAddedTime[latestindex % FRAT_TASK_BUFFER_LENGTH];
+			unsigned long int window=(timeWindow>0) ? timeWindow : 0;
+			unsigned long int startTime=(latestTime>window) ? latestTime-window : 0;
+			std::vector<std::pair<unsigned long int, unsigned int> > found;
+			collect(startTime, latestTime+window, found);
+
+			// slide a window of timeWindow over the triggers, ending at each trigger from the latest time on
+			std::map<unsigned int, unsigned int> countSBs; // subband -> triggers in the window
+			unsigned int begin=0;
+			for (unsigned int end=0; end<found.size(); end++){
+				countSBs[found[end].second]++;
+				if (found[end].first < latestTime || (end+1<found.size() && found[end+1].first==found[end].first)){
+					continue; // window has to end at the last trigger of a time >= latest time
+				}
+				unsigned long int reftime=(found[end].first>window) ? found[end].first-window : 0; //earliest time for coincidence events
+				while (found[begin].first < reftime){
+					std::map<unsigned int, unsigned int>::iterator sb=countSBs.find(found[begin].second);
+					if (--sb->second==0){
+						countSBs.erase(sb);
+					}
+					begin++;
+				}
+				// a single subband never is a coincidence, as before
+				if (countSBs.size() >= nChannles && countSBs.size() > 1){
+					std::cout << "Subbands found:" ;
+					for (std::map<unsigned int, unsigned int>::const_iterator sb=countSBs.begin(); sb!=countSBs.end(); sb++){
+						std::cout << " " << sb->first;
+					}
+					std::cout << std::endl;
+					return true;
+				}
+			}
 			//return -1;
 			return false;
 		};
-		// Add a trigger message to the buffer.
+
+
+		// Add a trigger message to the buffer. Can be called by several threads at the same time.
 		unsigned int CoinCheck::add2buffer(const triggerEvent& trigger){
-			// double date;
-			unsigned int newindex,runindex;
+			triggerBuffElem element;
 
 			std::cout << "Adding new event: SB " << trigger.subband << " at time " << trigger.time << std::endl;
 
-			// date = trigger.itsTime + trigger.itsSampleNr/200e6;
-			newindex = last;
-			last = trigBuffer[last].prev;
-			trigBuffer[last].next = FRAT_TASK_BUFFER_LENGTH;
-
-			trigBuffer[newindex].SBnr     = trigger.subband;
-			// trigBuffer[newindex].SeqNr     = trigger.fitsSeqNr;
-			trigBuffer[newindex].Time      = trigger.time;
-			trigBuffer[newindex].SampleNr  = trigger.sample;
-			trigBuffer[newindex].Sum       = trigger.sum;
-			trigBuffer[newindex].NrSamples = trigger.length;
-			trigBuffer[newindex].PeakValue = trigger.max;
-			//  trigBuffer[newindex].date      = date;
-
-			runindex = first;
-			while (runindex < FRAT_TASK_BUFFER_LENGTH){
-				if (trigBuffer[runindex].Time <= trigger.time) {
-					break;
-				};
-				runindex = trigBuffer[runindex].next;
-			};
-			trigBuffer[newindex].next = runindex;
-			if (runindex == first){
-				first = newindex;
-				trigBuffer[newindex].prev = FRAT_TASK_BUFFER_LENGTH;
-				trigBuffer[runindex].prev = newindex;
-			} else {
-				if (runindex >= FRAT_TASK_BUFFER_LENGTH){
-					trigBuffer[last].next = newindex;
-					trigBuffer[newindex].prev = last;
-					last = newindex;
-				} else {
-					trigBuffer[(trigBuffer[runindex].prev)].next = newindex;
-					trigBuffer[newindex].prev = trigBuffer[runindex].prev;
-					trigBuffer[runindex].prev = newindex;
-				};
-			};
-
-			//		for(int index=0; index<FRAT_TASK_BUFFER_LENGTH; index++){
-			//			std::cout << "Buffer index " << index << "; time: " << trigBuffer[index].Time << ";SB: " << trigBuffer[index].SBnr << "; prev: " << trigBuffer[index].prev << "; next: " << trigBuffer[index].next << std::endl;
-			//		}
-			//		std::cout << "first: " << first << "; last: " << last << std::endl;
+			element.SBnr      = trigger.subband;
+			element.Time      = trigger.time;
+			element.SampleNr  = trigger.sample;
+			element.Sum       = trigger.sum;
+			element.NrSamples = trigger.length;
+			element.PeakValue = trigger.max;
+			element.date      = 0.;
+			element.meanval   = 0;
+			element.afterval  = 0;
+
+			triggerShard& shard=itsShards[trigger.subband % FRAT_COINCIDENCE_SHARDS];
+			pthread_mutex_lock(&shard.lock);
+			shard.triggers.insert(std::make_pair(element.Time, element));
+			pthread_mutex_unlock(&shard.lock);
+
+			unsigned int newindex=__sync_fetch_and_add(&itsNrAdded, 1) % FRAT_TASK_BUFFER_LENGTH;
+			itsAddedTime[newindex]=element.Time;
+			if (__sync_add_and_fetch(&itsNrBuffered, 1) > FRAT_TASK_BUFFER_LENGTH){
+				removeEarliest();
+			}
 			return newindex;
 		};
+
+
+		// Remove the earliest trigger of all shards, keeps the buffer at FRAT_TASK_BUFFER_LENGTH triggers
+		void CoinCheck::removeEarliest(){
+			int earliest=-1;
+			unsigned long int earliestTime=0;
+			for (unsigned int s=0; s<FRAT_COINCIDENCE_SHARDS; s++){
+				pthread_mutex_lock(&itsShards[s].lock);
+				if (!itsShards[s].triggers.empty() && (earliest<0 || itsShards[s].triggers.begin()->first < earliestTime)){
+					earliest=s;
+					earliestTime=itsShards[s].triggers.begin()->first;
+				}
+				pthread_mutex_unlock(&itsShards[s].lock);
+			}
+			if (earliest<0){
+				return;
+			}
+			// another thread may have removed it in the mean time, then the next one of the shard goes
+			pthread_mutex_lock(&itsShards[earliest].lock);
+			if (!itsShards[earliest].triggers.empty()){
+				itsShards[earliest].triggers.erase(itsShards[earliest].triggers.begin());
+				__sync_sub_and_fetch(&itsNrBuffered, 1);
+			}
+			pthread_mutex_unlock(&itsShards[earliest].lock);
+		};
+
+
+		// List the triggers between reftime-timewindow and reftime
+		std::string CoinCheck::printEvents(int reftime, int timewindow){
+			std::vector<std::pair<unsigned long int, unsigned int> > found;
+			collect((reftime>timewindow) ? reftime-timewindow : 0, (reftime>0) ? reftime : 0, found);
+			std::stringstream events;
+			for (unsigned int i=0; i<found.size(); i++){
+				events << "SB " << found[i].second << " at time " << found[i].first << std::endl;
+			}
+			return events.str();
+		};
+
+
+		TriggerAggregator::TriggerAggregator(int port, int BatchSize, int NrBatches, int SocketBufferBytes) :
+		itsPort (port),
+		itsBatchSize (BatchSize),
+		itsSocketBufferBytes (SocketBufferBytes),
+		itsSocket (-1),
+		itsQueue (NrBatches),
+		itsFirst (0),
+		itsCount (0),
+		itsStop (0),
+		itsReceived (0),
+		itsKernelDrops (0),
+		itsBadPackets (0),
+		itsBatches (0),
+		itsTotalLatency (0),
+		itsMaxLatency (0),
+		itsReturned (0),
+		itsRunning (false) {
+			pthread_mutex_init(&itsLock, NULL);
+			pthread_cond_init(&itsNotEmpty, NULL);
+			pthread_cond_init(&itsNotFull, NULL);
+		}
+
+		TriggerAggregator::~TriggerAggregator(){
+			stop();
+			if(itsSocket>=0) { ::close(itsSocket); }
+			pthread_cond_destroy(&itsNotFull);
+			pthread_cond_destroy(&itsNotEmpty);
+			pthread_mutex_destroy(&itsLock);
+		}
+
+		bool TriggerAggregator::start(){
+			itsSocket=socket(AF_INET,SOCK_DGRAM,0);
+			if(itsSocket<0) {
+				perror("TriggerAggregator socket");
+				return false;
+			}
+			// SO_RCVBUFFORCE may exceed net.core.rmem_max, but needs CAP_NET_ADMIN
+			if(setsockopt(itsSocket,SOL_SOCKET,SO_RCVBUFFORCE,&itsSocketBufferBytes,sizeof(itsSocketBufferBytes))<0) {
+				setsockopt(itsSocket,SOL_SOCKET,SO_RCVBUF,&itsSocketBufferBytes,sizeof(itsSocketBufferBytes));
+			}
+			int on=1;
+			setsockopt(itsSocket,SOL_SOCKET,SO_RXQ_OVFL,&on,sizeof(on)); // number of dropped packets with every packet
+			setsockopt(itsSocket,SOL_SOCKET,SO_TIMESTAMPNS,&on,sizeof(on)); // arrival time with every packet
+			struct timeval timeout; // recvmmsg returns now and then to check for stop()
+			timeout.tv_sec=0;
+			timeout.tv_usec=100000;
+			setsockopt(itsSocket,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+			struct sockaddr_in address;
+			memset(&address,0,sizeof(address));
+			address.sin_family=AF_INET;
+			address.sin_addr.s_addr=htonl(INADDR_ANY);
+			address.sin_port=htons(itsPort);
+			if(bind(itsSocket,(struct sockaddr*)&address,sizeof(address))<0) {
+				perror("TriggerAggregator bind");
+				::close(itsSocket);
+				itsSocket=-1;
+				return false;
+			}
+			if(pthread_create(&itsThread,NULL,run,this)!=0) {
+				return false;
+			}
+			itsRunning=true;
+			return true;
+		}
+
+		void TriggerAggregator::stop(){
+			if(!itsRunning) {
+				return;
+			}
+			__atomic_store_n(&itsStop,1,__ATOMIC_RELEASE);
+			pthread_mutex_lock(&itsLock);
+			pthread_cond_broadcast(&itsNotFull);
+			pthread_cond_broadcast(&itsNotEmpty);
+			pthread_mutex_unlock(&itsLock);
+			pthread_join(itsThread,NULL);
+			itsRunning=false;
+		}
+
+		void* TriggerAggregator::run(void* aggregator){
+			((TriggerAggregator*) aggregator)->receive();
+			return NULL;
+		}
+
+		void TriggerAggregator::receive(){
+			const int controlBytes=CMSG_SPACE(sizeof(struct timespec))+CMSG_SPACE(sizeof(unsigned int));
+			const int packetBytes=sizeof(struct triggerEvent)+1; // a longer packet is not a triggerEvent either
+			std::vector<char> packets(itsBatchSize*packetBytes);
+			std::vector<char> control(itsBatchSize*controlBytes);
+			std::vector<struct mmsghdr> messages(itsBatchSize);
+			std::vector<struct iovec> parts(itsBatchSize);
+			triggerBatch batch;
+			batch.triggers.reserve(itsBatchSize);
+			batch.arrival.reserve(itsBatchSize);
+
+			while(__atomic_load_n(&itsStop,__ATOMIC_ACQUIRE)==0) {
+				memset(&messages[0],0,itsBatchSize*sizeof(struct mmsghdr));
+				for(int i=0; i<itsBatchSize; i++){
+					parts[i].iov_base=&packets[i*packetBytes];
+					parts[i].iov_len=packetBytes;
+					messages[i].msg_hdr.msg_iov=&parts[i];
+					messages[i].msg_hdr.msg_iovlen=1;
+					messages[i].msg_hdr.msg_control=&control[i*controlBytes];
+					messages[i].msg_hdr.msg_controllen=controlBytes;
+				}
+				// wait for one packet, then take whatever else is in the socket buffer
+				int n=recvmmsg(itsSocket,&messages[0],itsBatchSize,MSG_WAITFORONE,NULL);
+				if(n<0) {
+					if(errno==EAGAIN || errno==EWOULDBLOCK || errno==EINTR) {
+						continue;
+					}
+					perror("TriggerAggregator recvmmsg");
+					break;
+				}
+
+				batch.triggers.clear();
+				batch.arrival.clear();
+				long bad=0;
+				for(int i=0; i<n; i++){
+					double arrival=0;
+					for(struct cmsghdr* cmsg=CMSG_FIRSTHDR(&messages[i].msg_hdr); cmsg!=NULL; cmsg=CMSG_NXTHDR(&messages[i].msg_hdr,cmsg)) {
+						if(cmsg->cmsg_level!=SOL_SOCKET) {
+							continue;
+						}
+						if(cmsg->cmsg_type==SCM_TIMESTAMPNS) {
+							struct timespec stamp;
+							memcpy(&stamp,CMSG_DATA(cmsg),sizeof(stamp));
+							arrival=stamp.tv_sec+1e-9*stamp.tv_nsec;
+						} else if(cmsg->cmsg_type==SO_RXQ_OVFL) {
+							unsigned int drops; // total since the socket was opened
+							memcpy(&drops,CMSG_DATA(cmsg),sizeof(drops));
+							__atomic_store_n(&itsKernelDrops,(long)drops,__ATOMIC_RELEASE);
+						}
+					}
+					if(messages[i].msg_len!=sizeof(struct triggerEvent)) {
+						bad++;
+						continue;
+					}
+					struct triggerEvent trigger;
+					memcpy(&trigger,&packets[i*packetBytes],sizeof(struct triggerEvent));
+					batch.triggers.push_back(trigger);
+					batch.arrival.push_back(arrival);
+				}
+				__atomic_add_fetch(&itsBadPackets,bad,__ATOMIC_ACQ_REL);
+				if(batch.triggers.empty()) {
+					continue;
+				}
+
+				pthread_mutex_lock(&itsLock);
+				while(itsCount==(int)itsQueue.size() && __atomic_load_n(&itsStop,__ATOMIC_ACQUIRE)==0) {
+					pthread_cond_wait(&itsNotFull,&itsLock);
+				}
+				if(itsCount==(int)itsQueue.size()) {
+					pthread_mutex_unlock(&itsLock);
+					break;
+				}
+				triggerBatch& slot=itsQueue[(itsFirst+itsCount)%itsQueue.size()];
+				slot.triggers.swap(batch.triggers);
+				slot.arrival.swap(batch.arrival);
+				itsCount++;
+				__atomic_add_fetch(&itsReceived,(long)slot.triggers.size(),__ATOMIC_ACQ_REL);
+				__atomic_add_fetch(&itsBatches,1,__ATOMIC_ACQ_REL);
+				pthread_cond_signal(&itsNotEmpty);
+				pthread_mutex_unlock(&itsLock);
+			}
+			// also after an error of the socket: next() returns false once the queue is empty
+			pthread_mutex_lock(&itsLock);
+			__atomic_store_n(&itsStop,1,__ATOMIC_RELEASE);
+			pthread_cond_broadcast(&itsNotEmpty);
+			pthread_mutex_unlock(&itsLock);
+		}
+
+		bool TriggerAggregator::next(std::vector<triggerEvent>& triggers){
+			triggers.clear();
+			std::vector<double> arrival;
+			pthread_mutex_lock(&itsLock);
+			while(itsCount==0 && __atomic_load_n(&itsStop,__ATOMIC_ACQUIRE)==0) {
+				pthread_cond_wait(&itsNotEmpty,&itsLock);
+			}
+			if(itsCount==0) {
+				pthread_mutex_unlock(&itsLock);
+				return false;
+			}
+			triggerBatch& slot=itsQueue[itsFirst];
+			triggers.swap(slot.triggers);
+			arrival.swap(slot.arrival);
+			itsFirst=(itsFirst+1)%itsQueue.size();
+			itsCount--;
+			pthread_cond_signal(&itsNotFull);
+			pthread_mutex_unlock(&itsLock);
+
+			struct timespec now;
+			clock_gettime(CLOCK_REALTIME,&now);
+			double returned=now.tv_sec+1e-9*now.tv_nsec;
+			for(unsigned int i=0; i<arrival.size(); i++){
+				if(arrival[i]>0) {
+					double latency=returned-arrival[i];
+					itsTotalLatency+=latency;
+					itsMaxLatency=std::max(itsMaxLatency,latency);
+					itsReturned++;
+				}
+			}
+			return true;
+		}
+
+		double TriggerAggregator::meanLatency(){
+			return (itsReturned>0) ? itsTotalLatency/itsReturned : 0;
+		}
+
+		std::string TriggerAggregator::summary(){
+			int bufferBytes=0;
+			socklen_t length=sizeof(bufferBytes);
+			if(itsSocket>=0) {
+				getsockopt(itsSocket,SOL_SOCKET,SO_RCVBUF,&bufferBytes,&length);
+			}
+			std::stringstream text;
+			text << "triggers received " << received() << " in " << batches() << " batches";
+			if(batches()>0) {
+				text << " (" << (double) received()/batches() << " per batch)";
+			}
+			text << ", dropped by the kernel " << kernelDrops() << ", bad packets " << badPackets()
+			     << ", latency mean " << 1e3*meanLatency() << " ms max " << 1e3*maxLatency() << " ms"
+			     << ", socket buffer " << bufferBytes << " bytes";
+			return text.str();
+		}
 	};
 
 	namespace analysis {
 
-    UDPsend::UDPsend(){
-			hostname=FRAT_HOSTNAME;
+    UDPsend::UDPsend(const char* Hostname, int Port){
+			hostname=Hostname;
             send_data = new char[sizeof(struct triggerEvent)];
             host= (struct hostent *) gethostbyname(hostname);
 		    std::cout << "Setting network connection "  << std::endl;
@@ -167,22 +406,83 @@ namespace FRAT {
             }
 
             server_addr.sin_family = AF_INET;
-            server_addr.sin_port = htons(FRAT_TRIGGER_PORT_0);
+            server_addr.sin_port = htons(Port);
             server_addr.sin_addr = *((struct in_addr *)host->h_addr);
             bzero(&(server_addr.sin_zero),8);
+            pthread_mutex_init(&itsLock, NULL);
+            itsSent=0;
+            itsFailed=0;
+    }
 
+    UDPsend::~UDPsend(){
+        FlushTriggerMessages();
+        close(sock);
+        pthread_mutex_destroy(&itsLock);
+        delete[] send_data;
     }
 
     bool UDPsend::SendTriggerMessage(struct triggerEvent trigger){
         cout << " SENDING SENDING SENDING SENDING SENDING \n";
-        send_data = (char*) &trigger;
-        int n = sendto(sock, send_data, sizeof(struct triggerEvent), 0,
+        int n = sendto(sock, (const char*) &trigger, sizeof(struct triggerEvent), 0,
                (struct sockaddr *)&server_addr, sizeof(struct sockaddr));
+        pthread_mutex_lock(&itsLock);
         if (n  < 0){
-            return false;
+            itsFailed++;
+        } else {
+            itsSent++;
+        }
+        pthread_mutex_unlock(&itsLock);
+        return n>=0;
+    }
+
+    void UDPsend::QueueTriggerMessage(const struct triggerEvent& trigger){
+        pthread_mutex_lock(&itsLock);
+        itsQueue.push_back(trigger);
+        pthread_mutex_unlock(&itsLock);
+    }
+
+    bool UDPsend::FlushTriggerMessages(){
+        std::vector<struct triggerEvent> queued;
+        pthread_mutex_lock(&itsLock);
+        queued.swap(itsQueue);
+        pthread_mutex_unlock(&itsLock);
+        if(queued.empty()){
+            return true;
         }
-        return true;
-        cout << " SEND SEND SEND SEND SEND " << n << "\n";
+        int n=SendTriggerMessages(sock, server_addr, &queued[0], queued.size());
+        pthread_mutex_lock(&itsLock);
+        itsSent+=n;
+        itsFailed+=queued.size()-n;
+        pthread_mutex_unlock(&itsLock);
+        return n==(int)queued.size();
+    }
+
+    int UDPsend::SendTriggerMessages(int sock, const struct sockaddr_in& address, const struct triggerEvent* triggers, int nrTriggers){
+        const int maxBatch=64; // messages per sendmmsg call
+        struct mmsghdr messages[maxBatch];
+        struct iovec parts[maxBatch];
+        int sent=0;
+        while(sent<nrTriggers){
+            int n=std::min(maxBatch, nrTriggers-sent);
+            memset(messages, 0, n*sizeof(struct mmsghdr));
+            for(int i=0; i<n; i++){
+                parts[i].iov_base=(void*) &triggers[sent+i];
+                parts[i].iov_len=sizeof(struct triggerEvent);
+                messages[i].msg_hdr.msg_name=(void*) &address;
+                messages[i].msg_hdr.msg_namelen=sizeof(address);
+                messages[i].msg_hdr.msg_iov=&parts[i];
+                messages[i].msg_hdr.msg_iovlen=1;
+            }
+            int nsent=sendmmsg(sock, messages, n, 0);
+            if(nsent<0 && errno==EINTR){
+                continue;
+            }
+            if(nsent<=0){
+                break;
+            }
+            sent+=nsent;
+        }
+        return sent;
     }
 
 
@@ -196,6 +496,8 @@ namespace FRAT {
 			UseSamplesOr2=InUseSamplesOr2;
 			itsNrChannels= NrChannels;
 			itsNrSamples = NrSamples;
+            integrationLength.assign(1,IntegrationLength);
+            itsBoxcarSearch=NULL;
 			if(UseSamplesOr2){
 				itsNrSamplesOr2 = NrSamples|2;
 			} else {
@@ -293,6 +595,8 @@ namespace FRAT {
 
 			itsStreamID=StreamID;
 			itsDM = DM;
+            integrationLength=IntegrationLengthVector;
+            itsBoxcarSearch=NULL;
             if(IntegrationLengthVector.size()>0){
                 itsIntegrationLength=IntegrationLengthVector[0];
             } else {
@@ -419,6 +723,7 @@ namespace FRAT {
 		SubbandTrigger::~SubbandTrigger()
 		{
 			// LOG_DEBUG ("FRAT CoinCheck destruction");
+            delete itsBoxcarSearch;
 		}
 
 		bool SubbandTrigger::dedisperseData2(float* data, unsigned int sequenceNumber, FRAT::coincidence::CoinCheck* cc, int CoinNr, int CoinTime,bool Transposed){
@@ -487,6 +792,24 @@ namespace FRAT {
             }
         }
 
+    bool SubbandTrigger::setDedispersedData(float* dedispersed, unsigned int sequenceNumber){
+            //# Same bookkeeping as dedisperseData2, but the block is dedispersed already
+            //# dedispersed: itsNrSamples values, e.g. SubbandDedispersion::dedispersedData for itsDM
+            //# Afterwards calcAverageStddev and runTrigger can be called as after dedisperseData2
+			++itsSequenceNumber;
+			itsFoundTriggers="";
+			itsBlockNumber=sequenceNumber;
+            blocksum=0.0;
+            totaltime=itsSequenceNumber*itsNrSamples-1;
+			for(int time=0; time<itsNrSamples; time++){
+                totaltime++;
+				rest=totaltime%itsBufferLength;
+                DeDispersed[rest]=dedispersed[time];
+                blocksum+=dedispersed[time];
+            }
+            return false;
+        }
+
     bool SubbandTrigger::calcAverageStddev(unsigned int sequenceNumber){
         bool pulsefound=false;
         float subsum=0;
@@ -789,11 +1112,56 @@ namespace FRAT {
 
         }
     //    }
+        FlushTriggerMessages(); // all trigger messages of the block in one go
         return pulsefound;
 
 
     }
 
+    bool SubbandTrigger::runBoxcarTrigger(unsigned int, FRAT::coincidence::CoinCheck*, int, int){
+        //# Triggers for all widths in integrationLength from a single pass over the block (see BoxcarSearch)
+        //# Input: the block in DeDispersed (dedisperseData2 or setDedispersedData), the average and stddev
+        //# of calcAverageStddev. A trigger message is sent for each candidate, as runTrigger does per width.
+        bool pulsefound=false;
+        unsigned long int utc_second;
+        unsigned long int utc_nanosecond;
+        if(itsBoxcarSearch==NULL){
+            itsBoxcarSearch=new BoxcarSearch(itsNrSamples,integrationLength);
+        }
+        itsFoundTriggers="";
+        std::vector<float> series(itsNrSamples);
+        long start=itsSequenceNumber*itsNrSamples;
+        for(int time=0; time<itsNrSamples; time++){
+            series[time]=DeDispersed[(start+time)%itsBufferLength];
+        }
+        itsBoxcarSearch->search(&series[0], itsSBaverage, itsSBstdev, itsTriggerLevel, itsCandidates);
+
+        for(unsigned int i=0; i<itsCandidates.size(); i++){
+            const boxcarCandidate& candidate=itsCandidates[i];
+            trigger.time=start+candidate.sample+itsReferenceTime;
+            trigger.sum=candidate.sum;
+            trigger.length=candidate.width;
+            trigger.sample=candidate.sample;
+            trigger.block=itsBlockNumber;
+            trigger.max=candidate.snr;
+            trigger.width=candidate.width+candidate.length-1;
+            trigger.SBaverage=itsSBaverage*candidate.width;
+            trigger.SBstdev=itsSBstdev*sqrt(1.0*candidate.width);
+            trigger.Threshold=trigger.SBaverage+itsTriggerLevel*trigger.SBstdev;
+            if(itsBlockNumber>minBlockNumber){
+                utc_second=(unsigned long int) trigger.time*itsTimeResolution;
+                utc_nanosecond=(unsigned long int) (fmod(trigger.time*itsTimeResolution,1)*1e9);
+                trigger.utc_second=itsStarttime_utc_sec+utc_second;
+                trigger.utc_nanosecond=itsStarttime_utc_ns+utc_nanosecond;
+                SendTriggerMessage(trigger);
+                triggerMessages.push_back(trigger);
+                pulsefound=true;
+            }
+        }
+        FlushTriggerMessages();
+        return pulsefound;
+    }
+
     bool SubbandTrigger::processData(float* data, unsigned int sequenceNumber, FRAT::coincidence::CoinCheck* cc, int CoinNr, int CoinTime,bool Transposed){
             //# Input: data, 2-dimensional, axis frequencies and time (dynamic spectrum)
             //# sequenceNumber: block number
@@ -964,6 +1332,7 @@ namespace FRAT {
 			}
 
 
+			FlushTriggerMessages();
 			return pulsefound;
 		}
 
@@ -1196,15 +1565,20 @@ namespace FRAT {
 		}
 
 		bool SubbandTrigger::SendTriggerMessage(struct triggerEvent trigger){
-			send_data = (char*) &trigger;
-			int n = sendto(sock, send_data, sizeof(struct triggerEvent), 0,
-				   (struct sockaddr *)&server_addr, sizeof(struct sockaddr));
-			if (n  < 0){
-				return false;
-		    }
+			itsPendingTriggers.push_back(trigger);
 			return true;
 	    }
 
+		bool SubbandTrigger::FlushTriggerMessages(){
+			if(itsPendingTriggers.empty()){
+				return true;
+			}
+			int n=FRAT::analysis::UDPsend::SendTriggerMessages(sock, server_addr, &itsPendingTriggers[0], itsPendingTriggers.size());
+			bool allSent=(n==(int)itsPendingTriggers.size());
+			itsPendingTriggers.clear();
+			return allSent;
+	    }
+
 
 		bool SubbandTrigger::dedisperseData(float* data, unsigned int sequenceNumber, FRAT::coincidence::CoinCheck* cc, int CoinNr, int CoinTime,bool Transposed){
             // Mostly the same as process data, but now without triggering
@@ -1329,6 +1703,736 @@ namespace FRAT {
 
 
 
+        //#################################################################################
+
+        BoxcarSearch::BoxcarSearch(int NrSamples, std::vector<int> widths){
+            itsNrSamples=NrSamples;
+            itsWidths=widths;
+            itsMaxWidth=1;
+            for(unsigned int i=0; i<itsWidths.size(); i++){
+                if(itsWidths[i]<1) { itsWidths[i]=1; }
+                itsMaxWidth=std::max(itsMaxWidth,itsWidths[i]);
+            }
+            itsBuffer.assign(itsMaxWidth-1+itsNrSamples,0.0);
+            itsPrefix.assign(itsMaxWidth+itsNrSamples,0.0);
+        }
+
+        BoxcarSearch::~BoxcarSearch(){
+        }
+
+        int BoxcarSearch::search(const float* series, float average, float stddev, float TriggerLevel, std::vector<boxcarCandidate>& candidates){
+            //# Input: series, itsNrSamples values of the dedispersed block; average and stddev of a single sample
+            //# Output: candidates, for each width the highest boxcar of every run above TriggerLevel*stddev*sqrt(width)
+            //# Subtracting the average keeps the prefix sum close to 0, so it can be float without losing precision
+            int history=itsMaxWidth-1;
+            candidates.clear();
+            std::copy(series,series+itsNrSamples,itsBuffer.begin()+history);
+            itsPrefix[0]=0;
+            for(int i=0; i<history+itsNrSamples; i++){
+                itsPrefix[i+1]=itsPrefix[i]+(itsBuffer[i]-average);
+            }
+
+            for(unsigned int i=0; i<itsWidths.size(); i++){
+                int width=itsWidths[i];
+                // boxcar ending at sample t of the block: itsPrefix[history+t+1]-itsPrefix[history+t+1-width]
+                const float* hi=&itsPrefix[history+1];
+                const float* lo=&itsPrefix[history+1-width];
+                float cut=TriggerLevel*stddev*sqrt(1.0*width);
+                boxcarRun run;
+                run.active=false;
+                run.best.width=width;
+                int time=0;
+#ifdef __SSE__
+                __m128 vcut=_mm_set1_ps(cut);
+                for(; time+4<=itsNrSamples; time+=4){
+                    __m128 sums=_mm_sub_ps(_mm_loadu_ps(hi+time),_mm_loadu_ps(lo+time));
+                    if(_mm_movemask_ps(_mm_cmpgt_ps(sums,vcut))!=0 || run.active){
+                        scan(hi,lo,time,time+4,cut,run,candidates);
+                    }
+                }
+#endif
+                scan(hi,lo,time,itsNrSamples,cut,run,candidates);
+                if(run.active){ // run continues in the next block, report it now as runTrigger does
+                    candidates.push_back(run.best);
+                }
+            }
+            for(unsigned int i=0; i<candidates.size(); i++){
+                candidates[i].snr=candidates[i].sum/(stddev*sqrt(1.0*candidates[i].width));
+                candidates[i].sum+=candidates[i].width*average;
+            }
+
+            // keep the end of the block for the boxcars of the next block
+            std::copy(itsBuffer.end()-history,itsBuffer.end(),itsBuffer.begin());
+            return candidates.size();
+        }
+
+        void BoxcarSearch::scan(const float* hi, const float* lo, int start, int end, float cut, boxcarRun& run, std::vector<boxcarCandidate>& candidates){
+            for(int time=start; time<end; time++){
+                float sum=hi[time]-lo[time];
+                if(sum>cut){
+                    if(!run.active){ // new run
+                        run.active=true;
+                        run.best.sample=time;
+                        run.best.sum=sum;
+                        run.best.length=1;
+                    } else { // next sample, same width
+                        run.best.length++;
+                        if(sum>run.best.sum){ // new maximum
+                            run.best.sample=time;
+                            run.best.sum=sum;
+                        }
+                    }
+                } else if(run.active){ // end of the run
+                    candidates.push_back(run.best);
+                    run.active=false;
+                }
+            }
+        }
+
+        //#################################################################################
+
+        SubbandDedispersion::SubbandDedispersion(std::vector<float> FREQvalues, int StartChannel, int NrChannels, int TotNrChannels, int ChannelsPerSubband, int NrSamples, float TimeResolution, std::vector<float> DMvalues) {
+            itsStartChannel=StartChannel;
+            itsNrChannels=NrChannels;
+            itsTotNrChannels=TotNrChannels;
+            itsNrSamples=NrSamples;
+            itsDMvalues=DMvalues;
+            itsTotalTime=0;
+            if(ChannelsPerSubband<1) {
+                ChannelsPerSubband=1;
+            }
+
+            // frequencies in GHz, delays are relative to the lowest frequency of the stream and of each subband
+            std::vector<double> invFreqSqr(NrChannels); // 1/f^2
+            for(int channel=0; channel<NrChannels; channel++){
+                double freq=FREQvalues[StartChannel+channel]/1e9;
+                invFreqSqr[channel]=1.0/(freq*freq);
+            }
+            itsSubbandStart.clear();
+            for(int channel=0; channel<NrChannels; channel+=ChannelsPerSubband){
+                itsSubbandStart.push_back(channel);
+            }
+            itsNrSubbands=itsSubbandStart.size();
+            itsSubbandStart.push_back(NrChannels);
+
+            double streamMax=*std::max_element(invFreqSqr.begin(),invFreqSqr.end());
+            std::vector<double> subbandMax(itsNrSubbands); // 1/f^2 of the lowest frequency of each subband
+            double maxSpan=0; // largest delay within a subband per unit DM, in samples
+            for(int sb=0; sb<itsNrSubbands; sb++){
+                subbandMax[sb]=*std::max_element(invFreqSqr.begin()+itsSubbandStart[sb],invFreqSqr.begin()+itsSubbandStart[sb+1]);
+                double subbandMin=*std::min_element(invFreqSqr.begin()+itsSubbandStart[sb],invFreqSqr.begin()+itsSubbandStart[sb+1]);
+                maxSpan=std::max(maxSpan,DM_CONSTANT*(subbandMax[sb]-subbandMin)/TimeResolution);
+            }
+
+            // Nominal DMs: the DM trials are grouped such that the delays within a subband differ by at most
+            // a quarter sample from those of the trial DM; each group uses the DM in its middle.
+            int nDMs=DMvalues.size();
+            std::vector<int> order(nDMs);
+            for(int i=0; i<nDMs; i++){ order[i]=i; }
+            for(int i=1; i<nDMs; i++){ // insertion sort of the indices by DM
+                int j=i;
+                while(j>0 && DMvalues[order[j-1]]>DMvalues[order[j]]){
+                    std::swap(order[j-1],order[j]);
+                    j--;
+                }
+            }
+            itsNominalDMs.clear();
+            itsNominalIndex.resize(nDMs);
+            int groupStart=0;
+            for(int i=0; i<=nDMs; i++){
+                if(i==nDMs || (DMvalues[order[i]]-DMvalues[order[groupStart]])*maxSpan>0.5){
+                    if(i>groupStart){
+                        itsNominalDMs.push_back(0.5*(DMvalues[order[groupStart]]+DMvalues[order[i-1]]));
+                        for(int j=groupStart; j<i; j++){
+                            itsNominalIndex[order[j]]=itsNominalDMs.size()-1;
+                        }
+                    }
+                    groupStart=i;
+                }
+            }
+
+            // Delays of the channels within their subband for the nominal DMs (stage 1)
+            int maxChannelOffset=0;
+            itsChannelOffset.resize(itsNominalDMs.size()*NrChannels);
+            for(unsigned int nom=0; nom<itsNominalDMs.size(); nom++){
+                for(int sb=0; sb<itsNrSubbands; sb++){
+                    for(int channel=itsSubbandStart[sb]; channel<itsSubbandStart[sb+1]; channel++){
+                        // truncated like the total delay, so a DM trial equal to the nominal DM is dedispersed exactly
+                        int offset=(int)floor(DM_CONSTANT*itsNominalDMs[nom]*(streamMax-invFreqSqr[channel])/TimeResolution)
+                                  -(int)floor(DM_CONSTANT*itsNominalDMs[nom]*(streamMax-subbandMax[sb])/TimeResolution);
+                        itsChannelOffset[nom*NrChannels+channel]=offset;
+                        maxChannelOffset=std::max(maxChannelOffset,offset);
+                    }
+                }
+            }
+
+            // Delays of the subbands for the DM trials (stage 2). The total delay of a channel is the delay of
+            // its subband plus its delay within the subband for the nominal DM. The delay of the subband is
+            // the middle of the range of (truncated delay of the channel for the DM trial - delay within the
+            // subband) over its channels. This range is at most 2 samples wide (quarter sample grouping and
+            // truncations), so every channel is within one sample of its truncated delay, as in dedisperseData2.
+            int maxSubbandOffset=0;
+            itsSubbandOffset.resize(nDMs*itsNrSubbands);
+            for(int dm=0; dm<nDMs; dm++){
+                int nom=itsNominalIndex[dm];
+                for(int sb=0; sb<itsNrSubbands; sb++){
+                    int minOffset=0;
+                    int maxOffset=0;
+                    for(int channel=itsSubbandStart[sb]; channel<itsSubbandStart[sb+1]; channel++){
+                        int offset=(int)floor(DM_CONSTANT*DMvalues[dm]*(streamMax-invFreqSqr[channel])/TimeResolution)
+                                  -itsChannelOffset[nom*NrChannels+channel];
+                        if(channel==itsSubbandStart[sb] || offset<minOffset) { minOffset=offset; }
+                        if(channel==itsSubbandStart[sb] || offset>maxOffset) { maxOffset=offset; }
+                    }
+                    int offset=std::max(0,(minOffset+maxOffset+1)/2);
+                    itsSubbandOffset[dm*itsNrSubbands+sb]=offset;
+                    maxSubbandOffset=std::max(maxSubbandOffset,offset);
+                }
+            }
+            itsMaxDelay=0;
+            if(nDMs>0){
+                double maxDM=*std::max_element(DMvalues.begin(),DMvalues.end());
+                double streamMin=*std::min_element(invFreqSqr.begin(),invFreqSqr.end());
+                itsMaxDelay=(int)floor(DM_CONSTANT*maxDM*(streamMax-streamMin)/TimeResolution);
+            }
+
+            // Ring buffers hold the block and the largest delay, lengths are powers of 2 to replace % by &
+            int length=1;
+            while(length<NrSamples+maxChannelOffset+1){ length*=2; }
+            itsSubbandMask=length-1;
+            length=1;
+            while(length<NrSamples+maxSubbandOffset+1){ length*=2; }
+            itsOutputMask=length-1;
+
+            itsChannelData.resize(NrChannels*NrSamples);
+            itsChannelFlagged.resize(NrChannels);
+            itsSubbandBuffer.assign(itsNominalDMs.size()*itsNrSubbands*(itsSubbandMask+1),0.0);
+            itsOutputBuffer.assign(nDMs*(itsOutputMask+1),0.0);
+            itsDedispersed.assign(nDMs*NrSamples,0.0);
+        }
+
+        SubbandDedispersion::~SubbandDedispersion(){
+        }
+
+        bool SubbandDedispersion::dedisperse(float* data, const rfiMask* mask){
+            //# Input: data, 2-dimensional, axis time and frequency, data[sample*TotNrChannels+channel]
+            //#        mask (optional), flagged channels and samples of the block are replaced by mask->fill
+            //# Output: itsDedispersed[DM trial][sample], the sample is the arrival time at the lowest frequency
+            //# Task 1: copy the channels of this stream to [channel][sample], so all loops below are contiguous
+            //# Task 2: add each channel to the ring of its subband and nominal DM, at time+delay within the subband
+            //# Task 3: add each completed subband sample to the ring of each DM trial, at time+delay of the subband
+            //# Task 4: copy the completed samples of the DM trials and clear the used ring entries
+            int nDMs=itsDMvalues.size();
+            int nNominal=itsNominalDMs.size();
+            int subbandRing=itsSubbandMask+1;
+            int outputRing=itsOutputMask+1;
+
+            if(mask==NULL) {
+                for(int time=0; time<itsNrSamples; time++){
+                    float* sample=data+(long)time*itsTotNrChannels+itsStartChannel;
+                    for(int channel=0; channel<itsNrChannels; channel++){
+                        itsChannelData[channel*itsNrSamples+time]=sample[channel];
+                    }
+                }
+            } else {
+                const float* fill=&mask->fill[itsStartChannel];
+                for(int channel=0; channel<itsNrChannels; channel++){
+                    itsChannelFlagged[channel]=mask->channel(itsStartChannel+channel);
+                }
+                for(int time=0; time<itsNrSamples; time++){
+                    float* sample=data+(long)time*itsTotNrChannels+itsStartChannel;
+                    if(mask->sample(time)) {
+                        for(int channel=0; channel<itsNrChannels; channel++){
+                            itsChannelData[channel*itsNrSamples+time]=fill[channel];
+                        }
+                    } else {
+                        for(int channel=0; channel<itsNrChannels; channel++){
+                            itsChannelData[channel*itsNrSamples+time]= itsChannelFlagged[channel] ? fill[channel] : sample[channel];
+                        }
+                    }
+                }
+            }
+
+            // Stage 1
+            #ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic)
+            #endif
+            for(int task=0; task<nNominal*itsNrSubbands; task++){
+                int nom=task/itsNrSubbands;
+                int sb=task%itsNrSubbands;
+                float* ring=&itsSubbandBuffer[(long)task*subbandRing];
+                for(int channel=itsSubbandStart[sb]; channel<itsSubbandStart[sb+1]; channel++){
+                    const float* values=&itsChannelData[channel*itsNrSamples];
+                    long start=itsTotalTime+itsChannelOffset[nom*itsNrChannels+channel];
+                    for(int time=0; time<itsNrSamples; time++){
+                        ring[(start+time)&itsSubbandMask]+=values[time];
+                    }
+                }
+            }
+
+            // Stage 2
+            #ifdef _OPENMP
+            #pragma omp parallel for schedule(dynamic)
+            #endif
+            for(int dm=0; dm<nDMs; dm++){
+                float* ring=&itsOutputBuffer[(long)dm*outputRing];
+                const float* subbands=&itsSubbandBuffer[(long)itsNominalIndex[dm]*itsNrSubbands*subbandRing];
+                for(int sb=0; sb<itsNrSubbands; sb++){
+                    const float* subband=subbands+(long)sb*subbandRing;
+                    long start=itsTotalTime+itsSubbandOffset[dm*itsNrSubbands+sb];
+                    for(int time=0; time<itsNrSamples; time++){
+                        ring[(start+time)&itsOutputMask]+=subband[(itsTotalTime+time)&itsSubbandMask];
+                    }
+                }
+                float* out=&itsDedispersed[(long)dm*itsNrSamples];
+                for(int time=0; time<itsNrSamples; time++){
+                    long rest=(itsTotalTime+time)&itsOutputMask;
+                    out[time]=ring[rest];
+                    ring[rest]=0;
+                }
+            }
+
+            // the subband samples of this block are complete and used by all DM trials
+            for(int task=0; task<nNominal*itsNrSubbands; task++){
+                float* ring=&itsSubbandBuffer[(long)task*subbandRing];
+                for(int time=0; time<itsNrSamples; time++){
+                    ring[(itsTotalTime+time)&itsSubbandMask]=0;
+                }
+            }
+
+            itsTotalTime+=itsNrSamples;
+            return true;
+        }
+
+        float* SubbandDedispersion::dedispersedData(int DMindex){
+            return &itsDedispersed[(long)DMindex*itsNrSamples];
+        }
+
+        void SubbandDedispersion::summary(){
+            cout << "SubbandDedispersion: channels " << itsStartChannel << " - " << itsStartChannel+itsNrChannels-1
+                 << " in " << itsNrSubbands << " subbands, " << itsDMvalues.size() << " DM trials, "
+                 << itsNominalDMs.size() << " nominal DMs, max delay " << itsMaxDelay << " samples, ring buffers "
+                 << itsSubbandMask+1 << " / " << itsOutputMask+1 << " samples" << endl;
+        }
+
+
+        //#################################################################################
+
+        BlockRing::BlockRing(long BlockValues, int NrSlots, int NrConsumers) {
+            itsBlockValues=BlockValues;
+            itsSlotValues=(BlockValues+15)/16*16; // every slot starts on a 64 byte boundary
+            int slots=1;
+            while(slots<NrSlots) { slots*=2; }
+            itsMask=slots-1;
+            itsNrConsumers=NrConsumers;
+            itsWritten=0;
+            itsClosed=0;
+            itsAborted=0;
+            itsProducerWaits=0;
+            consumerCounter counter;
+            memset(&counter,0,sizeof(counter));
+            itsRead.assign(NrConsumers,counter);
+            itsSequenceNumbers.assign(slots,0);
+            itsGaps.assign(slots,0);
+            void* memory=NULL;
+            if(posix_memalign(&memory,64,slots*itsSlotValues*sizeof(float))!=0) {
+                cerr << "BlockRing: could not allocate " << slots << " blocks of " << BlockValues << " floats" << endl;
+                itsMemory=NULL;
+                itsAborted=1;
+            } else {
+                itsMemory=(float*)memory;
+                memset(itsMemory,0,slots*itsSlotValues*sizeof(float));
+            }
+        }
+
+        BlockRing::~BlockRing(){
+            free(itsMemory);
+        }
+
+        bool BlockRing::wait(int& spins){
+            if(__atomic_load_n(&itsAborted,__ATOMIC_ACQUIRE)) {
+                return false;
+            }
+            if(spins<64) { // the next block is usually close, give up the core for a moment first
+                spins++;
+                sched_yield();
+            } else {
+                usleep(100);
+            }
+            return true;
+        }
+
+        long BlockRing::slowestConsumer(){
+            long slowest=itsWritten;
+            for(int c=0; c<itsNrConsumers; c++){
+                long read=__atomic_load_n(&itsRead[c].read,__ATOMIC_ACQUIRE);
+                if(read<slowest) { slowest=read; }
+            }
+            return slowest;
+        }
+
+        float* BlockRing::reserve(){
+            int spins=0;
+            if(itsWritten-slowestConsumer()>itsMask) {
+                itsProducerWaits++;
+                while(itsWritten-slowestConsumer()>itsMask){
+                    if(!wait(spins)) { return NULL; }
+                }
+            }
+            if(__atomic_load_n(&itsAborted,__ATOMIC_ACQUIRE)) {
+                return NULL;
+            }
+            return itsMemory+(itsWritten&itsMask)*itsSlotValues;
+        }
+
+        void BlockRing::publish(unsigned int sequenceNumber, bool gap){
+            long slot=itsWritten&itsMask;
+            itsSequenceNumbers[slot]=sequenceNumber;
+            itsGaps[slot]=gap;
+            __atomic_store_n(&itsWritten,itsWritten+1,__ATOMIC_RELEASE); // the block is written before it is counted
+        }
+
+        void BlockRing::close(){
+            __atomic_store_n(&itsClosed,1,__ATOMIC_RELEASE);
+        }
+
+        void BlockRing::abort(){
+            __atomic_store_n(&itsAborted,1,__ATOMIC_RELEASE);
+        }
+
+        float* BlockRing::acquire(int consumer, unsigned int& sequenceNumber, bool& gap){
+            long next=itsRead[consumer].read; // only changed by this consumer
+            int spins=0;
+            while(__atomic_load_n(&itsWritten,__ATOMIC_ACQUIRE)<=next){
+                if(__atomic_load_n(&itsClosed,__ATOMIC_ACQUIRE) && __atomic_load_n(&itsWritten,__ATOMIC_ACQUIRE)<=next) {
+                    return NULL; // end of the data
+                }
+                if(!wait(spins)) { return NULL; }
+            }
+            if(__atomic_load_n(&itsAborted,__ATOMIC_ACQUIRE)) {
+                return NULL;
+            }
+            long slot=next&itsMask;
+            sequenceNumber=itsSequenceNumbers[slot];
+            gap=itsGaps[slot];
+            return itsMemory+slot*itsSlotValues;
+        }
+
+        void BlockRing::release(int consumer){
+            __atomic_store_n(&itsRead[consumer].read,itsRead[consumer].read+1,__ATOMIC_RELEASE); // only this consumer changes it
+        }
+
+        void BlockRing::summary(){
+            cout << "BlockRing: " << itsMask+1 << " blocks of " << itsBlockValues << " floats, " << itsNrConsumers
+                 << " consumers, " << __atomic_load_n(&itsWritten,__ATOMIC_ACQUIRE) << " blocks published, producer waited "
+                 << itsProducerWaits << " times" << endl;
+        }
+
+
+        //#################################################################################
+
+        FileSource::FileSource(std::string filename, long startBlock, long blockBytes, bool follow) {
+            itsFilename=filename;
+            itsStartBlock=startBlock*blockBytes; // in bytes
+            itsFile=NULL;
+            itsFollow=follow;
+        }
+
+        FileSource::~FileSource(){
+            if(itsFile!=NULL) { fclose(itsFile); }
+        }
+
+        bool FileSource::read(char* buffer, long bytes){
+            if(itsFile==NULL){
+                itsFile=fopen(itsFilename.c_str(),"rb");
+                while(itsFile==NULL) {
+                    if(!itsFollow || interrupted()) {
+                        cerr << "FileSource: could not open " << itsFilename << endl;
+                        return false;
+                    }
+                    cout << "File not there yet" << endl;
+                    usleep(500000);
+                    itsFile=fopen(itsFilename.c_str(),"rb");
+                }
+                if(itsStartBlock>0 && fseeko(itsFile,(off_t)itsStartBlock,SEEK_SET)!=0) {
+                    cerr << "FileSource: could not skip to byte " << itsStartBlock << " of " << itsFilename << endl;
+                    return false;
+                }
+            }
+            long done=0;
+            while(done<bytes){
+                done+=fread(buffer+done,1,bytes-done,itsFile);
+                if(done<bytes) { // block not completely written yet, keep what is there and wait for the rest
+                    if(!itsFollow || interrupted() || ferror(itsFile)) {
+                        return false;
+                    }
+                    clearerr(itsFile);
+                    usleep(50000);
+                }
+            }
+            return true;
+        }
+
+
+        //#################################################################################
+
+        UDPSource::UDPSource(int port, long blockBytes, int maxPacketBytes) {
+            itsBlockBytes=blockBytes;
+            itsBlockStart=0;
+            itsPacket.resize(maxPacketBytes);
+            itsNext.assign(blockBytes,0);
+            itsReceived=0;
+            itsNextReceived=0;
+            itsLostBytes=0;
+            itsHeld=0;
+            itsStarted=false;
+
+            itsSocket=socket(AF_INET,SOCK_DGRAM,0);
+            if(itsSocket<0) {
+                perror("UDPSource socket");
+                return;
+            }
+            int bufferSize=32*1024*1024; // a few blocks, the kernel limits this to net.core.rmem_max
+            setsockopt(itsSocket,SOL_SOCKET,SO_RCVBUF,&bufferSize,sizeof(bufferSize));
+            struct timeval timeout; // recv returns now and then to check for interrupt()
+            timeout.tv_sec=0;
+            timeout.tv_usec=100000;
+            setsockopt(itsSocket,SOL_SOCKET,SO_RCVTIMEO,&timeout,sizeof(timeout));
+            struct sockaddr_in address;
+            memset(&address,0,sizeof(address));
+            address.sin_family=AF_INET;
+            address.sin_addr.s_addr=htonl(INADDR_ANY);
+            address.sin_port=htons(port);
+            if(bind(itsSocket,(struct sockaddr*)&address,sizeof(address))<0) {
+                perror("UDPSource bind");
+                ::close(itsSocket);
+                itsSocket=-1;
+            }
+        }
+
+        UDPSource::~UDPSource(){
+            if(itsSocket>=0) { ::close(itsSocket); }
+        }
+
+        bool UDPSource::store(char* buffer, unsigned long long offset, const char* payload, long length){
+            unsigned long long nextStart=itsBlockStart+itsBlockBytes;
+            if(offset>=nextStart+itsBlockBytes) {
+                return false;
+            }
+            unsigned long long end=offset+length;
+            if(offset<nextStart && end>itsBlockStart) { // part in the current block
+                unsigned long long from=std::max(offset,itsBlockStart);
+                unsigned long long to=std::min(end,nextStart);
+                memcpy(buffer+(from-itsBlockStart),payload+(from-offset),to-from);
+                itsReceived+=to-from;
+            }
+            if(end>nextStart) { // part in the next block
+                unsigned long long from=std::max(offset,nextStart);
+                unsigned long long to=std::min(end,nextStart+itsBlockBytes);
+                memcpy(&itsNext[from-nextStart],payload+(from-offset),to-from);
+                itsNextReceived+=to-from;
+            }
+            return true; // late packets (before the current block) are dropped
+        }
+
+        bool UDPSource::read(char* buffer, long bytes){
+            if(itsSocket<0 || bytes!=itsBlockBytes) {
+                return false;
+            }
+            // the next block becomes the current one
+            memcpy(buffer,&itsNext[0],bytes);
+            itsReceived=itsNextReceived;
+            memset(&itsNext[0],0,bytes);
+            itsNextReceived=0;
+            const int headerBytes=8;
+
+            while(itsReceived<itsBlockBytes){
+                long length=itsHeld;
+                itsHeld=0;
+                if(length==0) {
+                    length=recv(itsSocket,&itsPacket[0],itsPacket.size(),0);
+                    if(length<0) {
+                        if(errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) {
+                            perror("UDPSource recv");
+                            return false;
+                        }
+                        if(interrupted()) { return false; }
+                        continue;
+                    }
+                }
+                if(length<=headerBytes) { continue; }
+                unsigned long long offset=0;
+                for(int i=0; i<headerBytes; i++) { offset=(offset<<8) | (unsigned char)itsPacket[i]; }
+                if(!itsStarted) { // start with the block of the first packet
+                    itsStarted=true;
+                    itsBlockStart=offset/itsBlockBytes*itsBlockBytes;
+                    memset(buffer,0,bytes);
+                    itsReceived=0;
+                }
+                if(!store(buffer,offset,&itsPacket[headerBytes],length-headerBytes)) {
+                    // packet of a later block: the current block is as complete as it gets
+                    itsHeld=length;
+                    if(offset>itsBlockStart+64*itsBlockBytes) { // sender restarted, continue at this packet
+                        itsStarted=false;
+                    }
+                    break;
+                }
+            }
+            itsLostBytes+=itsBlockBytes-std::min(itsReceived,itsBlockBytes);
+            itsBlockStart+=itsBlockBytes;
+            return true;
+        }
+
+
+        //#################################################################################
+
+        BlockReader::BlockReader(std::vector<BlockSource*> sources, inputBlockFormat format, BlockRing* ring) {
+            itsSources=sources;
+            itsFormat=format;
+            itsRing=ring;
+            itsTotNrChannels=sources.size()*format.nrChannels;
+            itsNrBlocks=0;
+            itsBlocksRead=0;
+            itsGaps=0;
+            itsRaw.resize(rawBlockBytes());
+            itsRunning=false;
+        }
+
+        BlockReader::~BlockReader(){
+            stop();
+        }
+
+        long BlockReader::rawBlockBytes(inputBlockFormat format){
+            long values=format.channelMajor ? (long)format.nrChannels*format.sampleStride : (long)format.nrChannels*format.nrSamples;
+            return format.headerBytes+values*sizeof(float);
+        }
+
+        long BlockReader::rawBlockBytes(){
+            return rawBlockBytes(itsFormat);
+        }
+
+        bool BlockReader::start(long nrBlocks){
+            if(itsRunning) {
+                return false;
+            }
+            if(itsRing->blockValues()!=(long)itsTotNrChannels*itsFormat.nrSamples) {
+                cerr << "BlockReader: ring blocks of " << itsRing->blockValues() << " floats, but the sources give "
+                     << itsTotNrChannels << " channels of " << itsFormat.nrSamples << " samples" << endl;
+                return false;
+            }
+            itsNrBlocks=nrBlocks;
+            if(pthread_create(&itsThread,NULL,run,this)!=0) {
+                cerr << "BlockReader: could not start the reader thread" << endl;
+                return false;
+            }
+            itsRunning=true;
+            return true;
+        }
+
+        void BlockReader::stop(){
+            if(!itsRunning) {
+                return;
+            }
+            for(unsigned int s=0; s<itsSources.size(); s++){
+                itsSources[s]->interrupt();
+            }
+            itsRing->abort();
+            pthread_join(itsThread,NULL);
+            itsRunning=false;
+        }
+
+        void* BlockReader::run(void* reader){
+            static_cast<BlockReader*>(reader)->readBlocks();
+            return NULL;
+        }
+
+        void BlockReader::readBlocks(){
+            unsigned int expected=0;
+            for(long block=0; itsNrBlocks<=0 || block<itsNrBlocks; block++){
+                float* data=itsRing->reserve();
+                if(data==NULL) {
+                    break;
+                }
+                unsigned int sequenceNumber=block;
+                bool gap=false;
+                bool complete=true;
+                for(unsigned int s=0; s<itsSources.size() && complete; s++){
+                    complete=itsSources[s]->read(&itsRaw[0],itsRaw.size());
+                    if(!complete) {
+                        break;
+                    }
+                    if(itsFormat.headerBytes>=4) {
+                        unsigned int bigEndian;
+                        memcpy(&bigEndian,&itsRaw[0],sizeof(bigEndian));
+                        if(s==0) {
+                            sequenceNumber=ntohl(bigEndian);
+                        } else if(ntohl(bigEndian)!=sequenceNumber) {
+                            gap=true; // the sources are not at the same block
+                        }
+                    }
+                    convert(&itsRaw[itsFormat.headerBytes],data,s);
+                }
+                if(!complete) {
+                    break;
+                }
+                if(block>0 && sequenceNumber!=expected) {
+                    gap=true;
+                }
+                expected=sequenceNumber+1;
+                if(gap) {
+                    __atomic_store_n(&itsGaps,itsGaps+1,__ATOMIC_RELEASE);
+                }
+                itsRing->publish(sequenceNumber,gap);
+                __atomic_store_n(&itsBlocksRead,itsBlocksRead+1,__ATOMIC_RELEASE);
+            }
+            itsRing->close();
+        }
+
+        // raw (possibly big endian) float
+        static inline float rawFloat(const char* raw, bool swap){
+            unsigned int bits;
+            memcpy(&bits,raw,sizeof(bits));
+            if(swap) {
+                bits=__builtin_bswap32(bits);
+            }
+            float value;
+            memcpy(&value,&bits,sizeof(value));
+            return value;
+        }
+
+        void BlockReader::convert(const char* raw, float* block, int source){
+            const int nrChannels=itsFormat.nrChannels;
+            const int nrSamples=itsFormat.nrSamples;
+            const bool swap=itsFormat.swapBytes;
+            float* out=block+source*nrChannels; // first channel of this source
+            if(!itsFormat.channelMajor) {
+                if(!swap && itsTotNrChannels==nrChannels) {
+                    memcpy(out,raw,(long)nrSamples*nrChannels*sizeof(float));
+                    return;
+                }
+                for(int sa=0; sa<nrSamples; sa++){
+                    const char* in=raw+(long)sa*nrChannels*sizeof(float);
+                    float* o=out+(long)sa*itsTotNrChannels;
+                    for(int ch=0; ch<nrChannels; ch++){
+                        o[ch]=rawFloat(in+ch*sizeof(float),swap);
+                    }
+                }
+                return;
+            }
+            // transpose in tiles of 16 samples: the rows of all channels of a tile and the samples written stay in cache
+            const int tile=16;
+            for(int sa0=0; sa0<nrSamples; sa0+=tile){
+                int sa1=std::min(sa0+tile,nrSamples);
+                for(int ch=0; ch<nrChannels; ch++){
+                    const char* in=raw+(long)ch*itsFormat.sampleStride*sizeof(float);
+                    for(int sa=sa0; sa<sa1; sa++){
+                        out[(long)sa*itsTotNrChannels+ch]=rawFloat(in+sa*sizeof(float),swap);
+                    }
+                }
+            }
+        }
+
+
 //##################################################################################
 
 /*
@@ -1410,87 +2514,326 @@ Save timeseries (append)
                 avgtimeseries.resize(itsNrSamples);
                 avgtimeseriesstream.resize(itsNrSamples);
                 sqrTimeseries.resize(itsNrSamples);
+                itsSampleDivisions=8;
+                divisionSums.resize(itsSampleDivisions*itsNrSamples);
+                mask.resize(itsNrChannels,itsNrSamples);
 
         }
 
 
-        bool RFIcleaning::calcBaseline(){
-             float * it;
-             #ifdef _OPENMP
-                #pragma omp parallel for private(it)
-             #else
-             #endif // _OPENMP
-             for(int ch=0; ch<itsNrChannels; ch++){
-                    it=itsDataStart+ch;
-                    baseline[ch]=0.0;
-                    for ( ; it<itsDataEnd; it+=itsNrChannels ) {
-                        baseline[ch]+=*it;
+        // Add row[start..end) to sum and the squares to sqr, returns the sum of the values and in rowSqr the sum of the squares.
+        // With scale, the values are first multiplied by scale and written back.
+        static inline float accumulateRow(float* row, const float* scale, float* sum, float* sqr, int start, int end, float& rowSqr){
+            int ch=start;
+            float rowSum=0;
+            rowSqr=0;
+#ifdef __SSE__
+            __m128 sum4=_mm_setzero_ps();
+            __m128 sqr4=_mm_setzero_ps();
+            for( ; ch+4<=end; ch+=4){
+                __m128 x=_mm_loadu_ps(row+ch);
+                if(scale!=NULL) {
+                    x=_mm_mul_ps(x,_mm_loadu_ps(scale+ch));
+                    _mm_storeu_ps(row+ch,x);
+                }
+                __m128 xx=_mm_mul_ps(x,x);
+                _mm_storeu_ps(sum+ch,_mm_add_ps(_mm_loadu_ps(sum+ch),x));
+                _mm_storeu_ps(sqr+ch,_mm_add_ps(_mm_loadu_ps(sqr+ch),xx));
+                sum4=_mm_add_ps(sum4,x);
+                sqr4=_mm_add_ps(sqr4,xx);
+            }
+            float s[4];
+            float q[4];
+            _mm_storeu_ps(s,sum4);
+            _mm_storeu_ps(q,sqr4);
+            rowSum=(s[0]+s[1])+(s[2]+s[3]);
+            rowSqr=(q[0]+q[1])+(q[2]+q[3]);
+#endif
+            for( ; ch<end; ch++){
+                float x=row[ch];
+                if(scale!=NULL) {
+                    x*=scale[ch];
+                    row[ch]=x;
+                }
+                sum[ch]+=x;
+                sqr[ch]+=x*x;
+                rowSum+=x;
+                rowSqr+=x*x;
+            }
+            return rowSum;
+        }
+
+
+        bool RFIcleaning::calcStatistics(bool normalize){
+            //# One pass over data[sample][channel] for all moments of the block:
+            //# per channel the sum (baseline) and the sum of squares (sqrBaseline),
+            //# per sample the sum (timeseries, avgtimeseries), the sum of squares (sqrTimeseries)
+            //# and the sums over each division of the band (divisionSums).
+            //# The samples are processed in tiles, every thread adds to its own channel sums.
+            vector<float> scale;
+            if(normalize) { // as divideBaseline, with the baseline of the previous call
+                scale.resize(itsNrChannels);
+                for(int ch=0; ch<itsNrChannels; ch++){
+                    scale[ch]= baseline[ch]!=0 ? itsNrSamples/baseline[ch] : 0.0;
+                }
+            }
+            const int tile=64;
+            int nrTiles=(itsNrSamples+tile-1)/tile;
+            int nrThreads=1;
+#ifdef _OPENMP
+            nrThreads=std::max(1,std::min(omp_get_max_threads(),nrTiles));
+#endif
+            int perDivision=itsNrChannels/itsSampleDivisions;
+            vector<float> channelSums(2L*nrThreads*itsNrChannels,0.0);
+
+#ifdef _OPENMP
+            #pragma omp parallel for schedule(static) num_threads(nrThreads)
+#endif
+            for(int t=0; t<nrTiles; t++){
+                int thread=0;
+#ifdef _OPENMP
+                thread=omp_get_thread_num();
+#endif
+                float* sum=&channelSums[2L*thread*itsNrChannels];
+                float* sqr=sum+itsNrChannels;
+                int end=std::min((t+1)*tile,itsNrSamples);
+                for(int sa=t*tile; sa<end; sa++){
+                    float* row=itsDataStart+(long)sa*itsNrChannels;
+                    float rowSum=0;
+                    float rowSqr=0;
+                    for(int div=0; div<=itsSampleDivisions; div++){ // the last part has the channels left over by the divisions
+                        int start=div*perDivision;
+                        int stop= div<itsSampleDivisions ? start+perDivision : itsNrChannels;
+                        float divSqr;
+                        float divSum=accumulateRow(row, normalize ? &scale[0] : NULL, sum, sqr, start, stop, divSqr);
+                        if(div<itsSampleDivisions) {
+                            divisionSums[div*itsNrSamples+sa]=divSum;
+                        }
+                        rowSum+=divSum;
+                        rowSqr+=divSqr;
                     }
+                    timeseries[sa]=rowSum;
+                    avgtimeseries[sa]=rowSum/itsNrChannels;
+                    sqrTimeseries[sa]=rowSqr;
                 }
-             return true;
+            }
+
+            for(int ch=0; ch<itsNrChannels; ch++){
+                float sum=0;
+                float sqr=0;
+                for(int thread=0; thread<nrThreads; thread++){
+                    sum+=channelSums[2L*thread*itsNrChannels+ch];
+                    sqr+=channelSums[(2L*thread+1)*itsNrChannels+ch];
+                }
+                baseline[ch]=sum;
+                sqrBaseline[ch]=sqr;
+            }
+            return true;
         }
 
 
+        bool RFIcleaning::robustStatistics(vector<float>& values, float& median, float& sigma){
+            median=0;
+            sigma=0;
+            if(values.size()==0) {
+                return false;
+            }
+            vector<float>::iterator middle=values.begin()+values.size()/2;
+            nth_element(values.begin(),middle,values.end());
+            median=*middle;
+            for(unsigned int i=0; i<values.size(); i++){
+                values[i]=fabs(values[i]-median);
+            }
+            nth_element(values.begin(),middle,values.end());
+            sigma=1.4826*(*middle); // sigma of a Gaussian distribution
+            return sigma>0;
+        }
 
-        bool RFIcleaning::calcSqrBaseline(){
-             float * it;
-            #ifdef _OPENMP
-                #pragma omp parallel for private(it)
-            #else
-            #endif // _OPENMP
-             for(int ch=0; ch<itsNrChannels; ch++){
-                    it=itsDataStart+ch;
-                    sqrBaseline[ch]=0.0;
-                    for ( ; it<itsDataEnd; it+=itsNrChannels ) {
-                        sqrBaseline[ch]+=(*it)*(*it);
+
+        int RFIcleaning::flagChannels(float cutlevel){
+            // channel sums without the flagged samples
+            vector<float> sum(baseline);
+            vector<float> sqr(sqrBaseline);
+            int validSamples=itsNrSamples;
+            for(int sa=0; sa<itsNrSamples; sa++){
+                if(mask.sample(sa)) {
+                    validSamples--;
+                    const float* row=itsDataStart+(long)sa*itsNrChannels;
+                    for(int ch=0; ch<itsNrChannels; ch++){
+                        sum[ch]-=row[ch];
+                        sqr[ch]-=row[ch]*row[ch];
                     }
                 }
-            return true;
+            }
+            // sqrBaseline/baseline^2 scaled to 1+variance/mean^2, high for channels with strong variations
+            vector<float> values;
+            values.reserve(itsNrChannels);
+            for(int ch=0; ch<itsNrChannels; ch++){
+                if(!mask.channel(ch) && sum[ch]!=0) {
+                    sqrDivBaseline[ch]=validSamples*sqr[ch]/(sum[ch]*sum[ch]);
+                    values.push_back(sqrDivBaseline[ch]);
+                } else {
+                    sqrDivBaseline[ch]=0;
+                }
+            }
+            float median;
+            float sigma;
+            if(!robustStatistics(values,median,sigma)) {
+                return 0;
+            }
+            int flagged=0;
+            chanIdVal tempIdVal;
+            for(int ch=0; ch<itsNrChannels; ch++){
+                if(!mask.channel(ch) && sum[ch]!=0 && fabs(sqrDivBaseline[ch]-median)>cutlevel*sigma) {
+                    mask.flagChannel(ch);
+                    tempIdVal.id=ch;
+                    tempIdVal.val=(int) round((sqrDivBaseline[ch]-median)/sigma);
+                    badChans.push_back(tempIdVal);
+                    flagged++;
+                }
+            }
+            return flagged;
         }
 
-        bool RFIcleaning::calcTimeseries(){
-             // calculate average timeseries
-             float * it;
-             float * vec_end=itsDataStart;
-             it=itsDataStart;
-            #ifdef _OPENMP
-                #pragma omp parallel for private(it,vec_end)
-            #else
-            #endif // _OPENMP
-             for(int sa=0; sa<itsNrSamples; sa++){
-                    it=itsDataStart+sa*itsNrChannels;
-                    vec_end+=itsNrChannels;
-                    // cout << it << " " << vec_end << endl;
-                    timeseries[sa]=0.0;
-                    for ( ; it<vec_end; it++ ) {
-                        timeseries[sa]+=*it;
+
+        int RFIcleaning::flagSamples(float cutlevel, int requiredDivisions){
+            // division sums without the flagged channels
+            int perDivision=itsNrChannels/itsSampleDivisions;
+            vector<float> sums(divisionSums);
+            vector<int> flaggedChannels;
+            for(int ch=0; ch<perDivision*itsSampleDivisions; ch++){
+                if(mask.channel(ch)) {
+                    flaggedChannels.push_back(ch);
+                }
+            }
+            if(flaggedChannels.size()>0) {
+                for(int sa=0; sa<itsNrSamples; sa++){
+                    const float* row=itsDataStart+(long)sa*itsNrChannels;
+                    for(unsigned int i=0; i<flaggedChannels.size(); i++){
+                        sums[(flaggedChannels[i]/perDivision)*itsNrSamples+sa]-=row[flaggedChannels[i]];
                     }
                 }
+            }
+            // count for each sample the divisions in which it is too high
+            vector<int> count(itsNrSamples,0);
+            vector<float> values;
+            values.reserve(itsNrSamples);
+            for(int div=0; div<itsSampleDivisions; div++){
+                const float* divSums=&sums[div*itsNrSamples];
+                values.resize(0);
+                for(int sa=0; sa<itsNrSamples; sa++){
+                    if(!mask.sample(sa)) {
+                        values.push_back(divSums[sa]);
+                    }
+                }
+                float median;
+                float sigma;
+                if(!robustStatistics(values,median,sigma)) {
+                    continue;
+                }
+                float limit=median+cutlevel*sigma;
+                for(int sa=0; sa<itsNrSamples; sa++){
+                    if(divSums[sa]>limit) {
+                        count[sa]++;
+                    }
+                }
+            }
+            int flagged=0;
+            for(int sa=0; sa<itsNrSamples; sa++){
+                if(count[sa]>=requiredDivisions && !mask.sample(sa)) {
+                    mask.flagSample(sa);
+                    badSamples.push_back(sa);
+                    flagged++;
+                }
+            }
+            return flagged;
+        }
+
+
+        int RFIcleaning::flagChannel0(){
+            int flagged=0;
+            for(int ch=0; ch<itsNrChannels; ch+=itsChansPerSubband){
+                mask.flagChannel(ch);
+                flagged++;
+            }
+            return flagged;
+        }
+
+
+        bool RFIcleaning::calcFill(std::string method){
+        /*  Sets the value used instead of the flagged data of each channel, according to the method. Options:
+            method "1" uses value 1, as cleanChannels("1") and cleanSamples("1") (data divided by the baseline)
+            method "0" uses value 0
+            method "mean" uses the mean of the unflagged samples of each channel, from the baseline of the
+            last calcStatistics, and 0 for flagged channels
+        */
+            if ( method == "1" || method == "0" ) {
+                std::fill(mask.fill.begin(),mask.fill.end(),(method == "1") ? 1.0 : 0.0);
+                return true;
+            } else if ( method != "mean" ) {
+                return false;
+            }
+            vector<float> sum(baseline);
+            int validSamples=itsNrSamples;
+            for(int sa=0; sa<itsNrSamples; sa++){
+                if(mask.sample(sa)) {
+                    validSamples--;
+                    const float* row=itsDataStart+(long)sa*itsNrChannels;
+                    for(int ch=0; ch<itsNrChannels; ch++){
+                        sum[ch]-=row[ch];
+                    }
+                }
+            }
+            for(int ch=0; ch<itsNrChannels; ch++){
+                mask.fill[ch]= (mask.channel(ch) || validSamples==0) ? 0.0 : sum[ch]/validSamples;
+            }
             return true;
         }
 
-        bool RFIcleaning::calcAverageTimeseries(){
-             // calculate average timeseries
-             float * it;
-             float * vec_end=itsDataStart;
-             it=itsDataStart;
-             #ifdef _OPENMP
-                #pragma omp parallel for private(it,vec_end)
+
+        bool RFIcleaning::applyMask(){
+            #ifdef _OPENMP
+                #pragma omp parallel for
             #else
             #endif // _OPENMP
-             for(int sa=0; sa<itsNrSamples; sa++){
-                    it=itsDataStart+sa*itsNrChannels;
-                    vec_end+=itsNrChannels;
-                    avgtimeseries[sa]=0.0;
-                    // cout << it << " " << vec_end << endl;
-                    for ( ; it<vec_end; it++ ) {
-                        avgtimeseries[sa]+=*it;
+            for(int sa=0; sa<itsNrSamples; sa++){
+                float* row=itsDataStart+(long)sa*itsNrChannels;
+                bool sampleFlagged=mask.sample(sa);
+                for(int ch=0; ch<itsNrChannels; ch++){
+                    if(sampleFlagged || mask.channel(ch)) {
+                        row[ch]=mask.fill[ch];
                     }
-                    avgtimeseries[sa]/=itsNrChannels;
                 }
+            }
             return true;
         }
 
+
+        void RFIcleaning::clearMask(){
+            mask.clear();
+            badChans.resize(0);
+            badSamples.resize(0);
+        }
+
+
+        bool RFIcleaning::calcBaseline(){
+            return calcStatistics(); // all moments in one pass
+        }
+
+
+
+        bool RFIcleaning::calcSqrBaseline(){
+            return calcStatistics(); // all moments in one pass
+        }
+
+        bool RFIcleaning::calcTimeseries(){
+            return calcStatistics(); // all moments in one pass
+        }
+
+        bool RFIcleaning::calcAverageTimeseries(){
+            return calcStatistics(); // all moments in one pass
+        }
+
         bool RFIcleaning::calcAverageTimeseriesStream(int startchan, int endchan){
              // calculate average timeseries
              float * it;
@@ -1532,23 +2875,7 @@ Save timeseries (append)
         }
 
         bool RFIcleaning::calcSqrTimeseries(){
-             float * it;
-             float * vec_end=itsDataStart;
-             it=itsDataStart;
-             #ifdef _OPENMP
-                #pragma omp parallel for private(it,vec_end)
-            #else
-            #endif // _OPENMP
-             for(int sa=0; sa<itsNrSamples; sa++){
-                    it=itsDataStart+sa*itsNrChannels;
-                    vec_end+=itsNrChannels;
-                    // cout << it << " " << vec_end << endl;
-                    sqrTimeseries[sa]=0.0;
-                    for ( ; it<vec_end; it++ ) {
-                        sqrTimeseries[sa]+=(*it)*(*it);
-                    }
-                }
-            return true;
+            return calcStatistics(); // all moments in one pass
         }
 
 
@@ -1976,6 +3303,7 @@ Save timeseries (append)
                     it2=baseline.begin();
                 }
             }
+            return true;
         }
 
         bool RFIcleaning::subtractAverageTimeseries(){
@@ -32,6 +32,7 @@
 
 #include <sstream>
 #include <vector>
+#include <map>
 #include <iostream>
 #include <fstream>
 #include <math.h>
@@ -48,8 +49,15 @@
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/time.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
 // forward declaration
 #define FRAT_TASK_BUFFER_LENGTH (20000)
+#define FRAT_COINCIDENCE_SHARDS (16) // number of locks of a CoinCheck
 #define FRAT_TRIGGER_PORT_0 (0x7BA0)
 #define FRAT_TRIGGER_PORT_1 (31661) // ports 0x7BA0 - 0x7BAF (31648-31663) are reserved for TBB triggers
 #define DM_CONSTANT (4.148808e-3)
@@ -90,6 +98,46 @@ struct triggerEvent {
 };
 
 
+// pulse candidate of the boxcar search, one per width and run of samples above the threshold
+struct boxcarCandidate {
+    int sample; // sample of the highest boxcar sum, relative to the start of the block (last sample of the boxcar)
+    int width; // boxcar width in samples
+    int length; // number of consecutive samples above the threshold
+    float sum; // boxcar sum at sample
+    float snr; // (sum-width*average)/(sqrt(width)*stddev)
+};
+
+// RFI flags of a block, set by RFIcleaning and used by SubbandDedispersion::dedisperse
+// instead of overwriting the flagged data
+struct rfiMask {
+    std::vector<unsigned int> channels; // bit ch%32 of word ch/32 is set if channel ch is flagged
+    std::vector<unsigned int> samples; // bit sa%32 of word sa/32 is set if sample sa is flagged
+    std::vector<float> fill; // value used instead of the flagged data of each channel
+    void resize(int nrChannels, int nrSamples) {
+        channels.assign((nrChannels+31)/32,0);
+        samples.assign((nrSamples+31)/32,0);
+        fill.assign(nrChannels,0.0);
+    }
+    void clear() {
+        std::fill(channels.begin(),channels.end(),0);
+        std::fill(samples.begin(),samples.end(),0);
+    }
+    bool channel(int ch) const { return (channels[ch>>5]>>(ch&31))&1; }
+    bool sample(int sa) const { return (samples[sa>>5]>>(sa&31))&1; }
+    void flagChannel(int ch) { channels[ch>>5]|=1u<<(ch&31); }
+    void flagSample(int sa) { samples[sa>>5]|=1u<<(sa&31); }
+};
+
+// layout of the raw blocks of one input file or stream, converted by the BlockReader
+struct inputBlockFormat {
+    int headerBytes; // bytes before the data of a block, the first 4 are a big endian sequence number (if headerBytes>=4)
+    int nrChannels; // channels in a block
+    int nrSamples; // samples in a block
+    int sampleStride; // values stored per channel (SAMPLES|2 in the old stokes data), only used if channelMajor
+    bool channelMajor; // data[channel][sampleStride], transposed by the reader; otherwise data[sample][channel]
+    bool swapBytes; // big endian floats
+};
+
 // Message used to trigger the TBBs
 struct TBBtriggerMessage {
     char Magic0;
@@ -201,6 +249,10 @@ inline bool SumArray(float *array, float* summedaxis, int dimArray1, int dimArra
 namespace FRAT {
   namespace coincidence {
     
+    // Store of the triggers of all subbands, searched for coincidences in time.
+    // The triggers are kept per group of subbands (shard) ordered by time, each shard with its own
+    // lock, so threads adding triggers of different subbands do not wait for each other. A check
+    // looks up the time window in every shard (O(log n)) and only walks the triggers inside it.
     class CoinCheck
     {
     public:
@@ -217,6 +269,7 @@ namespace FRAT {
 		CoinCheck(const CoinCheck&);
 		CoinCheck& operator=(const CoinCheck&);
 		
+        // triggers between reftime-timewindow and reftime
         std::string printEvents(int reftime, int timewindow);
     private:
 
@@ -230,8 +283,6 @@ namespace FRAT {
       
       // Single element in the buffer
         struct triggerBuffElem {
-            unsigned int	next;
-            unsigned int	prev;	
             unsigned int	SBnr; //RcuNr;
             //unsigned int	SeqNr;
             unsigned long int	Time;
@@ -244,13 +295,75 @@ namespace FRAT {
             unsigned int	afterval;
         };
 
-        // All buffered triggers
-        struct triggerBuffElem trigBuffer[FRAT_TASK_BUFFER_LENGTH];
+        // Triggers of the subbands with the same SBnr%FRAT_COINCIDENCE_SHARDS, by time
+        struct triggerShard {
+            pthread_mutex_t lock;
+            std::multimap<unsigned long int, triggerBuffElem> triggers;
+        };
 
-        // Index of first and last element in buffer
-        unsigned int first, last;
+        // collect SBnr and Time of the triggers with startTime <= Time <= endTime, sorted by time
+        void collect(unsigned long int startTime, unsigned long int endTime, std::vector<std::pair<unsigned long int, unsigned int> >& found);
+        // remove the trigger with the earliest time
+        void removeEarliest();
 
+        triggerShard itsShards[FRAT_COINCIDENCE_SHARDS];
+        volatile long itsNrBuffered; // triggers in all shards, at most FRAT_TASK_BUFFER_LENGTH
+        volatile unsigned long int itsNrAdded; // triggers added, the index returned by add2buffer is itsNrAdded%FRAT_TASK_BUFFER_LENGTH
+        unsigned long int itsAddedTime[FRAT_TASK_BUFFER_LENGTH]; // time of the trigger of each index
     }; // end CoinCheck
+
+
+    // Trigger messages of one recvmmsg call
+    struct triggerBatch {
+        std::vector<triggerEvent> triggers;
+        std::vector<double> arrival; // time the packet arrived on the socket (kernel timestamp), in seconds
+    };
+
+    // Receives the trigger messages of the SubbandTriggers on a udp port. A receiver thread reads up to
+    // BatchSize packets per recvmmsg call from a large socket buffer and queues them; next() gives the
+    // triggers to the thread that does the coincidence checks, so a burst of triggers is buffered in the
+    // queue instead of overflowing the socket. Packets dropped by the kernel (SO_RXQ_OVFL) are counted,
+    // as is the latency from the arrival of a packet until it is returned by next().
+    class TriggerAggregator {
+        public:
+            ~TriggerAggregator(); // destructor, stops the thread
+            TriggerAggregator(int port=FRAT_TRIGGER_PORT_0, int BatchSize=64, int NrBatches=256, int SocketBufferBytes=16*1024*1024); // constructor
+            bool start(); // bind the socket and start the receiver thread
+            void stop(); // stop the thread, next() returns the queued triggers and then false
+            bool next(std::vector<triggerEvent>& triggers); // wait for the next batch of triggers, false after stop()
+            long received() { return __atomic_load_n(&itsReceived,__ATOMIC_ACQUIRE); } // valid trigger messages received
+            long kernelDrops() { return __atomic_load_n(&itsKernelDrops,__ATOMIC_ACQUIRE); } // packets dropped because the socket buffer was full, as of the last packet received
+            long badPackets() { return __atomic_load_n(&itsBadPackets,__ATOMIC_ACQUIRE); } // packets that are not a triggerEvent
+            long batches() { return __atomic_load_n(&itsBatches,__ATOMIC_ACQUIRE); } // recvmmsg calls that returned packets
+            double meanLatency(); // average seconds from arrival to next()
+            double maxLatency() { return itsMaxLatency; } // largest seconds from arrival to next()
+            std::string summary(); // counters as text
+
+        private:
+            static void* run(void* aggregator); // thread entry point
+            void receive(); // loop of the thread
+
+            int itsPort;
+            int itsBatchSize; // packets per recvmmsg
+            int itsSocketBufferBytes; // requested SO_RCVBUF
+            int itsSocket;
+            std::vector<triggerBatch> itsQueue; // ring of batches
+            int itsFirst; // oldest batch in the queue
+            int itsCount; // batches in the queue
+            pthread_mutex_t itsLock; // protects the queue
+            pthread_cond_t itsNotEmpty;
+            pthread_cond_t itsNotFull;
+            volatile long itsStop; // 1 after stop()
+            volatile long itsReceived;
+            volatile long itsKernelDrops;
+            volatile long itsBadPackets;
+            volatile long itsBatches;
+            double itsTotalLatency; // sum of the latencies, only used by next()
+            double itsMaxLatency;
+            long itsReturned; // triggers returned by next()
+            pthread_t itsThread;
+            bool itsRunning; // thread started and not joined
+    }; // TriggerAggregator
   }; // end coincidence
 	namespace analysis { //FRAT::analysis
 	 
@@ -258,18 +371,59 @@ namespace FRAT {
          {
             public:
               ~UDPsend(); // destructor
-              UDPsend(); // constructor
+              UDPsend(const char* Hostname=FRAT_HOSTNAME, int Port=FRAT_TRIGGER_PORT_0); // constructor
               // send a trigger message over udp
 			  bool SendTriggerMessage(struct triggerEvent trigger);
+              // add a trigger message to the queue (thread safe), sent by FlushTriggerMessages
+              void QueueTriggerMessage(const struct triggerEvent& trigger);
+              // send the queued trigger messages with as few sendmmsg calls as possible
+              bool FlushTriggerMessages();
+              long sent() { return itsSent; } // messages sent
+              long failed() { return itsFailed; } // messages that could not be sent
+              // send nrTriggers messages with sendmmsg, returns the number sent
+              static int SendTriggerMessages(int sock, const struct sockaddr_in& address, const struct triggerEvent* triggers, int nrTriggers);
             private:
               const char* send_data;
               struct sockaddr_in server_addr;
 			  struct hostent *host;
 			  const char* hostname;
               int sock;
+              std::vector<struct triggerEvent> itsQueue; // messages waiting for FlushTriggerMessages
+              pthread_mutex_t itsLock; // protects itsQueue and the counters
+              long itsSent;
+              long itsFailed;
          }; // UDP send
 
 
+        // Matched filter search of a dedispersed time series with boxcars of several widths.
+        // One prefix sum of (series-average) per block gives the sum of every boxcar as the difference of two
+        // prefix values; all widths are compared with their threshold 4 samples at a time (SSE).
+        // The last maxWidth-1 samples of a block are kept, so boxcars extend into the previous block.
+        class BoxcarSearch {
+            public:
+                ~BoxcarSearch(); // destructor
+                BoxcarSearch(int NrSamples, std::vector<int> widths); // constructor
+                // search one block of NrSamples values, candidates are replaced by the runs above TriggerLevel*stddev
+                int search(const float* series, float average, float stddev, float TriggerLevel, std::vector<boxcarCandidate>& candidates);
+                int maxWidth() { return itsMaxWidth; } // largest boxcar width
+
+            private:
+                // state of a run of samples above the threshold
+                struct boxcarRun {
+                    bool active;
+                    boxcarCandidate best;
+                };
+                // check the boxcar sums hi[t]-lo[t] for start<=t<end
+                void scan(const float* hi, const float* lo, int start, int end, float cut, boxcarRun& run, std::vector<boxcarCandidate>& candidates);
+
+                int itsNrSamples; // samples per block
+                int itsMaxWidth; // largest width
+                std::vector<int> itsWidths; // boxcar widths
+                std::vector<float> itsBuffer; // maxWidth-1 samples of the previous block, followed by the block
+                std::vector<float> itsPrefix; // prefix sum of itsBuffer-average, itsPrefix[0]=0
+        }; // BoxcarSearch
+
+
 	  class SubbandTrigger // FRAT::analysis::SubbandTrigger 
 		  {
 		  public:	  
@@ -288,8 +442,12 @@ namespace FRAT {
               // dedisperse data for the DM of the constructor
               // NOTE: what is the difference between 1 and 2?
 			  bool dedisperseData2(float* data, unsigned int sequenceNumber, FRAT::coincidence::CoinCheck* cc, int CoinNr, int CoinTime, bool Transposed=false);
+              // use a block dedispersed by SubbandDedispersion instead of dedisperseData2
+			  bool setDedispersedData(float* dedispersed, unsigned int sequenceNumber);
               // search for pulses
 			  bool runTrigger(unsigned int sequenceNumber, int IntegrationLength, FRAT::coincidence::CoinCheck* cc, int CoinNr, int CoinTime, bool Transposed=false);
+              // search for pulses with all widths in integrationLength at once (BoxcarSearch)
+			  bool runBoxcarTrigger(unsigned int sequenceNumber, FRAT::coincidence::CoinCheck* cc, int CoinNr, int CoinTime);
               // calculate average and standard deviation of dedispersed data
 			  bool calcAverageStddev(unsigned int sequenceNumber);
               // do dedispersion and triggering, now split in separate steps
@@ -315,8 +473,10 @@ namespace FRAT {
 			  std::string blockAnalysisSummary();
               // triggers found sofar
 			  std::string FoundTriggers();
-              // send UDP message with from this trigger
+              // queue UDP message with from this trigger, sent at the end of the block
 			  bool SendTriggerMessage(struct triggerEvent trigger);
+              // send the queued messages of this block together (sendmmsg)
+			  bool FlushTriggerMessages();
               // write standard deviation and average from buffer to file
               bool writeStdDev(ofstream * fsfile);
               bool writeAverage(ofstream * fsfile);
@@ -361,6 +521,8 @@ namespace FRAT {
               std::vector <float> SumDeDispersed; // not used at the moment? NOTE
               std::vector <struct triggerEvent> triggerMessages; // stores trigger messages
               std::vector<int> integrationLength; // values for different sliding window length for the trigger
+              BoxcarSearch* itsBoxcarSearch; // used by runBoxcarTrigger, created at the first call
+              std::vector<boxcarCandidate> itsCandidates; // candidates of the last runBoxcarTrigger
               int minBlockNumber; // only send triggers for blocks later than this number, to prevent sending false triggers due to partially summed data leading to low averages.
 			  int itsBufferLength; // length of DeDispersedBuffer
 			  bool DoPadding; // Current task: swap endianness of data, if True
@@ -384,6 +546,7 @@ namespace FRAT {
 			  //char send_data[1024];
 			  const char* send_data;
 			  const char* hostname;
+              std::vector<struct triggerEvent> itsPendingTriggers; // trigger messages of this block, not sent yet
                 
               std::vector<float> itsFREQvalues; // values of the frequency axis
 			  
@@ -407,6 +570,186 @@ namespace FRAT {
 		  }; //SubbandTrigger
 
 
+        // Dedisperses a block of one stream for all DM trials at once (two-stage subband dedispersion).
+        // Stage 1 sums the channels of each subband for a coarse grid of nominal DMs, stage 2 sums
+        // the subbands with the delay of each DM trial (within one sample of the truncated delays of dedisperseData2,
+        // exact for a DM trial equal to its nominal DM). The result is a DM x time array of the
+        // block that is passed to the SubbandTrigger of each DM with setDedispersedData.
+        class SubbandDedispersion {
+            public:
+                ~SubbandDedispersion(); // destructor
+                SubbandDedispersion(std::vector<float> FREQvalues, int StartChannel, int NrChannels, int TotNrChannels, int ChannelsPerSubband, int NrSamples, float TimeResolution, std::vector<float> DMvalues); // constructor
+                /*
+                    * FREQvalues *,      frequency of each channel in Hz
+                    * StartChannel *,    first channel of this stream
+                    * NrChannels *,      channels in this stream
+                    * TotNrChannels *,   channels of all streams, stride of one sample in the data
+                    * ChannelsPerSubband *, channels summed in stage 1
+                    * NrSamples *,       samples in a block
+                    * TimeResolution *,  in s
+                    * DMvalues *,        DM trials, the rows of the output
+                */
+                bool dedisperse(float* data, const rfiMask* mask=NULL); // dedisperse one block, data[sample][TotNrChannels], flagged data replaced by mask->fill
+                float* dedispersedData(int DMindex); // NrSamples dedispersed values of DM trial DMindex of the last block
+                int nrNominalDMs() { return itsNominalDMs.size(); } // DM values of stage 1
+                int maxDelay() { return itsMaxDelay; } // delay in samples of the lowest to the highest frequency for the largest DM
+                void summary(); // summary of the parameters
+
+            private:
+                int itsStartChannel; // first channel of this stream
+                int itsNrChannels; // channels in this stream
+                int itsTotNrChannels; // stride of one sample in the data
+                int itsNrSubbands; // number of subbands of stage 1
+                int itsNrSamples; // samples per block
+                int itsMaxDelay; // largest delay in samples
+                long itsTotalTime; // samples processed so far
+                std::vector<float> itsDMvalues; // DM trials
+                std::vector<float> itsNominalDMs; // DM grid of stage 1
+                std::vector<int> itsNominalIndex; // nominal DM used for each DM trial
+                std::vector<int> itsSubbandStart; // first channel of each subband (relative to StartChannel), with end marker
+                std::vector<int> itsChannelOffset; // [nominal DM][channel] delay within the subband
+                std::vector<int> itsSubbandOffset; // [DM trial][subband] delay of the subband
+                int itsSubbandMask; // length-1 of the stage 1 ring buffers (power of 2)
+                int itsOutputMask; // length-1 of the stage 2 ring buffers (power of 2)
+                std::vector<float> itsChannelData; // [channel][sample] data of this stream
+                std::vector<char> itsChannelFlagged; // channel of this stream flagged in the mask of the block
+                std::vector<float> itsSubbandBuffer; // [nominal DM][subband][ring] partial sums of stage 1
+                std::vector<float> itsOutputBuffer; // [DM trial][ring] partial sums of stage 2
+                std::vector<float> itsDedispersed; // [DM trial][sample] dedispersed block
+
+        }; // SubbandDedispersion
+
+
+        // Lock-free ring of aligned blocks between one producer (the BlockReader) and NrConsumers consumers.
+        // Every consumer gets every block, in order; a slot is only reused once all consumers released it.
+        // The producer and the consumers only share counters (GCC __atomic builtins), nobody holds a lock,
+        // so a consumer only waits when the next block has not been read yet.
+        class BlockRing {
+            public:
+                ~BlockRing(); // destructor
+                BlockRing(long BlockValues, int NrSlots, int NrConsumers); // constructor, NrSlots is rounded up to a power of 2
+                // producer
+                float* reserve(); // slot for the next block, waits while the ring is full; NULL after abort()
+                void publish(unsigned int sequenceNumber, bool gap); // make the reserved block visible to the consumers
+                void close(); // no more blocks will be published
+                // consumers
+                float* acquire(int consumer, unsigned int& sequenceNumber, bool& gap); // next block, waits while empty; NULL at the end
+                void release(int consumer); // done with the block of the last acquire
+                void abort(); // stop producer and consumers, acquire and reserve return NULL
+                long blockValues() { return itsBlockValues; } // floats in a block
+                int nrSlots() { return itsMask+1; } // number of blocks in the ring
+                long producerWaits() { return itsProducerWaits; } // times the producer found the ring full
+                void summary(); // summary of the parameters
+
+            private:
+                // read counter of one consumer, on its own cache line
+                struct consumerCounter {
+                    volatile long read; // blocks released
+                    char pad[64-sizeof(long)];
+                };
+                bool wait(int& spins); // back off after a failed poll, false if aborted
+                long slowestConsumer(); // smallest read counter
+
+                float* itsMemory; // NrSlots blocks of BlockValues floats, 64 byte aligned
+                long itsBlockValues; // floats in a block
+                long itsSlotValues; // distance of two slots in floats (multiple of 16)
+                int itsMask; // NrSlots-1
+                int itsNrConsumers; // number of consumers
+                volatile long itsWritten; // blocks published
+                volatile long itsClosed; // 1 after close()
+                volatile long itsAborted; // 1 after abort()
+                long itsProducerWaits; // times the producer found the ring full (producer only)
+                std::vector<consumerCounter> itsRead; // blocks released by each consumer
+                std::vector<unsigned int> itsSequenceNumbers; // sequence number of each slot
+                std::vector<char> itsGaps; // data missing before the block in each slot
+        }; // BlockRing
+
+
+        // Source of raw blocks for the BlockReader
+        class BlockSource {
+            public:
+                virtual ~BlockSource() {}
+                virtual bool read(char* buffer, long bytes)=0; // read the next raw block of bytes, false at the end of the data
+                void interrupt() { __atomic_store_n(&itsInterrupted,1,__ATOMIC_RELEASE); } // make a waiting read return false
+            protected:
+                BlockSource() : itsInterrupted(0) {}
+                bool interrupted() { return __atomic_load_n(&itsInterrupted,__ATOMIC_ACQUIRE)!=0; } // interrupt() was called
+                volatile long itsInterrupted; // 1 after interrupt()
+        }; // BlockSource
+
+
+        // Raw blocks from a file (or a named pipe). The file is waited for if it is not there yet, and a
+        // block that is not completely written yet is waited for as well, so files that are still being
+        // written by the pipeline can be followed.
+        class FileSource : public BlockSource {
+            public:
+                ~FileSource(); // destructor
+                FileSource(std::string filename, long startBlock, long blockBytes, bool follow=true); // constructor
+                bool read(char* buffer, long bytes); // the file is opened at the first read
+            private:
+                std::string itsFilename;
+                long itsStartBlock; // first block to read
+                FILE* itsFile;
+                bool itsFollow; // wait for the file and at the end of the file for more data
+        }; // FileSource
+
+
+        // Raw blocks from UDP packets, e.g. written by a psrdada-style network sender.
+        // Each packet starts with the 64 bit big endian byte offset of its payload in the stream of
+        // raw blocks. Packets may be reordered within two blocks; lost packets leave zeros in the block.
+        class UDPSource : public BlockSource {
+            public:
+                ~UDPSource(); // destructor
+                UDPSource(int port, long blockBytes, int maxPacketBytes=9000); // constructor
+                bool read(char* buffer, long bytes);
+                long lostBytes() { return itsLostBytes; } // bytes of the blocks returned so far that were not received
+            private:
+                bool store(char* buffer, unsigned long long offset, const char* payload, long length); // copy a payload into the current (buffer) or next block, false if it is beyond the next block
+                int itsSocket;
+                long itsBlockBytes; // size of a raw block
+                unsigned long long itsBlockStart; // stream offset of the current block
+                std::vector<char> itsPacket; // receive buffer
+                std::vector<char> itsNext; // block after the current one
+                long itsReceived; // bytes received of the current block
+                long itsNextReceived; // bytes received of the next block
+                long itsLostBytes; // bytes lost in the blocks returned
+                long itsHeld; // length of a packet in itsPacket that belongs to a later block, 0 if none
+                bool itsStarted; // first packet received
+        }; // UDPSource
+
+
+        // Dedicated input thread: reads a raw block from each source, swaps the bytes, transposes it to
+        // data[sample][channel] (channels of the sources after each other) and publishes it in the ring,
+        // so the dedispersion threads never wait for I/O.
+        class BlockReader {
+            public:
+                ~BlockReader(); // destructor, stops the thread
+                BlockReader(std::vector<BlockSource*> sources, inputBlockFormat format, BlockRing* ring); // constructor
+                bool start(long nrBlocks=0); // start the thread, read nrBlocks blocks (0: until the end of a source)
+                void stop(); // interrupt the sources and abort the ring, wait for the thread
+                long blocksRead() { return __atomic_load_n(&itsBlocksRead,__ATOMIC_ACQUIRE); } // blocks published so far
+                long gaps() { return __atomic_load_n(&itsGaps,__ATOMIC_ACQUIRE); } // blocks with missing data before them
+                long rawBlockBytes(); // size of one raw block of a source
+                static long rawBlockBytes(inputBlockFormat format); // size of one raw block of a source
+
+            private:
+                static void* run(void* reader); // thread entry point
+                void readBlocks(); // loop of the thread
+                void convert(const char* raw, float* block, int source); // swap and transpose raw data of one source
+
+                std::vector<BlockSource*> itsSources;
+                inputBlockFormat itsFormat;
+                BlockRing* itsRing;
+                int itsTotNrChannels; // channels of all sources
+                long itsNrBlocks; // blocks to read, 0 for all
+                volatile long itsBlocksRead; // blocks published so far
+                volatile long itsGaps; // blocks with missing data before them
+                std::vector<char> itsRaw; // raw block
+                pthread_t itsThread;
+                bool itsRunning; // thread started and not joined
+        }; // BlockReader
+
+
         // Class used to clean a two dimensional array from interference along the time and frequency axis
         class RFIcleaning {
             public:
@@ -438,6 +781,8 @@ namespace FRAT {
                 vector <float> sqrDivBaseline;  // sqrBaseline / Baseline
                 vector <float> sqrDivBaselineSort; // sorted array of the previous one
                 vector <int> badSamples; // samples that contain RFI
+                vector <float> divisionSums; // [division][sample] sum over the channels of each division of the band, for flagSamples
+                rfiMask mask; // flags of the block, set by flagChannels, flagSamples and flagChannel0
                 // several iterators used throughout to save time creating time every time.
                 // care should be taken by this way of programming it
                 vector<float>::iterator it1;
@@ -453,6 +798,14 @@ namespace FRAT {
                 int size;
 
                 string outFileName;
+                bool calcStatistics(bool normalize=false); // baseline, sqrBaseline, timeseries, avgtimeseries, sqrTimeseries and divisionSums in one pass; normalize: first divide the data by the mean of its channel (as divideBaseline)
+                int flagChannels(float cutlevel); // flag channels with sqrBaseline/baseline^2 (without flagged samples) further than cutlevel robust sigma from the median
+                int flagSamples(float cutlevel, int requiredDivisions=2); // flag samples above median+cutlevel robust sigma (without flagged channels) in requiredDivisions divisions of the band
+                int flagChannel0(); // flag the 0th channel of each subband
+                bool calcFill(std::string method="mean"); // mask.fill: value 1, 0 or the mean of the unflagged samples of each channel (0 for flagged channels)
+                bool applyMask(); // write mask.fill into the flagged data, for users that do not take the mask
+                void clearMask(); // remove all flags of the previous block
+                static bool robustStatistics(vector<float>& values, float& median, float& sigma); // median and 1.4826*median absolute deviation, reorders values
                 bool calcBaseline(); // sum over time of the sample for each channel
                 bool calcSqrBaseline(); // sum over time of samples^2 for each channel
                 int calcBadChannels(int cutlevel, bool useInterpolatedBaseline); // True if SqrBaseline/Baseline > average+cutlevel*stddev for a certain frequencychannel
@@ -492,6 +845,7 @@ namespace FRAT {
                 int ChannelsPerDivision; // channels in each division
                 int cutlevel; // threshold for determining RFI
                 int itsChansPerSubband; // channels in each subband, used for flagging 0-th channel
+                int itsSampleDivisions; // divisions of the band in which samples are checked
 
 
        
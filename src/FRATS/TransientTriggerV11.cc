@@ -397,8 +397,6 @@ int main (int argc,
 	
 	
 	//--------------READ IN THE FILES----------------------------------	
-	FILE ** pFile;
-	pFile = new FILE*[ninputfiles];	
 	
 	std::string* infile;
 	infile=new std::string[ninputfiles];
@@ -442,14 +440,30 @@ int main (int argc,
 		}
 	}
 	
-	for(int i=0;i<ninputfiles;i++){
-		
-		pFile[i] = fopen(infile[i].c_str(),"rb");
-		while (pFile[i]==NULL) {
-			cout << "File not there yet" << endl;
-			usleep(500000);
-			pFile[i] = fopen(infile[i].c_str(),"rb");
-		} 		
+	// One reader thread per stream reads the files of its subbands: sequence number, padding and
+	// data[channel][samplesOr2] of each file are swapped and transposed to data[sample][channel]
+	// with the channels of the subbands after each other.
+	inputBlockFormat format;
+	format.headerBytes=sizeof(unsigned int);
+	if(DoPadding){format.headerBytes+=508;}
+	format.nrChannels=channels;
+	format.nrSamples=samples;
+	format.sampleStride=samplesOr2;
+	format.channelMajor=true;
+	format.swapBytes=DoPadding;
+	int stokesdatasize=BlockReader::rawBlockBytes(format);
+	vector<BlockSource*> sources[nstreams];
+	BlockRing* rings[nstreams];
+	BlockReader* readers[nstreams];
+	for(int sc=0; sc < nstreams; sc++){
+		for(int fc=0; fc < nrCombinedSBs; fc++){
+			sources[sc].push_back(new FileSource(infile[sc*nrCombinedSBs+fc], startpos, stokesdatasize));
+		}
+		rings[sc] = new BlockRing((long)NrChannels*samples, 8, 1);
+		readers[sc] = new BlockReader(sources[sc], format, rings[sc]);
+		if(!readers[sc]->start(nrblocks)){
+			return 1;
+		}
 	}
 	
 	ofstream pulselogfile;
@@ -476,88 +490,37 @@ int main (int argc,
 	triggerlogfile.open(triggerlogfilename.c_str());
 	alltriggerlogfile.open(alltriggerlogfilename.c_str(),ios::out | ios::app);
 	
-	unsigned int sequence_nr[ninputfiles];
-	unsigned int prev_sequence_nr[ninputfiles];
-	for(int i=0; i < ninputfiles; i++){
-		prev_sequence_nr[i]=0;
-	}
-	char pad[508];
-	unsigned num;
-	fpos_t pos;
-	int blockdatasize=channels*samplesOr2*sizeof(float);
-	int stokesdatasize=blockdatasize+sizeof(unsigned int);
-	if(DoPadding){stokesdatasize+=sizeof(pad);}
-	float *data=(float*)malloc(nrCombinedSBs*blockdatasize);
-	if (data==NULL)
-	{
-		cerr << "Memory could not be allocated\n";
-		return 1;
-	}
+	unsigned int sequence_nr;
+	bool gap;
+	float *data;
 	
 	cout << "stokesdatasize " << stokesdatasize << endl;
 	
-	for(int j=0; j<ninputfiles; j++){fseek(pFile[j], startpos*(stokesdatasize), SEEK_SET); }
 	for(int blockNr = 0; blockNr< nrblocks; blockNr++){
 		for(int sc=0; sc < nstreams; sc++){
 			
-			for(int fc=0; fc < nrCombinedSBs; fc++){
-				//cout << "fc = " << fc << endl;
-				int i=sc*nrCombinedSBs+fc; //file identifier
-				fgetpos(pFile[i],&pos);
-				
-				num = fread( &(sequence_nr[i]), sizeof(sequence_nr[i]), 1, pFile[i]); //read sequence number
-				if( !num) {
-					//	cout << "Error, EOF reached.\n";
-				}
-				
-
-				
-				if(DoPadding){
-					num = fread( &(pad),sizeof(pad), 1, pFile[i]); //read padding
-					if( !num) {
-						//		cout << "Error, EOF reached.\n";
-					}
-				}
-				//cout << "Data read start " << fc*channels*samplesOr2 << endl;
-				num = fread( &(data[fc*channels*samplesOr2]), blockdatasize, 1, pFile[i]); //read data
-				if( !num) {
-					//	cout << "Error, EOF reached.\n";
-				}
-				if( !num) {
-					cout << "*";
-					usleep(50000);
-					fsetpos(pFile[i],&pos);
-					fc--;
-					
-					//i--; //1 file k--
-					continue;
-				}
-				else {		  
-					swap_endian( (char*)&(sequence_nr[i]) );
-					if(i==0){  
-						cerr << "reading sequence number: " << sequence_nr[i] << endl;
-					}		
-					//	if (i%nrCombinedSBs==0){
-					//		blockvalidsamples[fc]=0; blocksum[fc]=0;
-					// 	}//  }
-				}
-				if(prev_sequence_nr[i]!=(sequence_nr[i]-1) && blockNr !=0)
-				{
-				    cout << "Data missing for block " << blockNr;
-					if(failsafe){
-						cout << "\n Failsafe is on, stopping the trigger ";
-						cout << "numbers: " << prev_sequence_nr[i] << " " << sequence_nr[i];
-						return 43;
-					}
-					cout << endl;
+			data = rings[sc]->acquire(0, sequence_nr, gap); // all files of this stream, read ahead by the reader
+			if(data==NULL) {
+				cout << "End of the data after " << blockNr << " blocks" << endl;
+				return nofFailedTests;
+			}
+			if(sc==0){  
+				cerr << "reading sequence number: " << sequence_nr << endl;
+			}		
+			if(gap)
+			{
+			    cout << "Data missing for block " << blockNr;
+				if(failsafe){
+					cout << "\n Failsafe is on, stopping the trigger ";
+					cout << "number: " << sequence_nr;
+					return 43;
 				}
-				prev_sequence_nr[i]=sequence_nr[i];
-
-			} // for files 
+				cout << endl;
+			}
 			for(int DMcounter=0; DMcounter<nDMs; DMcounter++){	//analyse data of one stream for all DMs
 				
 				cout << "Processing " << sc << " " << DMcounter << endl;
-				foundpulse=SBTs[sc][DMcounter]->processData(data, sequence_nr[sc*nrCombinedSBs], &cc[DMcounter], CoinNr, CoinTime);
+				foundpulse=SBTs[sc][DMcounter]->processData(data, sequence_nr, &cc[DMcounter], CoinNr, CoinTime);
 
 				datamonitor[sc][DMcounter] << SBTs[sc][DMcounter]->blockAnalysisSummary() << "\n";
 				if(foundpulse){ 
@@ -581,11 +544,18 @@ int main (int argc,
 					pulsenr++;
 				}
 			}
-			
+			rings[sc]->release(0);
 
 		}
         usleep(sleeptime);
 	}
+	for(int sc=0; sc < nstreams; sc++){
+		delete readers[sc];
+		delete rings[sc];
+		for(unsigned int fc=0; fc < sources[sc].size(); fc++){
+			delete sources[sc][fc];
+		}
+	}
 	return nofFailedTests;
 }
 
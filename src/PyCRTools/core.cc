@@ -28,6 +28,13 @@
 
 #include "core.h"
 
+#include <stdexcept>
+#include <new>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 // ========================================================================
 //
 //  Implementation
@@ -81,6 +88,176 @@ std::vector<uint> PyList2STLuIntVec(PyObject* pyob){
   return vec;
 }
 
+// ========================================================================
+//  Parallel execution of generated wrappers
+// ========================================================================
+
+namespace {
+  HInteger hParallelThreads = 0;
+  HInteger hParallelThreshold = HFPP_PARALLEL_DEFAULT_THRESHOLD;
+}
+
+/*!
+  \brief Set the number of threads used by parallel wrappers.
+
+  \param nthreads -- Number of threads, 0 to use the OpenMP default.
+*/
+void hSetParallelThreads(const HInteger nthreads)
+{
+  hParallelThreads = hfmax(nthreads, (HInteger)0);
+}
+
+/*!
+  \brief Number of threads used by parallel wrappers.
+*/
+HInteger hGetParallelThreads()
+{
+  if (hParallelThreads > 0)
+  {
+    return hParallelThreads;
+  }
+
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+/*!
+  \brief Set the minimum vector length for which parallel wrappers use threads.
+*/
+void hSetParallelThreshold(const HInteger threshold)
+{
+  hParallelThreshold = hfmax(threshold, (HInteger)1);
+}
+
+/*!
+  \brief Minimum vector length for which parallel wrappers use threads.
+*/
+HInteger hGetParallelThreshold()
+{
+  return hParallelThreshold;
+}
+
+// Types of exceptions kept by hfppParallelError, in the order they are caught
+enum {
+  HFPP_ERROR_NONE, HFPP_ERROR_VALUE, HFPP_ERROR_TYPE, HFPP_ERROR_KEY, HFPP_ERROR_INDEX,
+  HFPP_ERROR_MEMORY, HFPP_ERROR_ARITHMETIC, HFPP_ERROR_EOF, HFPP_ERROR_FLOATINGPOINT,
+  HFPP_ERROR_OVERFLOW, HFPP_ERROR_ZERODIVISION, HFPP_ERROR_NAME, HFPP_ERROR_NOTIMPLEMENTED,
+  HFPP_ERROR_IO, HFPP_ERROR_EXCEPTION, HFPP_ERROR_STD, HFPP_ERROR_UNKNOWN
+};
+
+hfppParallelError::hfppParallelError() : type(HFPP_ERROR_NONE)
+{
+}
+
+/*!
+  \brief Keep the exception being handled, if it is the first one.
+
+  Must be called from a catch block.
+*/
+void hfppParallelError::capture()
+{
+#ifdef _OPENMP
+#pragma omp critical(hfpp_parallel_error)
+#endif
+  {
+    if (type == HFPP_ERROR_NONE) {
+      try {
+        throw;
+      } catch (PyCR::ValueError& e) {
+        type = HFPP_ERROR_VALUE; message = e.message;
+      } catch (PyCR::TypeError& e) {
+        type = HFPP_ERROR_TYPE; message = e.message;
+      } catch (PyCR::KeyError& e) {
+        type = HFPP_ERROR_KEY; message = e.message;
+      } catch (PyCR::IndexError& e) {
+        type = HFPP_ERROR_INDEX; message = e.message;
+      } catch (PyCR::MemoryError& e) {
+        type = HFPP_ERROR_MEMORY; message = e.message;
+      } catch (PyCR::ArithmeticError& e) {
+        type = HFPP_ERROR_ARITHMETIC; message = e.message;
+      } catch (PyCR::EOFError& e) {
+        type = HFPP_ERROR_EOF; message = e.message;
+      } catch (PyCR::FloatingPointError& e) {
+        type = HFPP_ERROR_FLOATINGPOINT; message = e.message;
+      } catch (PyCR::OverflowError& e) {
+        type = HFPP_ERROR_OVERFLOW; message = e.message;
+      } catch (PyCR::ZeroDivisionError& e) {
+        type = HFPP_ERROR_ZERODIVISION; message = e.message;
+      } catch (PyCR::NameError& e) {
+        type = HFPP_ERROR_NAME; message = e.message;
+      } catch (PyCR::NotImplementedError& e) {
+        type = HFPP_ERROR_NOTIMPLEMENTED; message = e.message;
+      } catch (PyCR::IOError& e) {
+        type = HFPP_ERROR_IO; message = e.message;
+      } catch (PyCR::Exception& e) {
+        type = HFPP_ERROR_EXCEPTION; message = e.message;
+      } catch (std::bad_alloc& e) {
+        type = HFPP_ERROR_MEMORY; message = e.what();
+      } catch (std::exception& e) {
+        type = HFPP_ERROR_STD; message = e.what();
+      } catch (...) {
+        type = HFPP_ERROR_UNKNOWN; message = "unknown exception in a parallel wrapper";
+      }
+    }
+  }
+}
+
+/*!
+  \brief True if a piece has thrown an exception.
+*/
+bool hfppParallelError::failed() const
+{
+  return type != HFPP_ERROR_NONE;
+}
+
+/*!
+  \brief Throw the kept exception again (nothing if there is none).
+*/
+void hfppParallelError::rethrow() const
+{
+  switch (type) {
+  case HFPP_ERROR_NONE: return;
+  case HFPP_ERROR_VALUE: throw PyCR::ValueError(message);
+  case HFPP_ERROR_TYPE: throw PyCR::TypeError(message);
+  case HFPP_ERROR_KEY: throw PyCR::KeyError(message);
+  case HFPP_ERROR_INDEX: throw PyCR::IndexError(message);
+  case HFPP_ERROR_MEMORY: throw PyCR::MemoryError(message);
+  case HFPP_ERROR_ARITHMETIC: throw PyCR::ArithmeticError(message);
+  case HFPP_ERROR_EOF: throw PyCR::EOFError(message);
+  case HFPP_ERROR_FLOATINGPOINT: throw PyCR::FloatingPointError(message);
+  case HFPP_ERROR_OVERFLOW: throw PyCR::OverflowError(message);
+  case HFPP_ERROR_ZERODIVISION: throw PyCR::ZeroDivisionError(message);
+  case HFPP_ERROR_NAME: throw PyCR::NameError(message);
+  case HFPP_ERROR_NOTIMPLEMENTED: throw PyCR::NotImplementedError(message);
+  case HFPP_ERROR_IO: throw PyCR::IOError(message);
+  case HFPP_ERROR_EXCEPTION: throw PyCR::Exception(message);
+  default: throw std::runtime_error(message);
+  }
+}
+
+/*!
+  \brief Number of pieces a parallel wrapper splits a vector of given length into.
+
+  Returns 1 (serial execution) below the threshold, without OpenMP or
+  if called from within a parallel region.
+*/
+HInteger hfppParallelChunks(const HInteger length)
+{
+#ifdef _OPENMP
+  if (length < hParallelThreshold || omp_in_parallel())
+  {
+    return 1;
+  }
+
+  return hfmax(hfmin(hGetParallelThreads(), length / HFPP_PARALLEL_MIN_CHUNK), (HInteger)1);
+#else
+  return 1;
+#endif
+}
+
 // ========================================================================
 //  Additional string operation functions
 // ========================================================================
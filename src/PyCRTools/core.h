@@ -187,6 +187,22 @@ std::vector<HInteger> PyList2STLIntVec(PyObject* pyob);
 std::vector<int> PyList2STLInt32Vec(PyObject* pyob);
 std::vector<uint> PyList2STLuIntVec(PyObject* pyob);
 
+//========================================================================
+//                  Parallel execution of generated wrappers
+//========================================================================
+
+//! Minimum number of elements handled by one thread in a parallel wrapper
+#define HFPP_PARALLEL_MIN_CHUNK 4096
+
+//! Default minimum vector length for which parallel wrappers use threads
+#define HFPP_PARALLEL_DEFAULT_THRESHOLD 262144
+
+void hSetParallelThreads(const HInteger nthreads);
+HInteger hGetParallelThreads();
+void hSetParallelThreshold(const HInteger threshold);
+HInteger hGetParallelThreshold();
+HInteger hfppParallelChunks(const HInteger length);
+
 template<class T> T hfnull(){};
 template<> inline HString  hfnull<HString>(){HString null=""; return null;}
 template<> inline HPointer hfnull<HPointer>(){return NULL;}
@@ -527,5 +543,27 @@ namespace PyCR { // Namespace PyCR -- begin
 
 } // Namespace PyCR -- end
 
+/*!
+  \brief First exception thrown by the pieces of a parallel wrapper.
+
+  The pieces of a parallel wrapper run in OpenMP threads, which must not
+  let an exception escape. Each piece calls capture() from its catch
+  block; after the loop rethrow() raises the first exception again with
+  its original type and message. The kernel is not run a second time.
+*/
+class hfppParallelError
+{
+public:
+  hfppParallelError();
+
+  void capture();
+  bool failed() const;
+  void rethrow() const;
+
+private:
+  int type;
+  std::string message;
+};
+
 #endif /* CR_PIPELINE_CORE_H */
 
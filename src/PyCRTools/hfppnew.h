@@ -28,6 +28,7 @@ gcc -E -C -P -D H_DEBUG_CPP $HFLAGS -I. $LOFARSOFT/src/pycrtools/hfppnew-test.cc
 #include <boost/preprocessor/list.hpp>
 #include <boost/preprocessor/repeat.hpp>
 #include <boost/preprocessor/comparison.hpp>
+#include <boost/preprocessor/logical.hpp>
 #include <boost/preprocessor/facilities/expand.hpp>
 #include <boost/preprocessor/stringize.hpp>
 
@@ -505,6 +506,72 @@ BOOST_PP_IF(HFPP_FUNC_IS_VOID, }; , returnvector.push_back(returnvalue); }; retu
 #define HFPP_CODE_POST_PARLIST(WRAPPERTYPE) BOOST_PP_REPEAT(HFPP_GET_FUNC_PARNUM,HFPP_CODE_POST_PARLIST_MACRO,WRAPPERTYPE)
 #define HFPP_GET_PARLIST_INPUT(WRAPPERTYPE) BOOST_PP_ENUM(HFPP_GET_FUNC_PARNUM,HFPP_GET_PAR_INPUT_MACRO,WRAPPERTYPE)
 
+//------------------------------------------------------------------------------
+//Parallel wrappers: a function marked as parallel-safe (HFPP_FUNC_PARALLEL,
+//set by the //$PARALLEL directive) is an element-wise kernel. If all its
+//iterator parameters have the length of the master array, the wrapper
+//splits them into hfppParallelChunks() contiguous pieces and calls the
+//kernel for each piece in a separate OpenMP thread. Otherwise, or below
+//the size threshold, the kernel is called once as usual.
+//------------------------------------------------------------------------------
+#ifdef _OPENMP
+#define HFPP_PRAGMA_OMP_PARALLEL_FOR _Pragma("omp parallel for schedule(static) num_threads(hfpp_nchunks)")
+#else
+#define HFPP_PRAGMA_OMP_PARALLEL_FOR
+#endif
+
+//Wrapper classes that can be split (STDIT is only called by the others)
+#define HFPP_PARALLEL_WRAPPER_STL 1
+#define HFPP_PARALLEL_WRAPPER_STDIT 0
+#define HFPP_PARALLEL_WRAPPER_CASA 0
+#define HFPP_PARALLEL_WRAPPER_hARRAY 1
+#define HFPP_PARALLEL_WRAPPER_hARRAYALL 1
+
+//Input of a parameter for one piece: iterators are offset by the piece boundaries, scalars (empty class) and whole vectors are passed as usual
+#define HFPP_GET_PAR_INPUT_PARALLEL_(N,FROM_WRAPPERTYPE) HFPP_GET_PAR_INPUT(N,FROM_WRAPPERTYPE)
+#define HFPP_GET_PAR_INPUT_PARALLEL_STDIT(N,FROM_WRAPPERTYPE) HFPP_GET_PAR_NAME(N).begin()+hfpp_lo,HFPP_GET_PAR_NAME(N).begin()+hfpp_hi
+#define HFPP_GET_PAR_INPUT_PARALLEL_STDITFIXED(N,FROM_WRAPPERTYPE) HFPP_GET_PAR_NAME(N).begin()+hfpp_lo
+#define HFPP_GET_PAR_INPUT_PARALLEL_STL(N,FROM_WRAPPERTYPE) HFPP_GET_PAR_INPUT(N,FROM_WRAPPERTYPE)
+#define HFPP_GET_PAR_INPUT_PARALLEL_CASA(N,FROM_WRAPPERTYPE) HFPP_GET_PAR_INPUT(N,FROM_WRAPPERTYPE)
+#define HFPP_GET_PAR_INPUT_PARALLEL(N,FROM_WRAPPERTYPE) BOOST_PP_CAT(HFPP_GET_PAR_INPUT_PARALLEL_,HFPP_GET_PAR_BASE_CLASS(N))(N,FROM_WRAPPERTYPE)
+#define HFPP_GET_PAR_INPUT_PARALLEL_MACRO(ZZZ,N,FROM_WRAPPERTYPE) HFPP_GET_PAR_INPUT_PARALLEL(N,FROM_WRAPPERTYPE)
+#define HFPP_GET_PARLIST_INPUT_PARALLEL(WRAPPERTYPE) BOOST_PP_ENUM(HFPP_GET_FUNC_PARNUM,HFPP_GET_PAR_INPUT_PARALLEL_MACRO,WRAPPERTYPE)
+
+//Conditions on the parameter lengths for splitting, whole vectors (STL, CASA) can't be split
+#define HFPP_PARALLEL_LENGTH_CHECK_(VEC)
+#define HFPP_PARALLEL_LENGTH_CHECK_STDIT(VEC) && ((HInteger)(VEC.end()-VEC.begin()) == hfpp_length)
+#define HFPP_PARALLEL_LENGTH_CHECK_STDITFIXED(VEC) && ((HInteger)(VEC.end()-VEC.begin()) >= hfpp_length)
+#define HFPP_PARALLEL_LENGTH_CHECK_STL(VEC) && false
+#define HFPP_PARALLEL_LENGTH_CHECK_CASA(VEC) && false
+#define HFPP_PARALLEL_LENGTH_CHECK_MACRO(ZZZ,N,DATA) BOOST_PP_CAT(HFPP_PARALLEL_LENGTH_CHECK_,HFPP_GET_PAR_BASE_CLASS(N))(HFPP_GET_PAR_NAME(N))
+#define HFPP_PARALLEL_LENGTH_CHECKS BOOST_PP_REPEAT(HFPP_GET_FUNC_PARNUM,HFPP_PARALLEL_LENGTH_CHECK_MACRO,BOOST_PP_EMPTY())
+
+//The parameter lengths are checked before splitting (HFPP_PARALLEL_LENGTH_CHECKS). If a piece
+//throws nevertheless, the first exception is kept and thrown again after the loop: the kernel is
+//never run a second time, since in-place and accumulating kernels would be applied twice.
+#define HFPP_CODE_CALL_SERIAL(WRAPPERTYPE) HFPP_GET_FUNC_BASENAME(HFPP_GET_PARLIST_INPUT(WRAPPERTYPE))
+#define HFPP_CODE_CALL_PARALLEL(WRAPPERTYPE) { _H_NL_ \
+  const HInteger hfpp_length = (HInteger)(HFPP_GET_PAR_NAME(HFPP_FUNC_MASTER_ARRAY_PARAMETER).end()-HFPP_GET_PAR_NAME(HFPP_FUNC_MASTER_ARRAY_PARAMETER).begin()); _H_NL_ \
+  const HInteger hfpp_nchunks = (true HFPP_PARALLEL_LENGTH_CHECKS) ? hfppParallelChunks(hfpp_length) : 1; _H_NL_ \
+  if (hfpp_nchunks > 1) { _H_NL_ \
+    const HInteger hfpp_chunksize = (hfpp_length + hfpp_nchunks - 1) / hfpp_nchunks; _H_NL_ \
+    hfppParallelError hfpp_error; _H_NL_ \
+    HFPP_PRAGMA_OMP_PARALLEL_FOR _H_NL_ \
+    for (HInteger hfpp_chunk = 0; hfpp_chunk < hfpp_nchunks; ++hfpp_chunk) { _H_NL_ \
+      const HInteger hfpp_lo = hfmin(hfpp_chunk * hfpp_chunksize, hfpp_length); _H_NL_ \
+      const HInteger hfpp_hi = hfmin(hfpp_lo + hfpp_chunksize, hfpp_length); _H_NL_ \
+      try { HFPP_GET_FUNC_BASENAME(HFPP_GET_PARLIST_INPUT_PARALLEL(WRAPPERTYPE)); } catch (...) { hfpp_error.capture(); } _H_NL_ \
+    } _H_NL_ \
+    hfpp_error.rethrow(); _H_NL_ \
+  } else { _H_NL_ \
+    HFPP_CODE_CALL_SERIAL(WRAPPERTYPE); _H_NL_ \
+  } _H_NL_ \
+}
+
+#define HFPP_CODE_CALL_0(WRAPPERTYPE) HFPP_CODE_CALL_SERIAL(WRAPPERTYPE)
+#define HFPP_CODE_CALL_1(WRAPPERTYPE) HFPP_CODE_CALL_PARALLEL(WRAPPERTYPE)
+#define HFPP_CODE_CALL(WRAPPERTYPE) BOOST_PP_CAT(HFPP_CODE_CALL_,BOOST_PP_AND(HFPP_FUNC_PARALLEL,HFPP_PARALLEL_WRAPPER_##WRAPPERTYPE))(WRAPPERTYPE)
+
 #define HFPP_GET_FUNC_TEMPLATE_TYPENAMES_MACRO(ZZZ,N,XXX) class HFPP_GET_TEMPLATE_PARAMETER_NAME(BOOST_PP_INC(N))
 
 #define HFPP_GET_FUNC_TEMPLATE_TYPENAMES BOOST_PP_ENUM(HFPP_FUNC_NUMBER_OF_TEMPLATE_PARAMETERS,HFPP_GET_FUNC_TEMPLATE_TYPENAMES_MACRO,BOOST_PP_EMPTY())
@@ -516,7 +583,7 @@ BOOST_PP_IF(HFPP_FUNC_IS_VOID, }; , returnvector.push_back(returnvalue); }; retu
       HFPP_CODE_PRE \
       HFPP_CODE_PRE_##WRAPPERTYPE \
       HFPP_CODE_PRE_PARLIST(WRAPPERTYPE)  \
-      HFPP_CODE_RETURN_##WRAPPERTYPE HFPP_GET_FUNC_BASENAME  (HFPP_GET_PARLIST_INPUT(WRAPPERTYPE)); _H_NL_ \
+      HFPP_CODE_RETURN_##WRAPPERTYPE HFPP_CODE_CALL(WRAPPERTYPE); _H_NL_ \
       HFPP_CODE_POST_PARLIST(WRAPPERTYPE)  \
       HFPP_CODE_POST_##WRAPPERTYPE \
       HFPP_CODE_POST \
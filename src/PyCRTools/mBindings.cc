@@ -75,6 +75,7 @@
 //!initialize functions of the library
 void hInit(){
   hInitFitting();
+  hInitFFTW();
 }
 
 // ========================================================================
@@ -217,6 +218,10 @@ BOOST_PYTHON_MODULE(_hftools)
 // ________________________________________________________________________
 //                                                         State inspectors
   def("multicore", &PyCR::multicore);
+  def("hSetParallelThreads", &hSetParallelThreads);
+  def("hGetParallelThreads", &hGetParallelThreads);
+  def("hSetParallelThreshold", &hSetParallelThreshold);
+  def("hGetParallelThreshold", &hGetParallelThreshold);
 
 // ________________________________________________________________________
 //                                                       Core functionality
@@ -301,6 +306,27 @@ BOOST_PYTHON_MODULE(_hftools)
 
 #include "mMath.def.h"
 
+  enum_<hFUSEDOP>("hFUSEDOP")
+    .value("LOAD", FUSED_LOAD)
+    .value("CONST", FUSED_CONST)
+    .value("ADD", FUSED_ADD)
+    .value("SUB", FUSED_SUB)
+    .value("MUL", FUSED_MUL)
+    .value("DIV", FUSED_DIV)
+    .value("NEG", FUSED_NEG)
+    .value("ABS", FUSED_ABS)
+    .value("SQUARE", FUSED_SQUARE)
+    .value("ABSSQUARE", FUSED_ABSSQUARE)
+    .value("SQRT", FUSED_SQRT)
+    .value("EXP", FUSED_EXP)
+    .value("LOG", FUSED_LOG)
+    .value("CONJ", FUSED_CONJ)
+    .value("REAL", FUSED_REAL)
+    .value("IMAG", FUSED_IMAG)
+    .value("ARG", FUSED_ARG);
+
+  def("hFusedEvaluate", hFusedEvaluate);
+
 // ________________________________________________________________________
 //                                                              Calibration
 
@@ -337,6 +363,16 @@ BOOST_PYTHON_MODULE(_hftools)
     .value("BACKWARD", BACKWARD)
     ;
 
+  bool (*hFFTWExportWisdomDefault)() = hFFTWExportWisdom;
+  bool (*hFFTWExportWisdomFile)(const HString) = hFFTWExportWisdom;
+
+  def("hFFTWSetPlannerFlags", hFFTWSetPlannerFlags);
+  def("hFFTWClearPlanCache", hFFTWClearPlanCache);
+  def("hFFTWPlanCacheSize", hFFTWPlanCacheSize);
+  def("hFFTWImportWisdom", hFFTWImportWisdom);
+  def("hFFTWExportWisdom", hFFTWExportWisdomDefault);
+  def("hFFTWExportWisdom", hFFTWExportWisdomFile);
+
 // ________________________________________________________________________
 //                                                                   Filter
 
@@ -417,21 +453,28 @@ BOOST_PYTHON_MODULE(_hftools)
 
 #include "mTBB.def.h"
 
-  class_<TBBData>("TBBData", init<std::string>())
+  class_<TBBData, boost::noncopyable>("TBBData", init<std::string>())
     .def("version", &TBBData::version)
     .def("summary", &TBBData::python_summary)
     .def("filename", &TBBData::filename)
     .def("nofStationGroups", &TBBData::nofStationGroups)
     .def("nofDipoleDatasets", &TBBData::nofDipoleDatasets)
     .def("nofSelectedDatasets", &TBBData::nofSelectedDatasets)
-    .def("selectAllDipoles", &TBBData::selectAllDipoles)
+    .def("selectAllDipoles", &TBBData::python_selectAllDipoles)
     .def("dipoleNames", &TBBData::python_dipoleNames)
     .def("selectedDipoles", &TBBData::python_selectedDipoles)
     .def("selectDipoles", &TBBData::python_selectDipoles)
-    .def("selectAllDipoles", &TBBData::selectAllDipoles)
+    .def("selectAllDipoles", &TBBData::python_selectAllDipoles)
     .def("time", &TBBData::python_time)
     .def("sample_number", &TBBData::python_sample_number)
     .def("data_length", &TBBData::python_data_length)
+#ifdef PYCRTOOLS_WITH_NUMPY
+    .def("time_array", &TBBData::numpy_time)
+    .def("sample_number_array", &TBBData::numpy_sample_number)
+    .def("data_length_array", &TBBData::numpy_data_length)
+#endif
+    .def("setPrefetch", &TBBData::setPrefetch)
+    .def("prefetch", &TBBData::prefetch)
 #if TBB_TIMESERIES_VERSION > 0
     .def("dipole_calibration_delay", &TBBData::python_dipole_calibration_delay)
     .def("dipole_calibration_delay_unit", &TBBData::python_dipole_calibration_delay_unit)
@@ -42,6 +42,7 @@
 #include "mVector.h"
 #include "mMath.h"
 #include "mFFT.h"
+#include "mFFTW.h"
 
 #include "scimath/Mathematics/FFTServer.h"
 
@@ -92,6 +93,12 @@ using namespace casa;
   computing a forward followed by a backward transform (or vice versa)
   results in the original array scaled by :math:`N`.
 
+  Plans are taken from a process wide cache and only created on the
+  first call for a given size. Use ``hFFTWSetPlannerFlags(fftw_flags.MEASURE)``
+  to get measured plans; their wisdom is stored in
+  ``~/.pycrtools_fftw_wisdom`` (or ``$PYCRTOOLS_FFTW_WISDOM``) on exit
+  and loaded again on import.
+
   Usage:
   outvec.fftw(invec) -> return FFT of invec in outvec
 
@@ -105,16 +112,12 @@ void HFPP_FUNC_NAME(const Iter data_out, const Iter data_out_end,
   // Declaration of variables
   int lenIn  = data_in_end - data_in;
   int lenOut = data_out_end - data_out;
-  fftw_plan p;
 
   // Sanity check
   if (lenIn != lenOut) ERROR_RETURN("In- and output vectors do not have the same size.");
 
   // Implementation
-  p = fftw_plan_dft_1d(lenIn, (fftw_complex*) &(*data_in), (fftw_complex*) &(*data_out), FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_execute(p); /* repeat as needed */
-  fftw_destroy_plan(p);
-  fftw_cleanup();
+  hFFTWExecuteCached(lenIn, FFTW_FORWARD, (fftw_complex*) &(*data_in), (fftw_complex*) &(*data_out));
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -161,16 +164,12 @@ void HFPP_FUNC_NAME(const Iter data_out, const Iter data_out_end,
   // Declaration of variables
   int lenIn  = data_in_end - data_in;
   int lenOut = data_out_end - data_out;
-  fftw_plan p;
 
   // Sanity check
   if (lenIn != lenOut) ERROR_RETURN("In- and output vectors do not have the same size.");
 
   // Implementation
-  p = fftw_plan_dft_1d(lenIn, (fftw_complex*) &(*data_in), (fftw_complex*) &(*data_out), FFTW_BACKWARD, FFTW_ESTIMATE);
-  fftw_execute(p); /* repeat as needed */
-  fftw_destroy_plan(p);
-  fftw_cleanup();
+  hFFTWExecuteCached(lenIn, FFTW_BACKWARD, (fftw_complex*) &(*data_in), (fftw_complex*) &(*data_out));
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -216,7 +215,6 @@ void HFPP_FUNC_NAME(const Iter data_out, const Iter data_out_end,
   // Declaration of variables
   int lenIn  = data_in_end - data_in;
   int lenOut = data_out_end - data_out;
-  fftw_plan p;
   std::vector<IterValueType> scratchfft(lenIn);
 
   // Sanity check
@@ -229,11 +227,8 @@ void HFPP_FUNC_NAME(const Iter data_out, const Iter data_out_end,
   // Implementation
   hCopy(scratchfft.begin(),scratchfft.end(), data_in,  data_in_end);
   hNyquistSwap(scratchfft,nyquistZone);
-  p = fftw_plan_dft_1d(lenIn, (fftw_complex*) &scratchfft[0], (fftw_complex*) &(*data_out), FFTW_BACKWARD, FFTW_ESTIMATE);
-  fftw_execute(p); /* repeat as needed */
+  hFFTWExecuteCached(lenIn, FFTW_BACKWARD, (fftw_complex*) &scratchfft[0], (fftw_complex*) &(*data_out));
   hDiv2(data_out,data_out_end,(IterValueType)lenIn);
-  fftw_destroy_plan(p);
-  fftw_cleanup();
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -329,7 +324,6 @@ void HFPP_FUNC_NAME(const IterOut data_out, const IterOut data_out_end,
   int lenIn = data_in_end - data_in;
   int lenOut = data_out_end - data_out;
   std::vector<IterValueType> scratchfft(lenOut);
-  fftw_plan p;
 
   // Sanity check
   if (lenIn != (lenOut/2+1)) {
@@ -341,10 +335,7 @@ void HFPP_FUNC_NAME(const IterOut data_out, const IterOut data_out_end,
   // Implementation
   hCopy(scratchfft.begin(),scratchfft.end(), data_in,  data_in_end);
   hNyquistSwap(scratchfft,nyquistZone);
-  p = fftw_plan_dft_c2r_1d(lenOut, (fftw_complex*) &(scratchfft[0]), (fftw_number*) &(*data_out), FFTW_ESTIMATE);
-  fftw_execute(p); /* repeat as needed */
-  fftw_destroy_plan(p);
-  fftw_cleanup();
+  hFFTWExecuteCached(lenOut, (fftw_complex*) &(scratchfft[0]), (fftw_number*) &(*data_out));
   hDiv2(data_out,data_out_end,(HNumber)lenOut);
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
@@ -460,17 +451,13 @@ void HFPP_FUNC_NAME(const IterOut data_out, const IterOut data_out_end,
   // Declaration of variables
   int lenIn = data_in_end - data_in;
   int lenOut = data_out_end - data_out;
-  fftw_plan p;
 
   // Sanity check
   if (lenOut != (lenIn/2+1)) 
     ERROR_RETURN("Input or output vector has the wrong size. This should be: N(out) = N(in)/2+1.");
   
   // Implementation
-  p = fftw_plan_dft_r2c_1d(lenIn, (fftw_number*) &(*data_in), (fftw_complex*) &(*data_out), FFTW_ESTIMATE);
-  fftw_execute(p); /* repeat as needed */
-  fftw_destroy_plan(p);
-  fftw_cleanup();
+  hFFTWExecuteCached(lenIn, (fftw_number*) &(*data_in), (fftw_complex*) &(*data_out));
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -514,16 +501,12 @@ void HFPP_FUNC_NAME(const IterOut data_out, const IterOut data_out_end,
   // Declaration of variables
   int lenIn = data_in_end - data_in;
   int lenOut = data_out_end - data_out;
-  fftw_plan p;
 
   // Sanity check
   if (lenIn != (lenOut/2+1)) ERROR_RETURN("Input or output vector has the wrong size. This should be: N(in) = N(out)/2+1.");
 
   // Implementation
-  p = fftw_plan_dft_c2r_1d(lenOut, (fftw_complex*) &(*data_in), (fftw_number*) &(*data_out), FFTW_ESTIMATE);
-  fftw_execute(p); /* repeat as needed */
-  fftw_destroy_plan(p);
-  fftw_cleanup();
+  hFFTWExecuteCached(lenOut, (fftw_complex*) &(*data_in), (fftw_number*) &(*data_out));
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -43,6 +43,10 @@
 #include "core.h"
 #include "mFFTW.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 // ========================================================================
 //
@@ -70,7 +74,8 @@ FFTWPlanManyDft::FFTWPlanManyDft (int N, int howmany, int istride, int idist, in
   in = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * isize);
   out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * osize);
 
-  // Create FFTW plan
+  // Create FFTW plan, the planner is not thread safe
+  boost::mutex::scoped_lock lock(FFTWPlanCache::instance().plannerMutex());
   p = fftw_plan_many_dft(1, &N, howmany, in, NULL, istride, idist, out, NULL, ostride, odist, sign, flags);
 }
   
@@ -78,6 +83,8 @@ FFTWPlanManyDft::~FFTWPlanManyDft ()
 {
   fftw_free(in);
   fftw_free(out);
+
+  boost::mutex::scoped_lock lock(FFTWPlanCache::instance().plannerMutex());
   fftw_destroy_plan(p);
 }
 
@@ -98,7 +105,8 @@ FFTWPlanManyDftR2c::FFTWPlanManyDftR2c (int N, int howmany, int istride, int idi
   in = (double*) fftw_malloc(sizeof(double) * isize);
   out = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * osize);
 
-  // Create FFTW plan
+  // Create FFTW plan, the planner is not thread safe
+  boost::mutex::scoped_lock lock(FFTWPlanCache::instance().plannerMutex());
   p = fftw_plan_many_dft_r2c(1, &N, howmany, in, NULL, istride, idist, out, NULL, ostride, odist, flags);
 }
 
@@ -106,6 +114,8 @@ FFTWPlanManyDftR2c::~FFTWPlanManyDftR2c ()
 {
   fftw_free(in);
   fftw_free(out);
+
+  boost::mutex::scoped_lock lock(FFTWPlanCache::instance().plannerMutex());
   fftw_destroy_plan(p);
 }
 
@@ -126,7 +136,8 @@ FFTWPlanManyDftC2r::FFTWPlanManyDftC2r (int N, int howmany, int istride, int idi
   in = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * isize);
   out = (double*) fftw_malloc(sizeof(double) * osize);
 
-  // Create FFTW plan
+  // Create FFTW plan, the planner is not thread safe
+  boost::mutex::scoped_lock lock(FFTWPlanCache::instance().plannerMutex());
   p = fftw_plan_many_dft_c2r(1, &N, howmany, in, NULL, istride, idist, out, NULL, ostride, odist, flags);
 }
 
@@ -134,6 +145,8 @@ FFTWPlanManyDftC2r::~FFTWPlanManyDftC2r ()
 {
   fftw_free(in);
   fftw_free(out);
+
+  boost::mutex::scoped_lock lock(FFTWPlanCache::instance().plannerMutex());
   fftw_destroy_plan(p);
 }
 
@@ -144,6 +157,355 @@ std::ostream& operator<<(std::ostream& output, const FFTWPlanManyDftC2r& d)
     return output;
 }
 
+//__________________________________________________________________________
+//                                                             FFTWPlanCache
+
+// Arrays with this alignment can use plans made for fftw_malloc'ed arrays
+#define FFTW_PLAN_CACHE_ALIGNMENT 64
+
+FFTWPlanKey::FFTWPlanKey (int N_, enum fftw_plan_type type_, int sign_, const void* in, const void* out)
+{
+  init(N_, 1, type_, sign_, in, out, 1);
+}
+
+FFTWPlanKey::FFTWPlanKey (int N_, int howmany_, enum fftw_plan_type type_, int sign_, const void* in, const void* out, int nthreads_)
+{
+  init(N_, howmany_, type_, sign_, in, out, nthreads_);
+}
+
+void FFTWPlanKey::init (int N_, int howmany_, enum fftw_plan_type type_, int sign_, const void* in, const void* out, int nthreads_)
+{
+  N = N_;
+  howmany = howmany_;
+#ifdef PYCRTOOLS_WITH_FFTW_THREADS
+  nthreads = hfmax(nthreads_, 1);
+#else
+  nthreads = 1;
+#endif
+  type = type_;
+  sign = (type_ == PLAN_C2C) ? sign_ : 0;
+  inplace = (in == out);
+  aligned = (reinterpret_cast<size_t>(in) % FFTW_PLAN_CACHE_ALIGNMENT == 0)
+    && (reinterpret_cast<size_t>(out) % FFTW_PLAN_CACHE_ALIGNMENT == 0);
+  istride = 1;
+  ostride = 1;
+  idist = (type_ == PLAN_C2R) ? N_ / 2 + 1 : N_;
+  odist = (type_ == PLAN_R2C) ? N_ / 2 + 1 : N_;
+}
+
+bool FFTWPlanKey::operator< (const FFTWPlanKey& other) const
+{
+  if (N != other.N) return N < other.N;
+  if (howmany != other.howmany) return howmany < other.howmany;
+  if (nthreads != other.nthreads) return nthreads < other.nthreads;
+  if (type != other.type) return type < other.type;
+  if (sign != other.sign) return sign < other.sign;
+  if (inplace != other.inplace) return inplace < other.inplace;
+  if (aligned != other.aligned) return aligned < other.aligned;
+  if (istride != other.istride) return istride < other.istride;
+  if (idist != other.idist) return idist < other.idist;
+  if (ostride != other.ostride) return ostride < other.ostride;
+  return odist < other.odist;
+}
+
+FFTWPlanCache::FFTWPlanCache () :
+  planner_flags(FFTW_ESTIMATE),
+  wisdom_changed(false)
+{
+#ifdef PYCRTOOLS_WITH_FFTW_THREADS
+  // Has to happen before the first plan is made
+  fftw_init_threads();
+#endif
+}
+
+FFTWPlanCache::~FFTWPlanCache ()
+{
+  clear();
+}
+
+FFTWPlanCache& FFTWPlanCache::instance()
+{
+  static FFTWPlanCache cache;
+
+  return cache;
+}
+
+fftw_plan FFTWPlanCache::get(const FFTWPlanKey& key)
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  std::map<FFTWPlanKey, fftw_plan>::iterator it = plans.find(key);
+
+  if (it != plans.end())
+  {
+    return it->second;
+  }
+
+  // Number of elements spanned by the in- and output arrays
+  const int ilast = (key.howmany - 1) * key.idist + 1;
+  const int olast = (key.howmany - 1) * key.odist + 1;
+  const int isize = ilast + ((key.type == PLAN_C2R) ? key.N / 2 : key.N - 1) * key.istride;
+  const int osize = olast + ((key.type == PLAN_R2C) ? key.N / 2 : key.N - 1) * key.ostride;
+
+  // Scratch arrays to plan on, measuring plans overwrite their contents
+  const size_t ibytes = isize * ((key.type == PLAN_R2C) ? sizeof(double) : sizeof(fftw_complex));
+  const size_t obytes = osize * ((key.type == PLAN_C2R) ? sizeof(double) : sizeof(fftw_complex));
+
+  void* in = fftw_malloc(key.inplace ? hfmax(ibytes, obytes) : ibytes);
+  void* out = key.inplace ? in : fftw_malloc(obytes);
+
+  if (in == NULL || out == NULL)
+  {
+    throw PyCR::MemoryError("Unable to allocate scratch arrays for FFTW planning.");
+  }
+
+  unsigned int flags = planner_flags;
+  if (!key.aligned)
+  {
+    flags |= FFTW_UNALIGNED;
+  }
+
+  // Out of place complex to real transforms may otherwise overwrite their input
+  if (key.type == PLAN_C2R && !key.inplace)
+  {
+    flags |= FFTW_PRESERVE_INPUT;
+  }
+
+#ifdef PYCRTOOLS_WITH_FFTW_THREADS
+  fftw_plan_with_nthreads(key.nthreads);
+#endif
+
+  fftw_plan p = NULL;
+
+  switch (key.type)
+  {
+  case PLAN_C2C:
+    p = fftw_plan_many_dft(1, &key.N, key.howmany,
+                           (fftw_complex*) in, NULL, key.istride, key.idist,
+                           (fftw_complex*) out, NULL, key.ostride, key.odist,
+                           key.sign, flags);
+    break;
+  case PLAN_R2C:
+    p = fftw_plan_many_dft_r2c(1, &key.N, key.howmany,
+                               (double*) in, NULL, key.istride, key.idist,
+                               (fftw_complex*) out, NULL, key.ostride, key.odist,
+                               flags);
+    break;
+  case PLAN_C2R:
+    p = fftw_plan_many_dft_c2r(1, &key.N, key.howmany,
+                               (fftw_complex*) in, NULL, key.istride, key.idist,
+                               (double*) out, NULL, key.ostride, key.odist,
+                               flags);
+    break;
+  }
+
+  if (out != in)
+  {
+    fftw_free(out);
+  }
+  fftw_free(in);
+
+  if (p == NULL)
+  {
+    throw PyCR::ValueError("FFTW was unable to create a plan.");
+  }
+
+  if (planner_flags != FFTW_ESTIMATE)
+  {
+    wisdom_changed = true;
+  }
+
+  plans[key] = p;
+
+  return p;
+}
+
+void FFTWPlanCache::clear()
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  destroyPlans();
+}
+
+void FFTWPlanCache::destroyPlans()
+{
+  std::map<FFTWPlanKey, fftw_plan>::iterator it;
+  for (it = plans.begin(); it != plans.end(); ++it)
+  {
+    fftw_destroy_plan(it->second);
+  }
+
+  plans.clear();
+}
+
+int FFTWPlanCache::size()
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  return plans.size();
+}
+
+void FFTWPlanCache::setFlags(unsigned int flags)
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  // Plans made with other flags are no longer what the user asked for
+  if (flags != planner_flags)
+  {
+    destroyPlans();
+    planner_flags = flags;
+  }
+}
+
+unsigned int FFTWPlanCache::flags() const
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  return planner_flags;
+}
+
+bool FFTWPlanCache::importWisdom(const std::string& filename)
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  FILE* file = fopen(filename.c_str(), "r");
+
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  const int status = fftw_import_wisdom_from_file(file);
+  fclose(file);
+
+  return status != 0;
+}
+
+bool FFTWPlanCache::exportWisdom(const std::string& filename, bool force)
+{
+  boost::mutex::scoped_lock lock(mutex);
+
+  if (!force && !wisdom_changed)
+  {
+    return false;
+  }
+
+  FILE* file = fopen(filename.c_str(), "w");
+
+  if (file == NULL)
+  {
+    throw PyCR::IOError("Unable to open FFTW wisdom file " + filename + " for writing.");
+  }
+
+  fftw_export_wisdom_to_file(file);
+  fclose(file);
+
+  wisdom_changed = false;
+
+  return true;
+}
+
+std::string FFTWPlanCache::defaultWisdomFile()
+{
+  const char* filename = getenv("PYCRTOOLS_FFTW_WISDOM");
+
+  if (filename != NULL)
+  {
+    return std::string(filename);
+  }
+
+  const char* home = getenv("HOME");
+
+  return std::string(home != NULL ? home : ".") + "/.pycrtools_fftw_wisdom";
+}
+
+void hFFTWExecuteCached(int N, int sign, fftw_complex* in, fftw_complex* out)
+{
+  fftw_execute_dft(FFTWPlanCache::instance().get(FFTWPlanKey(N, PLAN_C2C, sign, in, out)), in, out);
+}
+
+void hFFTWExecuteCached(int N, double* in, fftw_complex* out)
+{
+  fftw_execute_dft_r2c(FFTWPlanCache::instance().get(FFTWPlanKey(N, PLAN_R2C, FFTW_FORWARD, in, out)), in, out);
+}
+
+void hFFTWExecuteCached(int N, fftw_complex* in, double* out)
+{
+  fftw_execute_dft_c2r(FFTWPlanCache::instance().get(FFTWPlanKey(N, PLAN_C2R, FFTW_BACKWARD, in, out)), in, out);
+}
+
+//! Number of FFTW threads to use, values below 1 select the OpenMP default
+int hFFTWThreads(int nthreads)
+{
+  if (nthreads > 0)
+  {
+    return nthreads;
+  }
+
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+void hFFTWExecuteCachedMany(int N, int howmany, int sign, fftw_complex* in, fftw_complex* out, int nthreads)
+{
+  fftw_execute_dft(FFTWPlanCache::instance().get(FFTWPlanKey(N, howmany, PLAN_C2C, sign, in, out, nthreads)), in, out);
+}
+
+void hFFTWExecuteCachedMany(int N, int howmany, double* in, fftw_complex* out, int nthreads)
+{
+  fftw_execute_dft_r2c(FFTWPlanCache::instance().get(FFTWPlanKey(N, howmany, PLAN_R2C, FFTW_FORWARD, in, out, nthreads)), in, out);
+}
+
+void hFFTWExecuteCachedMany(int N, int howmany, fftw_complex* in, double* out, int nthreads)
+{
+  fftw_execute_dft_c2r(FFTWPlanCache::instance().get(FFTWPlanKey(N, howmany, PLAN_C2R, FFTW_BACKWARD, in, out, nthreads)), in, out);
+}
+
+//! Load FFTW wisdom on import of the module
+void hInitFFTW()
+{
+  FFTWPlanCache::instance().importWisdom(FFTWPlanCache::defaultWisdomFile());
+}
+
+//! Set the planner flags used for cached plans (clears the cache)
+void hFFTWSetPlannerFlags(enum fftw_flags flags)
+{
+  FFTWPlanCache::instance().setFlags(flags);
+}
+
+//! Destroy all cached plans
+void hFFTWClearPlanCache()
+{
+  FFTWPlanCache::instance().clear();
+}
+
+//! Number of cached plans
+int hFFTWPlanCacheSize()
+{
+  return FFTWPlanCache::instance().size();
+}
+
+//! Import FFTW wisdom from file
+bool hFFTWImportWisdom(const HString filename)
+{
+  return FFTWPlanCache::instance().importWisdom(filename);
+}
+
+//! Export FFTW wisdom to file
+bool hFFTWExportWisdom(const HString filename)
+{
+  return FFTWPlanCache::instance().exportWisdom(filename, true);
+}
+
+//! Export FFTW wisdom to the default wisdom file if new plans were measured
+bool hFFTWExportWisdom()
+{
+  return FFTWPlanCache::instance().exportWisdom(FFTWPlanCache::defaultWisdomFile(), false);
+}
+
 //-----------------------------------------------------------------------
 //$DOCSTRING: Executes an FFTW plan.
 //$COPY_TO HFILE START --------------------------------------------------
@@ -421,6 +783,212 @@ void HFPP_FUNC_NAME(const Iter out, const Iter out_end,
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+//-----------------------------------------------------------------------
+//$DOCSTRING: Forward FFT of all rows of a two-dimensional array at once.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hFFTWBatchForward
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_FUNC_MASTER_ARRAY_PARAMETER 0 // Use the first parameter as the master array for looping and history informations
+#define HFPP_PARDEF_0 (HComplex)(out)()("Output array of dimensions [nrows, N] in which the FFT transformed data is stored, may be the input array.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(in)()("Input array of dimensions [nrows, N].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(nrows)()("Number of rows (e.g. antennas) in the arrays.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (HInteger)(nthreads)()("Number of threads FFTW may use, 0 for the OpenMP default.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END ----------------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  All rows are transformed by a single batched FFTW plan which is taken
+  from the plan cache, so there is neither a loop over the rows nor a
+  copy into plan buffers. As in FFTW the result is not normalized.
+
+  Example:
+  >>> x = cr.hArray(complex, [nantennas, N])
+  >>> y = cr.hArray(complex, [nantennas, N])
+  >>> cr.hFFTWBatchForward(y, x, nantennas, 0)
+
+  >>> # In place
+  >>> cr.hFFTWBatchForward(x, x, nantennas, 0)
+*/
+template <class CIter>
+void HFPP_FUNC_NAME(const CIter out, const CIter out_end,
+		    const CIter in,  const CIter in_end,
+        const HInteger nrows, const HInteger nthreads)
+{
+  // Get array lengths
+  const int Nin =  std::distance(in, in_end);
+  const int Nout = std::distance(out, out_end);
+
+  // Sanity check
+  if (nrows <= 0 || Nin % nrows != 0 || Nin == 0)
+  {
+    throw PyCR::ValueError("Input vector length is not a multiple of the number of rows.");
+  }
+
+  const int N = Nin / nrows;
+
+  if (Nout != Nin)
+  {
+    throw PyCR::ValueError("In- and output vectors do not have the required size.");
+  }
+
+  hFFTWExecuteCachedMany(N, nrows, FFTW_FORWARD, (fftw_complex*) &(*in), (fftw_complex*) &(*out), hFFTWThreads(nthreads));
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+//-----------------------------------------------------------------------
+//$DOCSTRING: Forward FFT of all rows of a two-dimensional real array at once.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hFFTWBatchForward
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_FUNC_MASTER_ARRAY_PARAMETER 0 // Use the first parameter as the master array for looping and history informations
+#define HFPP_PARDEF_0 (HComplex)(out)()("Output array of dimensions [nrows, N/2+1] in which the FFT transformed data is stored.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HNumber)(in)()("Input array of dimensions [nrows, N].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(nrows)()("Number of rows (e.g. antennas) in the arrays.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (HInteger)(nthreads)()("Number of threads FFTW may use, 0 for the OpenMP default.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END ----------------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Real to complex version, equivalent to calling ``hFFTWExecutePlan``
+  with a ``FFTWPlanManyDftR2c`` plan on every row but executed as a
+  single batched plan directly on the arrays.
+
+  Example:
+  >>> timeseries = cr.hArray(float, [nantennas, blocksize])
+  >>> spectrum = cr.hArray(complex, [nantennas, blocksize/2+1])
+  >>> cr.hFFTWBatchForward(spectrum, timeseries, nantennas, 0)
+*/
+template <class CIter, class Iter>
+void HFPP_FUNC_NAME(const CIter out, const CIter out_end,
+		    const Iter in,  const Iter in_end,
+        const HInteger nrows, const HInteger nthreads)
+{
+  // Get array lengths
+  const int Nin =  std::distance(in, in_end);
+  const int Nout = std::distance(out, out_end);
+
+  // Sanity check
+  if (nrows <= 0 || Nin % nrows != 0 || Nin == 0)
+  {
+    throw PyCR::ValueError("Input vector length is not a multiple of the number of rows.");
+  }
+
+  const int N = Nin / nrows;
+
+  if (Nout != (N / 2 + 1) * nrows)
+  {
+    throw PyCR::ValueError("In- and output vectors do not have the required size.");
+  }
+
+  hFFTWExecuteCachedMany(N, nrows, (double*) &(*in), (fftw_complex*) &(*out), hFFTWThreads(nthreads));
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+//-----------------------------------------------------------------------
+//$DOCSTRING: Backward FFT of all rows of a two-dimensional array at once.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hFFTWBatchBackward
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_FUNC_MASTER_ARRAY_PARAMETER 0 // Use the first parameter as the master array for looping and history informations
+#define HFPP_PARDEF_0 (HComplex)(out)()("Output array of dimensions [nrows, N] in which the FFT transformed data is stored, may be the input array.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(in)()("Input array of dimensions [nrows, N].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(nrows)()("Number of rows (e.g. antennas) in the arrays.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (HInteger)(nthreads)()("Number of threads FFTW may use, 0 for the OpenMP default.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END ----------------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  As in FFTW the result is not normalized, i.e. a forward followed by a
+  backward transform multiplies the data by N.
+
+  Example:
+  >>> x = cr.hArray(complex, [nantennas, N])
+  >>> cr.hFFTWBatchBackward(x, x, nantennas, 0)
+*/
+template <class CIter>
+void HFPP_FUNC_NAME(const CIter out, const CIter out_end,
+		    const CIter in,  const CIter in_end,
+        const HInteger nrows, const HInteger nthreads)
+{
+  // Get array lengths
+  const int Nin =  std::distance(in, in_end);
+  const int Nout = std::distance(out, out_end);
+
+  // Sanity check
+  if (nrows <= 0 || Nin % nrows != 0 || Nin == 0)
+  {
+    throw PyCR::ValueError("Input vector length is not a multiple of the number of rows.");
+  }
+
+  const int N = Nin / nrows;
+
+  if (Nout != Nin)
+  {
+    throw PyCR::ValueError("In- and output vectors do not have the required size.");
+  }
+
+  hFFTWExecuteCachedMany(N, nrows, FFTW_BACKWARD, (fftw_complex*) &(*in), (fftw_complex*) &(*out), hFFTWThreads(nthreads));
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+//-----------------------------------------------------------------------
+//$DOCSTRING: Backward FFT of all rows of a two-dimensional array to real data at once.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hFFTWBatchBackward
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_FUNC_MASTER_ARRAY_PARAMETER 0 // Use the first parameter as the master array for looping and history informations
+#define HFPP_PARDEF_0 (HNumber)(out)()("Output array of dimensions [nrows, N] in which the FFT transformed data is stored.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(in)()("Input array of dimensions [nrows, N/2+1].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(nrows)()("Number of rows (e.g. antennas) in the arrays.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (HInteger)(nthreads)()("Number of threads FFTW may use, 0 for the OpenMP default.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END ----------------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Complex to real version, the transform length N is taken from the
+  output array. The input array is left unchanged and the result is not
+  normalized.
+
+  Example:
+  >>> spectrum = cr.hArray(complex, [nantennas, blocksize/2+1])
+  >>> timeseries = cr.hArray(float, [nantennas, blocksize])
+  >>> cr.hFFTWBatchBackward(timeseries, spectrum, nantennas, 0)
+  >>> timeseries /= blocksize
+*/
+template <class Iter, class CIter>
+void HFPP_FUNC_NAME(const Iter out, const Iter out_end,
+		    const CIter in,  const CIter in_end,
+        const HInteger nrows, const HInteger nthreads)
+{
+  // Get array lengths
+  const int Nin =  std::distance(in, in_end);
+  const int Nout = std::distance(out, out_end);
+
+  // Sanity check
+  if (nrows <= 0 || Nout % nrows != 0 || Nout == 0)
+  {
+    throw PyCR::ValueError("Output vector length is not a multiple of the number of rows.");
+  }
+
+  const int N = Nout / nrows;
+
+  if (Nin != (N / 2 + 1) * nrows)
+  {
+    throw PyCR::ValueError("In- and output vectors do not have the required size.");
+  }
+
+  hFFTWExecuteCachedMany(N, nrows, (fftw_complex*) &(*in), (double*) &(*out), hFFTWThreads(nthreads));
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
 //-----------------------------------------------------------------------
 //$DOCSTRING: Convert between CASA and FFTW definitions for FFT
 //$COPY_TO HFILE START --------------------------------------------------
@@ -477,9 +1045,9 @@ void HFPP_FUNC_NAME(const NIter out, const NIter out_end, const NIter in, const
   fftw_complex * tmp_fd = (fftw_complex*)fftw_malloc((Nout/2+1)*sizeof(fftw_complex));
   double * buffer = (double*)fftw_malloc(buffer_size*sizeof(double));
   
-  // create fftw plans
-  fftw_plan fft_plan = fftw_plan_dft_r2c_1d(Nin, buffer, tmp_fd, FFTW_ESTIMATE);
-  fftw_plan ifft_plan = fftw_plan_dft_c2r_1d(Nout, tmp_fd, buffer, FFTW_ESTIMATE);
+  // get fftw plans from the cache
+  fftw_plan fft_plan = FFTWPlanCache::instance().get(FFTWPlanKey(Nin, PLAN_R2C, FFTW_FORWARD, buffer, tmp_fd));
+  fftw_plan ifft_plan = FFTWPlanCache::instance().get(FFTWPlanKey(Nout, PLAN_C2R, FFTW_BACKWARD, tmp_fd, buffer));
   
   // zero out tmp_fd
   memset(tmp_fd, 0, (Nout/2+1)*sizeof(fftw_complex));
@@ -505,8 +1073,6 @@ void HFPP_FUNC_NAME(const NIter out, const NIter out_end, const NIter in, const
   // cleanup
   fftw_free(tmp_fd);
   fftw_free(buffer);
-  fftw_destroy_plan(fft_plan);
-  fftw_destroy_plan(ifft_plan);
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -537,9 +1103,9 @@ void HFPP_FUNC_NAME(const NIter out, const NIter out_end, const NIter in, const
   fftw_complex * tmp_fd = (fftw_complex*)fftw_malloc((Nin/2+1)*sizeof(fftw_complex));
   double * buffer = (double*)fftw_malloc(buffer_size*sizeof(double));
   
-  // create fftw plans
-  fftw_plan fft_plan = fftw_plan_dft_r2c_1d(Nin, buffer, tmp_fd, FFTW_ESTIMATE);
-  fftw_plan ifft_plan = fftw_plan_dft_c2r_1d(Nout, tmp_fd, buffer, FFTW_ESTIMATE);
+  // get fftw plans from the cache
+  fftw_plan fft_plan = FFTWPlanCache::instance().get(FFTWPlanKey(Nin, PLAN_R2C, FFTW_FORWARD, buffer, tmp_fd));
+  fftw_plan ifft_plan = FFTWPlanCache::instance().get(FFTWPlanKey(Nout, PLAN_C2R, FFTW_BACKWARD, tmp_fd, buffer));
   
   // zero out tmp_fd
   memset(tmp_fd, 0, (Nout/2+1)*sizeof(fftw_complex));
@@ -566,8 +1132,6 @@ void HFPP_FUNC_NAME(const NIter out, const NIter out_end, const NIter in, const
   }
 
   // cleanup
-  fftw_destroy_plan(fft_plan);
-  fftw_destroy_plan(ifft_plan);
   fftw_free(tmp_fd);
   fftw_free(buffer);
 }
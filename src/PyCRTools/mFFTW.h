@@ -26,6 +26,10 @@
 #include "mArray.h"
 #include "mModule.h"
 
+#include <map>
+
+#include <boost/thread/mutex.hpp>
+
 #include <fftw3.h>
 
 enum fftw_flags {
@@ -112,6 +116,115 @@ public:
 
 };
 
+// ________________________________________________________________________
+//                                                          FFTW plan cache
+
+enum fftw_plan_type {
+  PLAN_C2C,
+  PLAN_R2C,
+  PLAN_C2R
+};
+
+/*!
+  \brief Describes an FFTW plan by everything its reusability depends on.
+
+  A plan can be executed on new arrays with the ``fftw_execute_dft*``
+  functions as long as size, direction, transform type, placement,
+  alignment and strides are the same as for the arrays it was made for.
+  Batched plans transform ``howmany`` contiguous rows of length ``N``
+  (``N/2+1`` on the complex side of real transforms) and may be planned
+  for execution with ``nthreads`` threads.
+*/
+struct FFTWPlanKey {
+  int N;
+  int howmany;
+  int nthreads;
+  int sign;
+  int type;
+  bool inplace;
+  bool aligned;
+  int istride;
+  int idist;
+  int ostride;
+  int odist;
+
+  FFTWPlanKey (int N, enum fftw_plan_type type, int sign, const void* in, const void* out);
+
+  FFTWPlanKey (int N, int howmany, enum fftw_plan_type type, int sign, const void* in, const void* out, int nthreads);
+
+  bool operator< (const FFTWPlanKey& other) const;
+
+private:
+  void init (int N, int howmany, enum fftw_plan_type type, int sign, const void* in, const void* out, int nthreads);
+};
+
+/*!
+  \brief Process wide, thread safe cache of FFTW plans.
+
+  Plans are made once on scratch arrays, with the planner flags set
+  through ``setFlags`` (``FFTW_ESTIMATE`` by default), and are then
+  executed on the actual data with the new-array execute functions of
+  FFTW. Creating plans is serialized because the FFTW planner is not
+  thread safe, executing them is not. Everything else that makes or
+  destroys FFTW plans has to hold ``plannerMutex`` while doing so.
+*/
+class FFTWPlanCache {
+
+  std::map<FFTWPlanKey, fftw_plan> plans;
+  mutable boost::mutex mutex;
+  unsigned int planner_flags;
+  bool wisdom_changed;
+
+  FFTWPlanCache ();
+  ~FFTWPlanCache ();
+
+  // Destroy all plans, the caller holds the mutex
+  void destroyPlans();
+
+public:
+
+  // === Methods ===========================================================
+  static FFTWPlanCache& instance();
+
+  fftw_plan get(const FFTWPlanKey& key);
+
+  void clear();
+
+  int size();
+
+  void setFlags(unsigned int flags);
+
+  unsigned int flags() const;
+
+  boost::mutex& plannerMutex() { return mutex; };
+
+  bool importWisdom(const std::string& filename);
+
+  bool exportWisdom(const std::string& filename, bool force);
+
+  static std::string defaultWisdomFile();
+};
+
+// Execute a 1-dimensional transform with a cached plan
+void hFFTWExecuteCached(int N, int sign, fftw_complex* in, fftw_complex* out);
+void hFFTWExecuteCached(int N, double* in, fftw_complex* out);
+void hFFTWExecuteCached(int N, fftw_complex* in, double* out);
+
+// Execute a batch of 1-dimensional transforms over contiguous rows
+int hFFTWThreads(int nthreads);
+void hFFTWExecuteCachedMany(int N, int howmany, int sign, fftw_complex* in, fftw_complex* out, int nthreads);
+void hFFTWExecuteCachedMany(int N, int howmany, double* in, fftw_complex* out, int nthreads);
+void hFFTWExecuteCachedMany(int N, int howmany, fftw_complex* in, double* out, int nthreads);
+
+// Plan cache and wisdom handling (exposed to Python)
+void hInitFFTW();
+void hFFTWSetPlannerFlags(enum fftw_flags flags);
+void hFFTWClearPlanCache();
+int hFFTWPlanCacheSize();
+bool hFFTWImportWisdom(const HString filename);
+bool hFFTWExportWisdom(const HString filename);
+bool hFFTWExportWisdom();
+
 // ________________________________________________________________________
 //                                    Add declarations of wrapper functions
 
@@ -41,6 +41,9 @@
 #include "math.h"
 #include "mFilter.h"
 
+#include <algorithm>
+#include <vector>
+
 // ========================================================================
 //
 //  Implementation
@@ -54,6 +57,175 @@ using namespace std;
 #define HFPP_FILETYPE CC
 //--------------------
 
+// ========================================================================
+//
+//  Cross-correlation engine
+//
+// ========================================================================
+
+/*!
+  \brief Cross-correlate one tile of antennas and frequencies.
+
+  Adds ``a * conj(b)``, summed over all time blocks, to the visibilities
+  of all baselines between the antennas ``[a0,a1)`` and ``[b0,b1)``
+  (only ``a < b``) for the frequencies ``[f0,f1)``. The data of each block
+  is first copied into planar real and imaginary buffers so that the
+  complex multiply-accumulate over frequency vectorizes, and it is summed
+  in double precision before a single update of ``ccm``.
+*/
+template <class T>
+void crossCorrelateTile(HComplex* ccm, const std::complex<T>* fftdata,
+                        const int nblocks, const int nantennas, const int nfreq, const HInteger nbaselines,
+                        const int a0, const int a1, const int b0, const int b1,
+                        const int f0, const int f1,
+                        std::vector<double>& scratch)
+{
+  const int F = f1 - f0;
+  const int A = XCORR_ANTENNA_TILE;
+  const bool diagonal = (a0 == b0);
+
+  // Planar input buffers for both antenna ranges and baseline accumulators
+  scratch.resize(4 * A * F + 2 * A * A * F);
+
+  double* a_re = &scratch[0];
+  double* a_im = a_re + A * F;
+  double* b_re = diagonal ? a_re : a_im + A * F;
+  double* b_im = diagonal ? a_im : b_re + A * F;
+  double* acc_re = &scratch[4 * A * F];
+  double* acc_im = acc_re + A * A * F;
+
+  std::fill(acc_re, acc_re + 2 * A * A * F, 0.0);
+
+  for (int block = 0; block < nblocks; ++block)
+  {
+    const std::complex<T>* data = fftdata + static_cast<size_t>(block) * nantennas * nfreq;
+
+    for (int a = a0; a < a1; ++a)
+    {
+      const std::complex<T>* row = data + static_cast<size_t>(a) * nfreq + f0;
+      double* re = a_re + (a - a0) * F;
+      double* im = a_im + (a - a0) * F;
+      for (int f = 0; f < F; ++f)
+      {
+        re[f] = real(row[f]);
+        im[f] = imag(row[f]);
+      }
+    }
+
+    if (!diagonal)
+    {
+      for (int b = b0; b < b1; ++b)
+      {
+        const std::complex<T>* row = data + static_cast<size_t>(b) * nfreq + f0;
+        double* re = b_re + (b - b0) * F;
+        double* im = b_im + (b - b0) * F;
+        for (int f = 0; f < F; ++f)
+        {
+          re[f] = real(row[f]);
+          im[f] = imag(row[f]);
+        }
+      }
+    }
+
+    for (int a = a0; a < a1; ++a)
+    {
+      const double* ar = a_re + (a - a0) * F;
+      const double* ai = a_im + (a - a0) * F;
+
+      for (int b = hfmax(b0, a + 1); b < b1; ++b)
+      {
+        const double* br = b_re + (b - b0) * F;
+        const double* bi = b_im + (b - b0) * F;
+        double* cr = acc_re + ((a - a0) * A + (b - b0)) * F;
+        double* ci = acc_im + ((a - a0) * A + (b - b0)) * F;
+
+        // a * conj(b)
+        for (int f = 0; f < F; ++f)
+        {
+          cr[f] += ar[f] * br[f] + ai[f] * bi[f];
+          ci[f] += ai[f] * br[f] - ar[f] * bi[f];
+        }
+      }
+    }
+  }
+
+  // Add the tile to the cross-correlation matrix
+  for (int a = a0; a < a1; ++a)
+  {
+    for (int b = hfmax(b0, a + 1); b < b1; ++b)
+    {
+      const HInteger baseline = static_cast<HInteger>(a) * nantennas - static_cast<HInteger>(a) * (a + 1) / 2 + (b - a - 1);
+
+      if (baseline >= nbaselines)
+      {
+        continue;
+      }
+
+      const double* cr = acc_re + ((a - a0) * A + (b - b0)) * F;
+      const double* ci = acc_im + ((a - a0) * A + (b - b0)) * F;
+      HComplex* out = ccm + baseline * nfreq + f0;
+
+      for (int f = 0; f < F; ++f)
+      {
+        out[f] += HComplex(cr[f], ci[f]);
+      }
+    }
+  }
+}
+
+/*!
+  \brief Add the cross-correlation matrix of ``nblocks`` consecutive
+  blocks of ``nantennas x nfreq`` spectra to ``ccm``.
+
+  The work is split in tiles of ``XCORR_ANTENNA_TILE`` by
+  ``XCORR_ANTENNA_TILE`` antennas and ``XCORR_FREQUENCY_TILE`` frequencies
+  which write disjoint parts of ``ccm`` and are distributed over the
+  OpenMP threads. Only the first ``nbaselines`` baselines are computed.
+*/
+template <class T>
+void crossCorrelateBlocked(HComplex* ccm, const std::complex<T>* fftdata,
+                           const int nblocks, const int nantennas, const int nfreq,
+                           const HInteger nbaselines)
+{
+  const int A = XCORR_ANTENNA_TILE;
+  const int nantennatiles = (nantennas + A - 1) / A;
+  const int nfreqtiles = (nfreq + XCORR_FREQUENCY_TILE - 1) / XCORR_FREQUENCY_TILE;
+
+  // Upper triangle of antenna tile pairs
+  std::vector<std::pair<int, int> > pairs;
+  for (int i = 0; i < nantennatiles; ++i)
+  {
+    for (int j = i; j < nantennatiles; ++j)
+    {
+      pairs.push_back(std::make_pair(i, j));
+    }
+  }
+
+  const int ntiles = pairs.size() * nfreqtiles;
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<double> scratch;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+    for (int tile = 0; tile < ntiles; ++tile)
+    {
+      const std::pair<int, int>& pair = pairs[tile / nfreqtiles];
+      const int f0 = (tile % nfreqtiles) * XCORR_FREQUENCY_TILE;
+
+      crossCorrelateTile(ccm, fftdata, nblocks, nantennas, nfreq, nbaselines,
+                         pair.first * A, hfmin((pair.first + 1) * A, nantennas),
+                         pair.second * A, hfmin((pair.second + 1) * A, nantennas),
+                         f0, hfmin(f0 + XCORR_FREQUENCY_TILE, nfreq),
+                         scratch);
+    }
+  }
+}
+
 // ========================================================================
 //$SECTION: Filtering functions
 // ========================================================================
@@ -76,6 +248,9 @@ using namespace std;
   number of antennas and ``N_freq`` the number of frequency bins per
   antenna. The length of the (input) vector is then ``N * N_freq``.
 
+  The matrix is computed in tiles of antennas and frequencies which
+  are distributed over the OpenMP threads.
+
   Usage:
   hCrossCorrelationMatrix(ccm,fftdata,nfreq) -> ccm = ccm(old) + ccm(fftdata)
 */
@@ -84,44 +259,152 @@ void HFPP_FUNC_NAME(const Iter ccm, const Iter ccm_end,
                     const Iter fftdata,const Iter fftdata_end,
                     const HInteger nfreq)
 {
-  // Declaration of variables
-  Iter it(ccm);
-  Iter it1_start(fftdata);
-  Iter it1_end(fftdata+nfreq);
-  Iter it1(it1_start);
-  Iter it2(it1_end);
-
   // Sanity check
   if (nfreq <= 0) {
     throw PyCR::ValueError("nfreq must be larger than 1");
     return;
   }
-  if ((it1 < fftdata) || (it1 >= fftdata_end)) {
-    throw PyCR::ValueError("Start iterator outside vector range");
+
+  const HInteger nantennas = std::distance(fftdata, fftdata_end) / nfreq;
+
+  if (nantennas < 2) {
+    throw PyCR::ValueError("fftdata must contain the data of at least two antennas");
     return;
   }
-  if ((it2 < fftdata) || (it2 >= fftdata_end)) {
-    throw PyCR::ValueError("Start iterator outside vector range");
+
+  // Implementation cross-correlation
+  crossCorrelateBlocked(&(*ccm), &(*fftdata), 1, nantennas, nfreq,
+                        hfmin(std::distance(ccm, ccm_end) / nfreq, nantennas * (nantennas - 1) / 2));
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+//$DOCSTRING: Adds the upper half of the cross-correlation matrix of consecutive blocks of antenna data in the frequency domain to the output vector.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hCrossCorrelationMatrix
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HComplex)(ccm)()("Upper half of the cross-correlation matrix (output) containing complex visibilities as a function of frequency, ordered as ``ant0*ant1,ant0*ant2,...,ant1*ant2,...``.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(fftdata)()("Array of dimensions [nblocks, nantennas, nfreq] with the FFTed data of all antennas for a number of time blocks.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(nfreq)()("Number of frequency bins per antenna.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (HInteger)(nantennas)()("Number of antennas per block.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  Equivalent to calling ``hCrossCorrelationMatrix(ccm,block,nfreq)``
+  for every block, but the visibilities are summed over all blocks
+  within a tile before ``ccm`` is updated. A long data set can thus be
+  correlated in a stream of calls, each adding a number of blocks to the
+  same ``ccm``.
+
+  Usage:
+  hCrossCorrelationMatrix(ccm,fftdata,nfreq,nantennas) -> ccm = ccm(old) + sum of ccm(block) over all blocks in fftdata
+
+  Example:
+  >>> ccm = cr.hArray(complex, nantennas * (nantennas - 1) / 2 * nfreq, fill=0)
+  >>> fftdata = cr.hArray(complex, [nblocks, nantennas, nfreq])
+  >>> cr.hCrossCorrelationMatrix(ccm, fftdata, nfreq, nantennas)
+*/
+template <class Iter>
+void HFPP_FUNC_NAME(const Iter ccm, const Iter ccm_end,
+                    const Iter fftdata,const Iter fftdata_end,
+                    const HInteger nfreq,
+                    const HInteger nantennas)
+{
+  // Sanity check
+  if (nfreq <= 0 || nantennas < 2) {
+    throw PyCR::ValueError("nfreq must be positive and nantennas at least 2");
     return;
   }
 
-  // Implementation cross-correlation
-  while (it != ccm_end) {
-    *it += (*it1) * conj(*it2);
-    ++it; ++it1; ++it2;
-    if (it1 == it1_end) {
-      if (it2 >= fftdata_end) {
-	it1_start += nfreq;
-	it1_end += nfreq;
-	if (it1_end >= fftdata_end) return;
-	it2 = it1_end;
-      };
-      it1 = it1_start;
-    };
-  };
+  const HInteger N = std::distance(fftdata, fftdata_end);
+
+  if (N % (nantennas * nfreq) != 0) {
+    throw PyCR::ValueError("Length of fftdata is not a multiple of nantennas * nfreq");
+    return;
+  }
+
+  if (std::distance(ccm, ccm_end) != nantennas * (nantennas - 1) / 2 * nfreq) {
+    throw PyCR::ValueError("ccm must have length nantennas * (nantennas - 1) / 2 * nfreq");
+    return;
+  }
+
+  crossCorrelateBlocked(&(*ccm), &(*fftdata), N / (nantennas * nfreq), nantennas, nfreq,
+                        nantennas * (nantennas - 1) / 2);
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+#ifdef PYCRTOOLS_WITH_NUMPY
+
+//$DOCSTRING: Adds the upper half of the cross-correlation matrix of consecutive blocks of single or double precision antenna data stored in a numpy array to the output vector.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hCrossCorrelationMatrix
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HComplex)(ccm)()("Upper half of the cross-correlation matrix (output) containing complex visibilities as a function of frequency, ordered as ``ant0*ant1,ant0*ant2,...,ant1*ant2,...``.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (ndarray)(fftdata)()("Contiguous numpy array of type complex64 or complex128 and dimensions [nblocks, nantennas, nfreq].")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_2 (HInteger)(nfreq)()("Number of frequency bins per antenna.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (HInteger)(nantennas)()("Number of antennas per block.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  Single precision input halves the memory needed for long TBB dumps,
+  the visibilities are still accumulated in double precision.
+
+  Example:
+  >>> ccm = cr.hArray(complex, nantennas * (nantennas - 1) / 2 * nfreq, fill=0)
+  >>> fftdata = np.zeros((nblocks, nantennas, nfreq), dtype=np.complex64)
+  >>> cr.hCrossCorrelationMatrix(ccm, fftdata, nfreq, nantennas)
+*/
+template <class Iter>
+void HFPP_FUNC_NAME(const Iter ccm, const Iter ccm_end,
+                    ndarray fftdata,
+                    const HInteger nfreq,
+                    const HInteger nantennas)
+{
+  // Sanity check
+  if (nfreq <= 0 || nantennas < 2) {
+    throw PyCR::ValueError("nfreq must be positive and nantennas at least 2");
+    return;
+  }
+
+  const HInteger N = num_util::size(fftdata);
+
+  if (N % (nantennas * nfreq) != 0) {
+    throw PyCR::ValueError("Size of fftdata is not a multiple of nantennas * nfreq");
+    return;
+  }
+
+  if (std::distance(ccm, ccm_end) != nantennas * (nantennas - 1) / 2 * nfreq) {
+    throw PyCR::ValueError("ccm must have length nantennas * (nantennas - 1) / 2 * nfreq");
+    return;
+  }
+
+  const HInteger nblocks = N / (nantennas * nfreq);
+
+  switch (num_util::type(fftdata))
+  {
+  case NPY_CFLOAT:
+    crossCorrelateBlocked(&(*ccm), numpyBeginPtr<std::complex<float> >(fftdata), nblocks, nantennas, nfreq,
+                          nantennas * (nantennas - 1) / 2);
+    break;
+  case NPY_CDOUBLE:
+    crossCorrelateBlocked(&(*ccm), numpyBeginPtr<std::complex<double> >(fftdata), nblocks, nantennas, nfreq,
+                          nantennas * (nantennas - 1) / 2);
+    break;
+  default:
+    throw PyCR::TypeError("fftdata must be of type complex64 or complex128");
+  }
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+#endif /* PYCRTOOLS_WITH_NUMPY */
+
 // ========================================================================
 //
 //  Hanning filter
@@ -26,6 +26,14 @@
 #include "mArray.h"
 #include "mModule.h"
 
+// ========================================================================
+//  Definitions
+// ========================================================================
+
+// Tile sizes of the cross-correlation engine
+#define XCORR_ANTENNA_TILE 8
+#define XCORR_FREQUENCY_TILE 128
+
 // ========================================================================
 //  Wrapper declarations
 // ========================================================================
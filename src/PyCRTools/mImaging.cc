@@ -916,6 +916,276 @@ void HFPP_FUNC_NAME (const Iter hc, const Iter hc_end,
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+//__________________________________________________________________________
+//                                                      Beamforming engine
+
+/*
+  The beamforming engine evaluates
+
+    image(p, f) += sum_a fftdata(a, f) * exp(i 2 pi f delay(p, a))
+
+  on tiles of ``BEAMFORM_PIXEL_TILE`` pixels by ``BEAMFORM_FREQUENCY_TILE``
+  frequency channels. The image tile is kept in (split real/imaginary)
+  accumulators of type T while all antennas are added, so the FFT data of
+  an antenna is read once per tile and reused for all pixels in it.
+
+  For equidistant frequencies the phasors are not evaluated with one
+  ``sin``/``cos`` pair per sample. Instead ``BEAMFORM_PHASOR_LANES``
+  consecutive phasors are kept in a vector that is advanced with a single
+  complex multiplication per lane, which the compiler can vectorize. The
+  recurrence is reseeded exactly at the start of every frequency tile,
+  which bounds the accumulated rounding error also in single precision.
+*/
+
+template <class T>
+static inline void beamformAddAntenna(T* acc_re, T* acc_im,
+                                      const T* fft_re, const T* fft_im,
+                                      const HNumber* frequencies,
+                                      const int Nchannels,
+                                      const HNumber delay,
+                                      const HNumber df,
+                                      const bool equidistant)
+{
+  int j;
+
+  if (!equidistant)
+  {
+    // Fall back to direct evaluation of the phasors
+    for (j=0; j<Nchannels; ++j)
+    {
+      const HNumber phase = (2*M_PI) * (frequencies[j] * delay);
+      const T w_re = static_cast<T>(cos(phase));
+      const T w_im = static_cast<T>(sin(phase));
+
+      acc_re[j] += fft_re[j] * w_re - fft_im[j] * w_im;
+      acc_im[j] += fft_re[j] * w_im + fft_im[j] * w_re;
+    }
+    return;
+  }
+
+  T w_re[BEAMFORM_PHASOR_LANES];
+  T w_im[BEAMFORM_PHASOR_LANES];
+
+  // Seed the lanes with the exact phasor of the first channel of the tile
+  // and the phasor increment between neighbouring channels
+  const HComplex w0 = polar(1.0, (2*M_PI) * (frequencies[0] * delay));
+  const HComplex dw = polar(1.0, (2*M_PI) * (df * delay));
+  const HComplex sw = polar(1.0, (2*M_PI) * (BEAMFORM_PHASOR_LANES * df * delay));
+  const T step_re = static_cast<T>(real(sw));
+  const T step_im = static_cast<T>(imag(sw));
+
+  HComplex w = w0;
+  for (j=0; j<BEAMFORM_PHASOR_LANES; ++j)
+  {
+    w_re[j] = static_cast<T>(real(w));
+    w_im[j] = static_cast<T>(imag(w));
+    w *= dw;
+  }
+
+  int k = 0;
+  for (; k + BEAMFORM_PHASOR_LANES <= Nchannels; k += BEAMFORM_PHASOR_LANES)
+  {
+    T* a_re = acc_re + k;
+    T* a_im = acc_im + k;
+    const T* f_re = fft_re + k;
+    const T* f_im = fft_im + k;
+
+    // Complex multiply-accumulate, independent per lane
+    for (j=0; j<BEAMFORM_PHASOR_LANES; ++j)
+    {
+      a_re[j] += f_re[j] * w_re[j] - f_im[j] * w_im[j];
+      a_im[j] += f_re[j] * w_im[j] + f_im[j] * w_re[j];
+    }
+
+    // Advance all lanes by BEAMFORM_PHASOR_LANES channels
+    for (j=0; j<BEAMFORM_PHASOR_LANES; ++j)
+    {
+      const T tmp = w_re[j] * step_re - w_im[j] * step_im;
+      w_im[j] = w_re[j] * step_im + w_im[j] * step_re;
+      w_re[j] = tmp;
+    }
+  }
+
+  // Remaining channels of the tile
+  for (j=0; k<Nchannels; ++j, ++k)
+  {
+    acc_re[k] += fft_re[k] * w_re[j] - fft_im[k] * w_im[j];
+    acc_im[k] += fft_re[k] * w_im[j] + fft_im[k] * w_re[j];
+  }
+}
+
+/*!
+  \brief Delay lookup in a precomputed [pixel x antenna] delay table.
+*/
+class BeamformDelayTable
+{
+  const HNumber* delays;
+  const int Nantennas;
+
+public:
+  BeamformDelayTable(const HNumber* d, const int Na) : delays(d), Nantennas(Na) {};
+
+  inline HNumber operator() (const int pixel, const int antenna) const
+  {
+    return delays[pixel * Nantennas + antenna];
+  };
+};
+
+/*!
+  \brief Far field delays computed on the fly from antenna and sky positions.
+*/
+class BeamformFarFieldDelays
+{
+  const HNumber* antpos;
+  const HNumber* skypos;
+
+public:
+  BeamformFarFieldDelays(const HNumber* a, const HNumber* s) : antpos(a), skypos(s) {};
+
+  inline HNumber operator() (const int pixel, const int antenna) const
+  {
+    const HNumber* sky = skypos + 3 * pixel;
+    const HNumber norm = sqrt(sky[0] * sky[0] + sky[1] * sky[1] + sky[2] * sky[2]);
+
+    return hGeometricDelayFarField(antpos + 3 * antenna, sky, norm);
+  };
+};
+
+/*!
+  \brief Returns true if the frequencies are equidistant, the step is returned in ``df``.
+*/
+static bool beamformEquidistantFrequencies(const HNumber* frequencies, const int Nfrequencies, HNumber &df)
+{
+  df = 0.0;
+
+  if (Nfrequencies < 2)
+  {
+    return true;
+  }
+
+  df = (frequencies[Nfrequencies - 1] - frequencies[0]) / (Nfrequencies - 1);
+
+  const HNumber tolerance = 1.e-9 * hfmax(fabs(df), fabs(frequencies[0]));
+
+  for (int k=0; k<Nfrequencies; ++k)
+  {
+    if (fabs(frequencies[k] - (frequencies[0] + k * df)) > tolerance)
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*!
+  \brief Tiled beamformer accumulating into ``image`` using accumulators of type T.
+
+  ``image`` is stored as [pixel x frequency] and ``fftdata`` as
+  [antenna x frequency], both with the frequency index running fastest.
+*/
+template <class T, class Delays>
+void beamformTiled(HComplex* image, const HComplex* fftdata,
+                   const HNumber* frequencies, const Delays& delays,
+                   const int Nskycoord, const int Nantennas, const int Nfrequencies)
+{
+  HNumber df = 0.0;
+  const bool equidistant = beamformEquidistantFrequencies(frequencies, Nfrequencies, df);
+
+  // Split FFT data in real and imaginary parts of the working precision
+  const size_t Nfft = static_cast<size_t>(Nantennas) * Nfrequencies;
+  std::vector<T> fft_re(Nfft);
+  std::vector<T> fft_im(Nfft);
+
+  for (size_t n=0; n<Nfft; ++n)
+  {
+    fft_re[n] = static_cast<T>(real(fftdata[n]));
+    fft_im[n] = static_cast<T>(imag(fftdata[n]));
+  }
+
+  const int NpixelTiles = (Nskycoord + BEAMFORM_PIXEL_TILE - 1) / BEAMFORM_PIXEL_TILE;
+  const int NfrequencyTiles = (Nfrequencies + BEAMFORM_FREQUENCY_TILE - 1) / BEAMFORM_FREQUENCY_TILE;
+  const int Ntiles = NpixelTiles * NfrequencyTiles;
+
+  // Loop over tiles (parallel on multi core systems if supported)
+#ifdef _OPENMP
+  #pragma omp parallel
+#endif // _OPENMP
+  {
+    std::vector<T> acc_re(BEAMFORM_PIXEL_TILE * BEAMFORM_FREQUENCY_TILE);
+    std::vector<T> acc_im(BEAMFORM_PIXEL_TILE * BEAMFORM_FREQUENCY_TILE);
+    std::vector<HNumber> tile_delays(BEAMFORM_PIXEL_TILE * Nantennas);
+
+#ifdef _OPENMP
+    #pragma omp for schedule(dynamic)
+#endif // _OPENMP
+    for (int t=0; t<Ntiles; ++t)
+    {
+      const int p0 = (t / NfrequencyTiles) * BEAMFORM_PIXEL_TILE;
+      const int k0 = (t % NfrequencyTiles) * BEAMFORM_FREQUENCY_TILE;
+      const int Np = hfmin(BEAMFORM_PIXEL_TILE, Nskycoord - p0);
+      const int Nk = hfmin(BEAMFORM_FREQUENCY_TILE, Nfrequencies - k0);
+
+      std::fill(acc_re.begin(), acc_re.end(), T(0));
+      std::fill(acc_im.begin(), acc_im.end(), T(0));
+
+      for (int p=0; p<Np; ++p)
+      {
+        for (int a=0; a<Nantennas; ++a)
+        {
+          tile_delays[p * Nantennas + a] = delays(p0 + p, a);
+        }
+      }
+
+      // Antennas outer, so the FFT data of one antenna stays in cache for all pixels
+      for (int a=0; a<Nantennas; ++a)
+      {
+        const size_t offset = static_cast<size_t>(a) * Nfrequencies + k0;
+
+        for (int p=0; p<Np; ++p)
+        {
+          beamformAddAntenna<T>(&acc_re[p * BEAMFORM_FREQUENCY_TILE],
+                                &acc_im[p * BEAMFORM_FREQUENCY_TILE],
+                                &fft_re[offset], &fft_im[offset],
+                                frequencies + k0, Nk,
+                                tile_delays[p * Nantennas + a], df, equidistant);
+        }
+      }
+
+      // Add tile to (possibly existing) image
+      for (int p=0; p<Np; ++p)
+      {
+        HComplex* it_im = image + static_cast<size_t>(p0 + p) * Nfrequencies + k0;
+
+        for (int k=0; k<Nk; ++k)
+        {
+          it_im[k] += HComplex(acc_re[p * BEAMFORM_FREQUENCY_TILE + k],
+                               acc_im[p * BEAMFORM_FREQUENCY_TILE + k]);
+        }
+      }
+    }
+  }
+}
+
+/*!
+  \brief Dispatches to the single or double precision tiled beamformer.
+*/
+template <class Delays>
+void beamformTiled(HComplex* image, const HComplex* fftdata,
+                   const HNumber* frequencies, const Delays& delays,
+                   const int Nskycoord, const int Nantennas, const int Nfrequencies,
+                   const bool singlePrecision)
+{
+  if (singlePrecision)
+  {
+    beamformTiled<float, Delays>(image, fftdata, frequencies, delays, Nskycoord, Nantennas, Nfrequencies);
+  }
+  else
+  {
+    beamformTiled<double, Delays>(image, fftdata, frequencies, delays, Nskycoord, Nantennas, Nfrequencies);
+  }
+}
+
 //$DOCSTRING: Beamform image
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hBeamformImage
@@ -940,10 +1210,6 @@ void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
     const Iter skypos, const Iter skypos_end
     )
 {
-  // Variables
-  HNumber norm = 0.0;
-  HNumber delay = 0.0;
-
   // Inspect length of input arrays
   const int Nimage = std::distance(image, image_end);
   const int Nfftdata = std::distance(fftdata, fftdata_end);
@@ -955,9 +1221,6 @@ void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
   const int Nantennas = Nantpos / 3;
   const int Nskycoord = Nskypos / 3;
 
-  // Indices
-  int i, j, k;
-
   // Sanity checks
   if (Nantpos != Nantennas * 3)
   {
@@ -984,64 +1247,91 @@ void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
     throw PyCR::ValueError(error_message);
   }
 
-  // Get iterators
-  CIter it_im = image;
-  CIter it_im_inner = image;
-  CIter it_fft = fftdata;
-  Iter it_freq = frequencies;
-  Iter it_ant = antpos;
-  Iter it_sky = skypos;
-
   clock_t start = clock(), diff;
 
-  // Loop over pixels (parallel on multi core systems if supported)
-#ifdef _OPENMP
-  std::cout<<"Running in parallel mode"<<std::endl;
-  #pragma omp parallel for private(delay, norm, it_im, it_im_inner, it_fft, it_freq, it_ant, it_sky, j, k)
-#else
-  std::cout<<"Running in serial mode"<<std::endl;
-#endif // _OPENMP
-  for (i=0; i<Nskycoord; ++i)
-  {
-    // Image iterator to start position
-    it_im = image + (i * Nfrequencies);
+  // Tiled beamforming with delays calculated per pixel tile
+  beamformTiled(&(*image), &(*fftdata), &(*frequencies),
+                BeamformFarFieldDelays(&(*antpos), &(*skypos)),
+                Nskycoord, Nantennas, Nfrequencies, false);
 
-    // Sky coordinate iterator to start position
-    it_sky = skypos + (i * 3);
+  diff = clock() - start;
 
-    // Loop over antennas
-    it_ant = antpos;
-    it_fft = fftdata;
+  std::cout<<"beamforming block done in "<< static_cast<float>(diff) / CLOCKS_PER_SEC<<" s"<<std::endl;
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
-    // Calculate norm of sky vector
-    norm = sqrt(*it_sky * *it_sky +
-                *(it_sky+1) * *(it_sky+1) +
-                *(it_sky+2) * *(it_sky+2));
 
-    for (j=Nantennas; j!=0; --j)
-    {
-      // Reset image iterator to first frequency of current pixel
-      it_im_inner = it_im;
+//$DOCSTRING: Beamform image
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hBeamformImage
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HComplex)(image)()("Array to store resulting image. Stored as ``[I(x_0, y_0, f_0), I(x_0, y_0, f_1), ... I(x_nx, y_ny, f_nf)]``, e.g. the rightmost (frequency) index runs fastest. This array may contain an existing image.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(fftdata)()("Array with FFT data of each antenna. Expects data to be stored as ``[f(0,0), f(0,1), ..., f(0,nf), f(1,0), f(1,1), ..., f(1,nf), ..., f(na, 0), f(na,1), ..., f(na,nf)]`` e.g. ``f(i,j)`` where ``i`` is the antenna number and ``j`` is the frequency.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HNumber)(frequencies)()("Array with frequencies [Hz] stored as ``[f_0, f_1, ..., f_n]``.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_3 (HNumber)(delays)()("Array containing the delays [s] for all antennas and positions (antenna index runs fastest: ``(ant1, pos1), (ant2, pos1), ...``) - length of vector has to be number of antennas times positions as calculated by :func:`hGeometricDelays`.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
 
-      // Calculate geometric delay
-      delay = hGeometricDelayFarField(it_ant, it_sky, norm);
+  Description:
 
-      // Loop over frequencies
-      it_freq = frequencies;
+  The image is computed in tiles of pixels and frequency channels such
+  that the FFT data of each antenna is reused from cache for all pixels
+  of a tile. For equidistant frequencies the phasors are obtained from a
+  vectorized complex recurrence that is reseeded exactly at the start of
+  every tile, instead of calling ``sin`` and ``cos`` for every sample.
+  :func:`hBeamformImageDirect` gives the result of the direct evaluation.
 
-      for (k=Nfrequencies; k!=0; --k)
-      {
-        // Multiply by geometric weight and add to image
-        *it_im_inner += (*it_fft) * polar(1.0, (2*M_PI)*((*it_freq) * delay));
-        ++it_im_inner;
-        ++it_fft;
-        ++it_freq;
-      }
+  Example:
+  >>> cr.hBeamformImage(image, fftdata, frequencies, delays)
+  >>> cr.hBeamformImage(image, fftdata, frequencies, delays, True) # single precision
+*/
 
-      // Next antenna position
-      it_ant += 3;
-    }
+template <class CIter, class Iter>
+void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
+    const CIter fftdata, const CIter fftdata_end,
+    const Iter frequencies, const Iter frequencies_end,
+    const Iter delays, const Iter delays_end
+    )
+{
+  // Inspect length of input arrays
+  const int Nimage = std::distance(image, image_end);
+  const int Nfftdata = std::distance(fftdata, fftdata_end);
+  const int Nfrequencies = std::distance(frequencies, frequencies_end);
+  const int Ndelays = std::distance(delays, delays_end);
+
+  // Get relevant numbers
+  const int Nskycoord = Nimage / Nfrequencies;
+  const int Nantennas = Ndelays / Nskycoord;
+
+  // Sanity checks
+  if (Nimage != Nskycoord * Nfrequencies)
+  {
+    char error_message[256];
+    sprintf(error_message, "Image array has wrong size: Nimage[=%d] != Nskycoord[=%d] * Nfrequencies[=%d]", Nimage, Nskycoord, Nfrequencies);
+    throw PyCR::ValueError(error_message);
   }
+  if (Ndelays != Nantennas * Nskycoord)
+  {
+    char error_message[256];
+    sprintf(error_message, "Delays array has wrong size: Ndelays[=%d] != Nantennas[=%d] * Nskycoord[=%d]", Ndelays, Nantennas, Nskycoord);
+    throw PyCR::ValueError(error_message);
+  }
+  if (Nfftdata != Nfrequencies * Nantennas)
+  {
+    char error_message[256];
+    sprintf(error_message,"FFT data array has wrong size: Nfftdata[=%d] != Nfrequencies[=%d] * Nantennas[=%d]", Nfftdata, Nfrequencies, Nantennas);
+    throw PyCR::ValueError(error_message);
+  }
+
+  clock_t start = clock(), diff;
+
+  // Tiled beamforming
+  beamformTiled(&(*image), &(*fftdata), &(*frequencies),
+                BeamformDelayTable(&(*delays), Nantennas),
+                Nskycoord, Nantennas, Nfrequencies, false);
 
   diff = clock() - start;
 
@@ -1049,8 +1339,7 @@ void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
-
-//$DOCSTRING: Beamform image
+//$DOCSTRING: Beamform image, optionally with phasors and accumulation in single precision.
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hBeamformImage
 //-----------------------------------------------------------------------
@@ -1059,6 +1348,73 @@ void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
 #define HFPP_PARDEF_1 (HComplex)(fftdata)()("Array with FFT data of each antenna. Expects data to be stored as ``[f(0,0), f(0,1), ..., f(0,nf), f(1,0), f(1,1), ..., f(1,nf), ..., f(na, 0), f(na,1), ..., f(na,nf)]`` e.g. ``f(i,j)`` where ``i`` is the antenna number and ``j`` is the frequency.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
 #define HFPP_PARDEF_2 (HNumber)(frequencies)()("Array with frequencies [Hz] stored as ``[f_0, f_1, ..., f_n]``.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
 #define HFPP_PARDEF_3 (HNumber)(delays)()("Array containing the delays [s] for all antennas and positions (antenna index runs fastest: ``(ant1, pos1), (ant2, pos1), ...``) - length of vector has to be number of antennas times positions as calculated by :func:`hGeometricDelays`.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_4 (bool)(singlePrecision)()("Compute phasors and accumulate each image tile in single precision. The result has a relative accuracy of about ``1e-6``.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+*/
+
+template <class CIter, class Iter>
+void HFPP_FUNC_NAME (const CIter image, const CIter image_end,
+    const CIter fftdata, const CIter fftdata_end,
+    const Iter frequencies, const Iter frequencies_end,
+    const Iter delays, const Iter delays_end,
+    const bool singlePrecision
+    )
+{
+  // Inspect length of input arrays
+  const int Nimage = std::distance(image, image_end);
+  const int Nfftdata = std::distance(fftdata, fftdata_end);
+  const int Nfrequencies = std::distance(frequencies, frequencies_end);
+  const int Ndelays = std::distance(delays, delays_end);
+
+  // Get relevant numbers
+  const int Nskycoord = Nimage / Nfrequencies;
+  const int Nantennas = Ndelays / Nskycoord;
+
+  // Sanity checks
+  if (Nimage != Nskycoord * Nfrequencies)
+  {
+    char error_message[256];
+    sprintf(error_message, "Image array has wrong size: Nimage[=%d] != Nskycoord[=%d] * Nfrequencies[=%d]", Nimage, Nskycoord, Nfrequencies);
+    throw PyCR::ValueError(error_message);
+  }
+  if (Ndelays != Nantennas * Nskycoord)
+  {
+    char error_message[256];
+    sprintf(error_message, "Delays array has wrong size: Ndelays[=%d] != Nantennas[=%d] * Nskycoord[=%d]", Ndelays, Nantennas, Nskycoord);
+    throw PyCR::ValueError(error_message);
+  }
+  if (Nfftdata != Nfrequencies * Nantennas)
+  {
+    char error_message[256];
+    sprintf(error_message,"FFT data array has wrong size: Nfftdata[=%d] != Nfrequencies[=%d] * Nantennas[=%d]", Nfftdata, Nfrequencies, Nantennas);
+    throw PyCR::ValueError(error_message);
+  }
+
+  clock_t start = clock(), diff;
+
+  // Tiled beamforming in the requested precision
+  beamformTiled(&(*image), &(*fftdata), &(*frequencies),
+                BeamformDelayTable(&(*delays), Nantennas),
+                Nskycoord, Nantennas, Nfrequencies, singlePrecision);
+
+  diff = clock() - start;
+
+  std::cout<<"beamforming block done in "<< static_cast<float>(diff) / CLOCKS_PER_SEC<<" s"<<std::endl;
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+//$DOCSTRING: Beamform image by direct evaluation of every phasor (reference implementation for :func:`hBeamformImage`).
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hBeamformImageDirect
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HComplex)(image)()("Array to store resulting image. Stored as ``[I(x_0, y_0, f_0), I(x_0, y_0, f_1), ... I(x_nx, y_ny, f_nf)]``, e.g. the rightmost (frequency) index runs fastest. This array may contain an existing image.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(fftdata)()("Array with FFT data of each antenna. Expects data to be stored as ``[f(0,0), f(0,1), ..., f(0,nf), f(1,0), f(1,1), ..., f(1,nf), ..., f(na, 0), f(na,1), ..., f(na,nf)]`` e.g. ``f(i,j)`` where ``i`` is the antenna number and ``j`` is the frequency.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HNumber)(frequencies)()("Array with frequencies [Hz] stored as ``[f_0, f_1, ..., f_n]``.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_3 (HNumber)(delays)()("Array containing the delays [s] for all antennas and positions (antenna index runs fastest: ``(ant1, pos1), (ant2, pos1), ...``) - length of vector has to be number of antennas times positions as calculated by :func:`hGeometricDelays`.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
 //$COPY_TO END --------------------------------------------------
 /*!
   \brief $DOCSTRING
@@ -1369,10 +1725,6 @@ void HFPP_FUNC_NAME (const CIter out, const CIter out_end,
     const Iter skypos, const Iter skypos_end
     )
 {
-  // Variables
-  HNumber delay = 0.0;
-  HInteger i, j;
-
   // Inspect length of input arrays
   const int Nout = std::distance(out, out_end);
   const int Nfftdata = std::distance(fftdata, fftdata_end);
@@ -1409,37 +1761,12 @@ void HFPP_FUNC_NAME (const CIter out, const CIter out_end,
     throw PyCR::ValueError(error_message);
   }
 
-  // Get iterators
-  CIter it_out = out;
-  CIter it_fft = fftdata;
-  Iter it_freq = frequencies;
-  Iter it_ant = antpos;
-  Iter it_sky = skypos;
-
   clock_t start = clock(), diff;
 
-  // Calculate norm of sky vector
-  const HNumber norm = sqrt(*it_sky * *it_sky + *(it_sky+1) * *(it_sky+1) + *(it_sky+2) * *(it_sky+2));
-
-  i = Nantennas;
-  while (i--)
-  {
-    delay = hGeometricDelayFarField(it_ant, it_sky, norm);
-
-    it_out = out;
-    it_freq = frequencies;
-
-    j = Nfrequencies;
-    while (j--)
-    {
-      *it_out += (*it_fft) * polar(1.0, (2*M_PI)*((*it_freq) * delay));
-      it_fft++;
-      it_out++;
-      it_freq++;
-    }
-
-    it_ant += 3;
-  }
+  // Tiled beamforming for a single pixel
+  beamformTiled(&(*out), &(*fftdata), &(*frequencies),
+                BeamformFarFieldDelays(&(*antpos), &(*skypos)),
+                1, Nantennas, Nfrequencies, false);
 
   diff = clock() - start;
 
@@ -1470,9 +1797,6 @@ void HFPP_FUNC_NAME (const CIter out, const CIter out_end,
     const Iter delays, const Iter delays_end
     )
 {
-  // Variables
-  HInteger i, j;
-
   // Inspect length of input arrays
   const int Nout = std::distance(out, out_end);
   const int Nfftdata = std::distance(fftdata, fftdata_end);
@@ -1495,32 +1819,72 @@ void HFPP_FUNC_NAME (const CIter out, const CIter out_end,
     throw PyCR::ValueError(error_message);
   }
 
-  // Get iterators
-  CIter it_out = out;
-  CIter it_fft = fftdata;
-  Iter it_freq = frequencies;
-  Iter it_delay = delays;
-
   clock_t start = clock(), diff;
 
-  i = Nantennas;
-  while (i--)
-  {
-    it_out = out;
-    it_freq = frequencies;
+  // Tiled beamforming for a single pixel
+  beamformTiled(&(*out), &(*fftdata), &(*frequencies),
+                BeamformDelayTable(&(*delays), Nantennas),
+                1, Nantennas, Nfrequencies, false);
 
-    j = Nfrequencies;
-    while (j--)
-    {
-      *it_out += (*it_fft) * polar(1.0, (2*M_PI)*((*it_freq) * (*it_delay)));
-      it_fft++;
-      it_out++;
-      it_freq++;
-    }
+  diff = clock() - start;
+
+  std::cout<<"beamforming block done in "<< static_cast<float>(diff) / CLOCKS_PER_SEC<<" s"<<std::endl;
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
-    it_delay++;
+//$DOCSTRING: Beamform block, optionally with phasors and accumulation in single precision.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hBeamformBlock
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HComplex)(out)()("Beamformer output.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(fftdata)()("Array with FFT data of each antenna. Expects data to be stored as ``[f(0,0), f(0,1), ..., f(0,nf), f(1,0), f(1,1), ..., f(1,nf), ..., f(na, 0), f(na,1), ..., f(na,nf)]`` e.g. ``f(i,j)`` where ``i`` is the antenna number and ``j`` is the frequency.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HNumber)(frequencies)()("Array with frequencies [Hz] stored as ``[f_0, f_1, ..., f_n]``.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_3 (HNumber)(delays)()("Array containing the delays [s] for all antennas")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_4 (bool)(singlePrecision)()("Compute phasors and accumulate in single precision.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+*/
+
+template <class CIter, class Iter>
+void HFPP_FUNC_NAME (const CIter out, const CIter out_end,
+    const CIter fftdata, const CIter fftdata_end,
+    const Iter frequencies, const Iter frequencies_end,
+    const Iter delays, const Iter delays_end,
+    const bool singlePrecision
+    )
+{
+  // Inspect length of input arrays
+  const int Nout = std::distance(out, out_end);
+  const int Nfftdata = std::distance(fftdata, fftdata_end);
+  const int Nfrequencies = std::distance(frequencies, frequencies_end);
+  const int Ndelays = std::distance(delays, delays_end);
+
+  // Get relevant numbers
+  const int Nantennas = Ndelays;
+
+  if (Nfftdata != Nfrequencies * Nantennas)
+  {
+    char error_message[256];
+    sprintf(error_message, "FFT data array has wrong size: Nfftdata[=%d] != Nfrequencies[=%d] * Nantennas[=%d]", Nfftdata, Nfrequencies, Nantennas);
+    throw PyCR::ValueError(error_message);
+  }
+  if (Nout != Nfrequencies)
+  {
+    char error_message[256];
+    sprintf(error_message, "Output array has wrong size: Nout[=%d] != Nfrequencies[=%d]", Nout, Nfrequencies);
+    throw PyCR::ValueError(error_message);
   }
 
+  clock_t start = clock(), diff;
+
+  // Tiled beamforming for a single pixel in the requested precision
+  beamformTiled(&(*out), &(*fftdata), &(*frequencies),
+                BeamformDelayTable(&(*delays), Nantennas),
+                1, Nantennas, Nfrequencies, singlePrecision);
+
   diff = clock() - start;
 
   std::cout<<"beamforming block done in "<< static_cast<float>(diff) / CLOCKS_PER_SEC<<" s"<<std::endl;
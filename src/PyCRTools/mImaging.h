@@ -33,6 +33,11 @@
 //  Definitions
 // ========================================================================
 
+// Tile sizes and vector width of the beamforming engine
+#define BEAMFORM_PIXEL_TILE 16
+#define BEAMFORM_FREQUENCY_TILE 256
+#define BEAMFORM_PHASOR_LANES 16
+
 // ========================================================================
 //  Wrapper declarations
 // ========================================================================
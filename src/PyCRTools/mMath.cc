@@ -544,6 +544,7 @@ HInteger HFPP_FUNC_NAME(const Iter vec,const Iter vec_end)
 //========================================================================
 
 //$DOCSTRING: Take the $MFUNC of all the elements in the vector.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC!CAPS}
 //-----------------------------------------------------------------------
@@ -568,6 +569,7 @@ void h{$MFUNC!CAPS}1(const Iter vec,const Iter vec_end)
 
 
 //$DOCSTRING: Take the $MFUNC of all the elements in the vector and return results in a second vector.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC!CAPS}
 //-----------------------------------------------------------------------
@@ -607,6 +609,7 @@ void h{$MFUNC!CAPS}2(const Iter vecout,const Iter vecout_end, const Iter vecin,c
 //========================================================================
 
 //$DOCSTRING: Take the $MFUNC of all the elements in the vector.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC!CAPS}
 //-----------------------------------------------------------------------
@@ -635,6 +638,7 @@ void h{$MFUNC!CAPS}1(const Iter vec,const Iter vec_end)
 
 
 //$DOCSTRING: Take the $MFUNC of all the elements in the vector and return results in a second vector.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC!CAPS}
 //-----------------------------------------------------------------------
@@ -761,6 +765,7 @@ void HFPP_FUNC_NAME(const Iterin vec1,const Iterin vec1_end, const Iter vec2,con
 
 
 //$DOCSTRING: Performs a $MFUNC between the two vectors, which is returned in the first vector. If the second vector is shorter it will be applied multiple times.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h$MFUNC
 //-----------------------------------------------------------------------
@@ -848,6 +853,7 @@ void HFPP_FUNC_NAME(const Iter vec1,const Iter vec1_end, const Iterin vec2,const
 
 
 //$DOCSTRING: Performs a $MFUNC between the vector and a scalar (applied to each element), which is returned in the first vector.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h$MFUNC
 //-----------------------------------------------------------------------
@@ -878,6 +884,7 @@ void h{$MFUNC}2(const Iter vec1,const Iter vec1_end, const S val)
 
 
 //$DOCSTRING: Performs a $MFUNC!LOW between the last two vectors, which is returned in the first vector.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h$MFUNC
 //-----------------------------------------------------------------------
@@ -920,6 +927,7 @@ void HFPP_FUNC_NAME(const Iter vec,const Iter vec_end, const Iterin1 vec1,const
 
 
 //$DOCSTRING: Performs a $MFUNC!LOW between the last two vectors, and add the result to the first vector which can be of different types.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC}Add
 //-----------------------------------------------------------------------
@@ -974,6 +982,7 @@ void HFPP_FUNC_NAME(const Iter vec,const Iter vec_end, const Iterin1 vec1,const
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
 //$DOCSTRING: Performs a $MFUNC!LOW between the input vector and a scalar, and add the result to the first vector which can be of different type. Looping will be done over the first argument, i.e. the output vector. If the second operand vector is shorter it will be applied multiple times.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC}Add
 //-----------------------------------------------------------------------
@@ -1021,6 +1030,7 @@ void HFPP_FUNC_NAME(const Iter vec,const Iter vec_end, const Iterin1 vec1,const
 
 
 //$DOCSTRING: Performs a $MFUNC!LOW between the last two vectors, and add the result to the first vector which can be of different type.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC}Add2
 //-----------------------------------------------------------------------
@@ -1125,6 +1135,7 @@ void HFPP_FUNC_NAME(const Iter vec,const Iter vec_end, const Iterin1 vec1,const
 
 
 //$DOCSTRING: Performs a $MFUNC!LOW between the vector and a scalar, where the result is returned in the first vector (with automatic casting).
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h$MFUNC
 //-----------------------------------------------------------------------
@@ -1161,6 +1172,7 @@ void h{$MFUNC}2(const Iter vec,const Iter vec_end,  const Iterin vec1,const Iter
 
 
 //$DOCSTRING: Performs a ``$MFUNC!LOW`` operation (i.e., val ``+/-*`` ``vec``) in place between a scalar and a vector, where the scalar is the first argument.
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME h{$MFUNC}Self
 //-----------------------------------------------------------------------
@@ -3167,6 +3179,344 @@ IterValueType HFPP_FUNC_NAME(const Iter vec, const Iter vec_end)
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
 
+//$DOCSTRING: Partially reorders a vector in place and returns the median value of the elements.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hSelectMedian
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_TEMPLATED_TYPE)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HFPP_TEMPLATED_TYPE)(vec)()("Numeric input vector")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  Returns the same value as ``hSortMedian`` but uses a selection
+  (``nth_element``) in linear time instead of a full sort.
+
+  .. warning::
+
+    The order of the elements is changed. Use ``hMedian`` to keep
+    the data in its original order.
+*/
+template <class Iter>
+IterValueType HFPP_FUNC_NAME(const Iter vec, const Iter vec_end)
+{
+  if (vec_end==vec) return hfnull<IterValueType>();
+
+  const Iter mid = vec+(vec_end-vec)/2;
+  nth_element(vec,mid,vec_end);
+  return *mid;
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Returns the median absolute deviation (MAD) of the elements from their median.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hMAD
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HNumber)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HFPP_TEMPLATED_TYPE)(vec)()("Numeric input vector")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  The MAD is not scaled, for Gaussian noise the standard deviation is
+  about ``1.4826 * MAD``. Both medians are found by selection on a
+  scratch copy, the input vector is not changed.
+
+  Example:
+  >>> v = hArray([1., 2., 3., 4., 100.])
+  >>> v.mad()
+  1.0
+*/
+template <class Iter>
+HNumber HFPP_FUNC_NAME(const Iter vec, const Iter vec_end)
+{
+  if (vec_end==vec) return 0.0;
+
+  std::vector<HNumber> scratch(vec_end-vec);
+  std::vector<HNumber>::iterator sit(scratch.begin());
+  for (Iter it=vec; it!=vec_end; ++it, ++sit) *sit=hfcast<HNumber>(*it);
+
+  const HNumber median = hSelectMedian(scratch.begin(),scratch.end());
+  for (sit=scratch.begin(); sit!=scratch.end(); ++sit) *sit=abs(*sit-median);
+
+  return hSelectMedian(scratch.begin(),scratch.end());
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Calculates the median of each row of a two-dimensional array.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hMedianRows
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HFPP_TEMPLATED_TYPE)(outvec)()("Output vector of length Nrows containing the median of each row")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HFPP_TEMPLATED_TYPE)(invec)()("Numeric input vector of size Nrows*Nel")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  The rows are processed in parallel with a selection based median
+  each. The input array is not changed.
+
+  Example:
+  >>> a = hArray(float, [96, 65536])
+  >>> medians = hArray(float, 96)
+  >>> medians.medianrows(a)
+*/
+template <class Iter>
+void HFPP_FUNC_NAME(const Iter outvec, const Iter outvec_end, const Iter invec, const Iter invec_end)
+{
+  const HInteger Nrows = outvec_end - outvec;
+
+  if (Nrows <= 0) ERROR_RETURN("Size of output vector is <= 0.");
+
+  const HInteger Nel = (invec_end - invec) / Nrows;
+
+  if (Nel <= 0 || Nel * Nrows != invec_end - invec) ERROR_RETURN("Size of input vector is not a multiple of the size of the output vector.");
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    std::vector<IterValueType> scratch(Nel);
+
+#ifdef _OPENMP
+#pragma omp for
+#endif
+    for (HInteger i=0; i<Nrows; ++i)
+    {
+      std::copy(invec + i*Nel, invec + (i+1)*Nel, scratch.begin());
+      *(outvec + i) = hSelectMedian(scratch.begin(), scratch.end());
+    }
+  }
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Calculates the median absolute deviation (MAD) of each row of a two-dimensional array.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hMADRows
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HNumber)(outvec)()("Output vector of length Nrows containing the MAD of each row")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HFPP_TEMPLATED_TYPE)(invec)()("Numeric input vector of size Nrows*Nel")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  The rows are processed in parallel. The input array is not changed.
+*/
+template <class NIter, class Iter>
+void HFPP_FUNC_NAME(const NIter outvec, const NIter outvec_end, const Iter invec, const Iter invec_end)
+{
+  const HInteger Nrows = outvec_end - outvec;
+
+  if (Nrows <= 0) ERROR_RETURN("Size of output vector is <= 0.");
+
+  const HInteger Nel = (invec_end - invec) / Nrows;
+
+  if (Nel <= 0 || Nel * Nrows != invec_end - invec) ERROR_RETURN("Size of input vector is not a multiple of the size of the output vector.");
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (HInteger i=0; i<Nrows; ++i)
+  {
+    *(outvec + i) = hMAD(invec + i*Nel, invec + (i+1)*Nel);
+  }
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Calculates mean and standard deviation of each row of a two-dimensional array in a single pass.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hMeanStdDevRows
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HNumber)(mean)()("Output vector of length Nrows containing the mean of each row")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HNumber)(stddev)()("Output vector of length Nrows containing the standard deviation of each row")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HFPP_TEMPLATED_TYPE)(invec)()("Numeric input vector of size Nrows*Nel")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  Uses Welford's algorithm, which is numerically stable and reads the
+  data only once, instead of ``hMean`` followed by ``hStdDev``. The
+  standard deviation is normalized by ``Nel-1`` as in ``hStdDev``.
+  A single vector is handled by output vectors of length 1.
+
+  Example:
+  >>> a = hArray(float, [96, 65536])
+  >>> mean = hArray(float, 96)
+  >>> stddev = hArray(float, 96)
+  >>> hMeanStdDevRows(mean, stddev, a)
+*/
+template <class NIter, class Iter>
+void HFPP_FUNC_NAME(const NIter mean, const NIter mean_end, const NIter stddev, const NIter stddev_end, const Iter invec, const Iter invec_end)
+{
+  const HInteger Nrows = mean_end - mean;
+
+  if (Nrows <= 0) ERROR_RETURN("Size of output vector is <= 0.");
+  if (stddev_end - stddev != Nrows) ERROR_RETURN("Mean and stddev vectors must have the same size.");
+
+  const HInteger Nel = (invec_end - invec) / Nrows;
+
+  if (Nel <= 0 || Nel * Nrows != invec_end - invec) ERROR_RETURN("Size of input vector is not a multiple of the size of the output vectors.");
+
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+  for (HInteger i=0; i<Nrows; ++i)
+  {
+    hWelfordMeanStdDev(invec + i*Nel, invec + (i+1)*Nel, *(mean + i), *(stddev + i));
+  }
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Calculates the running median of a vector over a sliding window.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hRunningMedian
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HFPP_TEMPLATED_TYPE)(odata)()("Output vector")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HFPP_TEMPLATED_TYPE)(idata)()("Input vector")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(window)()("Length of the window in samples")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  Element ``i`` of the output is the median of the input elements
+  ``i-window/2`` up to ``i-window/2+window-1``. Near the edges the window
+  is truncated to the elements that exist. The window is kept sorted
+  while it slides, so each step costs a binary search and a block move
+  of at most ``window`` values, O(window), instead of a new median of
+  the whole window.
+
+  Use ``odata[...].runningmedian(idata[...], window)`` to filter all rows
+  of a two-dimensional array.
+
+  See also:
+  hRunningMedianMAD, hRunningAverage
+*/
+template <class Iter>
+void HFPP_FUNC_NAME(const Iter odata, const Iter odata_end, const Iter idata, const Iter idata_end, const HInteger window)
+{
+  const HInteger N = idata_end - idata;
+
+  if (window <= 0) ERROR_RETURN("Window length must be positive.");
+  if (odata_end - odata != N) ERROR_RETURN("Input and output vectors must have the same size.");
+
+  hSortedWindow<IterValueType> sorted(window);
+
+  const HInteger half = window / 2;
+  HInteger lo = 0, hi = 0;
+
+  for (HInteger i=0; i<N; ++i)
+  {
+    for (; hi < std::min(N, i - half + window); ++hi) sorted.insert(*(idata + hi));
+    for (; lo < std::max<HInteger>(0, i - half); ++lo) sorted.erase(*(idata + lo));
+
+    *(odata + i) = sorted.median();
+  }
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Replaces a vector in place by its running median over a sliding window.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hRunningMedian
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HFPP_TEMPLATED_TYPE)(vec)()("Input and output vector")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HInteger)(window)()("Length of the window in samples")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  In place version of ``hRunningMedian(odata, idata, window)``.
+
+  Example:
+  >>> spectrum[...].runningmedian(65)
+*/
+template <class Iter>
+void HFPP_FUNC_NAME(const Iter vec, const Iter vec_end, const HInteger window)
+{
+  std::vector<IterValueType> scratch(vec, vec_end);
+
+  hRunningMedian(vec, vec_end, scratch.begin(), scratch.end(), window);
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
+//$DOCSTRING: Calculates the running median and median absolute deviation (MAD) of a vector over a sliding window.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hRunningMedianMAD
+//-----------------------------------------------------------------------
+#define HFPP_WRAPPER_TYPES HFPP_REAL_NUMERIC_TYPES
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HFPP_TEMPLATED_TYPE)(median)()("Output vector with the running median")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HNumber)(mad)()("Output vector with the running MAD")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HFPP_TEMPLATED_TYPE)(idata)()("Input vector")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_3 (HInteger)(window)()("Length of the window in samples")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  The window is placed as in ``hRunningMedian``. The MAD of each window
+  is found by a selection over the sorted window in O(log(window)),
+  which gives a robust local noise level for flagging, e.g. all samples
+  with ``abs(idata - median) > 5 * 1.4826 * mad``.
+*/
+template <class Iter, class NIter>
+void HFPP_FUNC_NAME(const Iter median, const Iter median_end, const NIter mad, const NIter mad_end, const Iter idata, const Iter idata_end, const HInteger window)
+{
+  const HInteger N = idata_end - idata;
+
+  if (window <= 0) ERROR_RETURN("Window length must be positive.");
+  if (median_end - median != N || mad_end - mad != N) ERROR_RETURN("Input and output vectors must have the same size.");
+
+  hSortedWindow<IterValueType> sorted(window);
+
+  const HInteger half = window / 2;
+  HInteger lo = 0, hi = 0;
+
+  for (HInteger i=0; i<N; ++i)
+  {
+    for (; hi < std::min(N, i - half + window); ++hi) sorted.insert(*(idata + hi));
+    for (; lo < std::max<HInteger>(0, i - half); ++lo) sorted.erase(*(idata + lo));
+
+    *(median + i) = sorted.median();
+    *(mad + i) = sorted.mad();
+  }
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+
 //$DOCSTRING: Returns the median value of the elements.
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hMedian
@@ -3187,7 +3537,7 @@ template <class Iter>
 IterValueType HFPP_FUNC_NAME(const Iter vec,const Iter vec_end)
 {
   std::vector<IterValueType> scratch(vec,vec_end);
-  return hSortMedian(scratch);
+  return hSelectMedian(scratch.begin(),scratch.end());
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -4817,7 +5167,7 @@ void HFPP_FUNC_NAME (const Iter vecout, const Iter vecout_end,
   Iter it1(vecin), it2(vecin);
   Iter itrms(vecrms);
   Iter itout(vecout), itout_end(vecout_end-1);
-  HNumber mean = 0.;
+  HNumber mean = 0., rms = 0.;
 
   // Sanity check
   if (lenIn <= 0) {
@@ -4839,15 +5189,15 @@ void HFPP_FUNC_NAME (const Iter vecout, const Iter vecout_end,
   //only produce the first N-1 blocks in the output vector
   while ((it1<vecin_end) && (itout<itout_end) && (itrms<vecrms_end)) {
     it2=vecin+hfmin((HInteger)(nblock*blen),lenIn);
-    mean=hMean(it1,it2);
-    *itrms=hStdDev(it1,it2,mean);
-    *itout=hMeanThreshold(it1,it2,mean,*itrms,nsigma);
+    hWelfordMeanStdDev(it1,it2,mean,rms);
+    *itrms=rms;
+    *itout=hMeanThreshold(it1,it2,mean,rms,nsigma);
     it1=it2;
     ++itout;++itrms; ++nblock;
   }
-  mean=hMean(it2,vecin_end);
-  *itrms=hStdDev(it2,vecin_end,mean);
-  *itout=hMeanThreshold(it2,vecin_end,mean,*itrms,nsigma);
+  hWelfordMeanStdDev(it2,vecin_end,mean,rms);
+  *itrms=rms;
+  *itout=hMeanThreshold(it2,vecin_end,mean,rms,nsigma);
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
@@ -5340,6 +5690,7 @@ void HFPP_FUNC_NAME (const DataIter odata,
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
 //$DOCSTRING: Calculates the square of the input vector and add it to the values in the output vector
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hSquareAdd
 //-----------------------------------------------------------------------
@@ -5489,6 +5840,7 @@ void HFPP_FUNC_NAME(ndarray out, const NIter in_begin, const NIter in_end, HInte
 #endif /* PYCRTOOLS_WITH_NUMPY */
 
 //$DOCSTRING: Calculates the square of the absolute value of a complex number and add to output vector
+//$PARALLEL
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hAbsSquareAdd
 //-----------------------------------------------------------------------
@@ -5786,6 +6138,139 @@ HInteger HFPP_FUNC_NAME (const IIter vec, const IIter vec_end)
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+namespace {
+
+  /*!
+    \brief Get the dimensions for hShiftedAbsSquareAdd and check their consistency.
+
+    The shifts and the target consist of ``ntrials`` consecutive parts,
+    one for each dispersion measure trial.
+  */
+  void shiftedAbsSquareAddDimensions(const HInteger Ntarget, const HInteger Nsource,
+                                     const HInteger Nshiftstotal, const HInteger ntrials,
+                                     HInteger& Nts, HInteger& Nss, HInteger& Nshifts)
+  {
+    if (ntrials < 1)
+    {
+      throw PyCR::ValueError("Number of trials must be positive.");
+    }
+    if (Nshiftstotal == 0 || Nshiftstotal % ntrials != 0)
+    {
+      throw PyCR::ValueError("Shifts must contain the same number of shifts for each trial.");
+    }
+    if (Ntarget % ntrials != 0)
+    {
+      throw PyCR::ValueError("Target must contain the same number of elements for each trial.");
+    }
+
+    Nshifts = Nshiftstotal / ntrials;
+
+    if (Nshifts > Nsource)
+    {
+      throw PyCR::ValueError("Shift dimensions cannot exceed source dimensions.");
+    }
+    if (Nsource > Ntarget / ntrials)
+    {
+      throw PyCR::ValueError("Source dimensions cannot exceed target dimensions.");
+    }
+
+    Nss = Nsource / Nshifts;
+
+    if (Nsource != Nss * Nshifts)
+    {
+      throw PyCR::ValueError("Shifts must fit an integer number of times in source.");
+    }
+
+    Nts = Ntarget / ntrials / Nss;
+  }
+
+  /*!
+    \brief Add the absolute value squared of each column of the source to
+    the target row given by its shift.
+
+    The shift indices are first grouped by target row. The rows of all
+    trials are then distributed over the threads, so no two threads
+    write to the same element. Each element sums its contributions in
+    order of the shift index in double precision before a single update
+    of the target, which makes the result independent of the number of
+    threads.
+  */
+  template <class T>
+  void shiftedAbsSquareAdd(T* target, const HComplex* source, const HInteger* shifts,
+                           const HInteger Nts, const HInteger Nss, const HInteger Nshifts,
+                           const HInteger ntrials)
+  {
+    const HInteger Nrows = ntrials * Nts;
+
+    // Count the shift indices per target row
+    std::vector<HInteger> offset(Nrows + 1, 0);
+
+    for (HInteger t = 0; t < ntrials; ++t)
+    {
+      for (HInteger i = 0; i < Nshifts; ++i)
+      {
+        const HInteger shift = shifts[t * Nshifts + i];
+        if (shift >= 0 && shift < Nts) ++offset[t * Nts + shift + 1];
+      }
+    }
+
+    for (HInteger r = 0; r < Nrows; ++r)
+    {
+      offset[r + 1] += offset[r];
+    }
+
+    if (offset[Nrows] == 0) return;
+
+    // Sort the shift indices by target row
+    std::vector<HInteger> index(offset[Nrows]);
+    std::vector<HInteger> next(offset.begin(), offset.end() - 1);
+
+    for (HInteger t = 0; t < ntrials; ++t)
+    {
+      for (HInteger i = 0; i < Nshifts; ++i)
+      {
+        const HInteger shift = shifts[t * Nshifts + i];
+        if (shift >= 0 && shift < Nts) index[next[t * Nts + shift]++] = i;
+      }
+    }
+
+    // Loop over target rows, shift indices mapping to the same row are
+    // mostly neighbouring source columns, so the inner loop stays within
+    // a few cache lines of the source
+    HInteger r;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 4)
+#endif // _OPENMP
+    for (r = 0; r < Nrows; ++r)
+    {
+      const HInteger* first = &index[0] + offset[r];
+      const HInteger* last = &index[0] + offset[r + 1];
+
+      if (first == last) continue;
+
+      T* target_it = target + r * Nss;
+      const HComplex* source_it = source;
+
+      for (HInteger j = 0; j < Nss; ++j)
+      {
+        HNumber sum = 0;
+
+        for (const HInteger* k = first; k != last; ++k)
+        {
+          sum += norm(source_it[*k]);
+        }
+
+        target_it[j] += static_cast<T>(sum);
+
+        // Next position in source array (skipping fastest index)
+        source_it += Nshifts;
+      }
+    }
+  }
+
+}
+
 //$DOCSTRING: Add absolute value squared at shifted position
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hShiftedAbsSquareAdd
@@ -5798,6 +6283,18 @@ HInteger HFPP_FUNC_NAME (const IIter vec, const IIter vec_end)
 /*!
   \brief $DOCSTRING
   $PARDOCSTRING
+
+  Description:
+  The fastest index of the source corresponds to the shifts. Column
+  ``i`` of the source is added to row ``shifts[i]`` of the target,
+  columns with a shift outside the target are ignored. Several columns
+  can be added to the same row.
+
+  The target rows are distributed over the threads, so the result does
+  not depend on the number of threads.
+
+  See also:
+  hDedispersionShifts
 */
 
 template <class CIter, class NIter, class IIter>
@@ -5806,78 +6303,127 @@ void HFPP_FUNC_NAME (const NIter target, const NIter target_end,
     const IIter shifts, const IIter shifts_end
     )
 {
-  // Variables
-  int i,j;
+  HInteger Nts, Nss, Nshifts;
 
-  // Get dimensions of input
-  const int Ntarget = std::distance(target, target_end);
-  const int Nsource = std::distance(source, source_end);
-  const int Nshifts = std::distance(shifts, shifts_end);
+  shiftedAbsSquareAddDimensions(std::distance(target, target_end), std::distance(source, source_end),
+                                std::distance(shifts, shifts_end), 1, Nts, Nss, Nshifts);
 
-  // Get fractions relating input and output
-  const int Nss = Nsource / Nshifts;
-  const int Nts = Ntarget / Nss;
-
-  // Sanity checks
-  if (Nshifts > Nsource)
-  {
-    throw PyCR::ValueError("Shift dimensions cannot exceed source dimensions.");
-  }
-  if (Nsource > Ntarget)
-  {
-    throw PyCR::ValueError("Source dimensions cannot exceed target dimensions.");
-  }
-  if (Nsource != Nss * Nshifts)
+  if (Nts < 1)
   {
-    throw PyCR::ValueError("Shifts must fit an integer number of times in source.");
+    throw PyCR::ValueError("Target dimensions too small.");
   }
-  if (Ntarget < Nss)
+
+  shiftedAbsSquareAdd(&(*target), &(*source), &(*shifts), Nts, Nss, Nshifts, 1);
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+//$DOCSTRING: Add absolute value squared at shifted position for a number of dispersion measure trials.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hShiftedAbsSquareAdd
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_0 (HNumber)(target)()("Target of dimensions [ntrials, nrows, nsource / nshifts].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_1 (HComplex)(source)()("Source of which the fastest index corresponds to the shifts.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(shifts)()("Shifts of dimensions [ntrials, nshifts].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_3 (HInteger)(ntrials)()("Number of trials.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Description:
+  Same as ``hShiftedAbsSquareAdd(target, source, shifts)`` for each
+  trial, with its own part of ``shifts`` and ``target``, but the
+  source block is read only once for all trials.
+
+  Example:
+  >>> shifts = hArray(int, [ndm, nfreq])
+  >>> for i, dm in enumerate(dms):
+  ...     hDedispersionShifts(shifts[i], frequencies, hMin(frequencies).val(), dm, dt)
+  >>> image = hArray(float, [ndm, nrows, npixels], fill=0)
+  >>> hShiftedAbsSquareAdd(image, t_image, shifts, ndm)
+*/
+
+template <class CIter, class NIter, class IIter>
+void HFPP_FUNC_NAME (const NIter target, const NIter target_end,
+    const CIter source, const CIter source_end,
+    const IIter shifts, const IIter shifts_end,
+    const HInteger ntrials
+    )
+{
+  HInteger Nts, Nss, Nshifts;
+
+  shiftedAbsSquareAddDimensions(std::distance(target, target_end), std::distance(source, source_end),
+                                std::distance(shifts, shifts_end), ntrials, Nts, Nss, Nshifts);
+
+  if (Nts < 1)
   {
     throw PyCR::ValueError("Target dimensions too small.");
   }
 
-  // Get iterators
-  NIter target_it = target;
-  CIter source_it = source;
-  IIter shifts_it = shifts;
+  shiftedAbsSquareAdd(&(*target), &(*source), &(*shifts), Nts, Nss, Nshifts, ntrials);
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
-  // Loop over shifts, which is also assumed to be the fastest index in
-  // the source array, so offset calculation is only needed for outer loop
+#ifdef PYCRTOOLS_WITH_NUMPY
 
-#ifdef _OPENMP
-#pragma omp parallel for private(target_it, source_it, shifts_it, j)
-#endif // _OPENMP
- for (i=0; i<Nshifts; ++i)
-  {
-    // Shift for current iteration
-    shifts_it = shifts + i;
+//$DOCSTRING: Add absolute value squared at shifted position to a single or double precision numpy array for a number of dispersion measure trials.
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hShiftedAbsSquareAdd
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_FUNC_MASTER_ARRAY_PARAMETER 1 // Use the second parameter as the master array for looping and history informations
+#define HFPP_PARDEF_0 (ndarray)(target)()("Contiguous numpy array of type float32 or float64 and dimensions [ntrials, nrows, nsource / nshifts].")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_1 (HComplex)(source)()("Source of which the fastest index corresponds to the shifts.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(shifts)()("Shifts of dimensions [ntrials, nshifts].")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_3 (HInteger)(ntrials)()("Number of trials.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
 
-    // Only inner loop if shift gives a valid offset into the target array
-    if (*shifts_it >= 0 && *shifts_it < Nts)
-    {
-      // Get offset into source and target arrays
-      source_it = source + i;
-      target_it = target + *shifts_it * Nss;
+  Description:
+  A float32 target halves the memory of large sets of trials, the
+  contributions to each element are still summed in double precision.
 
-      // Loop over second fastest index in source array stepping over
-      // the fastest index (with steps of Nshifts)
-      for (j=0; j<Nss; ++j)
-      {
-        // Add absolute value squared to the correct position in the target
-        // array
-        *target_it += real(*source_it * conj(*source_it));
+  Example:
+  >>> image = np.zeros((ndm, nrows, npixels), dtype=np.float32)
+  >>> hShiftedAbsSquareAdd(image, t_image, shifts, ndm)
+*/
 
-        // Next position in source array (skipping fastest index)
-        source_it += Nshifts;
+template <class CIter, class IIter>
+void HFPP_FUNC_NAME (ndarray target,
+    const CIter source, const CIter source_end,
+    const IIter shifts, const IIter shifts_end,
+    const HInteger ntrials
+    )
+{
+  HInteger Nts, Nss, Nshifts;
 
-        // Next position in target array
-        ++target_it;
-      }
-    }
+  shiftedAbsSquareAddDimensions(num_util::size(target), std::distance(source, source_end),
+                                std::distance(shifts, shifts_end), ntrials, Nts, Nss, Nshifts);
+
+  if (Nts < 1)
+  {
+    throw PyCR::ValueError("Target dimensions too small.");
+  }
+
+  switch (num_util::type(target))
+  {
+  case NPY_FLOAT:
+    shiftedAbsSquareAdd(numpyBeginPtr<float>(target), &(*source), &(*shifts), Nts, Nss, Nshifts, ntrials);
+    break;
+  case NPY_DOUBLE:
+    shiftedAbsSquareAdd(numpyBeginPtr<double>(target), &(*source), &(*shifts), Nts, Nss, Nshifts, ntrials);
+    break;
+  default:
+    throw PyCR::TypeError("target must be of type float32 or float64");
   }
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+#endif /* PYCRTOOLS_WITH_NUMPY */
+
 //$DOCSTRING: Returns true if all values are finite
 //$COPY_TO HFILE START --------------------------------------------------
 #define HFPP_FUNC_NAME hIsFinite
@@ -6262,3 +6808,359 @@ void HFPP_FUNC_NAME (const NIter vec0, const NIter vec0_end,
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+
+
+// ========================================================================
+//
+//  Fused expressions
+//
+// ========================================================================
+
+namespace {
+
+  //! Contiguous real or complex vector taking part in a fused expression
+  struct hFusedOperand {
+    HNumber* rdata;
+    HComplex* cdata;
+    HInteger size;
+  };
+
+  //! Get the data of a float or complex hArray (slice) or vector
+  bool hFusedExtract(boost::python::object obj, hFusedOperand& op)
+  {
+    op.rdata = NULL;
+    op.cdata = NULL;
+    op.size = 0;
+
+    boost::python::extract<hArray<HNumber>&> rarray(obj);
+    boost::python::extract<hArray<HComplex>&> carray(obj);
+    boost::python::extract<std::vector<HNumber>&> rvector(obj);
+    boost::python::extract<std::vector<HComplex>&> cvector(obj);
+
+    if (rarray.check())
+    {
+      hArray<HNumber>& a = rarray();
+      op.size = a.end() - a.begin();
+      if (op.size > 0) op.rdata = &(*a.begin());
+    }
+    else if (carray.check())
+    {
+      hArray<HComplex>& a = carray();
+      op.size = a.end() - a.begin();
+      if (op.size > 0) op.cdata = &(*a.begin());
+    }
+    else if (rvector.check())
+    {
+      std::vector<HNumber>& v = rvector();
+      op.size = v.size();
+      if (op.size > 0) op.rdata = &v[0];
+    }
+    else if (cvector.check())
+    {
+      std::vector<HComplex>& v = cvector();
+      op.size = v.size();
+      if (op.size > 0) op.cdata = &v[0];
+    }
+    else
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+  template <class T> inline T hFusedFromComplex(const HComplex& x);
+  template <> inline HNumber hFusedFromComplex<HNumber>(const HComplex& x) { return real(x); }
+  template <> inline HComplex hFusedFromComplex<HComplex>(const HComplex& x) { return x; }
+
+  inline void hFusedStore(HNumber& out, const HNumber x) { out = x; }
+  inline void hFusedStore(HNumber& out, const HComplex& x) { out = real(x); }
+  inline void hFusedStore(HComplex& out, const HNumber x) { out = x; }
+  inline void hFusedStore(HComplex& out, const HComplex& x) { out = x; }
+
+  // Elementary functions for real and complex registers, a complex
+  // register holding a real valued result has zero imaginary part
+  inline HNumber hFusedAbs(const HNumber x) { return fabs(x); }
+  inline HComplex hFusedAbs(const HComplex& x) { return abs(x); }
+  inline HNumber hFusedAbsSquare(const HNumber x) { return x * x; }
+  inline HComplex hFusedAbsSquare(const HComplex& x) { return norm(x); }
+  inline HNumber hFusedConj(const HNumber x) { return x; }
+  inline HComplex hFusedConj(const HComplex& x) { return conj(x); }
+  inline HNumber hFusedReal(const HNumber x) { return x; }
+  inline HComplex hFusedReal(const HComplex& x) { return real(x); }
+  inline HNumber hFusedImag(const HNumber) { return 0.0; }
+  inline HComplex hFusedImag(const HComplex& x) { return imag(x); }
+  inline HNumber hFusedArg(const HNumber x) { return (x < 0) ? M_PI : 0.0; }
+  inline HComplex hFusedArg(const HComplex& x) { return arg(x); }
+
+  /*!
+    \brief Evaluate a validated stack program block by block.
+
+    Registers of type ``T`` hold ``FUSED_BLOCK_SIZE`` elements each, so
+    every operation is a short loop over contiguous memory that stays in
+    cache and that the compiler can vectorize. Blocks are independent
+    and are distributed over threads for long outputs.
+  */
+  template <class T, class S>
+  void hFusedEvaluateBlocked(S* out, const HInteger n,
+                             const std::vector<HInteger>& program,
+                             const std::vector<hFusedOperand>& operands,
+                             const std::vector<HComplex>& constants,
+                             const HInteger depth)
+  {
+    const HInteger nblocks = (n + FUSED_BLOCK_SIZE - 1) / FUSED_BLOCK_SIZE;
+    const HInteger nprogram = program.size();
+
+#ifdef _OPENMP
+#pragma omp parallel if (n >= FUSED_PARALLEL_THRESHOLD)
+#endif
+    {
+      std::vector<T> stack(depth * FUSED_BLOCK_SIZE);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (HInteger b = 0; b < nblocks; ++b)
+      {
+        const HInteger start = b * FUSED_BLOCK_SIZE;
+        const HInteger len = hfmin(n - start, (HInteger)FUSED_BLOCK_SIZE);
+        HInteger sp = 0;
+
+        for (HInteger pc = 0; pc < nprogram; ++pc)
+        {
+          const HInteger op = program[pc];
+
+          if (op == FUSED_LOAD || op == FUSED_CONST)
+          {
+            T* r = &stack[sp * FUSED_BLOCK_SIZE];
+
+            if (op == FUSED_CONST)
+            {
+              const T c = hFusedFromComplex<T>(constants[program[++pc]]);
+              for (HInteger i = 0; i < len; ++i) r[i] = c;
+            }
+            else
+            {
+              const hFusedOperand& o = operands[program[++pc]];
+
+              if (o.size == 1)
+              {
+                const T c = o.rdata ? T(o.rdata[0]) : hFusedFromComplex<T>(o.cdata[0]);
+                for (HInteger i = 0; i < len; ++i) r[i] = c;
+              }
+              else if (o.rdata)
+              {
+                const HNumber* p = o.rdata + start;
+                for (HInteger i = 0; i < len; ++i) r[i] = p[i];
+              }
+              else
+              {
+                const HComplex* p = o.cdata + start;
+                for (HInteger i = 0; i < len; ++i) r[i] = hFusedFromComplex<T>(p[i]);
+              }
+            }
+
+            ++sp;
+          }
+          else if (op <= FUSED_DIV)
+          {
+            T* x = &stack[(sp - 2) * FUSED_BLOCK_SIZE];
+            const T* y = &stack[(sp - 1) * FUSED_BLOCK_SIZE];
+
+            switch (op)
+            {
+            case FUSED_ADD: for (HInteger i = 0; i < len; ++i) x[i] += y[i]; break;
+            case FUSED_SUB: for (HInteger i = 0; i < len; ++i) x[i] -= y[i]; break;
+            case FUSED_MUL: for (HInteger i = 0; i < len; ++i) x[i] *= y[i]; break;
+            case FUSED_DIV: for (HInteger i = 0; i < len; ++i) x[i] /= y[i]; break;
+            }
+
+            --sp;
+          }
+          else
+          {
+            T* x = &stack[(sp - 1) * FUSED_BLOCK_SIZE];
+
+            switch (op)
+            {
+            case FUSED_NEG: for (HInteger i = 0; i < len; ++i) x[i] = -x[i]; break;
+            case FUSED_ABS: for (HInteger i = 0; i < len; ++i) x[i] = hFusedAbs(x[i]); break;
+            case FUSED_SQUARE: for (HInteger i = 0; i < len; ++i) x[i] *= x[i]; break;
+            case FUSED_ABSSQUARE: for (HInteger i = 0; i < len; ++i) x[i] = hFusedAbsSquare(x[i]); break;
+            case FUSED_SQRT: for (HInteger i = 0; i < len; ++i) x[i] = sqrt(x[i]); break;
+            case FUSED_EXP: for (HInteger i = 0; i < len; ++i) x[i] = exp(x[i]); break;
+            case FUSED_LOG: for (HInteger i = 0; i < len; ++i) x[i] = log(x[i]); break;
+            case FUSED_CONJ: for (HInteger i = 0; i < len; ++i) x[i] = hFusedConj(x[i]); break;
+            case FUSED_REAL: for (HInteger i = 0; i < len; ++i) x[i] = hFusedReal(x[i]); break;
+            case FUSED_IMAG: for (HInteger i = 0; i < len; ++i) x[i] = hFusedImag(x[i]); break;
+            case FUSED_ARG: for (HInteger i = 0; i < len; ++i) x[i] = hFusedArg(x[i]); break;
+            }
+          }
+        }
+
+        S* o = out + start;
+        for (HInteger i = 0; i < len; ++i) hFusedStore(o[i], stack[i]);
+      }
+    }
+  }
+
+}
+
+/*!
+  \brief Evaluate an element-wise expression over hArrays in a single pass.
+
+  \param out       Float or complex ``hArray`` (or vector) receiving the result.
+  \param program   Stack program as a list of ``hFUSEDOP`` opcodes, where
+                   ``FUSED_LOAD`` and ``FUSED_CONST`` are followed by the
+                   index into ``operands`` and ``constants`` respectively.
+  \param operands  List of float or complex ``hArray``s (or vectors), each of
+                   the length of ``out`` or of length one.
+  \param constants List of (complex) scalars.
+
+  Description:
+  A chain of element-wise operations such as ``hMul``, ``hAdd``,
+  ``hSquareAdd`` or ``hAbsSquareAdd`` reads and writes each intermediate
+  vector from memory. Here the whole expression is evaluated for a block
+  of ``FUSED_BLOCK_SIZE`` elements at a time, so intermediate results never
+  leave the cache and no temporary arrays are allocated.
+
+  Registers are real if all operands and constants are real and complex
+  otherwise. The output may be one of the operands (e.g. for ``a += b*c``),
+  but should not overlap with any operand in a different way.
+
+  The program is normally built by the ``hFusedExpression`` class of the
+  Python interface rather than by hand.
+
+  Example:
+  >>> x = hFused(a); y = hFused(b)
+  >>> (x * y + abs(x) ** 2).evaluate(out)
+*/
+void hFusedEvaluate(boost::python::object out, boost::python::list program, boost::python::list operands, boost::python::list constants)
+{
+  hFusedOperand result;
+
+  if (!hFusedExtract(out, result))
+  {
+    throw PyCR::TypeError("[hFusedEvaluate] output must be a float or complex hArray.");
+  }
+
+  const HInteger n = result.size;
+
+  // Collect program, operands and constants
+  std::vector<HInteger> prog(boost::python::len(program));
+  for (HInteger i = 0; i < (HInteger)prog.size(); ++i)
+  {
+    prog[i] = boost::python::extract<HInteger>(program[i]);
+  }
+
+  std::vector<hFusedOperand> ops(boost::python::len(operands));
+  for (HInteger i = 0; i < (HInteger)ops.size(); ++i)
+  {
+    if (!hFusedExtract(operands[i], ops[i]))
+    {
+      throw PyCR::TypeError("[hFusedEvaluate] operands must be float or complex hArrays.");
+    }
+    if (ops[i].size != n && ops[i].size != 1)
+    {
+      throw PyCR::ValueError("[hFusedEvaluate] operands must have the length of the output or length one.");
+    }
+  }
+
+  std::vector<HComplex> consts(boost::python::len(constants));
+  for (HInteger i = 0; i < (HInteger)consts.size(); ++i)
+  {
+    consts[i] = boost::python::extract<HComplex>(constants[i]);
+  }
+
+  // Validate the program and determine stack depth and register type
+  std::vector<bool> iscomplex;
+  HInteger depth = 0;
+  bool complexmode = false;
+
+  for (HInteger pc = 0; pc < (HInteger)prog.size(); ++pc)
+  {
+    const HInteger op = prog[pc];
+
+    if (op == FUSED_LOAD || op == FUSED_CONST)
+    {
+      if (pc + 1 >= (HInteger)prog.size())
+      {
+        throw PyCR::ValueError("[hFusedEvaluate] program ends with a load without index.");
+      }
+
+      const HInteger index = prog[++pc];
+      bool c = false;
+
+      if (op == FUSED_LOAD)
+      {
+        if (index < 0 || index >= (HInteger)ops.size())
+        {
+          throw PyCR::ValueError("[hFusedEvaluate] operand index out of range.");
+        }
+        c = (ops[index].cdata != NULL);
+      }
+      else
+      {
+        if (index < 0 || index >= (HInteger)consts.size())
+        {
+          throw PyCR::ValueError("[hFusedEvaluate] constant index out of range.");
+        }
+        c = (imag(consts[index]) != 0);
+      }
+
+      iscomplex.push_back(c);
+      complexmode = complexmode || c;
+      depth = hfmax(depth, (HInteger)iscomplex.size());
+    }
+    else if (op >= FUSED_ADD && op <= FUSED_DIV)
+    {
+      if (iscomplex.size() < 2)
+      {
+        throw PyCR::ValueError("[hFusedEvaluate] binary operation on a stack with less than two values.");
+      }
+
+      const bool c = iscomplex.back();
+      iscomplex.pop_back();
+      iscomplex.back() = iscomplex.back() || c;
+    }
+    else if (op >= FUSED_NEG && op <= FUSED_ARG)
+    {
+      if (iscomplex.empty())
+      {
+        throw PyCR::ValueError("[hFusedEvaluate] unary operation on an empty stack.");
+      }
+
+      if (op == FUSED_ABS || op == FUSED_ABSSQUARE || op == FUSED_REAL || op == FUSED_IMAG || op == FUSED_ARG)
+      {
+        iscomplex.back() = false;
+      }
+    }
+    else
+    {
+      throw PyCR::ValueError("[hFusedEvaluate] unknown opcode.");
+    }
+  }
+
+  if (iscomplex.size() != 1)
+  {
+    throw PyCR::ValueError("[hFusedEvaluate] program must leave exactly one value on the stack.");
+  }
+
+  if (iscomplex.back() && result.rdata)
+  {
+    throw PyCR::TypeError("[hFusedEvaluate] complex valued expression cannot be stored in a float array.");
+  }
+
+  if (n == 0) return;
+
+  if (complexmode)
+  {
+    if (result.cdata) hFusedEvaluateBlocked<HComplex>(result.cdata, n, prog, ops, consts, depth);
+    else hFusedEvaluateBlocked<HComplex>(result.rdata, n, prog, ops, consts, depth);
+  }
+  else
+  {
+    if (result.cdata) hFusedEvaluateBlocked<HNumber>(result.cdata, n, prog, ops, consts, depth);
+    else hFusedEvaluateBlocked<HNumber>(result.rdata, n, prog, ops, consts, depth);
+  }
+}
@@ -26,6 +26,8 @@
 #include "mArray.h"
 #include "mModule.h"
 
+#include <algorithm>
+
 #include <boost/math/special_functions/fpclassify.hpp>
 
 // ========================================================================
@@ -63,6 +65,144 @@ template <class T,class S>
 template <class T,class S>
   inline bool OutsideOrEqual(T x, S lower, S upper) {return ((hfcast<S>(x) <= lower) || (hfcast<S>(x) >= upper));}
 
+//========================================================================
+//                           Robust statistics
+//========================================================================
+
+/*!
+  \brief Sorted copy of the values in a sliding window.
+
+  Values enter and leave the window in stream order. Their position in
+  the sorted buffer is found by binary search in O(log w), but inserting
+  or erasing it shifts the values behind it by a single block move, so
+  each update costs O(w). For the window lengths used in practice (up to
+  a few thousand samples) this move is cheaper than maintaining a tree;
+  much longer windows would need an order statistics structure instead.
+  The median is available in O(1) and the median absolute deviation
+  (MAD) is found by a selection over the two sorted runs on either side
+  of the median in O(log w).
+
+  As for ``hSortMedian`` the median of ``n`` values is the element at
+  position ``n/2`` of the sorted values.
+*/
+template <class T>
+class hSortedWindow {
+
+  std::vector<T> sorted;
+
+public:
+
+  hSortedWindow (const HInteger capacity) { sorted.reserve(capacity); };
+
+  void insert (const T& x) { sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), x), x); };
+
+  void erase (const T& x) { sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), x)); };
+
+  HInteger size () const { return sorted.size(); };
+
+  T median () const { return sorted[sorted.size() / 2]; };
+
+  HNumber mad () const;
+};
+
+template <class T>
+HNumber hSortedWindow<T>::mad () const
+{
+  const HInteger n = sorted.size();
+
+  if (n == 0) return 0.0;
+
+  const HNumber m = hfcast<HNumber>(median());
+
+  // Distances below (a) and above (b) the median, each in increasing order
+  const HInteger na = std::upper_bound(sorted.begin(), sorted.end(), median()) - sorted.begin();
+  const HInteger nb = n - na;
+
+#define HSORTEDWINDOW_A(i) (m - hfcast<HNumber>(sorted[na - 1 - (i)]))
+#define HSORTEDWINDOW_B(j) (hfcast<HNumber>(sorted[na + (j)]) - m)
+
+  // Take i values from a and need - i from b such that they are the need smallest
+  const HInteger need = n / 2 + 1;
+  HInteger lo = std::max<HInteger>(0, need - nb);
+  HInteger hi = std::min<HInteger>(need, na);
+
+  while (lo <= hi)
+  {
+    const HInteger i = (lo + hi) / 2;
+    const HInteger j = need - i;
+
+    if (i < na && j > 0 && HSORTEDWINDOW_B(j - 1) > HSORTEDWINDOW_A(i))
+    {
+      lo = i + 1;
+    }
+    else if (i > 0 && j < nb && HSORTEDWINDOW_A(i - 1) > HSORTEDWINDOW_B(j))
+    {
+      hi = i - 1;
+    }
+    else
+    {
+      if (i == 0) return HSORTEDWINDOW_B(j - 1);
+      if (j == 0) return HSORTEDWINDOW_A(i - 1);
+      return std::max(HSORTEDWINDOW_A(i - 1), HSORTEDWINDOW_B(j - 1));
+    }
+  }
+
+#undef HSORTEDWINDOW_A
+#undef HSORTEDWINDOW_B
+
+  return 0.0;
+}
+
+/*!
+  \brief Single pass mean and standard deviation (Welford's algorithm).
+
+  The standard deviation is normalized by ``n-1`` as in ``hStdDev``.
+*/
+template <class Iter>
+void hWelfordMeanStdDev (const Iter vec, const Iter vec_end, HNumber& mean, HNumber& stddev)
+{
+  HNumber m2 = 0.0;
+  HInteger n = 0;
+
+  mean = 0.0;
+
+  for (Iter it = vec; it != vec_end; ++it)
+  {
+    const HNumber x = hfcast<HNumber>(*it);
+    const HNumber delta = x - mean;
+
+    ++n;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+  }
+
+  stddev = (n > 1) ? sqrt(m2 / (n - 1)) : sqrt(m2);
+}
+
+//========================================================================
+//                           Fused expressions
+//========================================================================
+
+/*!
+  \brief Opcodes of the stack programs evaluated by ``hFusedEvaluate``.
+
+  ``FUSED_LOAD`` and ``FUSED_CONST`` are followed by the index of the
+  operand or constant to push, all other opcodes act on the top of the
+  stack.
+*/
+enum hFUSEDOP {FUSED_LOAD, FUSED_CONST,
+               FUSED_ADD, FUSED_SUB, FUSED_MUL, FUSED_DIV,
+               FUSED_NEG, FUSED_ABS, FUSED_SQUARE, FUSED_ABSSQUARE, FUSED_SQRT,
+               FUSED_EXP, FUSED_LOG, FUSED_CONJ, FUSED_REAL, FUSED_IMAG, FUSED_ARG};
+
+//! Number of elements evaluated per block, chosen such that the stack stays in L1 cache
+#define FUSED_BLOCK_SIZE 256
+
+//! Minimum output length for which blocks are distributed over threads
+#define FUSED_PARALLEL_THRESHOLD 32768
+
+extern void hFusedEvaluate(boost::python::object out, boost::python::list program, boost::python::list operands, boost::python::list constants);
+
 extern vector<HNumber> hWeights(const HInteger wlen, const hWEIGHTS wtype);
 
 extern HNumber hPhase(const HNumber frequency, const HNumber time);
@@ -44,6 +44,8 @@
 #include <measures/Measures/MeasConvert.h>
 #include <measures/Measures/MPosition.h>
 #include <measures/Measures/MCPosition.h>
+#include <casa/Arrays/ArrayMath.h>
+#include <casa/Arrays/ArrayLogical.h>
 
 #include "core.h"
 #include "mTBB.h"
@@ -69,12 +71,16 @@ using namespace std;
   \param filename -- Name of the file from which to read in the data
 */
 TBBData::TBBData (std::string const &filename)
-  : DAL1::TBB_Timeseries (filename, DAL1::IO_Mode::ReadOnly)
+  : DAL1::TBB_Timeseries (filename, DAL1::IO_Mode::ReadOnly),
+    prefetch_enabled(false),
+    prefetch_valid(false),
+    prefetch_nofSamples(0)
 {
 }
 
 TBBData::~TBBData ()
 {
+  cancelPrefetch();
 }
 
 int TBBData::version ()
@@ -87,10 +93,112 @@ int TBBData::version ()
   return v;
 }
 
+//__________________________________________________________________________
+//                                                        Streaming read-out
+
+/*!
+  \param out -- Output buffer of ``nofSamples`` times the number of selected
+                dipoles, filled dipole by dipole
+  \param start -- Start sample for each of the selected dipoles
+  \param nofSamples -- Number of samples to read per dipole
+
+  The data is read straight into ``out``. With prefetching enabled the
+  block following the requested one, i.e. starting at ``start +
+  nofSamples`` for every dipole, is read on a background thread. If that
+  block is requested next it is served from memory, any other request
+  is read directly as before.
+*/
+void TBBData::readTimeseries(double* out, const casa::Vector<int>& start, const int nofSamples)
+{
+  // Wait for the block being prefetched
+  if (prefetch_thread.joinable())
+  {
+    prefetch_thread.join();
+  }
+
+  // Held until the next prefetch is started, which then waits for it
+  boost::mutex::scoped_lock lock(io_mutex);
+
+  const int nofDipoles = nofSelectedDatasets();
+
+  const bool hit = prefetch_valid
+    && prefetch_nofSamples == nofSamples
+    && prefetch_start.nelements() == start.nelements()
+    && static_cast<int>(prefetch_buffer.ncolumn()) == nofDipoles
+    && allEQ(prefetch_start, start);
+
+  if (hit)
+  {
+    memcpy(out, prefetch_buffer.data(), sizeof(double) * nofSamples * nofDipoles);
+  }
+  else
+  {
+    // Matrix sharing memory with the output buffer
+    casa::Matrix<double> temp(casa::IPosition(2, nofSamples, nofDipoles), out, casa::SHARE);
+
+    readData(temp, start, nofSamples);
+  }
+
+  prefetch_valid = false;
+
+  if (prefetch_enabled)
+  {
+    prefetch_start.resize(start.nelements());
+    prefetch_start = start + nofSamples;
+    prefetch_nofSamples = nofSamples;
+    prefetch_buffer.resize(nofSamples, nofDipoles);
+
+    prefetch_thread = boost::thread(&TBBData::prefetchBlock, this);
+  }
+}
+
+//! Body of the prefetch thread
+void TBBData::prefetchBlock()
+{
+  boost::mutex::scoped_lock lock(io_mutex);
+
+  try
+  {
+    readData(prefetch_buffer, prefetch_start, prefetch_nofSamples);
+    prefetch_valid = true;
+  }
+  catch (...)
+  {
+    // E.g. reading beyond the end of the file, a direct read will report it
+    prefetch_valid = false;
+  }
+}
+
+//! Wait for a running prefetch and discard its result
+void TBBData::cancelPrefetch()
+{
+  if (prefetch_thread.joinable())
+  {
+    prefetch_thread.join();
+  }
+
+  prefetch_valid = false;
+}
+
+/*!
+  \param enable -- Read the next block in the background after each read
+*/
+void TBBData::setPrefetch(bool enable)
+{
+  if (!enable)
+  {
+    cancelPrefetch();
+  }
+
+  prefetch_enabled = enable;
+}
+
 //__________________________________________________________________________
 //                                                   Python access functions
 boost::python::list TBBData::python_dipoleNames()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<std::string> names = dipoleNames();
@@ -105,6 +213,8 @@ boost::python::list TBBData::python_dipoleNames()
 
 boost::python::list TBBData::python_selectedDipoles()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::set<std::string> dipoles = selectedDipoles();
@@ -119,6 +229,9 @@ boost::python::list TBBData::python_selectedDipoles()
 
 bool TBBData::python_selectDipoles(boost::python::list names)
 {
+  // A prefetched block belongs to the old selection
+  cancelPrefetch();
+
   std::set<std::string> selection;
 
   const int N = boost::python::extract<int>(names.attr("__len__")());
@@ -128,11 +241,24 @@ bool TBBData::python_selectDipoles(boost::python::list names)
     selection.insert(boost::python::extract<std::string>(names[i]));
   }
 
+  boost::mutex::scoped_lock lock(io_mutex);
+
   return selectDipoles(selection);
 }
 
+void TBBData::python_selectAllDipoles()
+{
+  cancelPrefetch();
+
+  boost::mutex::scoped_lock lock(io_mutex);
+
+  selectAllDipoles();
+}
+
 boost::python::list TBBData::python_time()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<uint> vec = time();
@@ -170,6 +296,8 @@ int TBBData::sample_number_correction()
 
 boost::python::list TBBData::python_sample_number()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   const int correction = sample_number_correction();
 
   boost::python::list lst;
@@ -186,6 +314,8 @@ boost::python::list TBBData::python_sample_number()
 
 boost::python::list TBBData::python_data_length()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<uint> vec = data_length();
@@ -198,9 +328,66 @@ boost::python::list TBBData::python_data_length()
   return lst;
 }
 
+#ifdef PYCRTOOLS_WITH_NUMPY
+ndarray TBBData::numpy_time()
+{
+  boost::mutex::scoped_lock lock(io_mutex);
+
+  std::vector<uint> vec = time();
+
+  ndarray arr = num_util::makeNum(vec.size(), NPY_INT64);
+  int64_t* it = numpyBeginPtr<int64_t>(arr);
+
+  for (uint i=0; i<vec.size(); ++i)
+  {
+    it[i] = vec[i];
+  }
+
+  return arr;
+}
+
+ndarray TBBData::numpy_sample_number()
+{
+  boost::mutex::scoped_lock lock(io_mutex);
+
+  const int correction = sample_number_correction();
+
+  std::vector<uint> vec = sample_number();
+
+  ndarray arr = num_util::makeNum(vec.size(), NPY_INT64);
+  int64_t* it = numpyBeginPtr<int64_t>(arr);
+
+  for (uint i=0; i<vec.size(); ++i)
+  {
+    it[i] = static_cast<int64_t>(vec[i]) + correction;
+  }
+
+  return arr;
+}
+
+ndarray TBBData::numpy_data_length()
+{
+  boost::mutex::scoped_lock lock(io_mutex);
+
+  std::vector<uint> vec = data_length();
+
+  ndarray arr = num_util::makeNum(vec.size(), NPY_INT64);
+  int64_t* it = numpyBeginPtr<int64_t>(arr);
+
+  for (uint i=0; i<vec.size(); ++i)
+  {
+    it[i] = vec[i];
+  }
+
+  return arr;
+}
+#endif /* PYCRTOOLS_WITH_NUMPY */
+
 #if TBB_TIMESERIES_VERSION > 0
 boost::python::list TBBData::python_dipole_calibration_delay()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<double> vec = dipole_calibration_delay();
@@ -215,6 +402,8 @@ boost::python::list TBBData::python_dipole_calibration_delay()
 
 boost::python::list TBBData::python_dipole_calibration_delay_unit()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<std::string> vec = dipole_calibration_delay_unit();
@@ -230,6 +419,8 @@ boost::python::list TBBData::python_dipole_calibration_delay_unit()
 
 boost::python::list TBBData::python_cable_delay()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<double> vec = cable_delay();
@@ -244,6 +435,8 @@ boost::python::list TBBData::python_cable_delay()
 
 boost::python::list TBBData::python_cable_delay_unit()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<std::string> vec = cable_delay_unit();
@@ -258,6 +451,8 @@ boost::python::list TBBData::python_cable_delay_unit()
 
 boost::python::list TBBData::python_sample_frequency_value()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<double> vec = sample_frequency_value();
@@ -272,6 +467,8 @@ boost::python::list TBBData::python_sample_frequency_value()
 
 boost::python::list TBBData::python_sample_frequency_unit()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector< std::string > vec = sample_frequency_unit();
@@ -286,6 +483,8 @@ boost::python::list TBBData::python_sample_frequency_unit()
 
 boost::python::list TBBData::python_sample_offset(int refAntenna)
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<int> vec = sample_offset(static_cast<uint>(refAntenna));
@@ -302,6 +501,8 @@ boost::python::list TBBData::python_sample_offset(int refAntenna)
 // readData which expects positive offset. This needs to be corrected.
 boost::python::list TBBData::python_alignment_offset(int refAntenna)
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<int> vec = sample_offset(static_cast<uint>(refAntenna));
@@ -316,6 +517,8 @@ boost::python::list TBBData::python_alignment_offset(int refAntenna)
 
 boost::python::list TBBData::python_antenna_position()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   // Get antenna positions
@@ -339,6 +542,8 @@ boost::python::list TBBData::python_antenna_position()
  */
 boost::python::list TBBData::python_antenna_position_itrf()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   // Get antenna positions
@@ -362,6 +567,8 @@ boost::python::list TBBData::python_antenna_position_itrf()
 // WARNING Non trivial method needs to be migrated to parent class
 uint TBBData::python_maximum_read_length(int refAntenna)
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   std::vector<uint> length = data_length();
   std::vector<int> offset = sample_offset(refAntenna);
 
@@ -381,6 +588,11 @@ uint TBBData::python_maximum_read_length(int refAntenna)
 // WARNING Non trivial method needs to be migrated to parrent class
 int TBBData::python_alignment_reference_antenna()
 {
+  // The selection is changed below, the prefetch thread must not read meanwhile
+  cancelPrefetch();
+
+  boost::mutex::scoped_lock lock(io_mutex);
+
   // Store current antenna selection
   std::set<std::string> selection = selectedDipoles();
 
@@ -424,6 +636,8 @@ int TBBData::python_alignment_reference_antenna()
 
 boost::python::list TBBData::python_channelID()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<int> vec = channelID();
@@ -438,6 +652,8 @@ boost::python::list TBBData::python_channelID()
 
 boost::python::list TBBData::python_nyquist_zone()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   std::vector<uint> vec = nyquist_zone();
@@ -452,54 +668,72 @@ boost::python::list TBBData::python_nyquist_zone()
 
 std::string TBBData::python_antenna_set()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.antennaSet();
 }
 
 std::string TBBData::python_filetype()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.filetype();
 }
 
 std::string TBBData::python_filedate()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.filedate();
 }
 
 std::string TBBData::python_telescope()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.telescope();
 }
 
 std::string TBBData::python_observer()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.observer();
 }
 
 double TBBData::python_clockFrequency()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.clockFrequency();
 }
 
 std::string TBBData::python_clockFrequencyUnit()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.clockFrequencyUnit();
 }
 
 std::string TBBData::python_filterSelection()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.filterSelection();
 }
 
 std::string TBBData::python_target()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
 
   DAL1::CommonAttributes c = commonAttributes();
   return c.target();
@@ -507,108 +741,144 @@ std::string TBBData::python_target()
 
 std::string TBBData::python_systemVersion()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.systemVersion();
 }
 
 std::string TBBData::python_pipelineName()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.pipelineName();
 }
 
 std::string TBBData::python_pipelineVersion()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.pipelineVersion();
 }
 
 std::string TBBData::python_notes()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.notes();
 }
 
 std::string TBBData::python_projectID()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.projectID();
 }
 
 std::string TBBData::python_projectTitle()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.projectTitle();
 }
 
 std::string TBBData::python_projectPI()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.projectPI();
 }
 
 std::string TBBData::python_projectCoI()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.projectCoI();
 }
 
 std::string TBBData::python_projectContact()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.projectContact();
 }
 
 std::string TBBData::python_observationID()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.observationID();
 }
 
 std::string TBBData::python_startMJD()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.startMJD();
 }
 
 std::string TBBData::python_startTAI()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.startTAI();
 }
 
 std::string TBBData::python_startUTC()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.startUTC();
 }
 
 std::string TBBData::python_endMJD()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.endMJD();
 }
 
 std::string TBBData::python_endTAI()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.endTAI();
 }
 
 std::string TBBData::python_endUTC()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.endUTC();
 }
 
 int TBBData::python_nofStations()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.nofStations();
 }
 
 boost::python::list TBBData::python_stationList()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   boost::python::list lst;
 
   DAL1::CommonAttributes c = commonAttributes();
@@ -624,30 +894,40 @@ boost::python::list TBBData::python_stationList()
 
 double TBBData::python_frequencyMin()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.frequencyMin();
 }
 
 double TBBData::python_frequencyMax()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.frequencyMax();
 }
 
 double TBBData::python_frequencyCenter()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.frequencyCenter();
 }
 
 std::string TBBData::python_frequencyUnit()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   DAL1::CommonAttributes c = commonAttributes();
   return c.frequencyUnit();
 }
 
 std::string TBBData::python_summary()
 {
+  boost::mutex::scoped_lock lock(io_mutex);
+
   std::ostringstream os;
 
   summary(os);
@@ -680,6 +960,20 @@ std::ostream& operator<<(std::ostream& output, const TBBData& d)
 /*!
   \brief $DOCSTRING
   $PARDOCSTRING
+
+  The data is read straight into the output vector. When prefetching is
+  enabled with ``data.setPrefetch(True)`` the following block
+  (``start + nofSamples``) is read on a background thread, so reading
+  consecutive blocks overlaps file access with processing.
+
+  Example:
+  >>> f = cr.TBBData(filename)
+  >>> f.setPrefetch(True)
+  >>> data = cr.hArray(float, [f.nofSelectedDatasets(), blocksize])
+  >>> start = cr.hArray(int, f.nofSelectedDatasets(), fill=0)
+  >>> for block in range(nblocks):
+  ...     cr.hReadTimeseriesData(data, start, blocksize, f)
+  ...     start += blocksize
 */
 template <class Iter, class IIter>
 void HFPP_FUNC_NAME(const Iter vec_begin, const Iter vec_end, const IIter start_begin, const IIter start_end, const HInteger nofSamples, TBBData &data)
@@ -709,16 +1003,64 @@ void HFPP_FUNC_NAME(const Iter vec_begin, const Iter vec_end, const IIter start_
     ++start_it;
   }
 
-  // Set shape of temp array
-  casa::IPosition vec_shape(2);
-  vec_shape(0) = nofSamples;
-  vec_shape(1) = data.nofSelectedDatasets();
+  // Read data straight into the output vector
+  data.readTimeseries(&(*vec_begin), start, nofSamples);
+}
+//$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
+
+#ifdef PYCRTOOLS_WITH_NUMPY
+
+//$DOCSTRING: Read data into a numpy array
+//$COPY_TO HFILE START --------------------------------------------------
+#define HFPP_FUNC_NAME hReadTimeseriesData
+//-----------------------------------------------------------------------
+#define HFPP_FUNCDEF  (HFPP_VOID)(HFPP_FUNC_NAME)("$DOCSTRING")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_FUNC_MASTER_ARRAY_PARAMETER 1 // Use the second parameter as the master array for looping and history informations
+#define HFPP_PARDEF_0 (ndarray)(out)()("Contiguous numpy array of type float64 with :math:`N_a * N_s` elements, e.g. of shape :math:`(N_a, N_s)`.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_1 (HInteger)(start)()("Vector with start positions in samples, expected to have length :math:`N_a` where :math:`N_a` is the number of selected antennas.")(HFPP_PAR_IS_VECTOR)(STDIT)(HFPP_PASS_AS_REFERENCE)
+#define HFPP_PARDEF_2 (HInteger)(nofSamples)()("Number of samples, :math:`N_s`, to read.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_VALUE)
+#define HFPP_PARDEF_3 (TBBData)(data)()("TBBData object to read from.")(HFPP_PAR_IS_SCALAR)()(HFPP_PASS_AS_REFERENCE)
+//$COPY_TO END --------------------------------------------------
+/*!
+  \brief $DOCSTRING
+  $PARDOCSTRING
+
+  Same as the ``hArray`` version, the data is read without intermediate
+  copies into the memory of the numpy array.
+*/
+template <class IIter>
+void HFPP_FUNC_NAME(ndarray out, const IIter start_begin, const IIter start_end, const HInteger nofSamples, TBBData &data)
+{
+  // Sanity checks
+  num_util::check_type(out, NPY_DOUBLE);
+
+  const uint N_out = num_util::size(out);
+
+  if (N_out != nofSamples*data.nofSelectedDatasets())
+  {
+    throw PyCR::ValueError("Data array has wrong size.");
+  }
+
+  const uint N_start = std::distance(start_begin, start_end);
+
+  if (N_start != data.nofSelectedDatasets())
+  {
+    throw PyCR::ValueError("Array with start samples has wrong size.");
+  }
+
+  // Get start numbers into casa vector
+  IIter start_it = start_begin;
 
-  // Create temporary casa matrix sharing memory with the output vector
-  casa::Matrix<double> temp(vec_shape, &(*vec_begin), casa::SHARE);
+  casa::Vector<int> start(N_start);
+  for (uint i=0; i<N_start; ++i)
+  {
+    start(i) = static_cast<int>(*start_it);
+    ++start_it;
+  }
 
-  // Read data into matrix and hence to the output vector
-  data.readData(temp, start, nofSamples);
+  // Read data straight into the numpy array
+  data.readTimeseries(numpyBeginPtr<double>(out), start, nofSamples);
 }
 //$COPY_TO HFILE: #include "hfppnew-generatewrappers.def"
 
+#endif /* PYCRTOOLS_WITH_NUMPY */
@@ -26,6 +26,9 @@
 #include "mArray.h"
 #include "mModule.h"
 
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
 /* DAL1 header files */
 #include <data_hl/TBB_Timeseries.h>
 
@@ -34,6 +37,21 @@ class TBBData : public DAL1::TBB_Timeseries {
 private:
   int sample_number_correction();
 
+  //! Serializes access to the file between the caller and the prefetch thread
+  boost::mutex io_mutex;
+
+  //! Read the block following each read on a background thread
+  bool prefetch_enabled;
+  boost::thread prefetch_thread;
+  bool prefetch_valid;
+  casa::Vector<int> prefetch_start;
+  int prefetch_nofSamples;
+  casa::Matrix<double> prefetch_buffer;
+
+  void prefetchBlock();
+
+  void cancelPrefetch();
+
 public:
 
   // === Construction ======================================================
@@ -51,6 +69,13 @@ public:
   // === Methods ===========================================================
   int version ();
 
+  //! Read ``nofSamples`` samples per selected dipole into ``out``
+  void readTimeseries(double* out, const casa::Vector<int>& start, const int nofSamples);
+
+  void setPrefetch(bool enable);
+
+  bool prefetch() const { return prefetch_enabled; };
+
   // === Python specific methods ===========================================
   boost::python::list python_dipoleNames();
 
@@ -58,12 +83,22 @@ public:
 
   bool python_selectDipoles(boost::python::list);
 
+  void python_selectAllDipoles();
+
   boost::python::list python_time();
 
   boost::python::list python_sample_number();
 
   boost::python::list python_data_length();
 
+#ifdef PYCRTOOLS_WITH_NUMPY
+  ndarray numpy_time();
+
+  ndarray numpy_sample_number();
+
+  ndarray numpy_data_length();
+#endif /* PYCRTOOLS_WITH_NUMPY */
+
 #if TBB_TIMESERIES_VERSION > 0
   boost::python::list python_dipole_calibration_delay();
 
@@ -14,9 +14,14 @@ from harray import *
 from plot import *
 from math import *
 from utils import *
+from fused import *
 
 # Import structure modules
 from workspaces import *
 
-# Some initialization on the C++ side
+# Some initialization on the C++ side (also loads FFTW wisdom)
 hInit()
+
+# Store FFTW wisdom of plans measured in this session
+import atexit
+atexit.register(hFFTWExportWisdom)
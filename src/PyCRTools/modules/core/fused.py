@@ -0,0 +1,199 @@
+"""Fused evaluation of element-wise expressions on hArrays.
+
+A chain of calls like ``hMul``, ``hAdd``, ``hSquareAdd`` or
+``hAbsSquareAdd`` makes one pass through memory per call and often
+needs temporary arrays for intermediate results. An
+:class:`hFusedExpression` records such a chain instead and evaluates it
+in a single, cache blocked pass with ``hFusedEvaluate``.
+
+Example::
+
+  >>> x = hFused(fftdata)
+  >>> w = hFused(weights)
+  >>> (x.abssquare() * w + hFused(spectrum)).evaluate(spectrum)
+
+is equivalent to ``spectrum += weights * |fftdata|**2`` without any
+intermediate array.
+"""
+
+from hftools import *
+
+
+class hFusedExpression(object):
+    """Element-wise expression over float and complex hArrays.
+
+    Expressions are built from :func:`hFused` leaves with the normal
+    arithmetic operators, ``abs``, ``**`` (with exponent 2 or 0.5) and the
+    methods below. Python numbers are accepted as constants on either
+    side of an operator. hArrays and vectors are accepted as the right
+    hand operand, on the left hand side they have to be wrapped with
+    :func:`hFused` since their own operators take precedence. Arrays must
+    all have the length of the output or length one.
+    """
+
+    def __init__(self, op, *args):
+        self.op = op
+        self.args = args
+
+    def _binary(self, op, other, reverse=False):
+        other = _as_expression(other)
+        if reverse:
+            return hFusedExpression(op, other, self)
+        return hFusedExpression(op, self, other)
+
+    def __add__(self, other):
+        return self._binary(hFUSEDOP.ADD, other)
+
+    def __radd__(self, other):
+        return self._binary(hFUSEDOP.ADD, other, True)
+
+    def __sub__(self, other):
+        return self._binary(hFUSEDOP.SUB, other)
+
+    def __rsub__(self, other):
+        return self._binary(hFUSEDOP.SUB, other, True)
+
+    def __mul__(self, other):
+        return self._binary(hFUSEDOP.MUL, other)
+
+    def __rmul__(self, other):
+        return self._binary(hFUSEDOP.MUL, other, True)
+
+    def __div__(self, other):
+        return self._binary(hFUSEDOP.DIV, other)
+
+    def __rdiv__(self, other):
+        return self._binary(hFUSEDOP.DIV, other, True)
+
+    __truediv__ = __div__
+    __rtruediv__ = __rdiv__
+
+    def __neg__(self):
+        return hFusedExpression(hFUSEDOP.NEG, self)
+
+    def __pos__(self):
+        return self
+
+    def __abs__(self):
+        return hFusedExpression(hFUSEDOP.ABS, self)
+
+    def __pow__(self, exponent):
+        if exponent == 1:
+            return self
+        elif exponent == 2:
+            return self.square()
+        elif exponent == 0.5:
+            return self.sqrt()
+        raise ValueError("hFusedExpression only supports the exponents 1, 2 and 0.5")
+
+    def square(self):
+        """Square of the expression."""
+        return hFusedExpression(hFUSEDOP.SQUARE, self)
+
+    def abssquare(self):
+        """Square of the absolute value, i.e. the power of a complex expression."""
+        return hFusedExpression(hFUSEDOP.ABSSQUARE, self)
+
+    def sqrt(self):
+        """Square root of the expression."""
+        return hFusedExpression(hFUSEDOP.SQRT, self)
+
+    def exp(self):
+        """Exponential of the expression."""
+        return hFusedExpression(hFUSEDOP.EXP, self)
+
+    def log(self):
+        """Natural logarithm of the expression."""
+        return hFusedExpression(hFUSEDOP.LOG, self)
+
+    def conj(self):
+        """Complex conjugate of the expression."""
+        return hFusedExpression(hFUSEDOP.CONJ, self)
+
+    def real(self):
+        """Real part of the expression."""
+        return hFusedExpression(hFUSEDOP.REAL, self)
+
+    def imag(self):
+        """Imaginary part of the expression."""
+        return hFusedExpression(hFUSEDOP.IMAG, self)
+
+    def phase(self):
+        """Phase (argument) of the expression in radians."""
+        return hFusedExpression(hFUSEDOP.ARG, self)
+
+    def compile(self):
+        """Returns the stack program, operands and constants of the
+        expression as expected by ``hFusedEvaluate``.
+
+        Arrays occurring more than once in the expression are passed only
+        once.
+        """
+        program = []
+        operands = []
+        constants = []
+
+        def emit(node):
+            if node.op == hFUSEDOP.LOAD:
+                array = node.args[0]
+                for i, a in enumerate(operands):
+                    if a is array:
+                        break
+                else:
+                    i = len(operands)
+                    operands.append(array)
+                program.extend([int(hFUSEDOP.LOAD), i])
+            elif node.op == hFUSEDOP.CONST:
+                program.extend([int(hFUSEDOP.CONST), len(constants)])
+                constants.append(complex(node.args[0]))
+            else:
+                for arg in node.args:
+                    emit(arg)
+                program.append(int(node.op))
+
+        emit(self)
+
+        return program, operands, constants
+
+    def evaluate(self, out):
+        """Evaluate the expression and store the result in the float or
+        complex array *out*, which is returned. *out* may itself be an
+        operand of the expression.
+        """
+        program, operands, constants = self.compile()
+
+        hFusedEvaluate(out, program, operands, constants)
+
+        return out
+
+    def __repr__(self):
+        if self.op == hFUSEDOP.LOAD:
+            return "hFused(<%s>)" % type(self.args[0]).__name__
+        elif self.op == hFUSEDOP.CONST:
+            return repr(self.args[0])
+        return "%s(%s)" % (str(self.op).lower(), ", ".join([repr(arg) for arg in self.args]))
+
+
+def _as_expression(value):
+    if isinstance(value, hFusedExpression):
+        return value
+    elif isinstance(value, (int, long, float, complex)):
+        return hFusedExpression(hFUSEDOP.CONST, value)
+    return hFusedExpression(hFUSEDOP.LOAD, value)
+
+
+def hFused(array):
+    """Returns a leaf of an :class:`hFusedExpression` referring to
+    *array*, which can be a float or complex hArray (slice) or vector.
+
+    Note that the array is referenced, not copied, so changes to it before
+    evaluation are taken into account.
+    """
+    return _as_expression(array)
+
+
+def hFusedAssign(out, expression):
+    """Evaluate the fused *expression* into *out*, see
+    :meth:`hFusedExpression.evaluate`.
+    """
+    return _as_expression(expression).evaluate(out)
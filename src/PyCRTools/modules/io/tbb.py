@@ -109,6 +109,7 @@ class TBBData(IOInterface):
             "CABLE_DELAY": self.__file.cable_delay,
             "CABLE_DELAY_UNIT": self.__file.cable_delay_unit,
             "DATA_LENGTH": self.__file.data_length,
+            "PREFETCH": self.__file.prefetch,
             "NOF_STATION_GROUPS": self.__file.nofStationGroups,
             "NOF_DIPOLE_DATASETS": self.__file.nofDipoleDatasets,
             "NOF_SELECTED_DATASETS": self.__file.nofSelectedDatasets,
@@ -315,7 +316,7 @@ class TBBData(IOInterface):
             else:
                 return self.__keyworddict[key]
 
-    setable_keywords = set(["BLOCKSIZE", "BLOCK", "SELECTED_DIPOLES", "ANTENNA_SET"])
+    setable_keywords = set(["BLOCKSIZE", "BLOCK", "SELECTED_DIPOLES", "ANTENNA_SET", "PREFETCH"])
 
     def __setitem__(self, key, value):
         if key not in self.setable_keywords:
@@ -330,6 +331,8 @@ class TBBData(IOInterface):
             self.setAntennaSelection(value)
         elif key is "ANTENNA_SET":
             self.antenna_set = value
+        elif key is "PREFETCH":
+            self.__file.setPrefetch(value)
         else:
             raise KeyError(str(key) + " cannot be set. Available keywords: " + str(list(self.setable_keywords)))
 
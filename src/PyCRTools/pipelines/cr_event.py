@@ -672,19 +672,6 @@ def process_datafile(full_filename, datafile_info=None, dump_html=False):
         #reallocated, if eventually one loops over events - but that needs
         #checking).
 
-        ########################################################################
-        #Allocating the memory for the fft, if it doesn't exist yet
-        ########################################################################
-        if globals().has_key("fftplan") or locals().has_key("fftplan"):
-            print "#fftplan exists - reusing old one!"
-        else:
-            fftplan = FFTWPlanManyDftR2c(blocksize, 1, 1, 1, 1, 1, fftw_flags.ESTIMATE)
-
-        if globals().has_key("invfftplan") or locals().has_key("invfftplan"):
-            print "#invfftplan exists - reusing old one!"
-        else:
-            invfftplan = FFTWPlanManyDftC2r(blocksize, 1, 1, 1, 1, 1, fftw_flags.ESTIMATE)
-
         ########################################################################
         #Calculating the average spectrum and quality flags
         ########################################################################
@@ -928,7 +915,7 @@ def process_datafile(full_filename, datafile_info=None, dump_html=False):
         fft_data.par.xvalues.setUnit("M","")
 
         #FFT
-        hFFTWExecutePlan(fft_data[...], timeseries_data[...], fftplan)
+        hFFTWBatchForward(fft_data, timeseries_data, ndipoles, 0)
         fft_data[...,0]=0 # take out zero (DC) offset (-> offset/mean==0)
 
         if do_checksums:
@@ -950,7 +937,7 @@ def process_datafile(full_filename, datafile_info=None, dump_html=False):
             fft_data.mul(weights)
 
             # back to time domain to get calibrated timeseries data
-            hFFTWExecutePlan(timeseries_data[...], fft_data[...], invfftplan)
+            hFFTWBatchBackward(timeseries_data, fft_data, ndipoles, 0)
             timeseries_data /= blocksize
 
             results.update(dict(
@@ -998,7 +985,7 @@ def process_datafile(full_filename, datafile_info=None, dump_html=False):
         ########################################################################
         timeseries_calibrated_data=hArray(properties=timeseries_data)
         #fft_data[...,0]=0 # take out zero offset (-> offset/mean==0)
-        hFFTWExecutePlan(timeseries_calibrated_data[...], fft_data[...], invfftplan)
+        hFFTWBatchBackward(timeseries_calibrated_data, fft_data, ndipoles, 0)
 
         timeseries_calibrated_data /= blocksize # normalize back to original value
 
@@ -153,6 +153,18 @@ class WrapperBlock():
         self._file = file_ptr
 
 
+    # ______________________________________________________________________
+    #                                           Mark block as parallel-safe
+    def setParallel(self, parallel=True):
+        """
+        Mark the function of the block as an element-wise kernel that
+        can be split over several threads by the generated wrappers.
+        """
+        if (parallel):
+            self._lines.append("#define HFPP_FUNC_PARALLEL HFPP_TRUE\n")
+        self.doc.setParallel(parallel)
+
+
     # ______________________________________________________________________
     #                                        Add a line of code to the block
     def addLine(self, line=""):
@@ -340,6 +352,7 @@ class DocumentationBlock():
         self._example_lines = []
         self._plotcode_lines = []
         self._dump_lines = []
+        self._parallel = False
 
 
     # ______________________________________________________________________
@@ -816,9 +829,30 @@ class DocumentationBlock():
             result += r"\n" + self.formatSectionTitle("Example") + r"\n"
             result += self.formatPlot() + r"\n"
 
+        # Parallel execution
+        if self.getParallel():
+            result += r"\n" + self.formatSectionTitle("Parallelization") + r"\n"
+            result += r"Vectors longer than ``hGetParallelThreshold()`` are split into pieces processed by up to ``hGetParallelThreads()`` threads.\n"
+
         return result
 
 
+    # ______________________________________________________________________
+    #                                                     Parallel execution
+    def setParallel(self, parallel=True):
+        """
+        Set whether the wrappers of the function run in parallel.
+        """
+        self._parallel = parallel
+
+
+    def getParallel(self):
+        """
+        Return whether the wrappers of the function run in parallel.
+        """
+        return self._parallel
+
+
     # ______________________________________________________________________
     #                                                getDoxygenDocumentation
     def getDoxygenDoc(self):
@@ -932,6 +966,7 @@ def parseFile(input_filename, output_filename, options):
     iterator_block = None
     wrapper_block = None
     ifdef_list = []
+    parallel = False
 
     header_rule = "="*80
     header_text = "ATTENTION: DON'T EDIT THIS FILE!!! IT IS GENERATED AUTOMATICALLY BY crtools_code_parser.py"
@@ -1002,6 +1037,12 @@ def parseFile(input_filename, output_filename, options):
             docstring = m.group(1)
             continue
 
+        # Check parallel-safe marker for the next wrapper block
+        m = re.match('^\/\/\$PARALLEL', line)
+        if (m):
+            parallel = True
+            continue
+
         # Check iterator block (start)
         m = re.match("^\/\/\$ITERATE (\w*) ([A-Za-z0-9,]*)", line)
         if (m):
@@ -1026,6 +1067,8 @@ def parseFile(input_filename, output_filename, options):
             wrapper_block = WrapperBlock(output_file, def_file, pydoc_file, ifdef_list, options)  # Create block
             wrapper_block.addLine(line)
             wrapper_block.doc.setSummary(docstring)         # Set document summary
+            wrapper_block.setParallel(parallel)             # Mark as parallel-safe
+            parallel = False
             continue
 
         # Check wrapper block (end)
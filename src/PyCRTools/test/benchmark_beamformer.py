@@ -0,0 +1,45 @@
+#! /usr/bin/env python
+#
+# Benchmark of the tiled beamforming engine behind hBeamformImage against
+# the direct OpenMP loop (hBeamformImageDirect) that evaluates one phasor
+# per pixel, antenna and frequency.
+#
+# Usage: benchmark_beamformer.py [nantennas] [npixels] [nfrequencies]
+#
+
+import sys
+import time
+import numpy as np
+import pycrtools as cr
+
+nantennas = int(sys.argv[1]) if len(sys.argv) > 1 else 96
+npixels = int(sys.argv[2]) if len(sys.argv) > 2 else 2500
+nfrequencies = int(sys.argv[3]) if len(sys.argv) > 3 else 1024
+
+print "Beamforming %d antennas x %d pixels x %d frequencies" % (nantennas, npixels, nfrequencies)
+
+# Equidistant frequencies as produced by an FFT of a TBB block
+frequencies = cr.hArray(30.e6 + np.arange(nfrequencies) * (50.e6 / nfrequencies))
+
+# Random FFT data and delays up to a few microseconds
+np.random.seed(1)
+fftdata = cr.hArray(np.random.standard_normal(nantennas * nfrequencies) + 1j * np.random.standard_normal(nantennas * nfrequencies))
+
+delays = cr.hArray(2.e-6 * (np.random.random(npixels * nantennas) - 0.5))
+
+def run(name, function, *args):
+    image = cr.hArray(complex, npixels * nfrequencies, fill=0)
+    t0 = time.time()
+    function(image, fftdata, frequencies, delays, *args)
+    t = time.time() - t0
+    print "%-32s %8.3f s" % (name, t)
+    return image, t
+
+reference, t_direct = run("hBeamformImageDirect", cr.hBeamformImageDirect)
+tiled, t_tiled = run("hBeamformImage", cr.hBeamformImage)
+single, t_single = run("hBeamformImage (single precision)", cr.hBeamformImage, True)
+
+scale = np.abs(reference.toNumpy()).max()
+
+print "Speedup double precision : %6.2f (max. relative deviation %.2e)" % (t_direct / t_tiled, np.abs(tiled.toNumpy() - reference.toNumpy()).max() / scale)
+print "Speedup single precision : %6.2f (max. relative deviation %.2e)" % (t_direct / t_single, np.abs(single.toNumpy() - reference.toNumpy()).max() / scale)
@@ -0,0 +1,67 @@
+#! /usr/bin/env python
+#
+# Benchmark of fused expression evaluation (hFusedEvaluate) against the
+# equivalent chains of individual element-wise hArray functions, each of
+# which makes a separate pass through memory.
+#
+# Usage: benchmark_fused.py [length] [repetitions]
+#
+
+import sys
+import time
+import numpy as np
+import pycrtools as cr
+
+length = int(sys.argv[1]) if len(sys.argv) > 1 else 4 * 1024 * 1024
+repetitions = int(sys.argv[2]) if len(sys.argv) > 2 else 10
+
+print "Evaluating expressions over %d elements, %d repetitions" % (length, repetitions)
+
+np.random.seed(1)
+a, b, c, d, e = [cr.hArray(np.random.standard_normal(length)) for i in range(5)]
+w = cr.hArray(np.random.random(length))
+X = cr.hArray(np.random.standard_normal(length) + 1j * np.random.standard_normal(length))
+
+def run(name, function):
+    out = cr.hArray(float, length, fill=0)
+    t0 = time.time()
+    for i in range(repetitions):
+        function(out)
+    t = (time.time() - t0) / repetitions
+    print "%-48s %8.4f s" % (name, t)
+    return out, t
+
+def compare(title, chain, fused):
+    reference, t_chain = run(title + " (chain)", chain)
+    result, t_fused = run(title + " (fused)", fused)
+    deviation = np.abs(result.toNumpy() - reference.toNumpy()).max()
+    print "%-48s %8.2f (max. deviation %.2e)" % ("Speedup", t_chain / t_fused, deviation)
+
+# out = a*b + c*d - e
+tmp = cr.hArray(float, length)
+
+def chain(out):
+    out.fill(0)
+    cr.hMulAdd(out, a, b)
+    cr.hMulAdd(out, c, d)
+    cr.hSub(out, e)
+
+compare("a*b + c*d - e", chain, lambda out: (cr.hFused(a) * b + cr.hFused(c) * d - e).evaluate(out))
+
+# out = sqrt(a**2 + b**2)
+def chain(out):
+    out.fill(0)
+    cr.hSquareAdd(out, a)
+    cr.hSquareAdd(out, b)
+    cr.hSqrt(out)
+
+compare("sqrt(a**2 + b**2)", chain, lambda out: ((cr.hFused(a) ** 2 + cr.hFused(b) ** 2) ** 0.5).evaluate(out))
+
+# Weighted spectral power of complex data, out += w*|X|**2
+def chain(out):
+    tmp.fill(0)
+    cr.hAbsSquareAdd(tmp, X)
+    cr.hMul(tmp, w)
+    cr.hAdd(out, tmp)
+
+compare("out + w*|X|**2", chain, lambda out: (cr.hFused(X).abssquare() * w + out).evaluate(out))
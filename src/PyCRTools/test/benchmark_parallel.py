@@ -0,0 +1,56 @@
+#! /usr/bin/env python
+#
+# Benchmark of the parallel generated wrappers of element-wise hArray
+# functions (marked with //$PARALLEL) for an increasing number of threads.
+#
+# Usage: benchmark_parallel.py [length] [repetitions]
+#
+
+import sys
+import time
+import numpy as np
+import pycrtools as cr
+
+length = int(sys.argv[1]) if len(sys.argv) > 1 else 16 * 1024 * 1024
+repetitions = int(sys.argv[2]) if len(sys.argv) > 2 else 10
+
+if not cr.multicore():
+    print "PyCRTools was compiled without OpenMP, wrappers run serially"
+
+maxthreads = cr.hGetParallelThreads()
+
+print "Element-wise functions over %d elements, %d repetitions, threshold %d" % (length, repetitions, cr.hGetParallelThreshold())
+
+np.random.seed(1)
+a = cr.hArray(np.random.random(length) + 1)
+b = cr.hArray(np.random.random(length) + 1)
+X = cr.hArray(np.random.standard_normal(length) + 1j * np.random.standard_normal(length))
+out = cr.hArray(float, length, fill=0)
+
+tests = [
+    ("hMul(a, b)", lambda: cr.hMul(a, b)),
+    ("hMulAdd(out, a, b)", lambda: cr.hMulAdd(out, a, b)),
+    ("hSqrt(out, a)", lambda: cr.hSqrt(out, a)),
+    ("hAbsSquareAdd(out, X)", lambda: cr.hAbsSquareAdd(out, X))
+]
+
+nthreads = 1
+threads = []
+while nthreads < maxthreads:
+    threads.append(nthreads)
+    nthreads *= 2
+threads.append(maxthreads)
+
+for name, function in tests:
+    t_serial = None
+    for n in threads:
+        cr.hSetParallelThreads(n)
+        t0 = time.time()
+        for i in range(repetitions):
+            function()
+        t = (time.time() - t0) / repetitions
+        if t_serial is None:
+            t_serial = t
+        print "%-28s %3d threads %8.4f s (speedup %5.2f)" % (name, n, t, t_serial / t)
+
+cr.hSetParallelThreads(0)
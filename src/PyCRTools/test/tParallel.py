@@ -0,0 +1,75 @@
+#! /usr/bin/env python
+#
+# Test of the parallel generated wrappers of element-wise hArray
+# functions (marked with //$PARALLEL): the results with several threads
+# must be identical to the serial results, in particular for in-place
+# and accumulating kernels, where a piece applied twice would go
+# unnoticed in the timings of benchmark_parallel.py.
+#
+# Usage: tParallel.py [length]
+#
+
+import sys
+import numpy as np
+import pycrtools as cr
+
+length = int(sys.argv[1]) if len(sys.argv) > 1 else 1024 * 1024
+
+if not cr.multicore():
+    print "PyCRTools was compiled without OpenMP, wrappers run serially"
+
+threshold = cr.hGetParallelThreshold()
+cr.hSetParallelThreshold(1)
+
+np.random.seed(1)
+a0 = np.random.random(length) + 1
+b0 = np.random.random(length) + 1
+out0 = np.random.random(length)
+X0 = np.random.standard_normal(length) + 1j * np.random.standard_normal(length)
+
+
+def run(nthreads):
+    """Run an in-place and two accumulating kernels with nthreads threads"""
+    cr.hSetParallelThreads(nthreads)
+
+    # in-place kernel
+    a = cr.hArray(a0)
+    cr.hSqrt(a)
+
+    # accumulating kernels, called twice
+    out = cr.hArray(out0)
+    b = cr.hArray(b0)
+    cr.hMulAdd(out, cr.hArray(a0), b)
+    cr.hMulAdd(out, cr.hArray(a0), b)
+
+    power = cr.hArray(out0)
+    X = cr.hArray(X0)
+    cr.hAbsSquareAdd(power, X)
+    cr.hAbsSquareAdd(power, X)
+
+    return a.toNumpy(), out.toNumpy(), power.toNumpy()
+
+serial = run(1)
+failed = False
+
+for nthreads in [2, 3, 4, 8]:
+    parallel = run(nthreads)
+    for name, s, p in zip(["hSqrt (in-place)", "hMulAdd (accumulating)", "hAbsSquareAdd (accumulating)"], serial, parallel):
+        if not np.array_equal(s, p):
+            print "FAILED: %s with %d threads differs from serial (max difference %g)" % (name, nthreads, np.max(np.abs(s - p)))
+            failed = True
+
+# the serial results themselves
+expected = (np.sqrt(a0), out0 + 2 * a0 * b0, out0 + 2 * np.abs(X0) ** 2)
+for name, s, e in zip(["hSqrt", "hMulAdd", "hAbsSquareAdd"], serial, expected):
+    if not np.allclose(s, e, rtol=1e-12):
+        print "FAILED: serial %s differs from numpy" % name
+        failed = True
+
+cr.hSetParallelThreads(0)
+cr.hSetParallelThreshold(threshold)
+
+if failed:
+    sys.exit(1)
+
+print "Parallel and serial results are identical"
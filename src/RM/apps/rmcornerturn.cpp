@@ -0,0 +1,222 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+/*!
+  \file rmcornerturn.cpp
+  \ingroup RM
+
+  \brief Corner turn a stack of 2-D Q/U FITS planes into a tiled spectral-major cube
+
+  \date 17-10-2026
+
+  <h3>Synopsis</h3>
+
+  The planes are read in blocks of consecutive channels, as many as fit into
+  the given memory budget, and each block is scattered into the tiles of the
+  output cube (see RM::rmTiledCube). Every input plane is read exactly once.
+
+  The list file contains one channel per line:
+  \verbatim
+  <q plane.fits> <u plane.fits> <frequency [Hz]> [<channel width [Hz]>]
+  \endverbatim
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "fitsio.h"
+#include "rmTiledCube.h"
+
+using namespace std;
+
+
+void readChannelList(const string &listfilename, vector<string> &qlist, vector<string> &ulist, vector<double> &freqs, vector<double> &widths);
+void planeSize(const string &filename, long &nx, long &ny);
+void readPlane(const string &filename, long nx, long ny, float *plane);
+
+
+int main (int argc, const char * argv[]) {
+	//-------------------------------------
+	// Command line argument parsing
+	if(argc<3 || argc>5)
+	{
+		cout << "usage: rmcornerturn <list.txt> <output.rmtc> [tilesize] [memory MB]" << endl;
+		cout << endl;
+		cout << "This program reads the Q and U planes listed in <list.txt>" << endl;
+		cout << "(lines: q.fits u.fits frequency [width]) and writes them" << endl;
+		cout << "into a tiled spectral-major cube (default 32x32 pixel tiles," << endl;
+		cout << "512 MB for the blocks of planes)." << endl;
+		return 1;
+	}
+
+	string listfilename=argv[1];
+	string outfilename=argv[2];
+	unsigned int tilesize=(argc>3) ? atoi(argv[3]) : 32;
+	double memoryMB=(argc>4) ? atof(argv[4]) : 512;
+
+	try {
+		vector<string> qlist, ulist;
+		vector<double> freqs, widths;
+		long nx=0, ny=0;
+
+		readChannelList(listfilename, qlist, ulist, freqs, widths);
+		planeSize(qlist[0], nx, ny);
+
+		// Q and U plane of every channel of a block are held in memory
+		size_t planeBytes=2*nx*ny*sizeof(float);
+		size_t block=(size_t)(memoryMB*1024*1024)/planeBytes;
+		if(block==0)
+			throw "rmcornerturn: memory budget smaller than one Q/U plane pair";
+		if(block>freqs.size())
+			block=freqs.size();
+
+		RM::rmTiledCube cube;
+		cube.create(outfilename, nx, ny, freqs, widths, tilesize, tilesize, 1);
+		cube.summary();
+
+		vector<float> q(block*nx*ny), u(block*nx*ny);
+		for(size_t c0=0; c0<freqs.size(); c0+=block)
+		{
+			size_t nofPlanes=min(block, freqs.size()-c0);
+			cout << "channels " << c0 << " - " << c0+nofPlanes-1 << " / " << freqs.size() << endl;
+			for(size_t c=0; c<nofPlanes; c++)
+			{
+				readPlane(qlist[c0+c], nx, ny, &q[c*nx*ny]);
+				readPlane(ulist[c0+c], nx, ny, &u[c*nx*ny]);
+			}
+			cube.cornerTurn(&q[0], &u[0], c0, nofPlanes);
+		}
+
+		cube.flush();
+		cube.close();
+	}
+	catch (const char* s) {
+		cout << s << endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+/*!
+ \brief Read the list of channels
+
+ \param listfilename - text file with one channel per line
+ \param qlist - names of the Q planes
+ \param ulist - names of the U planes
+ \param freqs - frequencies of the channels
+ \param widths - widths of the channels (0 if not given)
+ */
+void readChannelList(const string &listfilename, vector<string> &qlist, vector<string> &ulist, vector<double> &freqs, vector<double> &widths)
+{
+	ifstream infile(listfilename.c_str(), ifstream::in);
+	string line;
+
+	if(infile.fail())
+		throw "rmcornerturn::readChannelList failed to open file";
+
+	qlist.clear();
+	ulist.clear();
+	freqs.clear();
+	widths.clear();
+	while(getline(infile, line))
+	{
+		istringstream fields(line);
+		string qname, uname;
+		double freq=0, width=0;
+
+		if(!(fields >> qname))		// skip empty lines
+			continue;
+		if(qname[0]=='#')		// and comments
+			continue;
+		if(!(fields >> uname >> freq))
+			throw "rmcornerturn::readChannelList line without U plane or frequency";
+		fields >> width;
+
+		qlist.push_back(qname);
+		ulist.push_back(uname);
+		freqs.push_back(freq);
+		widths.push_back(width);
+	}
+	infile.close();
+
+	if(qlist.size()==0)
+		throw "rmcornerturn::readChannelList list has length 0";
+}
+
+
+/*!
+ \brief Get the size of the first two axes of a FITS image
+
+ \param filename - name of the FITS image
+ \param nx - size of the first axis
+ \param ny - size of the second axis
+ */
+void planeSize(const string &filename, long &nx, long &ny)
+{
+	fitsfile *fptr=NULL;
+	int fitsstatus=0;
+	long naxes[3]={0, 0, 0};
+
+	fits_open_image(&fptr, filename.c_str(), READONLY, &fitsstatus);
+	fits_get_img_size(fptr, 3, naxes, &fitsstatus);
+	fits_close_file(fptr, &fitsstatus);
+	if(fitsstatus)
+		throw "rmcornerturn::planeSize could not read image size";
+
+	nx=naxes[0];
+	ny=naxes[1];
+}
+
+
+/*!
+ \brief Read the first plane of a FITS image, NaN for undefined pixels
+
+ \param filename - name of the FITS image
+ \param nx - expected size of the first axis
+ \param ny - expected size of the second axis
+ \param plane - buffer of nx*ny values
+ */
+void readPlane(const string &filename, long nx, long ny, float *plane)
+{
+	fitsfile *fptr=NULL;
+	int fitsstatus=0;
+	int anynul=0;
+	long naxes[3]={0, 0, 0};
+	long fpixel[3]={1, 1, 1};
+
+	fits_open_image(&fptr, filename.c_str(), READONLY, &fitsstatus);
+	fits_get_img_size(fptr, 3, naxes, &fitsstatus);
+	if(fitsstatus)
+		throw "rmcornerturn::readPlane could not open image";
+	if(naxes[0]!=nx || naxes[1]!=ny)
+	{
+		fits_close_file(fptr, &fitsstatus);
+		throw "rmcornerturn::readPlane input images differ in size";
+	}
+
+	fits_read_pix(fptr, TFLOAT, fpixel, nx*ny, NULL, plane, &anynul, &fitsstatus);
+	fits_close_file(fptr, &fitsstatus);
+	if(fitsstatus)
+		throw "rmcornerturn::readPlane could not read pixels";
+}
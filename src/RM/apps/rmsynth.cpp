@@ -29,6 +29,9 @@
 #include "rmCube.h"
 #include "rmIO.h"
 #include "WienerFilter.h"
+#include "rmCubeClean.h"
+#include "rmSynthesis.h"
+#include "rmTilePipeline.h"
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 #include "wavelet.h"
@@ -42,6 +45,8 @@ const int Meth_RMSynth=1;
 const int Meth_Wiener=2;
 const int Meth_Eigen=3;
 const int Meth_Wavelet=4;
+/* batched RM-CLEAN of the complete cube with the shared RMSF (processCube and processTiledCube only) */
+const int Clean_RMSF=4;
 bool print ;
 /*! Procedure fills the vector faradays with equidistant values of faradaydepths from the given munimum to 
    the also given maximum
@@ -285,8 +290,9 @@ void Convert(string nameQ, string nameU, string ausName, string out_names, doubl
       Wiener.alpha = alpha;
       Wiener.nu_0 = nu_0 ;
       Wiener.epsilon_0 = epsilon ;
-      Wiener.generateWienerFiltering(noNoise, flatPrior, signalVar, sigCorrLength, noiseVar, gaps, eps,2) ;
-      cout << "Wiener filter generated" << endl ;
+      /* only the matrices, the filter is applied with Cholesky/QR solves in filterCube */
+      Wiener.setupWienerFiltering(noNoise, flatPrior, signalVar, sigCorrLength, noiseVar, gaps, eps,2) ;
+      cout << "Wiener filter matrices generated" << endl ;
     }
     else if (method == Meth_Eigen) { // wiener filtering with iterating the powerspectrum 
       Wiener.setFrequencies(freqs) ;
@@ -298,21 +304,13 @@ void Convert(string nameQ, string nameU, string ausName, string out_names, doubl
     /* perform the actual computation for each line of site  */
     uint nx = cubeIn.getXSize() ;
     uint ny = cubeIn.getYSize() ;;
-    if ((method==Meth_RMSynth) || (method==Meth_Wiener)) {
-      for (uint ij=0 ; ij<ny; ij++) {
-        cout << "ij= " << ij << endl ;
-        for (uint ii=0; ii<nx; ii++) {
-          vector<complex<double> > P_lambda;
-	  cubeIn.getLineOfSight(ii,ij,P_lambda) ;
-          vector<complex<double> > P_farad ;
-          if (method == Meth_RMSynth)        
-            P_farad = cubeIn.performRMSynthesis(P_lambda,lambdas,faras, gaps, nu_0, alpha, epsilon) ;
-          else
-            P_farad =Wiener.applyWF(P_lambda) ;
-
-          cubeOut.setLineOfSight(ii,ij,P_farad);
-        }
-      }
+    if (method==Meth_RMSynth) {
+      /* all lines of sight at once, the phase kernel is shared between them */
+      cubeIn.performRMSynthesis(cubeOut, lambdas, faras, gaps) ;
+    }
+    else if (method==Meth_Wiener) {
+      /* factored once per pattern of flagged channels, applied to blocks of lines of sight */
+      Wiener.filterCube(cubeIn, cubeOut, noNoise, flatPrior) ;
     }
     else if (method==Meth_Eigen){  // case iterating the signal power spectrum
 	/* the following function calculates the covariance matrix for the datas */
@@ -505,6 +503,11 @@ void writeLogging (PagedImage<Float> image,
  *   \param rmFakt   factor to reduce the size of the subtracted peak out of the measured data in rmClean 
  *   \param maxIter  maximal number of separate iterations (used point sources) for rmClean
  *   \param CleanRatio ratio for biggest peak to mean peak when the rmClean search for more point sources is stoped
+ *
+ *   With method==Meth_RMSynth and useClean==Clean_RMSF the rm-synthesized cube is
+ *   cleaned with rmCubeClean (rmFakt is the loop gain, CleanRatio the residual
+ *   peak relative to the dirty peak at which to stop), and the statistics of
+ *   each line of sight are written to outDat.cleanstats
 */
 void processCube (double phi_min,
 		  double phi_max,
@@ -537,6 +540,10 @@ void processCube (double phi_min,
   int ySize = cube.getYSize() ;
   rmCube result(xSize, ySize, faras) ; // create a rmCube to store the result of rmSynthesis in (in memory not on file)
   Wiener.prepare(freqsC.data, freqsI.data, faras, nu_0, alpha, epsilon, method) ; // prepare Wiener filter if requested by the user
+  /* with the batched RM-CLEAN the lines of sight are only synthesized here and
+     cleaned all together after the loop */
+  bool cleanCube = (method==Meth_RMSynth) && (useClean==Clean_RMSF) ;
+  int useCleanLine = cleanCube ? 0 : useClean ;
   
   /* performing the rm-synthesis for all pixels of the image. For each pixel, the
      rmsynthesis is done separatly by using the line procedure */
@@ -551,11 +558,26 @@ void processCube (double phi_min,
         vector<complex<double> > P_farad ; // create vector for line of sight in the rmCube
         print=((x==0) && (y==0)); // flag for controle printing
         /* call the procedure to perform the rmsynthesis on the current line of sight */
-        processLine(data, Wiener, P_farad , freqsC, freqsI, faras, phi_min, phi_max, nFara, method, nu_0, alpha, epsilon, outDat, useClean, rmFakt, maxIter, cleanRatio, addRes, minWave, maxWave, stepWave) ;
+        processLine(data, Wiener, P_farad , freqsC, freqsI, faras, phi_min, phi_max, nFara, method, nu_0, alpha, epsilon, outDat, useCleanLine, rmFakt, maxIter, cleanRatio, addRes, minWave, maxWave, stepWave) ;
         result.setLineOfSight(x,y,P_farad) ; // store the result of processLine into the rmCube object 
       }
     }
   }
+  if (cleanCube) {
+    /* RMSF = rm-synthesis of unit data on twice the range of faraday depths */
+    vector<double> lcenter ;
+    vector<double> linterv ;
+    vector<double> rmsfFaras(2*nFara-1) ;
+    fillFaras(-(phi_max-phi_min), phi_max-phi_min, 2*nFara-1, rmsfFaras) ;
+    freqToLambdaSq(freqsC.data,freqsI.data,lcenter,linterv) ;
+    vector<complex<double> > ones(freqsC.size(), complex<double>(1,0)) ;
+    vector<complex<double> > rmsf = performRMSynthesis(ones,lcenter,linterv,rmsfFaras, nu_0, alpha, epsilon) ;
+    /* clean all lines of sight in place, the rmCube stores them contiguously */
+    rmCubeClean cleaner(rmsf, rmCubeClean::estimateFWHM(rmsf), rmFakt, 0, maxIter) ;
+    cleaner.setRelativeThreshold(cleanRatio) ;
+    cleaner.clean(result.vals.data(), result.vals.data(), xSize*ySize, addRes!=0) ;
+    cleaner.writeStatistics(outDat+".cleanstats", xSize) ;
+  }
   CoordinateSystem coors=cube.get_cs() ;
   CoordinateSystem neu;
   IPosition size=cube.get_shape() ; 
@@ -607,6 +629,153 @@ void processCube (double phi_min,
   }
 }
 
+//_______________________________________________________________________________
+//                                                        rmSynthesisTileProcessor
+/*! Computation stage of the streaming rm-synthesis of a tiled cube: rm-synthesis
+ *  of all lines of sight of a tile and, with useClean==Clean_RMSF, the batched
+ *  RM-CLEAN. The statistics of the clean are appended to a table per tile.
+*/
+class rmSynthesisTileProcessor : public rmTileProcessor
+{
+  const rmTiledCube &input_p ;
+  vector<double> lambdas_p ;       // ascending lambda squared values
+  bool reversed_p ;                // channel order of the cube is descending in lambda squared
+  unsigned int nFara_p ;
+  rmSynthesis *synthesis_p ;
+  rmCubeClean *cleaner_p ;
+  bool addRes_p ;
+  ofstream stats_p ;
+
+public:
+
+  rmSynthesisTileProcessor(const rmTiledCube &input, const vector<double> &faras, int useClean,
+			   double rmFakt, uint maxIter, double cleanRatio, int addRes, string outDat)
+    : input_p(input), lambdas_p(input.nofChannels()), reversed_p(false), nFara_p(faras.size()),
+      synthesis_p(NULL), cleaner_p(NULL), addRes_p(addRes!=0)
+  {
+    const vector<double> &axisValues = input.axisValues() ;
+    /* convert frequencies to lambda squared values, if this is necessary */
+    for (uint i=0; i<lambdas_p.size(); i++) {
+      lambdas_p[i] = (input.axis()==1) ? pow(CVAC/axisValues[i],2) : axisValues[i] ;
+    }
+    reversed_p = (lambdas_p.size()>1) && (lambdas_p.front()>lambdas_p.back()) ;
+    if (reversed_p) {
+      reverse(lambdas_p.begin(), lambdas_p.end()) ;
+    }
+    vector<uint> gaps ;
+    findGaps(lambdas_p,gaps) ;
+    synthesis_p = new rmSynthesis(lambdas_p, faras, gaps) ;
+    if (useClean==Clean_RMSF) {
+      /* RMSF = rm-synthesis of unit data on twice the range of faraday depths */
+      double range = faras.back()-faras.front() ;
+      vector<double> rmsfFaras(2*nFara_p-1) ;
+      fillFaras(-range, range, 2*nFara_p-1, rmsfFaras) ;
+      rmSynthesis rmsfSynthesis(lambdas_p, rmsfFaras, gaps) ;
+      vector<complex<double> > rmsf = rmsfSynthesis.transform(vector<complex<double> >(lambdas_p.size(), complex<double>(1,0))) ;
+      cleaner_p = new rmCubeClean(rmsf, rmCubeClean::estimateFWHM(rmsf), rmFakt, 0, maxIter) ;
+      cleaner_p->setRelativeThreshold(cleanRatio) ;
+      stats_p.open((outDat+".cleanstats").c_str()) ;
+      if (stats_p.fail()) {
+        throw "rmsynth: failed to open the clean statistics file" ;
+      }
+      stats_p << "# x\ty\titerations\tcomponents\tinitial_peak\tresidual_peak\tresidual_rms\tflux_q\tflux_u" << endl ;
+    }
+  }
+
+  ~rmSynthesisTileProcessor()
+  {
+    delete cleaner_p ;
+    delete synthesis_p ;
+  }
+
+  unsigned int nofInputValues () const { return lambdas_p.size() ; }
+
+  unsigned int nofOutputValues () const { return nFara_p ; }
+
+  void process (unsigned int tile, complex<double> *in, complex<double> *out, unsigned long nofLines)
+  {
+    const uint nofChannels = lambdas_p.size() ;
+    if (reversed_p) {
+      for (unsigned long p=0; p<nofLines; p++) {
+	reverse(in+p*nofChannels, in+(p+1)*nofChannels) ;
+      }
+    }
+    synthesis_p->transform(in, out, nofLines) ;
+    if (cleaner_p != NULL) {
+      cleaner_p->clean(out, out, nofLines, addRes_p) ;
+      /* one row per pixel of the image, the tiles at the border are padded */
+      uint x0, y0 ;
+      input_p.tileOrigin(tile, x0, y0) ;
+      const vector<rmCleanStatistics> &stats = cleaner_p->statistics() ;
+      for (unsigned long p=0; p<nofLines; p++) {
+	uint x = x0+p%input_p.tileX() ;
+	uint y = y0+p/input_p.tileX() ;
+	if (x<input_p.nx() && y<input_p.ny()) {
+	  const rmCleanStatistics &s = stats[p] ;
+	  stats_p << x << "\t" << y << "\t" << s.nofIterations << "\t" << s.nofComponents << "\t"
+		  << s.initialPeak << "\t" << s.residualPeak << "\t" << s.residualRMS << "\t"
+		  << s.cleanFlux.real() << "\t" << s.cleanFlux.imag() << "\n" ;
+	}
+      }
+    }
+  }
+};
+
+//_______________________________________________________________________________
+//                                                                processTiledCube
+/*! rm-synthesis of a tiled spectral-major cube (see rmcornerturn) into a tiled
+ *  cube of faraday depths. The tiles are streamed through an rmTilePipeline, so
+ *  reading and writing overlap with the computation and only as many tiles as
+ *  fit into the memory budget are held in memory.
+ *   \param phi_min  mininal value for the reconstructed faraday depth
+ *   \param phi_max  maximal value for the reconstructed faraday depth
+ *   \param nFara    number of values for the fararaday depth
+ *   \param method   used method for reconstruction, only Meth_RMSynth
+ *   \param input    name of the input tiled cube (.rmtc)
+ *   \param outDat   name of the output tiled cube
+ *   \param useClean 0 or Clean_RMSF for the batched RM-CLEAN of each tile
+ *   \param rmFakt   loop gain of the clean
+ *   \param maxIter  maximal number of iterations of the clean
+ *   \param cleanRatio residual peak relative to the dirty peak at which to stop
+ *   \param addRes   add the residuals to the restored spectra
+ *   \param memoryMB memory budget for the tile buffers in MB
+*/
+void processTiledCube (double phi_min,
+		       double phi_max,
+		       uint nFara,
+		       int method,
+		       string input,
+		       string outDat,
+		       int useClean,
+		       double rmFakt,
+		       uint maxIter,
+		       double cleanRatio,
+		       int addRes,
+		       double memoryMB)
+{
+  if (method != Meth_RMSynth) {
+    throw "rmsynth: tiled cubes are only processed with method rm-synthesis" ;
+  }
+  if ((useClean != 0) && (useClean != Clean_RMSF)) {
+    throw "rmsynth: tiled cubes are only cleaned with the batched RM-CLEAN" ;
+  }
+  rmTiledCube cube ;
+  cube.open(input) ;
+  vector<double> faras(nFara) ;
+  fillFaras(phi_min, phi_max, nFara, faras) ;
+  rmTiledCube result ;
+  result.create(outDat, cube.nx(), cube.ny(), faras, vector<double>(), cube.tileX(), cube.tileY(), 3) ;
+
+  rmSynthesisTileProcessor processor(cube, faras, useClean, rmFakt, maxIter, cleanRatio, addRes, outDat) ;
+  rmTilePipeline pipeline(cube, result, processor, (size_t)(memoryMB*1024*1024)) ;
+  pipeline.summary() ;
+  pipeline.run() ;
+
+  result.flush() ;
+  result.close() ;
+  cube.close() ;
+}
+
 //_______________________________________________________________________________
 //                                                                      fillFreqs
 
@@ -700,6 +869,17 @@ int main (int argc, char * const argv[]) {
     ein.readFreqLine(input,vals,freqsC, freqsI,indFreq,fits);
     convLine(vals, freqsC, freqsI, minPhi, maxPhi, nFaraday, method, nu_0, alpha, epsilon, outDat, useClean, rmFakt, maxIter, cleanRatio, addRes, minWave, maxWave, stepWave) ;
   }
+  // a tiled cube (see rmcornerturn) is streamed tile by tile
+  else if ((input.size()>5) && (input.compare(input.size()-5,5,".rmtc")==0)) {
+    double memoryMB = inp.param_present("memory") ? inp.findDouble("memory") : 1024 ;
+    try {
+      processTiledCube(minPhi, maxPhi, nFaraday, method, input, outDat, useClean, rmFakt, maxIter, cleanRatio, addRes, memoryMB) ;
+    }
+    catch (const char* s) {
+      cout << s << endl ;
+      return 1 ;
+    }
+  }
   // a complete rm cube is to be processed 
   else {
     processCube(minPhi, maxPhi, nFaraday, method, nu_0, alpha, epsilon, input, casaQuery, outDat, useClean, rmFakt, maxIter, cleanRatio, addRes, minWave, maxWave, stepWave) ;
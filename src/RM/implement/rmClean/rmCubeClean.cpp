@@ -0,0 +1,447 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <rmCubeClean.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmCubeClean
+
+  /*!
+    \param rmsf          -- RMSF for the Faraday depth offsets -(n-1) .. (n-1)
+                            (in units of the Faraday depth spacing), i.e. 2n-1
+                            values for lines of sight of n Faraday depths.
+    \param fwhm          -- FWHM of the restoring Gaussian in units of the
+                            Faraday depth spacing.
+    \param gain          -- Loop gain, 0 < gain <= 1.
+    \param threshold     -- CLEAN stops when the residual peak is below.
+    \param maxIterations -- Maximum number of iterations per line of sight.
+    \param rmsfCutoff    -- Only the part of the RMSF with an amplitude above
+                            rmsfCutoff (relative to the main peak) is
+                            subtracted; 0 subtracts the full RMSF.
+  */
+  rmCubeClean::rmCubeClean (const std::vector<std::complex<double> > &rmsf,
+                            double fwhm,
+                            double gain,
+                            double threshold,
+                            unsigned int maxIterations,
+                            double rmsfCutoff)
+    : nofDepths_p ((rmsf.size()+1)/2),
+      nofThreads_p (0),
+      gain_p (gain),
+      threshold_p (threshold),
+      relativeThreshold_p (0),
+      maxIterations_p (maxIterations),
+      support_p (0),
+      fwhm_p (fwhm),
+      fftSize_p (0)
+  {
+#ifdef HAVE_FFTW3
+    forward_p  = NULL;
+    backward_p = NULL;
+#endif
+
+    if (rmsf.size() < 3 || rmsf.size()%2 == 0) {
+      throw "rmCubeClean: RMSF must have an odd number (2n-1) of values";
+    }
+    if (gain <= 0 || gain > 1) {
+      throw "rmCubeClean: gain must be in (0,1]";
+    }
+    if (fwhm <= 0) {
+      throw "rmCubeClean: fwhm <= 0";
+    }
+
+    /* Normalize the RMSF to 1 at zero offset */
+    const unsigned int center = nofDepths_p-1;
+    if (std::abs(rmsf[center]) == 0) {
+      throw "rmCubeClean: RMSF vanishes at zero Faraday depth";
+    }
+    rmsf_p.resize (rmsf.size());
+    for (unsigned int i=0; i<rmsf.size(); i++) {
+      rmsf_p[i] = rmsf[i]/rmsf[center];
+    }
+
+    /* Window of the RMSF which is subtracted */
+    support_p = center;
+    if (rmsfCutoff > 0) {
+      while (support_p > 0
+             && std::abs(rmsf_p[center+support_p]) < rmsfCutoff
+             && std::abs(rmsf_p[center-support_p]) < rmsfCutoff) {
+        support_p--;
+      }
+    }
+
+    /* Restoring Gaussian, cut at 4 sigma */
+    const double sigma = fwhm_p/(2*sqrt(2*log(2.0)));
+    const unsigned int width = std::min ((unsigned int)ceil(4*sigma), center);
+    kernel_p.resize (width+1);
+    for (unsigned int d=0; d<=width; d++) {
+      kernel_p[d] = exp(-0.5*d*d/(sigma*sigma));
+    }
+
+#ifdef HAVE_FFTW3
+    /* Linear convolution: the size must exceed nofDepths_p+width */
+    fftSize_p = 1;
+    while (fftSize_p < nofDepths_p+width+1) {
+      fftSize_p *= 2;
+    }
+
+    fftw_complex *buffer = (fftw_complex*) fftw_malloc (sizeof(fftw_complex)*fftSize_p);
+    forward_p  = fftw_plan_dft_1d (fftSize_p, buffer, buffer, FFTW_FORWARD, FFTW_ESTIMATE);
+    backward_p = fftw_plan_dft_1d (fftSize_p, buffer, buffer, FFTW_BACKWARD, FFTW_ESTIMATE);
+
+    std::complex<double> *kernel = (std::complex<double>*) buffer;
+    std::fill (kernel, kernel+fftSize_p, std::complex<double>(0.0));
+    kernel[0] = kernel_p[0];
+    for (unsigned int d=1; d<=width; d++) {
+      kernel[d] = kernel[fftSize_p-d] = kernel_p[d];
+    }
+    fftw_execute (forward_p);
+
+    kernelFT_p.resize (fftSize_p);
+    for (unsigned int i=0; i<fftSize_p; i++) {
+      kernelFT_p[i] = kernel[i]/double(fftSize_p);
+    }
+    fftw_free (buffer);
+#endif
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmCubeClean
+
+  rmCubeClean::~rmCubeClean ()
+  {
+#ifdef HAVE_FFTW3
+    if (forward_p != NULL) {
+      fftw_destroy_plan (forward_p);
+    }
+    if (backward_p != NULL) {
+      fftw_destroy_plan (backward_p);
+    }
+#endif
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                 estimateFWHM
+
+  /*!
+    \param rmsf -- RMSF on 2n-1 Faraday depth offsets, centered at n-1.
+
+    \return fwhm -- Full width at half maximum of the amplitude of the main
+            peak, linearly interpolated between the Faraday depth samples.
+  */
+  double rmCubeClean::estimateFWHM (const std::vector<std::complex<double> > &rmsf)
+  {
+    if (rmsf.size() < 3 || rmsf.size()%2 == 0) {
+      throw "rmCubeClean::estimateFWHM: RMSF must have an odd number of values";
+    }
+
+    const unsigned int center = (rmsf.size()-1)/2;
+    const double half = 0.5*std::abs(rmsf[center]);
+    double width = 0;
+
+    /* Half width on both sides of the peak */
+    for (int side=-1; side<=1; side+=2) {
+      unsigned int d = 1;
+      while (d <= center && std::abs(rmsf[center+side*int(d)]) > half) {
+        d++;
+      }
+      if (d > center) {
+        width += center;
+      }
+      else {
+        double a0 = std::abs(rmsf[center+side*int(d-1)]);
+        double a1 = std::abs(rmsf[center+side*int(d)]);
+        width += (d-1) + (a0-half)/(a0-a1);
+      }
+    }
+
+    return width;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    cleanLine
+
+  /*!
+    \param residual   -- Dirty spectrum on input, residual on output.
+    \param components -- CLEAN components, zero on input.
+    \param tileMax    -- Work space for the peak of each tile.
+    \param tilePos    -- Work space for the position of the peak of each tile.
+    \param stats      -- Statistics of this line of sight.
+  */
+  void rmCubeClean::cleanLine (std::complex<double> *residual,
+                               std::complex<double> *components,
+                               std::vector<double> &tileMax,
+                               std::vector<unsigned int> &tilePos,
+                               rmCleanStatistics &stats) const
+  {
+    const unsigned int n = nofDepths_p;
+    const unsigned int T = RM_CLEAN_PEAK_TILE;
+    const unsigned int nofTiles = (n+T-1)/T;
+    const unsigned int center = n-1;
+
+    tileMax.resize (nofTiles);
+    tilePos.resize (nofTiles);
+
+    /* Peak (of the squared amplitude) of the tiles first to last */
+    #define RM_CLEAN_UPDATE_TILES(first, last)                           \
+    for (unsigned int t=(first); t<=(last); t++) {                       \
+      double m = -1;                                                     \
+      unsigned int pos = t*T;                                            \
+      for (unsigned int k=t*T; k<std::min(n,(t+1)*T); k++) {             \
+        double a = std::norm(residual[k]);                               \
+        if (a > m) {                                                     \
+          m = a;                                                         \
+          pos = k;                                                       \
+        }                                                                \
+      }                                                                  \
+      tileMax[t] = m;                                                    \
+      tilePos[t] = pos;                                                  \
+    }
+
+    RM_CLEAN_UPDATE_TILES (0, nofTiles-1);
+
+    stats.nofIterations = 0;
+    stats.nofComponents = 0;
+    stats.initialPeak   = sqrt(*std::max_element(tileMax.begin(), tileMax.end()));
+    stats.cleanFlux     = 0;
+
+    const double threshold = std::max (threshold_p, relativeThreshold_p*stats.initialPeak);
+
+    while (stats.nofIterations < maxIterations_p) {
+      const unsigned int tile = std::max_element(tileMax.begin(), tileMax.end())-tileMax.begin();
+      const unsigned int p = tilePos[tile];
+      if (sqrt(tileMax[tile]) <= threshold) {
+        break;
+      }
+
+      const std::complex<double> c = gain_p*residual[p];
+      if (components[p] == 0.0) {
+        stats.nofComponents++;
+      }
+      components[p] += c;
+      stats.cleanFlux += c;
+
+      /* residual[k] -= c*RMSF(k-p) within the support of the RMSF */
+      const unsigned int lo = (p > support_p) ? p-support_p : 0;
+      const unsigned int hi = std::min (n-1, p+support_p);
+      const std::complex<double> *shifted = &rmsf_p[center-p];
+      for (unsigned int k=lo; k<=hi; k++) {
+        residual[k] -= c*shifted[k];
+      }
+
+      RM_CLEAN_UPDATE_TILES (lo/T, hi/T);
+
+      stats.nofIterations++;
+    }
+
+    #undef RM_CLEAN_UPDATE_TILES
+
+    double sum = 0;
+    for (unsigned int k=0; k<n; k++) {
+      sum += std::norm(residual[k]);
+    }
+    stats.residualPeak = sqrt(*std::max_element(tileMax.begin(), tileMax.end()));
+    stats.residualRMS  = sqrt(sum/n);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  restoreLine
+
+  /*!
+    \param components -- CLEAN components of the line of sight.
+    \param restored   -- Convolution of the components with the restoring
+                         Gaussian.
+    \param buffer     -- Work space of fftSize_p values (with FFTW3).
+  */
+  void rmCubeClean::restoreLine (const std::complex<double> *components,
+                                 std::complex<double> *restored,
+                                 std::complex<double> *buffer) const
+  {
+    const unsigned int n = nofDepths_p;
+
+#ifdef HAVE_FFTW3
+    std::copy (components, components+n, buffer);
+    std::fill (buffer+n, buffer+fftSize_p, std::complex<double>(0.0));
+    fftw_execute_dft (forward_p, (fftw_complex*)buffer, (fftw_complex*)buffer);
+    for (unsigned int i=0; i<fftSize_p; i++) {
+      buffer[i] *= kernelFT_p[i];
+    }
+    fftw_execute_dft (backward_p, (fftw_complex*)buffer, (fftw_complex*)buffer);
+    std::copy (buffer, buffer+n, restored);
+#else
+    /* Direct convolution, only the (few) non-zero components contribute */
+    const int width = kernel_p.size()-1;
+    std::fill (restored, restored+n, std::complex<double>(0.0));
+    for (int j=0; j<(int)n; j++) {
+      if (components[j] == 0.0) {
+        continue;
+      }
+      for (int k=std::max(0,j-width); k<=std::min((int)n-1,j+width); k++) {
+        restored[k] += components[j]*kernel_p[std::abs(k-j)];
+      }
+    }
+    (void)buffer;
+#endif
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        clean
+
+  /*!
+    \param dirty       -- nofLines dirty Faraday spectra of nofDepths() values
+                          each, stored one after the other (i.e. the storage of
+                          a [faraday depth, x, y] cube).
+    \param restored    -- nofLines restored spectra (may be the same as dirty).
+    \param nofLines    -- Number of lines of sight.
+    \param addResidual -- Add the residual to the restored spectra?
+    \param residual    -- If not NULL, the residual spectra are stored here.
+    \param components  -- If not NULL, the CLEAN components are stored here.
+  */
+  void rmCubeClean::clean (const std::complex<double> *dirty,
+                           std::complex<double> *restored,
+                           unsigned long nofLines,
+                           bool addResidual,
+                           std::complex<double> *residual,
+                           std::complex<double> *components)
+  {
+    const unsigned int n = nofDepths_p;
+    long line;
+
+    statistics_p.resize (nofLines);
+
+#ifdef _OPENMP
+    int nofThreads = (nofThreads_p > 0) ? nofThreads_p : omp_get_max_threads();
+#pragma omp parallel private(line) num_threads(nofThreads)
+#endif
+    {
+      std::vector<std::complex<double> > res (n);
+      std::vector<std::complex<double> > comp (n);
+      std::vector<double> tileMax;
+      std::vector<unsigned int> tilePos;
+      std::complex<double> *buffer = NULL;
+
+#ifdef HAVE_FFTW3
+      buffer = (std::complex<double>*) fftw_malloc (sizeof(fftw_complex)*fftSize_p);
+#endif
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (line=0; line<(long)nofLines; line++) {
+        std::copy (dirty+line*n, dirty+(line+1)*n, res.begin());
+        std::fill (comp.begin(), comp.end(), std::complex<double>(0.0));
+
+        cleanLine (&res[0], &comp[0], tileMax, tilePos, statistics_p[line]);
+
+        std::complex<double> *out = restored+line*n;
+        restoreLine (&comp[0], out, buffer);
+        if (addResidual) {
+          for (unsigned int k=0; k<n; k++) {
+            out[k] += res[k];
+          }
+        }
+        if (residual != NULL) {
+          std::copy (res.begin(), res.end(), residual+line*n);
+        }
+        if (components != NULL) {
+          std::copy (comp.begin(), comp.end(), components+line*n);
+        }
+      }
+
+#ifdef HAVE_FFTW3
+      fftw_free (buffer);
+#endif
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                              writeStatistics
+
+  /*!
+    \param filename -- Name of the ASCII file, one row per line of sight.
+    \param nx       -- Size of the cube in x direction, used to give the pixel
+                       position (x,y) of each line of sight.
+  */
+  void rmCubeClean::writeStatistics (const std::string &filename,
+                                     unsigned int nx) const
+  {
+    std::ofstream outfile (filename.c_str());
+
+    if (outfile.fail()) {
+      throw "rmCubeClean::writeStatistics failed to open file";
+    }
+    if (nx == 0) {
+      nx = 1;
+    }
+
+    outfile << "# x\ty\titerations\tcomponents\tinitial_peak\tresidual_peak\tresidual_rms\tflux_q\tflux_u" << std::endl;
+    for (unsigned long i=0; i<statistics_p.size(); i++) {
+      const rmCleanStatistics &s = statistics_p[i];
+      outfile << i%nx << "\t" << i/nx << "\t"
+              << s.nofIterations << "\t" << s.nofComponents << "\t"
+              << s.initialPeak << "\t" << s.residualPeak << "\t" << s.residualRMS << "\t"
+              << s.cleanFlux.real() << "\t" << s.cleanFlux.imag() << std::endl;
+    }
+
+    outfile.close();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      summary
+
+  /*
+    \param os -- Output stream to which the summary is written.
+  */
+  void rmCubeClean::summary (std::ostream &os)
+  {
+    os << "[rmCubeClean] Summary of internal parameters" << std::endl;
+
+    os << "-- nof. Faraday depths    = " << nofDepths_p       << std::endl;
+    os << "-- Gain                   = " << gain_p            << std::endl;
+    os << "-- Threshold              = " << threshold_p       << std::endl;
+    os << "-- Relative threshold     = " << relativeThreshold_p << std::endl;
+    os << "-- Max. iterations        = " << maxIterations_p   << std::endl;
+    os << "-- RMSF support           = " << support_p         << std::endl;
+    os << "-- Restoring FWHM         = " << fwhm_p            << std::endl;
+    os << "-- FFT size               = " << fftSize_p         << std::endl;
+    os << "-- nof. threads           = " << nofThreads_p      << std::endl;
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,244 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_CUBECLEAN_H
+#define RM_CUBECLEAN_H
+
+#include <complex>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef HAVE_FFTW3
+#include <fftw3.h>
+#endif
+
+//! Number of Faraday depths per tile of the peak search
+#define RM_CLEAN_PEAK_TILE 64
+
+namespace RM {
+
+  /*!
+    \brief Iteration statistics of the RM-CLEAN of one line of sight
+  */
+  struct rmCleanStatistics {
+    //! Number of CLEAN iterations
+    unsigned int nofIterations;
+    //! Number of different Faraday depths with CLEAN components
+    unsigned int nofComponents;
+    //! Peak of the dirty spectrum
+    double initialPeak;
+    //! Peak of the residual spectrum
+    double residualPeak;
+    //! RMS of the residual spectrum
+    double residualRMS;
+    //! Sum of the CLEAN components
+    std::complex<double> cleanFlux;
+  };
+
+  /*!
+    \class rmCubeClean
+
+    \ingroup RM
+
+    \brief RM-CLEAN of many Faraday spectra sharing the same RMSF
+
+    \date 17.10.2026
+
+    \test trmCubeClean.cpp
+
+    <h3>Prerequisite</h3>
+
+    <ul type="square">
+      <li>rmSynthesis
+      <li>rmclean
+    </ul>
+
+    <h3>Synopsis</h3>
+
+    All lines of sight of a cube are synthesized with the same channels and
+    Faraday depths, so they share a single RMSF. rmCubeClean normalizes the
+    RMSF once and performs a Hogbom RM-CLEAN of each line of sight: the peak
+    of the residual is found, gain times the peak is added to the CLEAN
+    components and the RMSF shifted to the peak and scaled by the component
+    is subtracted from the residual. The lines of sight are distributed over
+    the threads (OpenMP, dynamic scheduling, as lines converge after
+    different numbers of iterations).
+
+    The peak search keeps the maximum of every tile of RM_CLEAN_PEAK_TILE
+    Faraday depths. With an RMSF cutoff only the part of the RMSF above the
+    cutoff is subtracted, and only the tiles within that window have to be
+    searched again.
+
+    The CLEAN components are restored by convolution with a Gaussian of the
+    FWHM of the RMSF. With FFTW3 the convolution is done by FFT, with the
+    Fourier transform of the Gaussian computed once.
+
+    The statistics of every line of sight (iterations, peaks, residual RMS,
+    CLEAN flux) are kept and can be written to a side table.
+
+    <h3>Example(s)</h3>
+
+    \code
+    rmCubeClean cleaner (rmsf, fwhm, 0.1, threshold, 1000);
+    cleaner.clean (&cubeIn.vals(0,0,0), &cubeOut.vals(0,0,0), nx*ny);
+    cleaner.writeStatistics ("clean.stats", nx);
+    \endcode
+  */
+  class rmCubeClean
+  {
+
+    //! Number of Faraday depths of a line of sight
+    unsigned int nofDepths_p;
+    //! Number of threads, 0 for the OpenMP default
+    unsigned int nofThreads_p;
+    //! Loop gain
+    double gain_p;
+    //! Absolute threshold of the residual peak
+    double threshold_p;
+    //! Threshold of the residual peak relative to the dirty peak
+    double relativeThreshold_p;
+    //! Maximum number of iterations per line of sight
+    unsigned int maxIterations_p;
+    //! RMSF normalized to 1 at zero Faraday depth, centered at nofDepths_p-1
+    std::vector<std::complex<double> > rmsf_p;
+    //! Half width of the part of the RMSF subtracted
+    unsigned int support_p;
+    //! FWHM of the restoring Gaussian in Faraday depth samples
+    double fwhm_p;
+    //! Restoring Gaussian for offsets 0 .. kernelWidth
+    std::vector<double> kernel_p;
+    //! Size of the FFT of the restoring convolution
+    unsigned int fftSize_p;
+    //! Fourier transform of the restoring Gaussian divided by fftSize_p
+    std::vector<std::complex<double> > kernelFT_p;
+#ifdef HAVE_FFTW3
+    //! Forward FFT plan, executed on per thread buffers
+    fftw_plan forward_p;
+    //! Backward FFT plan, executed on per thread buffers
+    fftw_plan backward_p;
+#endif
+    //! Statistics of the lines of sight of the last clean()
+    std::vector<rmCleanStatistics> statistics_p;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Argumented constructor
+    rmCubeClean (const std::vector<std::complex<double> > &rmsf,
+                 double fwhm,
+                 double gain=0.1,
+                 double threshold=0,
+                 unsigned int maxIterations=1000,
+                 double rmsfCutoff=0);
+
+    // === Destruction ==========================================================
+
+    //! Destructor
+    ~rmCubeClean ();
+
+    // === Parameter access =====================================================
+
+    //! Get the number of Faraday depths of a line of sight
+    inline unsigned int nofDepths () const {
+      return nofDepths_p;
+    }
+
+    //! Get the loop gain
+    inline double gain () const {
+      return gain_p;
+    }
+
+    //! Get the half width of the part of the RMSF subtracted
+    inline unsigned int support () const {
+      return support_p;
+    }
+
+    //! Set the threshold of the residual peak relative to the dirty peak
+    inline void setRelativeThreshold (double relativeThreshold) {
+      relativeThreshold_p = relativeThreshold;
+    }
+
+    //! Get the number of threads, 0 for the OpenMP default
+    inline unsigned int nofThreads () const {
+      return nofThreads_p;
+    }
+
+    //! Set the number of threads, 0 for the OpenMP default
+    inline void setNofThreads (unsigned int nofThreads) {
+      nofThreads_p = nofThreads;
+    }
+
+    //! Get the statistics of the lines of sight of the last clean()
+    inline const std::vector<rmCleanStatistics>& statistics () const {
+      return statistics_p;
+    }
+
+    // === Methods ==============================================================
+
+    //! Estimate the FWHM (in Faraday depth samples) of the main peak of an RMSF
+    static double estimateFWHM (const std::vector<std::complex<double> > &rmsf);
+
+    //! RM-CLEAN of nofLines consecutive lines of sight
+    void clean (const std::complex<double> *dirty,
+                std::complex<double> *restored,
+                unsigned long nofLines,
+                bool addResidual=true,
+                std::complex<double> *residual=NULL,
+                std::complex<double> *components=NULL);
+
+    //! Write the statistics of the last clean() to an ASCII table
+    void writeStatistics (const std::string &filename,
+                          unsigned int nx) const;
+
+    //! Provide a summary of the internal status
+    inline void summary () {
+      summary (std::cout);
+    }
+
+    //! Provide a summary of the internal status
+    void summary (std::ostream &os);
+
+  private:
+
+    //! Hogbom CLEAN of a single line of sight
+    void cleanLine (std::complex<double> *residual,
+                    std::complex<double> *components,
+                    std::vector<double> &tileMax,
+                    std::vector<unsigned int> &tilePos,
+                    rmCleanStatistics &stats) const;
+
+    //! Convolve the CLEAN components with the restoring Gaussian
+    void restoreLine (const std::complex<double> *components,
+                      std::complex<double> *restored,
+                      std::complex<double> *buffer) const;
+
+    //! Unassigned copy constructor
+    rmCubeClean (const rmCubeClean &other);
+
+    //! Unassigned copy operator
+    rmCubeClean& operator= (const rmCubeClean &other);
+
+  };  //  END -- class rmCubeClean
+
+}  // END -- namespace RM
+
+#endif
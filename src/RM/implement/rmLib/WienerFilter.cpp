@@ -491,11 +491,12 @@ vector<complex<double> > wienerfilter::applyR(vector<complex<double> > &map) {
 
 
 /*!
-  \brief functions generates the Matrix for performing the wiener filtering
+  \brief Set up the signal, noise and response matrices for the Wiener filtering
+
+  This is the common part of generateWienerFiltering and filterCube.
 */
-void wienerfilter::generateWienerFiltering(int noNoise, int flatPrior, double signal_var, double signal_corr, double noise_var, vector<uint> gaps, double eps, uint QR )
+void wienerfilter::setupWienerFiltering(int noNoise, int flatPrior, double signal_var, double signal_corr, double noise_var, vector<uint> gaps, double eps, uint QR )
 {
-//    cout << "doing WienerFiltering" << endl;	// debug
   setVariance_s(signal_var) ;
   setLambdaPhi(signal_corr) ;
   if (noNoise == 0 )   // don't create noise matrix if noNoise is active 
@@ -509,6 +510,15 @@ void wienerfilter::generateWienerFiltering(int noNoise, int flatPrior, double si
   R.realValOut("real.csv") ;
   R.imagValOut("imag.csv") ;
   R.absOut("Response.mat");
+}
+
+/*!
+  \brief functions generates the Matrix for performing the wiener filtering
+*/
+void wienerfilter::generateWienerFiltering(int noNoise, int flatPrior, double signal_var, double signal_corr, double noise_var, vector<uint> gaps, double eps, uint QR )
+{
+//    cout << "doing WienerFiltering" << endl;	// debug
+  setupWienerFiltering(noNoise, flatPrior, signal_var, signal_corr, noise_var, gaps, eps, QR) ;
   cout << "noNoise=" << noNoise << " flatPrior=" <<  flatPrior << endl ;
   // Perform Wiener Filtering computations
   if (noNoise == 0) {
@@ -1768,6 +1778,103 @@ void wienerfilter::computeWF()
 
 
 
+/*!
+	\brief Create a wienerSolver from the current R, N and S matrices
+
+	\param noNoise   - if not 0, no noise matrix is used (least squares)
+	\param flatPrior - if not 0, no signal covariance matrix is used
+*/
+wienerSolver wienerfilter::createSolver(int noNoise, int flatPrior)
+{
+  if(R.data.size()==0 || R.cols()==0) {
+    cerr << "wienerfilter::createSolver R has size 0" << endl ;
+    throw "wienerfilter::createSolver R has size 0";
+  }
+  uint nfreqs = R.rows() ;
+  uint nfaras = R.cols() ;
+
+  vector<complex<double> > response(nfreqs*nfaras) ;
+  for (uint i=0; i<nfreqs; i++) {
+    copy(R.data[i].begin(), R.data[i].end(), response.begin()+i*nfaras) ;
+  }
+  vector<double> noise ;
+  if (noNoise == 0) {
+    if (N.data.size() != nfreqs) {
+      cerr << "wienerfilter::createSolver N has invalid size" << endl ;
+      throw "wienerfilter::createSolver N has invalid size";
+    }
+    noise.resize(nfreqs*nfreqs) ;
+    for (uint i=0; i<nfreqs; i++) {
+      copy(N.data[i].begin(), N.data[i].end(), noise.begin()+i*nfreqs) ;
+    }
+  }
+  vector<complex<double> > signal ;
+  if (flatPrior == 0) {
+    if (S.data.size() != nfaras) {
+      cerr << "wienerfilter::createSolver S has invalid size" << endl ;
+      throw "wienerfilter::createSolver S has invalid size";
+    }
+    signal.resize(nfaras*nfaras) ;
+    for (uint i=0; i<nfaras; i++) {
+      copy(S.data[i].begin(), S.data[i].end(), signal.begin()+i*nfaras) ;
+    }
+  }
+  return wienerSolver(nfreqs, nfaras, response, noise, signal) ;
+}
+
+/*!
+	\brief Compute the Wiener Filter matrix WF with Cholesky/QR solves instead
+	of explicit inverses of S, N and the propagator (see wienerSolver)
+
+	\param noNoise   - if not 0, no noise matrix is used (least squares)
+	\param flatPrior - if not 0, no signal covariance matrix is used
+*/
+void wienerfilter::computeWF_Solver(int noNoise, int flatPrior)
+{
+  wienerSolver solver = createSolver(noNoise, flatPrior) ;
+  vector<complex<double> > op ;
+  solver.filterOperator(op) ;
+  uint nfreqs = solver.nofChannels() ;
+  uint nfaras = solver.nofDepths() ;
+  WF.set_size(nfaras, nfreqs) ;
+  for (uint k=0; k<nfaras; k++) {
+    copy(op.begin()+k*nfreqs, op.begin()+(k+1)*nfreqs, WF.data[k].begin()) ;
+  }
+  WF_ready=true ;
+}
+
+/*!
+	\brief Wiener filtering of all lines of sight of a cube
+
+	The matrices R, N (unless noNoise) and S (unless flatPrior) have to be set
+	up before, e.g. by setupWienerFiltering. The filter operator is factored
+	once for every pattern of flagged (non-finite) channels and applied to
+	blocks of lines of sight in parallel, see wienerSolver.
+
+	\param cubeIn    - cube of the data, [channel,x,y]
+	\param cubeOut   - cube for the result, [faraday depth,x,y]
+	\param noNoise   - if not 0, no noise matrix is used (least squares)
+	\param flatPrior - if not 0, no signal covariance matrix is used
+*/
+void wienerfilter::filterCube(rmCube &cubeIn, rmCube &cubeOut, int noNoise, int flatPrior)
+{
+  wienerSolver solver = createSolver(noNoise, flatPrior) ;
+  solver.summary() ;
+  if ((uint)cubeIn.vals.shape()(0) != solver.nofChannels()) {
+    throw "wienerfilter::filterCube number of channels does not match the response matrix";
+  }
+  if (cubeOut.vals.shape() != casa::IPosition(3,solver.nofDepths(),cubeIn.vals.shape()(1),cubeIn.vals.shape()(2))) {
+    throw "wienerfilter::filterCube output cube has incompatible shape";
+  }
+  if (!cubeIn.vals.contiguousStorage() || !cubeOut.vals.contiguousStorage()) {
+    throw "wienerfilter::filterCube cubes must have contiguous storage";
+  }
+  /* the lines of sight are the columns of the [channel,x,y] cubes */
+  uint nofPatterns = solver.apply(cubeIn.vals.data(), cubeOut.vals.data(), (unsigned long)cubeIn.vals.shape()(1)*cubeIn.vals.shape()(2)) ;
+  cout << "wiener filter applied, " << nofPatterns << " channel pattern(s)" << endl ;
+}
+
+
 //******************************************************************
 //
 // Delete Matrices that are not needed anymore
@@ -10,6 +10,7 @@
 // RM header files
 #include "rmNumUtils.h"
 #include "rmCube.h"
+#include "WienerSolver.h"
 
 using namespace std;
 
@@ -112,6 +113,7 @@ namespace RM {  //  namespace RM
   void createNoiseMatrix(vector<double> &noiseperchan);	// create a noise matrix with rms noise for each frequency channel
   void createResponseMatrix(vector<unsigned int> gaps, double eps, uint singVal );	 							// create the Response matrix frequencies as No. of columns, Faraday depths as No. of rows
   void createResponseMatrix(vector<double> intervals, double eps, uint singVal );	 							// create the Response matrix frequencies as No. of columns, Faraday depths as No. of rows
+  void setupWienerFiltering(int noNoise, int flatPrior, double signal_var, double signal_corr, double noise_var, vector<unsigned int> gaps, double eps, unsigned int QR ) ;
   void generateWienerFiltering(int noNoise, int flatPrior, double signal_var, double signal_corr, double noise_var, vector<unsigned int> gaps, double eps, unsigned int QR ) ;
   void generateWienerFiltering(int noNoise, double noise_var, vector<uint> gaps, cvec power, double eps, uint QR ) ;
   void generateWienerFiltering(int noNoise, double noise_var, vector<uint> gaps, cmat covMat, double eps, uint QR );
@@ -136,6 +138,11 @@ namespace RM {  //  namespace RM
   void computeW_noNoise();
   void computeM();					// M = W*R
 
+  // Solver mode: Cholesky/QR solves instead of explicit inverses
+  wienerSolver createSolver(int noNoise, int flatPrior);	// solver from the current R, N and S
+  void computeWF_Solver(int noNoise, int flatPrior);	// WF from the solver
+  void filterCube(rmCube &cubeIn, rmCube &cubeOut, int noNoise, int flatPrior);	// apply the solver to all lines of sight
+
   void reconstructm();					// function to reconstruct the map m
 
   // Functions to free memory of matrices that are not needed anymore
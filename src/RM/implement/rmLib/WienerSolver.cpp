@@ -0,0 +1,600 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <map>
+#include <WienerSolver.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace RM {
+
+  typedef std::complex<double> dcomplex;
+
+  // ============================================================================
+  //
+  //  Dense Hermitian / triangular helpers (row-major storage)
+  //
+  // ============================================================================
+
+  /*!
+    \brief In place Cholesky factorization A = L L^H of a Hermitian matrix
+
+    Only the lower triangle of A is used and overwritten with L.
+
+    \return false if A is not positive definite.
+  */
+  static bool choleskyDecomp (std::vector<dcomplex> &A,
+                              unsigned int n)
+  {
+    for (unsigned int j=0; j<n; j++) {
+      dcomplex *Lj = &A[(size_t)j*n];
+      double diag = Lj[j].real();
+      for (unsigned int k=0; k<j; k++) {
+        diag -= std::norm(Lj[k]);
+      }
+      if (!(diag > 0)) {
+        return false;
+      }
+      diag = sqrt(diag);
+      Lj[j] = diag;
+      for (unsigned int i=j+1; i<n; i++) {
+        dcomplex *Li = &A[(size_t)i*n];
+        dcomplex sum = Li[j];
+        for (unsigned int k=0; k<j; k++) {
+          sum -= Li[k]*conj(Lj[k]);
+        }
+        Li[j] = sum/diag;
+      }
+    }
+    return true;
+  }
+
+  /*!
+    \brief Solve L X = B in place for the n x nrhs matrix B
+  */
+  static void solveLower (const std::vector<dcomplex> &L,
+                          unsigned int n,
+                          std::vector<dcomplex> &B,
+                          unsigned int nrhs)
+  {
+    for (unsigned int i=0; i<n; i++) {
+      dcomplex *Bi = &B[(size_t)i*nrhs];
+      for (unsigned int k=0; k<i; k++) {
+        const dcomplex l = L[(size_t)i*n+k];
+        const dcomplex *Bk = &B[(size_t)k*nrhs];
+        for (unsigned int c=0; c<nrhs; c++) {
+          Bi[c] -= l*Bk[c];
+        }
+      }
+      const double diag = L[(size_t)i*n+i].real();
+      for (unsigned int c=0; c<nrhs; c++) {
+        Bi[c] /= diag;
+      }
+    }
+  }
+
+  /*!
+    \brief Solve L^H X = B in place for the n x nrhs matrix B
+  */
+  static void solveLowerAdjoint (const std::vector<dcomplex> &L,
+                                 unsigned int n,
+                                 std::vector<dcomplex> &B,
+                                 unsigned int nrhs)
+  {
+    for (unsigned int i=n; i-- > 0; ) {
+      dcomplex *Bi = &B[(size_t)i*nrhs];
+      const double diag = L[(size_t)i*n+i].real();
+      for (unsigned int c=0; c<nrhs; c++) {
+        Bi[c] /= diag;
+      }
+      /* eliminate x_i from the rows above */
+      for (unsigned int k=0; k<i; k++) {
+        const dcomplex l = conj(L[(size_t)i*n+k]);
+        dcomplex *Bk = &B[(size_t)k*nrhs];
+        for (unsigned int c=0; c<nrhs; c++) {
+          Bk[c] -= l*Bi[c];
+        }
+      }
+    }
+  }
+
+  // ============================================================================
+  //
+  //  Construction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                 wienerSolver
+
+  /*!
+    \param nofChannels -- Number of channels.
+    \param nofDepths   -- Number of Faraday depths.
+    \param response    -- Response matrix R, [channel][depth].
+    \param noise       -- Noise covariance N, either its nofChannels diagonal
+                          elements or the full [channel][channel] matrix.
+                          Without noise (empty vector) the filter is the least
+                          squares solution.
+    \param signal      -- Signal covariance S, [depth][depth]. An empty vector
+                          denotes a flat prior (S^{-1} = 0).
+  */
+  wienerSolver::wienerSolver (unsigned int nofChannels,
+                              unsigned int nofDepths,
+                              const std::vector<dcomplex> &response,
+                              const std::vector<double> &noise,
+                              const std::vector<dcomplex> &signal)
+    : nofChannels_p (nofChannels),
+      nofDepths_p (nofDepths),
+      nofThreads_p (0),
+      response_p (response),
+      noiseDiagonal_p (true),
+      signal_p (signal)
+  {
+    if (nofChannels_p == 0 || nofDepths_p == 0) {
+      throw "wienerSolver: no channels or Faraday depths given";
+    }
+    if (response_p.size() != (size_t)nofChannels_p*nofDepths_p) {
+      throw "wienerSolver: response matrix has incompatible size";
+    }
+    if (!signal_p.empty() && signal_p.size() != (size_t)nofDepths_p*nofDepths_p) {
+      throw "wienerSolver: signal covariance has incompatible size";
+    }
+
+    if (noise.size() == nofChannels_p || noise.empty()) {
+      noise_p = noise;
+    } else if (noise.size() == (size_t)nofChannels_p*nofChannels_p) {
+      /* Keep only the diagonal, if there are no correlations between channels */
+      for (unsigned int i=0; i<nofChannels_p && noiseDiagonal_p; i++) {
+        for (unsigned int j=0; j<nofChannels_p; j++) {
+          if (i != j && noise[(size_t)i*nofChannels_p+j] != 0) {
+            noiseDiagonal_p = false;
+            break;
+          }
+        }
+      }
+      if (noiseDiagonal_p) {
+        noise_p.resize (nofChannels_p);
+        for (unsigned int i=0; i<nofChannels_p; i++) {
+          noise_p[i] = noise[(size_t)i*nofChannels_p+i];
+        }
+      } else {
+        noise_p = noise;
+      }
+    } else {
+      throw "wienerSolver: noise covariance has incompatible size";
+    }
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                               filterOperator
+
+  /*!
+    \param valid -- Channels present in the data, the others are ignored.
+    \param op    -- Wiener filter operator, [depth][valid channel].
+  */
+  void wienerSolver::filterOperator (const std::vector<bool> &valid,
+                                     std::vector<dcomplex> &op) const
+  {
+    if (valid.size() != nofChannels_p) {
+      throw "wienerSolver::filterOperator: channel mask has incompatible length";
+    }
+
+    std::vector<unsigned int> channels;
+    for (unsigned int j=0; j<nofChannels_p; j++) {
+      if (valid[j]) {
+        channels.push_back (j);
+      }
+    }
+
+    if (channels.empty()) {
+      op.clear();
+    } else if (!signal_p.empty() && !noise_p.empty()) {
+      choleskyOperator (channels, op);
+    } else {
+      leastSquaresOperator (channels, op);
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                               filterOperator
+
+  /*!
+    \param op -- Wiener filter operator, [depth][channel].
+  */
+  void wienerSolver::filterOperator (std::vector<dcomplex> &op) const
+  {
+    filterOperator (std::vector<bool> (nofChannels_p, true), op);
+  }
+
+  //_____________________________________________________________________________
+  //                                                             choleskyOperator
+
+  /*!
+    With \f$ C = R S R^{\dagger} + N \f$ (restricted to the given channels) the
+    operator is \f$ S R^{\dagger} C^{-1} = (C^{-1} R S)^{\dagger} \f$, i.e. the
+    adjoint of the solution of C X = R S.
+  */
+  void wienerSolver::choleskyOperator (const std::vector<unsigned int> &channels,
+                                       std::vector<dcomplex> &op) const
+  {
+    const unsigned int nc = channels.size();
+    const unsigned int nd = nofDepths_p;
+
+    /* RS = R S */
+    std::vector<dcomplex> RS ((size_t)nc*nd, 0.0);
+    for (unsigned int i=0; i<nc; i++) {
+      const dcomplex *Ri = &response_p[(size_t)channels[i]*nd];
+      dcomplex *RSi = &RS[(size_t)i*nd];
+      for (unsigned int k=0; k<nd; k++) {
+        const dcomplex r = Ri[k];
+        const dcomplex *Sk = &signal_p[(size_t)k*nd];
+        for (unsigned int l=0; l<nd; l++) {
+          RSi[l] += r*Sk[l];
+        }
+      }
+    }
+
+    /* C = RS R^H + N, only the lower triangle is needed */
+    std::vector<dcomplex> C ((size_t)nc*nc, 0.0);
+    for (unsigned int i=0; i<nc; i++) {
+      const dcomplex *RSi = &RS[(size_t)i*nd];
+      for (unsigned int j=0; j<=i; j++) {
+        const dcomplex *Rj = &response_p[(size_t)channels[j]*nd];
+        dcomplex sum = 0.0;
+        for (unsigned int l=0; l<nd; l++) {
+          sum += RSi[l]*conj(Rj[l]);
+        }
+        if (noiseDiagonal_p) {
+          if (i == j) {
+            sum += noise_p[channels[i]];
+          }
+        } else {
+          sum += noise_p[(size_t)channels[i]*nofChannels_p+channels[j]];
+        }
+        C[(size_t)i*nc+j] = sum;
+      }
+    }
+
+    if (!choleskyDecomp (C, nc)) {
+      throw "wienerSolver: R S R^H + N is not positive definite";
+    }
+    solveLower (C, nc, RS, nd);
+    solveLowerAdjoint (C, nc, RS, nd);
+
+    op.resize ((size_t)nd*nc);
+    for (unsigned int i=0; i<nc; i++) {
+      for (unsigned int k=0; k<nd; k++) {
+        op[(size_t)k*nc+i] = conj(RS[(size_t)i*nd+k]);
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                         leastSquaresOperator
+
+  /*!
+    With the whitening \f$ W = L^{-1} \f$, \f$ N = L L^{\dagger} \f$ (or the
+    identity without noise), the operator is
+    \f$ (R^{\dagger} N^{-1} R)^{-1} R^{\dagger} N^{-1} = T^{-1} Q^{\dagger} W \f$
+    where \f$ W R = Q T \f$ is a Householder QR decomposition.
+  */
+  void wienerSolver::leastSquaresOperator (const std::vector<unsigned int> &channels,
+                                           std::vector<dcomplex> &op) const
+  {
+    const unsigned int nc = channels.size();
+    const unsigned int nd = nofDepths_p;
+
+    if (nc < nd) {
+      throw "wienerSolver: fewer channels than Faraday depths, a signal prior is needed";
+    }
+
+    /* A = W R and B = W */
+    std::vector<dcomplex> A ((size_t)nc*nd);
+    std::vector<dcomplex> B ((size_t)nc*nc, 0.0);
+    for (unsigned int i=0; i<nc; i++) {
+      std::copy (&response_p[(size_t)channels[i]*nd], &response_p[(size_t)channels[i]*nd]+nd, &A[(size_t)i*nd]);
+    }
+
+    if (noise_p.empty()) {
+      for (unsigned int i=0; i<nc; i++) {
+        B[(size_t)i*nc+i] = 1.0;
+      }
+    } else if (noiseDiagonal_p) {
+      for (unsigned int i=0; i<nc; i++) {
+        if (!(noise_p[channels[i]] > 0)) {
+          throw "wienerSolver: noise covariance is not positive definite";
+        }
+        const double w = 1.0/sqrt(noise_p[channels[i]]);
+        for (unsigned int k=0; k<nd; k++) {
+          A[(size_t)i*nd+k] *= w;
+        }
+        B[(size_t)i*nc+i] = w;
+      }
+    } else {
+      std::vector<dcomplex> L ((size_t)nc*nc);
+      for (unsigned int i=0; i<nc; i++) {
+        for (unsigned int j=0; j<nc; j++) {
+          L[(size_t)i*nc+j] = noise_p[(size_t)channels[i]*nofChannels_p+channels[j]];
+        }
+        B[(size_t)i*nc+i] = 1.0;
+      }
+      if (!choleskyDecomp (L, nc)) {
+        throw "wienerSolver: noise covariance is not positive definite";
+      }
+      solveLower (L, nc, A, nd);
+      solveLower (L, nc, B, nc);
+    }
+
+    /* Householder QR of A, the reflections are applied to B as well */
+    std::vector<dcomplex> v (nc);
+    std::vector<dcomplex> sA (nd);
+    std::vector<dcomplex> sB (nc);
+    double maxDiag = 0;
+
+    for (unsigned int k=0; k<nd; k++) {
+      double norm = 0;
+      for (unsigned int i=k; i<nc; i++) {
+        norm += std::norm(A[(size_t)i*nd+k]);
+      }
+      norm = sqrt(norm);
+
+      const dcomplex akk = A[(size_t)k*nd+k];
+      const dcomplex phase = (std::abs(akk) > 0) ? akk/std::abs(akk) : dcomplex(1.0);
+      const dcomplex alpha = -phase*norm;
+
+      double vnorm = 0;
+      for (unsigned int i=k; i<nc; i++) {
+        v[i] = A[(size_t)i*nd+k];
+      }
+      v[k] -= alpha;
+      for (unsigned int i=k; i<nc; i++) {
+        vnorm += std::norm(v[i]);
+      }
+
+      if (vnorm > 0) {
+        /* s = v^H A and s = v^H B, accumulated row by row */
+        std::fill (sA.begin()+k, sA.end(), dcomplex(0.0));
+        std::fill (sB.begin(), sB.end(), dcomplex(0.0));
+        for (unsigned int i=k; i<nc; i++) {
+          const dcomplex cv = conj(v[i]);
+          const dcomplex *Ai = &A[(size_t)i*nd];
+          const dcomplex *Bi = &B[(size_t)i*nc];
+          for (unsigned int c=k; c<nd; c++) {
+            sA[c] += cv*Ai[c];
+          }
+          for (unsigned int c=0; c<nc; c++) {
+            sB[c] += cv*Bi[c];
+          }
+        }
+        /* A -= 2 v s / |v|^2 */
+        for (unsigned int i=k; i<nc; i++) {
+          const dcomplex f = 2.0*v[i]/vnorm;
+          dcomplex *Ai = &A[(size_t)i*nd];
+          dcomplex *Bi = &B[(size_t)i*nc];
+          for (unsigned int c=k; c<nd; c++) {
+            Ai[c] -= f*sA[c];
+          }
+          for (unsigned int c=0; c<nc; c++) {
+            Bi[c] -= f*sB[c];
+          }
+        }
+      }
+      maxDiag = std::max (maxDiag, std::abs(A[(size_t)k*nd+k]));
+    }
+
+    for (unsigned int k=0; k<nd; k++) {
+      if (!(std::abs(A[(size_t)k*nd+k]) > 1e-12*maxDiag)) {
+        throw "wienerSolver: response matrix is rank deficient";
+      }
+    }
+
+    /* T X = (Q^H W)[0:nd], the first nd rows of B */
+    op.assign (B.begin(), B.begin()+(size_t)nd*nc);
+    for (unsigned int k=nd; k-- > 0; ) {
+      dcomplex *Xk = &op[(size_t)k*nc];
+      for (unsigned int c=k+1; c<nd; c++) {
+        const dcomplex t = A[(size_t)k*nd+c];
+        const dcomplex *Xc = &op[(size_t)c*nc];
+        for (unsigned int j=0; j<nc; j++) {
+          Xk[j] -= t*Xc[j];
+        }
+      }
+      const dcomplex diag = A[(size_t)k*nd+k];
+      for (unsigned int j=0; j<nc; j++) {
+        Xk[j] /= diag;
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    applyTile
+
+  /*!
+    \param opReal   -- Real part of the operator, [depth][valid channel].
+    \param opImag   -- Imaginary part of the operator.
+    \param channels -- Valid channels.
+    \param in       -- Lines of sight of nofChannels() values each.
+    \param out      -- Lines of nofDepths() values each.
+    \param lines    -- Indices of the nofLines lines of sight of the tile.
+    \param nofLines -- Number of lines in the tile, at most RM_WIENER_LINE_TILE.
+    \param buffer   -- Work space of the calling thread.
+  */
+  void wienerSolver::applyTile (const std::vector<double> &opReal,
+                                const std::vector<double> &opImag,
+                                const std::vector<unsigned int> &channels,
+                                const dcomplex *in,
+                                dcomplex *out,
+                                const unsigned long *lines,
+                                unsigned int nofLines,
+                                std::vector<double> &buffer) const
+  {
+    const unsigned int LT = RM_WIENER_LINE_TILE;
+    const unsigned int nc = channels.size();
+
+    buffer.resize (2*((size_t)nc+1)*LT);
+    double *inReal  = &buffer[0];
+    double *inImag  = inReal+(size_t)nc*LT;
+    double *accReal = inImag+(size_t)nc*LT;
+    double *accImag = accReal+LT;
+
+    /* Gather the valid channels of the tile, [channel][line] */
+    for (unsigned int j=0; j<nc; j++) {
+      for (unsigned int p=0; p<LT; p++) {
+        dcomplex val = (p < nofLines) ? in[lines[p]*nofChannels_p+channels[j]] : 0.0;
+        inReal[j*LT+p] = val.real();
+        inImag[j*LT+p] = val.imag();
+      }
+    }
+
+    for (unsigned int k=0; k<nofDepths_p; k++) {
+      const double *wr = &opReal[(size_t)k*nc];
+      const double *wi = &opImag[(size_t)k*nc];
+      for (unsigned int p=0; p<LT; p++) {
+        accReal[p] = 0;
+        accImag[p] = 0;
+      }
+      for (unsigned int j=0; j<nc; j++) {
+        const double a = wr[j];
+        const double b = wi[j];
+        const double *xr = inReal+j*LT;
+        const double *xi = inImag+j*LT;
+        for (unsigned int p=0; p<LT; p++) {
+          accReal[p] += a*xr[p] - b*xi[p];
+          accImag[p] += a*xi[p] + b*xr[p];
+        }
+      }
+      for (unsigned int p=0; p<nofLines; p++) {
+        out[lines[p]*nofDepths_p+k] = dcomplex(accReal[p], accImag[p]);
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        apply
+
+  /*!
+    \param in       -- nofLines lines of sight of nofChannels() values each,
+                       stored one after the other (i.e. the storage of a
+                       [channel, x, y] cube). Non-finite values mark flagged
+                       channels.
+    \param out      -- nofLines lines of nofDepths() values each.
+    \param nofLines -- Number of lines of sight.
+
+    \return nofPatterns -- Number of different patterns of flagged channels,
+            i.e. the number of factorizations performed.
+  */
+  unsigned int wienerSolver::apply (const dcomplex *in,
+                                    dcomplex *out,
+                                    unsigned long nofLines) const
+  {
+    typedef std::map<std::vector<bool>, std::vector<unsigned long> > patternMap;
+    patternMap patterns;
+
+    /* Group the lines of sight by their valid channels */
+    std::vector<bool> valid (nofChannels_p);
+    for (unsigned long line=0; line<nofLines; line++) {
+      const dcomplex *los = in+line*nofChannels_p;
+      for (unsigned int j=0; j<nofChannels_p; j++) {
+        /* false for NaN and infinity */
+        valid[j] = std::fabs(los[j].real()) <= DBL_MAX && std::fabs(los[j].imag()) <= DBL_MAX;
+      }
+      patterns[valid].push_back (line);
+    }
+
+    for (patternMap::const_iterator it=patterns.begin(); it!=patterns.end(); ++it) {
+      const std::vector<unsigned long> &lines = it->second;
+
+      std::vector<unsigned int> channels;
+      for (unsigned int j=0; j<nofChannels_p; j++) {
+        if (it->first[j]) {
+          channels.push_back (j);
+        }
+      }
+      if (channels.empty()) {
+        for (unsigned long p=0; p<lines.size(); p++) {
+          std::fill (out+lines[p]*nofDepths_p, out+(lines[p]+1)*nofDepths_p, dcomplex(0.0));
+        }
+        continue;
+      }
+
+      std::vector<dcomplex> op;
+      filterOperator (it->first, op);
+
+      std::vector<double> opReal (op.size());
+      std::vector<double> opImag (op.size());
+      for (size_t i=0; i<op.size(); i++) {
+        opReal[i] = op[i].real();
+        opImag[i] = op[i].imag();
+      }
+
+      const long LT = RM_WIENER_LINE_TILE;
+      const long nofTiles = (lines.size()+LT-1)/LT;
+      long tile;
+
+#ifdef _OPENMP
+      int nofThreads = (nofThreads_p > 0) ? nofThreads_p : omp_get_max_threads();
+#pragma omp parallel private(tile) num_threads(nofThreads)
+#endif
+      {
+        std::vector<double> buffer;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+        for (tile=0; tile<nofTiles; tile++) {
+          unsigned long first = tile*LT;
+          unsigned int n = std::min((unsigned long)LT, (unsigned long)lines.size()-first);
+          applyTile (opReal, opImag, channels, in, out, &lines[first], n, buffer);
+        }
+      }
+    }
+
+    return patterns.size();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      summary
+
+  /*
+    \param os -- Output stream to which the summary is written.
+  */
+  void wienerSolver::summary (std::ostream &os)
+  {
+    os << "[wienerSolver] Summary of internal parameters" << std::endl;
+
+    os << "-- nof. channels          = " << nofChannels_p << std::endl;
+    os << "-- nof. Faraday depths    = " << nofDepths_p   << std::endl;
+    os << "-- Signal prior           = " << (signal_p.empty() ? "flat" : "covariance") << std::endl;
+    os << "-- Noise                  = " << (noise_p.empty() ? "none" : (noiseDiagonal_p ? "diagonal" : "covariance")) << std::endl;
+    os << "-- Solver                 = " << ((!signal_p.empty() && !noise_p.empty()) ? "Cholesky" : "QR") << std::endl;
+    os << "-- nof. threads           = " << nofThreads_p  << std::endl;
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,181 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef WIENERSOLVER_H
+#define WIENERSOLVER_H
+
+#include <complex>
+#include <iostream>
+#include <vector>
+
+//! Number of lines of sight filtered together by one thread
+#define RM_WIENER_LINE_TILE 32
+
+namespace RM {
+
+  /*!
+    \class wienerSolver
+
+    \ingroup RM
+
+    \brief Wiener filter operator from Cholesky and QR solves, applied to many
+           lines of sight at once
+
+    \date 17.10.2026
+
+    \test tWienerSolver.cpp
+
+    <h3>Prerequisite</h3>
+
+    <ul type="square">
+      <li>wienerfilter
+    </ul>
+
+    <h3>Synopsis</h3>
+
+    For data \f$ d = R s + n \f$ with response R (channels x Faraday depths),
+    signal covariance S and noise covariance N the Wiener filter is
+    \f[
+      WF = (S^{-1} + R^{\dagger} N^{-1} R)^{-1} R^{\dagger} N^{-1}
+         = S R^{\dagger} (R S R^{\dagger} + N)^{-1} .
+    \f]
+    wienerfilter evaluates the first form with explicit inverses. wienerSolver
+    uses the second form and a Cholesky factorization of
+    \f$ R S R^{\dagger} + N \f$, so neither S nor N is inverted. Without a
+    signal prior (flat prior) or without noise the filter is the (noise
+    weighted) least squares solution, which is computed from a Householder QR
+    decomposition of the whitened response. A diagonal noise matrix is only
+    added to the diagonal, or scales the rows of the response.
+
+    The operator only depends on the channels which are present in a line of
+    sight. apply() groups the lines of sight by their pattern of flagged
+    channels (non-finite values), factors once per pattern and applies the
+    operator to tiles of RM_WIENER_LINE_TILE lines of sight as a matrix
+    product, distributed over the threads (OpenMP).
+
+    <h3>Example(s)</h3>
+
+    \code
+    wienerSolver solver (nofChannels, nofDepths, response, noise, signal);
+    solver.apply (&cubeIn.vals(0,0,0), &cubeOut.vals(0,0,0), nx*ny);
+    \endcode
+  */
+  class wienerSolver
+  {
+
+    //! Number of channels
+    unsigned int nofChannels_p;
+    //! Number of Faraday depths
+    unsigned int nofDepths_p;
+    //! Number of threads, 0 for the OpenMP default
+    unsigned int nofThreads_p;
+    //! Response matrix, [channel][depth]
+    std::vector<std::complex<double> > response_p;
+    //! Noise covariance, diagonal or [channel][channel], empty without noise
+    std::vector<double> noise_p;
+    //! Is the noise covariance diagonal?
+    bool noiseDiagonal_p;
+    //! Signal covariance, [depth][depth], empty for a flat prior
+    std::vector<std::complex<double> > signal_p;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Argumented constructor
+    wienerSolver (unsigned int nofChannels,
+                  unsigned int nofDepths,
+                  const std::vector<std::complex<double> > &response,
+                  const std::vector<double> &noise,
+                  const std::vector<std::complex<double> > &signal);
+
+    // === Parameter access =====================================================
+
+    //! Get the number of channels
+    inline unsigned int nofChannels () const {
+      return nofChannels_p;
+    }
+
+    //! Get the number of Faraday depths
+    inline unsigned int nofDepths () const {
+      return nofDepths_p;
+    }
+
+    //! Is the noise covariance diagonal?
+    inline bool noiseDiagonal () const {
+      return noiseDiagonal_p;
+    }
+
+    //! Get the number of threads, 0 for the OpenMP default
+    inline unsigned int nofThreads () const {
+      return nofThreads_p;
+    }
+
+    //! Set the number of threads, 0 for the OpenMP default
+    inline void setNofThreads (unsigned int nofThreads) {
+      nofThreads_p = nofThreads;
+    }
+
+    // === Methods ==============================================================
+
+    //! Wiener filter operator for the channels marked as valid
+    void filterOperator (const std::vector<bool> &valid,
+                         std::vector<std::complex<double> > &op) const;
+
+    //! Wiener filter operator for all channels
+    void filterOperator (std::vector<std::complex<double> > &op) const;
+
+    //! Filter nofLines consecutive lines of sight
+    unsigned int apply (const std::complex<double> *in,
+                        std::complex<double> *out,
+                        unsigned long nofLines) const;
+
+    //! Provide a summary of the internal status
+    inline void summary () {
+      summary (std::cout);
+    }
+
+    //! Provide a summary of the internal status
+    void summary (std::ostream &os);
+
+  private:
+
+    //! Operator of the Gaussian prior from a Cholesky factorization
+    void choleskyOperator (const std::vector<unsigned int> &channels,
+                           std::vector<std::complex<double> > &op) const;
+
+    //! Least squares operator from a QR decomposition
+    void leastSquaresOperator (const std::vector<unsigned int> &channels,
+                               std::vector<std::complex<double> > &op) const;
+
+    //! Apply an operator to a tile of lines of sight
+    void applyTile (const std::vector<double> &opReal,
+                    const std::vector<double> &opImag,
+                    const std::vector<unsigned int> &channels,
+                    const std::complex<double> *in,
+                    std::complex<double> *out,
+                    const unsigned long *lines,
+                    unsigned int nofLines,
+                    std::vector<double> &buffer) const;
+
+  };  //  END -- class wienerSolver
+
+}  // END -- namespace RM
+
+#endif
@@ -215,6 +215,30 @@ complex<double> rmCube::integrateLamdaSq(vector<complex<double> > &QU,vector<dou
     }
     return erg ;
 }
+
+/*! Procedure performs the RM-Synthesis of performRMSynthesis for all lines of
+  * sight of the cube at once. The phase kernel (or the gridding weights of the 
+  * nonuniform FFT) is computed only once and applied to tiles of lines of sight
+  * in parallel, see rmSynthesis.
+  * \param	cubeOut		: cube for the result, with faradays.size() Faraday depths
+  * \param	lambdas		: lambda^2 of the channels of the cube
+  * \param	faradays	: faraday depths for which the new QU values are calculated
+  * \param	gaps		: first indices of the intervals without gaps (see findGaps)
+  * \param	method		: direct transform, nonuniform FFT or automatic choice */
+void rmCube::performRMSynthesis(rmCube &cubeOut, vector<double> &lambdas, vector<double> &faradays, vector<uint> &gaps, rmSynthesis::Method method) {
+  if ((uint)vals.shape()(0) != lambdas.size()) {
+    throw ("performRMSynthesis: number of lambda squareds does not match the cube") ;
+  }
+  if (cubeOut.vals.shape() != IPosition(3,faradays.size(),vals.shape()(1),vals.shape()(2))) {
+    throw ("performRMSynthesis: output cube has incompatible shape") ;
+  }
+  if (!vals.contiguousStorage() || !cubeOut.vals.contiguousStorage()) {
+    throw ("performRMSynthesis: cubes must have contiguous storage") ;
+  }
+  rmSynthesis synthesis(lambdas, faradays, gaps, method) ;
+  /* the lines of sight are the columns of the [channel,x,y] cubes */
+  synthesis.transform(vals.data(), cubeOut.vals.data(), (unsigned long)vals.shape()(1)*vals.shape()(2)) ;
+}
   /*!
     \brief Empty constructor
   */
@@ -853,6 +877,69 @@ void rmCube::copyMetaData(PagedImage<Float> &tarImage) {
     
     //   cout << "rmCube::rmCube(int x, int y, vector<double> faradayDepths) constructor" << endl;  
   }
+
+  /*!
+    \brief Constructor reading a tiled spectral-major cube
+
+    The values of a line of sight are contiguous both in the mapped file and in
+    vals, so each line of sight is copied with one sequential read.
+
+    \param tiled - Mapped tiled cube, e.g. written by rmcornerturn
+  */
+  rmCube::rmCube(const rmTiledCube &tiled)
+  {
+    if (!tiled.isOpen())
+      throw "rmCube::rmCube tiled cube is not open";
+
+    this->axis=tiled.axis();
+    this->rmType=tiled.axis();
+    this->xSize=tiled.nx();
+    this->ySize=tiled.ny();
+    this->freqSize=tiled.nofChannels();
+    this->faradaySize=tiled.nofChannels();
+    this->pix=-32;	// FLOAT_IMG
+
+    this->buffer=NULL;
+    this->currentX=0;
+    this->currentY=0;
+    this->currentFaradayDepth=0;
+    this->ra=0;
+    this->dec=0;
+    this->ra_low=0;
+    this->ra_high=0;
+    this->dec_low=0;
+    this->dec_high=0;
+
+    switch(axis) {
+    case 1:
+      freqs=tiled.axisValues();
+      freqsInter=tiled.axisIntervals();
+      break;
+    case 2:
+      lambdaSqs=tiled.axisValues();
+      deltaLambdaSqs=tiled.axisIntervals();
+      break;
+    case 3:
+      faradayDepths=tiled.axisValues();
+      break;
+    }
+    allocMemory(axis==3) ;
+
+    /* tile by tile, so the file is read front to back */
+    for (uint t=0; t<tiled.nofTiles(); t++) {
+      uint x0, y0;
+      tiled.tileOrigin(t, x0, y0);
+      for (uint y=y0; y<std::min(y0+tiled.tileY(),ySize); y++) {
+        for (uint x=x0; x<std::min(x0+tiled.tileX(),xSize); x++) {
+          const complex<float> *line=tiled.lineOfSight(x,y);
+          complex<double> *dest=&vals(0,x,y);
+          for (uint i=0; i<freqSize; i++) {
+            dest[i]=complex<double>(line[i].real(), line[i].imag());
+          }
+        }
+      }
+    }
+  }
   
   
   //===============================================================================
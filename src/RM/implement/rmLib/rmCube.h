@@ -18,6 +18,8 @@
 /* RM-Synthesis header files */
 #include "rm.h"
 #include "rmIO.h"
+#include "rmSynthesis.h"
+#include "rmTiledCube.h"
 /* casacore headre files */
 #include <casa/Arrays/IPosition.h>
 #include <casa/Arrays/Array.h>
@@ -151,6 +153,8 @@ namespace RM {
     rmCube(string qpath, string upath,int axis, double f_min, double f_max) ;
     //! Constructo for a rmCube generated from an casa image directory
     rmCube(string imagePath, string imageName, string query, casa::Vector<int> &inds ) ;
+    //! Constructor for a rmCube read from a tiled spectral-major cube (see rmTiledCube)
+    rmCube(const rmTiledCube &tiled) ;
     //! procedure to allocate memory for the current rmCube object, to be called from constructors 
     void allocMemory(bool faraday) ;
     void readDir(string path, vector<string> &dats) ;
@@ -196,6 +200,8 @@ namespace RM {
     vector<double> freqsToFarraday(vector<double> freqs, double cq ) ;
     vector<complex<double> > performRMSynthesis(vector<complex<double> > &QU, vector<double> &lambdas, vector<double> &faradays, vector<uint> &gaps, double nu_0, double alpha, double epsilon);
     complex<double> integrateLamdaSq(vector<complex<double> > &QU,vector<double> &lambdas, double faraday, vector<uint> gaps, double nu_0, double alpha, double epsilon) ;
+    //! RM-Synthesis of all lines of sight of the cube into cubeOut (see rmSynthesis)
+    void performRMSynthesis(rmCube &cubeOut, vector<double> &lambdas, vector<double> &faradays, vector<uint> &gaps, rmSynthesis::Method method=rmSynthesis::Automatic) ;
     vector<double> freqToLambdaSq(const vector<double> &frequency) ;
     double getRA();				//! get total RA of field
     double getDec();				//! get total Dec of field
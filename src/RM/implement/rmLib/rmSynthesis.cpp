@@ -0,0 +1,430 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <rmSynthesis.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmSynthesis
+
+  /*!
+    \param lambdaSqs     -- Lambda squareds of the channels.
+    \param faradayDepths -- Faraday depths to compute.
+    \param gaps          -- First channel of each interval without gaps, plus
+                            the number of channels (see findGaps).
+    \param method        -- Method used for the transform. The nonuniform FFT
+                            requires equidistant Faraday depths.
+  */
+  rmSynthesis::rmSynthesis (const std::vector<double> &lambdaSqs,
+                            const std::vector<double> &faradayDepths,
+                            const std::vector<unsigned int> &gaps,
+                            Method method)
+    : nofChannels_p (lambdaSqs.size()),
+      nofDepths_p (faradayDepths.size()),
+      nofThreads_p (0),
+      method_p (Direct),
+      weights_p (lambdaSqs.size(), 0.0),
+      gridSize_p (0)
+  {
+#ifdef HAVE_FFTW3
+    plan_p = NULL;
+#endif
+
+    if (nofChannels_p == 0 || nofDepths_p == 0) {
+      throw "rmSynthesis: no channels or Faraday depths given";
+    }
+    if (gaps.size() < 2 || gaps.back() > nofChannels_p) {
+      throw "rmSynthesis: gaps do not match the channels";
+    }
+
+    /* Integration interval of each channel, as in rmCube::integrateLamdaSq */
+    for (unsigned int i=0; i<gaps.size()-1; i++) {
+      unsigned int anf  = gaps[i];
+      unsigned int ende = gaps[i+1];
+      for (unsigned int j=anf; j<ende; j++) {
+        double lam_a = (j==anf) ? lambdaSqs[anf] : 0.5*(lambdaSqs[j-1]+lambdaSqs[j]);
+        double lam_b = (j==ende-1) ? lambdaSqs[ende-1] : 0.5*(lambdaSqs[j]+lambdaSqs[j+1]);
+        weights_p[j] = lam_b-lam_a;
+      }
+    }
+
+    /* The nonuniform FFT needs equidistant Faraday depths */
+    bool equidistant = (nofDepths_p > 1);
+    if (equidistant) {
+      double delta = (faradayDepths.back()-faradayDepths.front())/(nofDepths_p-1);
+      equidistant = (delta != 0);
+      for (unsigned int k=0; equidistant && k<nofDepths_p; k++) {
+        equidistant = std::fabs(faradayDepths[k]-faradayDepths[0]-k*delta) <= 1e-9*std::fabs(delta);
+      }
+    }
+
+#ifdef HAVE_FFTW3
+    bool haveNUFFT = equidistant;
+#else
+    bool haveNUFFT = false;
+#endif
+
+    switch (method) {
+    case NUFFT:
+      if (!haveNUFFT) {
+        throw "rmSynthesis: nonuniform FFT requires FFTW3 and equidistant Faraday depths";
+      }
+      method_p = NUFFT;
+      break;
+    case Automatic:
+      method_p = (haveNUFFT && nofDepths_p >= RM_SYNTHESIS_NUFFT_THRESHOLD) ? NUFFT : Direct;
+      break;
+    default:
+      method_p = Direct;
+    }
+
+    if (method_p == NUFFT) {
+      initNUFFT (lambdaSqs, faradayDepths);
+    } else {
+      initDirect (lambdaSqs, faradayDepths);
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmSynthesis
+
+  rmSynthesis::~rmSynthesis ()
+  {
+#ifdef HAVE_FFTW3
+    if (plan_p != NULL) {
+      fftw_destroy_plan (plan_p);
+    }
+#endif
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                   initDirect
+
+  /*!
+    The rows of the phase matrix already contain the integration intervals.
+  */
+  void rmSynthesis::initDirect (const std::vector<double> &lambdaSqs,
+                                const std::vector<double> &faradayDepths)
+  {
+    kernelReal_p.resize ((size_t)nofDepths_p*nofChannels_p);
+    kernelImag_p.resize ((size_t)nofDepths_p*nofChannels_p);
+
+    for (unsigned int k=0; k<nofDepths_p; k++) {
+      for (unsigned int j=0; j<nofChannels_p; j++) {
+        double arg = -2.0*faradayDepths[k]*lambdaSqs[j];
+        kernelReal_p[(size_t)k*nofChannels_p+j] = weights_p[j]*cos(arg);
+        kernelImag_p[(size_t)k*nofChannels_p+j] = weights_p[j]*sin(arg);
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    initNUFFT
+
+  /*!
+    With \f$ \phi_k = \phi_0 + k \Delta\phi \f$ and \f$ x_j = 2 \Delta\phi
+    \lambda_j^2 \f$ the transform is a nonuniform FFT of type 1
+    \f[
+      F(\phi_k) = \sum_j c_j \exp(-i k x_j), \quad
+      c_j = w_j P_j \exp(-2 i \phi_0 \lambda_j^2) .
+    \f]
+    It is evaluated by Gaussian gridding on a grid oversampled by a factor
+    two, an FFT and a deconvolution with the Fourier transform of the
+    Gaussian (Greengard & Lee 2004, SIAM Review 46, 443). All factors that
+    only depend on the channels and Faraday depths are computed here.
+  */
+  void rmSynthesis::initNUFFT (const std::vector<double> &lambdaSqs,
+                               const std::vector<double> &faradayDepths)
+  {
+#ifdef HAVE_FFTW3
+    const int spread = RM_SYNTHESIS_NUFFT_SPREAD;
+    const double twopi = 2.0*M_PI;
+    const double M = nofDepths_p;
+    const double phi0 = faradayDepths.front();
+    const double delta = (faradayDepths.back()-faradayDepths.front())/(nofDepths_p-1);
+    /* Shift of the output indices to the symmetric range [-M/2, M/2) */
+    const int shift = nofDepths_p/2;
+
+    gridSize_p = std::max(2*nofDepths_p, (unsigned int)(4*spread));
+
+    const double ratio = double(gridSize_p)/M;
+    const double tau = M_PI*spread/(M*M*ratio*(ratio-0.5));
+    const double cell = twopi/gridSize_p;
+
+    gridOffset_p.resize (nofChannels_p);
+    gridWeights_p.resize ((size_t)nofChannels_p*2*spread);
+    gridFactor_p.resize (nofChannels_p);
+
+    for (unsigned int j=0; j<nofChannels_p; j++) {
+      double x = fmod (2.0*delta*lambdaSqs[j], twopi);
+      if (x < 0) x += twopi;
+
+      int first = (int)floor(x/cell) - spread + 1;
+      for (int l=0; l<2*spread; l++) {
+        double d = x-(first+l)*cell;
+        gridWeights_p[(size_t)j*2*spread+l] = exp(-d*d/(4.0*tau));
+      }
+      gridOffset_p[j] = (first+gridSize_p) % gridSize_p;
+
+      double arg = -2.0*phi0*lambdaSqs[j] - shift*x;
+      gridFactor_p[j] = weights_p[j]*std::complex<double>(cos(arg), sin(arg));
+    }
+
+    deconvolution_p.resize (nofDepths_p);
+    for (unsigned int k=0; k<nofDepths_p; k++) {
+      double kk = double(k)-shift;
+      deconvolution_p[k] = sqrt(M_PI/tau)*exp(kk*kk*tau)/gridSize_p;
+    }
+
+    /* Plan on a temporary buffer, executed on per thread buffers of the same alignment */
+    fftw_complex *grid = (fftw_complex*) fftw_malloc (sizeof(fftw_complex)*gridSize_p);
+    plan_p = fftw_plan_dft_1d (gridSize_p, grid, grid, FFTW_FORWARD, FFTW_ESTIMATE);
+    fftw_free (grid);
+#else
+    /* Without FFTW the transform falls back to the direct sums */
+    (void)lambdaSqs;
+    (void)faradayDepths;
+#endif
+  }
+
+  //_____________________________________________________________________________
+  //                                                              transformDirect
+
+  /*!
+    The lines of sight of the tile are transposed into planar real and
+    imaginary parts, so that the multiply-accumulate over the lines of the
+    tile vectorizes. Blocks of RM_SYNTHESIS_DEPTH_TILE rows of the phase
+    matrix and RM_SYNTHESIS_CHANNEL_TILE channels keep the working set in
+    cache.
+  */
+  void rmSynthesis::transformDirect (const std::complex<double> *in,
+                                     std::complex<double> *out,
+                                     unsigned int nofLines,
+                                     std::vector<double> &buffer) const
+  {
+    const unsigned int LT = RM_SYNTHESIS_LINE_TILE;
+    const unsigned int DT = RM_SYNTHESIS_DEPTH_TILE;
+    const unsigned int CT = RM_SYNTHESIS_CHANNEL_TILE;
+    const unsigned int nc = nofChannels_p;
+
+    buffer.resize (2*(size_t)nc*LT + 2*DT*LT);
+
+    double *inReal  = &buffer[0];
+    double *inImag  = inReal + (size_t)nc*LT;
+    double *accReal = inImag + (size_t)nc*LT;
+    double *accImag = accReal + DT*LT;
+
+    /* Transpose the tile, unused lines are zero */
+    for (unsigned int j=0; j<nc; j++) {
+      for (unsigned int p=0; p<LT; p++) {
+        std::complex<double> val = (p < nofLines) ? in[(size_t)p*nc+j] : 0.0;
+        inReal[(size_t)j*LT+p] = val.real();
+        inImag[(size_t)j*LT+p] = val.imag();
+      }
+    }
+
+    for (unsigned int kb=0; kb<nofDepths_p; kb+=DT) {
+      unsigned int kn = std::min(DT, nofDepths_p-kb);
+
+      std::fill (accReal, accReal+DT*LT, 0.0);
+      std::fill (accImag, accImag+DT*LT, 0.0);
+
+      for (unsigned int jb=0; jb<nc; jb+=CT) {
+        unsigned int jn = std::min(CT, nc-jb);
+
+        for (unsigned int k=0; k<kn; k++) {
+          const double *kr = &kernelReal_p[(size_t)(kb+k)*nc+jb];
+          const double *ki = &kernelImag_p[(size_t)(kb+k)*nc+jb];
+          double *ar = accReal + k*LT;
+          double *ai = accImag + k*LT;
+
+          for (unsigned int j=0; j<jn; j++) {
+            const double cr = kr[j];
+            const double ci = ki[j];
+            const double *xr = inReal + (size_t)(jb+j)*LT;
+            const double *xi = inImag + (size_t)(jb+j)*LT;
+
+            for (unsigned int p=0; p<LT; p++) {
+              ar[p] += cr*xr[p] - ci*xi[p];
+              ai[p] += cr*xi[p] + ci*xr[p];
+            }
+          }
+        }
+      }
+
+      for (unsigned int p=0; p<nofLines; p++) {
+        for (unsigned int k=0; k<kn; k++) {
+          out[(size_t)p*nofDepths_p+kb+k] = std::complex<double>(accReal[k*LT+p], accImag[k*LT+p]);
+        }
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                               transformNUFFT
+
+  void rmSynthesis::transformNUFFT (const std::complex<double> *in,
+                                    std::complex<double> *out,
+                                    std::complex<double> *grid) const
+  {
+#ifdef HAVE_FFTW3
+    const int spread = RM_SYNTHESIS_NUFFT_SPREAD;
+    const int gridSize = gridSize_p;
+
+    std::fill (grid, grid+gridSize, 0.0);
+
+    /* Spread the weighted channels onto the oversampled grid */
+    for (unsigned int j=0; j<nofChannels_p; j++) {
+      const std::complex<double> c = gridFactor_p[j]*in[j];
+      const double *w = &gridWeights_p[(size_t)j*2*spread];
+      int m = gridOffset_p[j];
+
+      for (int l=0; l<2*spread; l++) {
+        grid[m] += c*w[l];
+        if (++m == gridSize) m = 0;
+      }
+    }
+
+    fftw_execute_dft (plan_p, (fftw_complex*)grid, (fftw_complex*)grid);
+
+    /* Deconvolve, output index k corresponds to grid frequency k-M/2 */
+    const int shift = nofDepths_p/2;
+    for (unsigned int k=0; k<nofDepths_p; k++) {
+      int q = (int)k-shift;
+      if (q < 0) q += gridSize;
+      out[k] = deconvolution_p[k]*grid[q];
+    }
+#else
+    (void)in;
+    (void)out;
+    (void)grid;
+#endif
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    transform
+
+  /*!
+    \param in       -- nofLines lines of sight of nofChannels() values each,
+                       stored one after the other (i.e. the storage of a
+                       [channel, x, y] cube).
+    \param out      -- nofLines lines of nofDepths() values each.
+    \param nofLines -- Number of lines of sight.
+  */
+  void rmSynthesis::transform (const std::complex<double> *in,
+                               std::complex<double> *out,
+                               unsigned long nofLines) const
+  {
+    const long LT = RM_SYNTHESIS_LINE_TILE;
+    const long nofTiles = (nofLines+LT-1)/LT;
+    long tile;
+
+#ifdef _OPENMP
+    int nofThreads = (nofThreads_p > 0) ? nofThreads_p : omp_get_max_threads();
+#pragma omp parallel private(tile) num_threads(nofThreads)
+#endif
+    {
+      std::vector<double> buffer;
+      std::complex<double> *grid = NULL;
+
+#ifdef HAVE_FFTW3
+      if (method_p == NUFFT) {
+        grid = (std::complex<double>*) fftw_malloc (sizeof(fftw_complex)*gridSize_p);
+      }
+#endif
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic)
+#endif
+      for (tile=0; tile<nofTiles; tile++) {
+        unsigned long first = tile*LT;
+        unsigned int n = std::min((unsigned long)LT, nofLines-first);
+
+        if (method_p == NUFFT) {
+          for (unsigned int p=0; p<n; p++) {
+            transformNUFFT (in+(first+p)*nofChannels_p, out+(first+p)*nofDepths_p, grid);
+          }
+        } else {
+          transformDirect (in+first*nofChannels_p, out+first*nofDepths_p, n, buffer);
+        }
+      }
+
+#ifdef HAVE_FFTW3
+      if (grid != NULL) {
+        fftw_free (grid);
+      }
+#endif
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    transform
+
+  std::vector<std::complex<double> > rmSynthesis::transform (const std::vector<std::complex<double> > &in) const
+  {
+    if (in.size() != nofChannels_p) {
+      throw "rmSynthesis::transform: line of sight has incompatible length";
+    }
+
+    std::vector<std::complex<double> > out (nofDepths_p);
+
+    transform (&in[0], &out[0], 1);
+
+    return out;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      summary
+
+  /*
+    \param os -- Output stream to which the summary is written.
+  */
+  void rmSynthesis::summary (std::ostream &os)
+  {
+    os << "[rmSynthesis] Summary of internal parameters" << std::endl;
+
+    os << "-- nof. channels          = " << nofChannels_p << std::endl;
+    os << "-- nof. Faraday depths    = " << nofDepths_p   << std::endl;
+    os << "-- Method                 = " << ((method_p == NUFFT) ? "NUFFT" : "Direct") << std::endl;
+    os << "-- nof. threads           = " << nofThreads_p  << std::endl;
+    if (method_p == NUFFT) {
+      os << "-- Oversampled grid size  = " << gridSize_p << std::endl;
+    }
+  }
+
+}  // END -- namespace RM
@@ -0,0 +1,222 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_SYNTHESIS_H
+#define RM_SYNTHESIS_H
+
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#ifdef HAVE_FFTW3
+#include <fftw3.h>
+#endif
+
+//! Number of lines of sight transformed together by one thread
+#define RM_SYNTHESIS_LINE_TILE 32
+//! Number of Faraday depths accumulated together in the direct transform
+#define RM_SYNTHESIS_DEPTH_TILE 64
+//! Number of lambda squared channels per block of the direct transform
+#define RM_SYNTHESIS_CHANNEL_TILE 256
+//! Half width (in grid cells) of the gridding kernel of the nonuniform FFT
+#define RM_SYNTHESIS_NUFFT_SPREAD 12
+//! Minimum number of Faraday depths for which the nonuniform FFT is used by default
+#define RM_SYNTHESIS_NUFFT_THRESHOLD 256
+
+namespace RM {
+
+  /*!
+    \class rmSynthesis
+
+    \ingroup RM
+
+    \brief RM-Synthesis of many lines of sight sharing the same channels
+
+    \date 17.10.2026
+
+    \test trmSynthesis.cpp
+
+    <h3>Prerequisite</h3>
+
+    <ul type="square">
+      <li>rmCube::performRMSynthesis
+    </ul>
+
+    <h3>Synopsis</h3>
+
+    For all lines of sight of a cube the channels (lambda squareds), their
+    integration intervals and the Faraday depths are identical. The Fourier
+    sum of rmCube::performRMSynthesis
+    \f[
+      F(\phi_k) = \sum_j w_j P(\lambda_j^2) \exp(-2 i \phi_k \lambda_j^2)
+    \f]
+    therefore is a product of one phase matrix with the matrix of all lines
+    of sight. rmSynthesis computes the phase matrix once and applies it to
+    tiles of RM_SYNTHESIS_LINE_TILE lines of sight at a time, which are
+    distributed over the threads (OpenMP).
+
+    For large equidistant Faraday depth grids the transform can instead be
+    evaluated with a nonuniform FFT (Gaussian gridding of the channels onto
+    an oversampled regular grid followed by an FFTW transform). The
+    gridding weights are again shared by all lines of sight.
+
+    <h3>Example(s)</h3>
+
+    \code
+    rmSynthesis synthesis (lambdas, faras, gaps);
+    synthesis.transform (&cubeIn.vals(0,0,0), &cubeOut.vals(0,0,0), nx*ny);
+    \endcode
+  */
+  class rmSynthesis
+  {
+  public:
+
+    //! Method used to evaluate the transform
+    enum Method {
+      //! Choose the nonuniform FFT for large equidistant Faraday depth grids
+      Automatic,
+      //! Direct product with the phase matrix
+      Direct,
+      //! Nonuniform FFT (requires FFTW3 and equidistant Faraday depths)
+      NUFFT
+    };
+
+  private:
+
+    //! Number of channels
+    unsigned int nofChannels_p;
+    //! Number of Faraday depths
+    unsigned int nofDepths_p;
+    //! Number of threads, 0 for the OpenMP default
+    unsigned int nofThreads_p;
+    //! Method used for the transform
+    Method method_p;
+    //! Integration interval of each channel
+    std::vector<double> weights_p;
+    //! Real part of the phase matrix, [depth][channel]
+    std::vector<double> kernelReal_p;
+    //! Imaginary part of the phase matrix, [depth][channel]
+    std::vector<double> kernelImag_p;
+    //! Size of the oversampled grid of the nonuniform FFT
+    unsigned int gridSize_p;
+    //! First grid cell each channel is spread to
+    std::vector<int> gridOffset_p;
+    //! Gridding weights, [channel][2*RM_SYNTHESIS_NUFFT_SPREAD]
+    std::vector<double> gridWeights_p;
+    //! Phase factor and integration interval of each channel
+    std::vector<std::complex<double> > gridFactor_p;
+    //! Deconvolution of each Faraday depth
+    std::vector<double> deconvolution_p;
+#ifdef HAVE_FFTW3
+    //! FFTW plan of the oversampled grid, executed on per thread buffers
+    fftw_plan plan_p;
+#endif
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Argumented constructor
+    rmSynthesis (const std::vector<double> &lambdaSqs,
+                 const std::vector<double> &faradayDepths,
+                 const std::vector<unsigned int> &gaps,
+                 Method method=Automatic);
+
+    // === Destruction ==========================================================
+
+    //! Destructor
+    ~rmSynthesis ();
+
+    // === Parameter access =====================================================
+
+    //! Get the number of lambda squared channels
+    inline unsigned int nofChannels () const {
+      return nofChannels_p;
+    }
+
+    //! Get the number of Faraday depths
+    inline unsigned int nofDepths () const {
+      return nofDepths_p;
+    }
+
+    //! Get the method used for the transform
+    inline Method method () const {
+      return method_p;
+    }
+
+    //! Get the number of threads, 0 for the OpenMP default
+    inline unsigned int nofThreads () const {
+      return nofThreads_p;
+    }
+
+    //! Set the number of threads, 0 for the OpenMP default
+    inline void setNofThreads (unsigned int nofThreads) {
+      nofThreads_p = nofThreads;
+    }
+
+    // === Methods ==============================================================
+
+    //! Transform nofLines consecutive lines of sight
+    void transform (const std::complex<double> *in,
+                    std::complex<double> *out,
+                    unsigned long nofLines) const;
+
+    //! Transform a single line of sight
+    std::vector<std::complex<double> > transform (const std::vector<std::complex<double> > &in) const;
+
+    //! Provide a summary of the internal status
+    inline void summary () {
+      summary (std::cout);
+    }
+
+    //! Provide a summary of the internal status
+    void summary (std::ostream &os);
+
+  private:
+
+    //! Compute the phase matrix of the direct transform
+    void initDirect (const std::vector<double> &lambdaSqs,
+                     const std::vector<double> &faradayDepths);
+
+    //! Compute the gridding weights of the nonuniform FFT
+    void initNUFFT (const std::vector<double> &lambdaSqs,
+                    const std::vector<double> &faradayDepths);
+
+    //! Direct transform of a tile of lines of sight
+    void transformDirect (const std::complex<double> *in,
+                          std::complex<double> *out,
+                          unsigned int nofLines,
+                          std::vector<double> &buffer) const;
+
+    //! Nonuniform FFT of a single line of sight
+    void transformNUFFT (const std::complex<double> *in,
+                         std::complex<double> *out,
+                         std::complex<double> *grid) const;
+
+    //! Unassigned copy constructor
+    rmSynthesis (const rmSynthesis &other);
+
+    //! Unassigned copy operator
+    rmSynthesis& operator= (const rmSynthesis &other);
+
+  };  //  END -- class rmSynthesis
+
+}  // END -- namespace RM
+
+#endif
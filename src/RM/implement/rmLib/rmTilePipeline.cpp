@@ -0,0 +1,293 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <rmTilePipeline.h>
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                               rmTilePipeline
+
+  /*!
+    \param input        -- Mapped input cube.
+    \param output       -- Writable output cube with the same image size and
+                           tiling, processor.nofOutputValues() channels.
+    \param processor    -- Computation stage.
+    \param memoryBudget -- Memory for the tile buffers in bytes; at least one
+                           buffer (see bufferSize) must fit, three or more keep
+                           all stages busy.
+  */
+  rmTilePipeline::rmTilePipeline (const rmTiledCube &input,
+                                  rmTiledCube &output,
+                                  rmTileProcessor &processor,
+                                  size_t memoryBudget)
+    : input_p (input),
+      output_p (output),
+      processor_p (processor),
+      memoryBudget_p (memoryBudget),
+      nofBuffers_p (0),
+      free_p (NULL),
+      read_p (NULL),
+      processed_p (NULL),
+      abort_p (false),
+      error_p (NULL)
+  {
+    if (!input.isOpen() || !output.isOpen() || !output.writable()) {
+      throw "rmTilePipeline: input must be open, output open and writable";
+    }
+    if (input.nx() != output.nx() || input.ny() != output.ny()
+        || input.tileX() != output.tileX() || input.tileY() != output.tileY()) {
+      throw "rmTilePipeline: input and output differ in image size or tiling";
+    }
+    if (input.nofChannels() != processor.nofInputValues()
+        || output.nofChannels() != processor.nofOutputValues()) {
+      throw "rmTilePipeline: number of channels does not match the processor";
+    }
+
+    nofBuffers_p = std::min<size_t> (memoryBudget_p/bufferSize(), input.nofTiles());
+    if (nofBuffers_p == 0) {
+      throw "rmTilePipeline: memory budget smaller than one tile buffer";
+    }
+
+    pthread_mutex_init (&errorMutex_p, NULL);
+  }
+
+  //_____________________________________________________________________________
+  //                                                              ~rmTilePipeline
+
+  rmTilePipeline::~rmTilePipeline ()
+  {
+    pthread_mutex_destroy (&errorMutex_p);
+  }
+
+  // ============================================================================
+  //
+  //  Parameter access
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                   bufferSize
+
+  size_t rmTilePipeline::bufferSize () const
+  {
+    return (size_t)input_p.tileX()*input_p.tileY()
+      * (processor_p.nofInputValues()+processor_p.nofOutputValues())
+      * sizeof(std::complex<double>);
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                          run
+
+  /*!
+    Starts the reader and writer threads and processes the tiles in the
+    calling thread. Returns when all tiles have been written; a failure of
+    any stage is rethrown here.
+  */
+  void rmTilePipeline::run ()
+  {
+    const unsigned long nofLines = (unsigned long)input_p.tileX()*input_p.tileY();
+
+    std::vector<tileBuffer> buffers (nofBuffers_p);
+    rmBoundedQueue<tileBuffer*> freeQueue (nofBuffers_p);
+    rmBoundedQueue<tileBuffer*> readQueue (nofBuffers_p+1);
+    rmBoundedQueue<tileBuffer*> processedQueue (nofBuffers_p+1);
+
+    for (unsigned int i=0; i<nofBuffers_p; i++) {
+      buffers[i].in.resize (nofLines*processor_p.nofInputValues());
+      buffers[i].out.resize (nofLines*processor_p.nofOutputValues());
+      freeQueue.push (&buffers[i]);
+    }
+
+    free_p      = &freeQueue;
+    read_p      = &readQueue;
+    processed_p = &processedQueue;
+    abort_p     = false;
+    error_p     = NULL;
+
+    pthread_t reader, writer;
+    if (pthread_create (&reader, NULL, readThread, this) != 0) {
+      throw "rmTilePipeline::run could not start reader thread";
+    }
+    bool haveWriter = (pthread_create (&writer, NULL, writeThread, this) == 0);
+    if (!haveWriter) {
+      /* processed tiles are discarded below, the reader stops */
+      fail ("rmTilePipeline::run could not start writer thread");
+    }
+
+    /* Computation stage */
+    for (tileBuffer *buffer = readQueue.pop(); buffer != NULL; buffer = readQueue.pop()) {
+      if (aborted()) {
+        freeQueue.push (buffer);
+        continue;
+      }
+      try {
+        processor_p.process (buffer->tile, &buffer->in[0], &buffer->out[0], nofLines);
+        if (haveWriter) {
+          processedQueue.push (buffer);
+        }
+        else {
+          freeQueue.push (buffer);
+        }
+      } catch (const char *message) {
+        fail (message);
+        freeQueue.push (buffer);
+      }
+    }
+    processedQueue.push (NULL);
+
+    pthread_join (reader, NULL);
+    if (haveWriter) {
+      pthread_join (writer, NULL);
+    }
+
+    free_p = read_p = processed_p = NULL;
+
+    if (error_p != NULL) {
+      throw error_p;
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         read
+
+  void rmTilePipeline::read ()
+  {
+    const unsigned int nofTiles = input_p.nofTiles();
+    const size_t tileSize = input_p.tileSize();
+
+    for (unsigned int t=0; t<nofTiles && !aborted(); t++) {
+      tileBuffer *buffer = free_p->pop();
+      try {
+        if (t+1 < nofTiles) {
+          input_p.prefetch (t+1);
+        }
+        const std::complex<float> *values = input_p.tile (t);
+        for (size_t i=0; i<tileSize; i++) {
+          buffer->in[i] = std::complex<double> (values[i].real(), values[i].imag());
+        }
+        input_p.release (t);
+        buffer->tile = t;
+        read_p->push (buffer);
+      } catch (const char *message) {
+        fail (message);
+        free_p->push (buffer);
+      }
+    }
+    read_p->push (NULL);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        write
+
+  void rmTilePipeline::write ()
+  {
+    const size_t tileSize = output_p.tileSize();
+
+    for (tileBuffer *buffer = processed_p->pop(); buffer != NULL; buffer = processed_p->pop()) {
+      if (!aborted()) {
+        try {
+          std::complex<float> *values = output_p.writableTile (buffer->tile);
+          for (size_t i=0; i<tileSize; i++) {
+            values[i] = std::complex<float> (buffer->out[i].real(), buffer->out[i].imag());
+          }
+          output_p.release (buffer->tile);
+        } catch (const char *message) {
+          fail (message);
+        }
+      }
+      free_p->push (buffer);
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         fail
+
+  void rmTilePipeline::fail (const char *message)
+  {
+    pthread_mutex_lock (&errorMutex_p);
+    if (error_p == NULL) {
+      error_p = message;
+    }
+    abort_p = true;
+    pthread_mutex_unlock (&errorMutex_p);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      aborted
+
+  bool rmTilePipeline::aborted ()
+  {
+    pthread_mutex_lock (&errorMutex_p);
+    bool result = abort_p;
+    pthread_mutex_unlock (&errorMutex_p);
+    return result;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   readThread
+
+  void* rmTilePipeline::readThread (void *pipeline)
+  {
+    static_cast<rmTilePipeline*>(pipeline)->read ();
+    return NULL;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  writeThread
+
+  void* rmTilePipeline::writeThread (void *pipeline)
+  {
+    static_cast<rmTilePipeline*>(pipeline)->write ();
+    return NULL;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      summary
+
+  /*
+    \param os -- Output stream to which the summary is written.
+  */
+  void rmTilePipeline::summary (std::ostream &os)
+  {
+    os << "[rmTilePipeline] Summary of internal parameters" << std::endl;
+
+    os << "-- nof. tiles             = " << input_p.nofTiles()          << std::endl;
+    os << "-- Tile size              = " << input_p.tileX() << " x " << input_p.tileY() << std::endl;
+    os << "-- Input values per line  = " << processor_p.nofInputValues()  << std::endl;
+    os << "-- Output values per line = " << processor_p.nofOutputValues() << std::endl;
+    os << "-- Memory budget [bytes]  = " << memoryBudget_p               << std::endl;
+    os << "-- Buffer size [bytes]    = " << bufferSize()                 << std::endl;
+    os << "-- nof. buffers           = " << nofBuffers_p                 << std::endl;
+  }
+
+}  // END -- namespace RM
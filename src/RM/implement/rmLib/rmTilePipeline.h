@@ -0,0 +1,293 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_TILEPIPELINE_H
+#define RM_TILEPIPELINE_H
+
+#include <complex>
+#include <deque>
+#include <iostream>
+#include <vector>
+#include <pthread.h>
+
+#include "rmTiledCube.h"
+
+namespace RM {
+
+  /*!
+    \class rmBoundedQueue
+
+    \ingroup RM
+
+    \brief FIFO of limited capacity shared between threads
+
+    push() blocks while the queue is full, pop() while it is empty.
+  */
+  template <class T>
+  class rmBoundedQueue
+  {
+
+    //! Maximum number of elements
+    size_t capacity_p;
+    //! Elements in the queue
+    std::deque<T> elements_p;
+    //! Protects elements_p
+    pthread_mutex_t mutex_p;
+    //! Signalled when an element was removed
+    pthread_cond_t notFull_p;
+    //! Signalled when an element was added
+    pthread_cond_t notEmpty_p;
+
+  public:
+
+    //! Argumented constructor
+    rmBoundedQueue (size_t capacity)
+      : capacity_p (capacity)
+    {
+      pthread_mutex_init (&mutex_p, NULL);
+      pthread_cond_init (&notFull_p, NULL);
+      pthread_cond_init (&notEmpty_p, NULL);
+    }
+
+    //! Destructor
+    ~rmBoundedQueue ()
+    {
+      pthread_cond_destroy (&notEmpty_p);
+      pthread_cond_destroy (&notFull_p);
+      pthread_mutex_destroy (&mutex_p);
+    }
+
+    //! Append an element, wait while the queue is full
+    void push (const T &element)
+    {
+      pthread_mutex_lock (&mutex_p);
+      while (elements_p.size() >= capacity_p) {
+        pthread_cond_wait (&notFull_p, &mutex_p);
+      }
+      elements_p.push_back (element);
+      pthread_cond_signal (&notEmpty_p);
+      pthread_mutex_unlock (&mutex_p);
+    }
+
+    //! Remove the first element, wait while the queue is empty
+    T pop ()
+    {
+      pthread_mutex_lock (&mutex_p);
+      while (elements_p.empty()) {
+        pthread_cond_wait (&notEmpty_p, &mutex_p);
+      }
+      T element = elements_p.front();
+      elements_p.pop_front ();
+      pthread_cond_signal (&notFull_p);
+      pthread_mutex_unlock (&mutex_p);
+      return element;
+    }
+
+  private:
+
+    //! Unassigned copy constructor
+    rmBoundedQueue (const rmBoundedQueue &other);
+
+    //! Unassigned copy operator
+    rmBoundedQueue& operator= (const rmBoundedQueue &other);
+
+  };  //  END -- class rmBoundedQueue
+
+  /*!
+    \class rmTileProcessor
+
+    \ingroup RM
+
+    \brief Computation stage of an rmTilePipeline
+
+    process() is called by a single thread, one tile after the other; it may
+    use OpenMP internally (as rmSynthesis and rmCubeClean do).
+  */
+  class rmTileProcessor
+  {
+  public:
+
+    //! Destructor
+    virtual ~rmTileProcessor () {}
+
+    //! Number of input values per line of sight
+    virtual unsigned int nofInputValues () const = 0;
+
+    //! Number of output values per line of sight
+    virtual unsigned int nofOutputValues () const = 0;
+
+    //! Process the nofLines lines of sight of a tile (in may be overwritten)
+    virtual void process (unsigned int tile,
+                          std::complex<double> *in,
+                          std::complex<double> *out,
+                          unsigned long nofLines) = 0;
+  };
+
+  /*!
+    \class rmTilePipeline
+
+    \ingroup RM
+
+    \brief Read tile -> process -> write tile, with disk I/O overlapping compute
+
+    \date 17.10.2026
+
+    \test trmTilePipeline.cpp
+
+    <h3>Prerequisite</h3>
+
+    <ul type="square">
+      <li>rmTiledCube
+      <li>rmTileProcessor
+    </ul>
+
+    <h3>Synopsis</h3>
+
+    The tiles of an input rmTiledCube are processed into the tiles of an
+    output rmTiledCube with the same tiling by three stages:
+
+    <ol>
+      <li>a reader thread copies a tile of the (memory-mapped) input into a
+          buffer and asks the kernel to read ahead the next tile;
+      <li>the calling thread runs the rmTileProcessor on the buffer;
+      <li>a writer thread copies the result into the output tile.
+    </ol>
+
+    The stages are connected by rmBoundedQueue's. The number of tile buffers
+    is set by the memory budget, and a buffer is only reused once the writer
+    has stored its result; the memory used is therefore the budget, however
+    large the cube is. The pages of the mapped files are released after each
+    tile, so they do not accumulate either.
+
+    <h3>Example(s)</h3>
+
+    \code
+    rmTiledCube in, out;
+    in.open ("field.rmtc");
+    out.create ("faraday.rmtc", in.nx(), in.ny(), faradays, std::vector<double>(),
+                in.tileX(), in.tileY(), 3);
+    rmTilePipeline pipeline (in, out, processor, 1024*1024*1024);
+    pipeline.run();
+    \endcode
+  */
+  class rmTilePipeline
+  {
+
+    //! Buffer of one tile travelling through the pipeline
+    struct tileBuffer {
+      //! Index of the tile
+      unsigned int tile;
+      //! Input lines of sight
+      std::vector<std::complex<double> > in;
+      //! Output lines of sight
+      std::vector<std::complex<double> > out;
+    };
+
+    //! Cube the tiles are read from
+    const rmTiledCube &input_p;
+    //! Cube the tiles are written to
+    rmTiledCube &output_p;
+    //! Computation stage
+    rmTileProcessor &processor_p;
+    //! Memory budget for the tile buffers in bytes
+    size_t memoryBudget_p;
+    //! Number of tile buffers
+    unsigned int nofBuffers_p;
+    //! Buffers not in use
+    rmBoundedQueue<tileBuffer*> *free_p;
+    //! Buffers read, waiting for processing
+    rmBoundedQueue<tileBuffer*> *read_p;
+    //! Buffers processed, waiting for writing
+    rmBoundedQueue<tileBuffer*> *processed_p;
+    //! Set when a stage failed, the other stages stop
+    bool abort_p;
+    //! Message of the first failure
+    const char *error_p;
+    //! Protects error_p and abort_p
+    pthread_mutex_t errorMutex_p;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Argumented constructor
+    rmTilePipeline (const rmTiledCube &input,
+                    rmTiledCube &output,
+                    rmTileProcessor &processor,
+                    size_t memoryBudget);
+
+    // === Destruction ==========================================================
+
+    //! Destructor
+    ~rmTilePipeline ();
+
+    // === Parameter access =====================================================
+
+    //! Get the number of tile buffers allowed by the memory budget
+    inline unsigned int nofBuffers () const {
+      return nofBuffers_p;
+    }
+
+    //! Get the size of one tile buffer in bytes
+    size_t bufferSize () const;
+
+    // === Methods ==============================================================
+
+    //! Process all tiles
+    void run ();
+
+    //! Provide a summary of the internal status
+    inline void summary () {
+      summary (std::cout);
+    }
+
+    //! Provide a summary of the internal status
+    void summary (std::ostream &os);
+
+  private:
+
+    //! Reader stage
+    void read ();
+
+    //! Writer stage
+    void write ();
+
+    //! Record the first failure and stop the other stages
+    void fail (const char *message);
+
+    //! Has a stage failed?
+    bool aborted ();
+
+    //! Entry point of the reader thread
+    static void* readThread (void *pipeline);
+
+    //! Entry point of the writer thread
+    static void* writeThread (void *pipeline);
+
+    //! Unassigned copy constructor
+    rmTilePipeline (const rmTilePipeline &other);
+
+    //! Unassigned copy operator
+    rmTilePipeline& operator= (const rmTilePipeline &other);
+
+  };  //  END -- class rmTilePipeline
+
+}  // END -- namespace RM
+
+#endif
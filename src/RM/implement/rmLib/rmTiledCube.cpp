@@ -0,0 +1,472 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <rmTiledCube.h>
+
+namespace RM {
+
+  // ============================================================================
+  //
+  //  Construction / Destruction
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                  rmTiledCube
+
+  rmTiledCube::rmTiledCube ()
+    : fd_p (-1),
+      map_p (NULL),
+      mapSize_p (0),
+      writable_p (false)
+  {
+    memset (&header_p, 0, sizeof(header_p));
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 ~rmTiledCube
+
+  rmTiledCube::~rmTiledCube ()
+  {
+    close ();
+  }
+
+  // ============================================================================
+  //
+  //  Methods
+  //
+  // ============================================================================
+
+  //_____________________________________________________________________________
+  //                                                                       create
+
+  /*!
+    \param filename      -- Name of the file to create (an existing file is
+                            overwritten).
+    \param nx            -- Number of pixels in x direction.
+    \param ny            -- Number of pixels in y direction.
+    \param axisValues    -- Values of the spectral axis (frequencies, lambda
+                            squared or Faraday depths).
+    \param axisIntervals -- Interval lengths of the spectral axis, either of
+                            the same size as axisValues or empty.
+    \param tileX         -- Number of pixels of a tile in x direction.
+    \param tileY         -- Number of pixels of a tile in y direction.
+    \param axis          -- Type of the spectral axis (1 = frequencies,
+                            2 = lambda squared, 3 = Faraday depths).
+  */
+  void rmTiledCube::create (const std::string &filename,
+                            unsigned int nx,
+                            unsigned int ny,
+                            const std::vector<double> &axisValues,
+                            const std::vector<double> &axisIntervals,
+                            unsigned int tileX,
+                            unsigned int tileY,
+                            int axis)
+  {
+    if (nx == 0 || ny == 0) {
+      throw "rmTiledCube::create image size is 0";
+    }
+    if (axisValues.size() == 0) {
+      throw "rmTiledCube::create spectral axis has size 0";
+    }
+    if (axisIntervals.size() != 0 && axisIntervals.size() != axisValues.size()) {
+      throw "rmTiledCube::create axisIntervals and axisValues differ in size";
+    }
+    if (tileX == 0 || tileY == 0) {
+      throw "rmTiledCube::create tile size is 0";
+    }
+
+    close ();
+
+    memset (&header_p, 0, sizeof(header_p));
+    memcpy (header_p.magic, RM_TILEDCUBE_MAGIC, sizeof(header_p.magic));
+    header_p.axis        = axis;
+    header_p.nx          = nx;
+    header_p.ny          = ny;
+    header_p.nofChannels = axisValues.size();
+    header_p.tileX       = std::min (tileX, nx);
+    header_p.tileY       = std::min (tileY, ny);
+
+    axisValues_p    = axisValues;
+    axisIntervals_p = axisIntervals;
+    axisIntervals_p.resize (axisValues.size(), 0.0);
+
+    /* Tiles start on a page boundary */
+    const size_t page   = sysconf (_SC_PAGESIZE);
+    const size_t header = sizeof(header_p) + 2*header_p.nofChannels*sizeof(double);
+    header_p.dataOffset = ((header+page-1)/page)*page;
+
+    const size_t size = header_p.dataOffset + (size_t)nofTiles()*tileSize()*sizeof(std::complex<float>);
+
+    fd_p = ::open (filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_p < 0) {
+      throw "rmTiledCube::create could not create file";
+    }
+    if (ftruncate (fd_p, size) != 0) {
+      close ();
+      throw "rmTiledCube::create could not resize file";
+    }
+
+    filename_p = filename;
+    writable_p = true;
+    map (size);
+
+    memcpy (map_p, &header_p, sizeof(header_p));
+    double *axisData = (double*)(map_p+sizeof(header_p));
+    std::copy (axisValues_p.begin(), axisValues_p.end(), axisData);
+    std::copy (axisIntervals_p.begin(), axisIntervals_p.end(), axisData+header_p.nofChannels);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         open
+
+  /*!
+    \param filename -- Name of an existing tiled cube file.
+    \param writable -- Map the file writable, e.g. to fill it with results.
+  */
+  void rmTiledCube::open (const std::string &filename,
+                          bool writable)
+  {
+    close ();
+
+    fd_p = ::open (filename.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd_p < 0) {
+      throw "rmTiledCube::open could not open file";
+    }
+
+    struct stat info;
+    if (fstat (fd_p, &info) != 0 || (size_t)info.st_size < sizeof(header_p)) {
+      close ();
+      throw "rmTiledCube::open file too short for a tiled cube";
+    }
+    if (pread (fd_p, &header_p, sizeof(header_p), 0) != (ssize_t)sizeof(header_p)) {
+      close ();
+      throw "rmTiledCube::open could not read header";
+    }
+
+    try {
+      checkHeader (info.st_size);
+    } catch (const char*) {
+      close ();
+      throw;
+    }
+
+    filename_p = filename;
+    writable_p = writable;
+    map (info.st_size);
+
+    /* Lines of sight are read front to back, tiles one after the other */
+    posix_madvise (map_p, mapSize_p, POSIX_MADV_SEQUENTIAL);
+
+    const double *axisData = (const double*)(map_p+sizeof(header_p));
+    axisValues_p.assign (axisData, axisData+header_p.nofChannels);
+    axisIntervals_p.assign (axisData+header_p.nofChannels, axisData+2*header_p.nofChannels);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        flush
+
+  void rmTiledCube::flush ()
+  {
+    if (map_p != NULL && writable_p) {
+      if (msync (map_p, mapSize_p, MS_SYNC) != 0) {
+        throw "rmTiledCube::flush msync failed";
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                        close
+
+  void rmTiledCube::close ()
+  {
+    if (map_p != NULL) {
+      munmap (map_p, mapSize_p);
+      map_p     = NULL;
+      mapSize_p = 0;
+    }
+    if (fd_p >= 0) {
+      ::close (fd_p);
+      fd_p = -1;
+    }
+    writable_p = false;
+    filename_p = "";
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   tileOrigin
+
+  /*!
+    \param tile -- Index of the tile.
+    \retval x0  -- x position of the first pixel of the tile.
+    \retval y0  -- y position of the first pixel of the tile.
+  */
+  void rmTiledCube::tileOrigin (unsigned int tile,
+                                unsigned int &x0,
+                                unsigned int &y0) const
+  {
+    if (tile >= nofTiles()) {
+      throw "rmTiledCube::tileOrigin tile index out of range";
+    }
+    x0 = (tile%nofTilesX())*header_p.tileX;
+    y0 = (tile/nofTilesX())*header_p.tileY;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                    tileIndex
+
+  unsigned int rmTiledCube::tileIndex (unsigned int x,
+                                       unsigned int y) const
+  {
+    return (y/header_p.tileY)*nofTilesX() + x/header_p.tileX;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                         tile
+
+  const std::complex<float>* rmTiledCube::tile (unsigned int tile) const
+  {
+    if (map_p == NULL) {
+      throw "rmTiledCube::tile no file mapped";
+    }
+    if (tile >= nofTiles()) {
+      throw "rmTiledCube::tile tile index out of range";
+    }
+    return (const std::complex<float>*)(map_p+header_p.dataOffset) + tile*tileSize();
+  }
+
+  //_____________________________________________________________________________
+  //                                                                 writableTile
+
+  std::complex<float>* rmTiledCube::writableTile (unsigned int tile)
+  {
+    if (!writable_p) {
+      throw "rmTiledCube::writableTile cube is mapped read only";
+    }
+    return const_cast<std::complex<float>*>(this->tile(tile));
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  lineOfSight
+
+  const std::complex<float>* rmTiledCube::lineOfSight (unsigned int x,
+                                                       unsigned int y) const
+  {
+    if (x >= header_p.nx || y >= header_p.ny) {
+      throw "rmTiledCube::lineOfSight pixel out of range";
+    }
+    const unsigned int pixel = (y%header_p.tileY)*header_p.tileX + x%header_p.tileX;
+    return tile(tileIndex(x,y)) + (size_t)pixel*header_p.nofChannels;
+  }
+
+  //_____________________________________________________________________________
+  //                                                          writableLineOfSight
+
+  std::complex<float>* rmTiledCube::writableLineOfSight (unsigned int x,
+                                                         unsigned int y)
+  {
+    if (!writable_p) {
+      throw "rmTiledCube::writableLineOfSight cube is mapped read only";
+    }
+    return const_cast<std::complex<float>*>(lineOfSight(x,y));
+  }
+
+  //_____________________________________________________________________________
+  //                                                               getLineOfSight
+
+  void rmTiledCube::getLineOfSight (unsigned int x,
+                                    unsigned int y,
+                                    std::vector<std::complex<double> > &line) const
+  {
+    const std::complex<float> *values = lineOfSight (x,y);
+    line.resize (header_p.nofChannels);
+    for (unsigned int c=0; c<header_p.nofChannels; c++) {
+      line[c] = std::complex<double> (values[c].real(), values[c].imag());
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                               setLineOfSight
+
+  void rmTiledCube::setLineOfSight (unsigned int x,
+                                    unsigned int y,
+                                    const std::vector<std::complex<double> > &line)
+  {
+    if (line.size() != header_p.nofChannels) {
+      throw "rmTiledCube::setLineOfSight vector line has incompatible length";
+    }
+    std::complex<float> *values = writableLineOfSight (x,y);
+    for (unsigned int c=0; c<header_p.nofChannels; c++) {
+      values[c] = std::complex<float> (line[c].real(), line[c].imag());
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                     prefetch
+
+  /*!
+    Used by a reader to get the next tile from disk while the current one is
+    processed; the call returns immediately.
+  */
+  void rmTiledCube::prefetch (unsigned int tile) const
+  {
+    const size_t page  = sysconf (_SC_PAGESIZE);
+    const char *start  = (const char*) this->tile (tile);
+    const char *end    = start + tileSize()*sizeof(std::complex<float>);
+    const char *first  = map_p + ((start-map_p)/page)*page;
+    posix_madvise ((void*)first, end-first, POSIX_MADV_WILLNEED);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      release
+
+  /*!
+    Streaming readers and writers call this after a tile has been copied, so
+    the resident part of the mapping stays bounded by the tiles in flight.
+    Modified pages of a writable mapping stay in the page cache and are
+    written back by the kernel.
+  */
+  void rmTiledCube::release (unsigned int tile) const
+  {
+    const size_t page  = sysconf (_SC_PAGESIZE);
+    const char *start  = (const char*) this->tile (tile);
+    const char *end    = start + tileSize()*sizeof(std::complex<float>);
+    const char *first  = map_p + ((start-map_p)/page)*page;
+    if (writable_p) {
+      msync ((void*)first, end-first, MS_ASYNC);
+    }
+    madvise ((void*)first, end-first, MADV_DONTNEED);
+  }
+
+  //_____________________________________________________________________________
+  //                                                                   cornerTurn
+
+  /*!
+    \param q            -- nofPlanes consecutive Q planes of nx*ny values each
+                           (x running fastest, as read from FITS).
+    \param u            -- The corresponding U planes.
+    \param firstChannel -- Channel of the first plane.
+    \param nofPlanes    -- Number of planes in the block.
+
+    Each tile is visited once per block and receives nofPlanes consecutive
+    values per pixel, so the pages of a tile are written in one go. The tiles
+    are independent and distributed over the threads.
+  */
+  void rmTiledCube::cornerTurn (const float *q,
+                                const float *u,
+                                unsigned int firstChannel,
+                                unsigned int nofPlanes)
+  {
+    if (!writable_p) {
+      throw "rmTiledCube::cornerTurn cube is mapped read only";
+    }
+    if (firstChannel+nofPlanes > header_p.nofChannels) {
+      throw "rmTiledCube::cornerTurn planes exceed the number of channels";
+    }
+
+    const size_t planeSize = header_p.nx*header_p.ny;
+    const int nofTiles     = this->nofTiles();
+    int t;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) private(t)
+#endif
+    for (t=0; t<nofTiles; t++) {
+      unsigned int x0, y0;
+      tileOrigin (t, x0, y0);
+      const unsigned int x1 = std::min<unsigned int> (x0+header_p.tileX, header_p.nx);
+      const unsigned int y1 = std::min<unsigned int> (y0+header_p.tileY, header_p.ny);
+      std::complex<float> *values = writableTile (t);
+
+      for (unsigned int y=y0; y<y1; y++) {
+        for (unsigned int x=x0; x<x1; x++) {
+          std::complex<float> *line = values
+            + ((size_t)(y-y0)*header_p.tileX + (x-x0))*header_p.nofChannels + firstChannel;
+          const size_t pixel = (size_t)y*header_p.nx + x;
+          for (unsigned int c=0; c<nofPlanes; c++) {
+            line[c] = std::complex<float> (q[c*planeSize+pixel], u[c*planeSize+pixel]);
+          }
+        }
+      }
+    }
+  }
+
+  //_____________________________________________________________________________
+  //                                                                      summary
+
+  /*
+    \param os -- Output stream to which the summary is written.
+  */
+  void rmTiledCube::summary (std::ostream &os)
+  {
+    os << "[rmTiledCube] Summary of internal parameters" << std::endl;
+
+    os << "-- Filename               = " << filename_p              << std::endl;
+    os << "-- Writable               = " << writable_p              << std::endl;
+    os << "-- Image size             = " << nx() << " x " << ny()   << std::endl;
+    os << "-- nof. channels          = " << nofChannels()           << std::endl;
+    os << "-- Spectral axis          = " << axis()                  << std::endl;
+    os << "-- Tile size              = " << tileX() << " x " << tileY() << std::endl;
+    os << "-- nof. tiles             = " << nofTiles()              << std::endl;
+    os << "-- Data offset            = " << header_p.dataOffset     << std::endl;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                          map
+
+  void rmTiledCube::map (size_t size)
+  {
+    void *start = mmap (NULL, size,
+                        writable_p ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                        MAP_SHARED, fd_p, 0);
+    if (start == MAP_FAILED) {
+      close ();
+      throw "rmTiledCube could not map file";
+    }
+    map_p     = (char*) start;
+    mapSize_p = size;
+  }
+
+  //_____________________________________________________________________________
+  //                                                                  checkHeader
+
+  void rmTiledCube::checkHeader (size_t fileSize) const
+  {
+    if (memcmp (header_p.magic, RM_TILEDCUBE_MAGIC, sizeof(header_p.magic)) != 0) {
+      throw "rmTiledCube::open file is not a tiled cube";
+    }
+    if (header_p.nx == 0 || header_p.ny == 0 || header_p.nofChannels == 0
+        || header_p.tileX == 0 || header_p.tileY == 0) {
+      throw "rmTiledCube::open header has zero dimensions";
+    }
+    if (header_p.dataOffset < sizeof(header_p) + 2*header_p.nofChannels*sizeof(double)) {
+      throw "rmTiledCube::open data overlap the header";
+    }
+    if (fileSize < header_p.dataOffset + (size_t)nofTiles()*tileSize()*sizeof(std::complex<float>)) {
+      throw "rmTiledCube::open file is truncated";
+    }
+  }
+
+}  // END -- namespace RM
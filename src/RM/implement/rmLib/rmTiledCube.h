@@ -0,0 +1,321 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#ifndef RM_TILEDCUBE_H
+#define RM_TILEDCUBE_H
+
+#include <complex>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//! Magic string at the start of a tiled spectral-major cube file
+#define RM_TILEDCUBE_MAGIC "RMTCUBE1"
+
+namespace RM {
+
+  /*!
+    \brief Header of a tiled spectral-major cube file
+
+    The header is followed by the values and the interval lengths of the
+    spectral axis (2*nofChannels doubles); the data start at dataOffset, which
+    is aligned to the page size.
+  */
+  struct rmTiledCubeHeader {
+    //! Magic string RM_TILEDCUBE_MAGIC
+    char magic[8];
+    //! Type of the spectral axis: 1 = frequencies, 2 = lambda squared, 3 = Faraday depths
+    uint32_t axis;
+    //! Unused, keeps the following fields aligned
+    uint32_t reserved;
+    //! Number of pixels in x direction
+    uint64_t nx;
+    //! Number of pixels in y direction
+    uint64_t ny;
+    //! Number of channels (values of the spectral axis)
+    uint64_t nofChannels;
+    //! Number of pixels of a tile in x direction
+    uint64_t tileX;
+    //! Number of pixels of a tile in y direction
+    uint64_t tileY;
+    //! Offset of the first tile in the file in bytes
+    uint64_t dataOffset;
+  };
+
+  /*!
+    \class rmTiledCube
+
+    \ingroup RM
+
+    \brief Q/U cube stored spectral-major in tiles of pixels, memory-mapped
+
+    \date 17.10.2026
+
+    \test trmTiledCube.cpp
+
+    <h3>Prerequisite</h3>
+
+    <ul type="square">
+      <li>rmCube
+    </ul>
+
+    <h3>Synopsis</h3>
+
+    Image cubes are delivered as one 2-D plane per channel, whereas
+    RM-synthesis processes the complete spectrum of one pixel at a time.
+    Reading a line of sight from a plane stack touches every plane; an
+    rmTiledCube stores the cube the other way round:
+
+    <ul>
+      <li>the image is divided into tiles of tileX x tileY pixels, stored one
+          after the other in row-major order of the tiles (edge tiles are
+          padded to the full tile size, so all tiles have the same size);
+      <li>within a tile the pixels are stored row by row, x running fastest;
+      <li>each pixel holds the complete spectrum, nofChannels complex<float>
+          values (Q,U).
+    </ul>
+
+    The file is memory-mapped, so a line of sight is one contiguous block of
+    memory and a tile is one contiguous block of the file, which can be handed
+    to a thread as a unit of work.
+
+    A cube is created from a plane stack by cornerTurn(), which takes blocks
+    of consecutive planes and scatters them into the tiles. The number of
+    planes per block sets the memory used for the corner turn; the output file
+    itself is never held in memory as a whole.
+
+    <h3>Example(s)</h3>
+
+    \code
+    rmTiledCube cube;
+    cube.create ("field.rmtc", nx, ny, freqs, freqsInterval, 32, 32);
+    for (unsigned int c=0; c<nofChannels; c+=block) {
+      // read planes c .. c+block-1 into q and u
+      cube.cornerTurn (q, u, c, block);
+    }
+    cube.close();
+
+    cube.open ("field.rmtc");
+    const std::complex<float> *line = cube.lineOfSight (x, y);
+    \endcode
+  */
+  class rmTiledCube
+  {
+
+    //! Name of the mapped file
+    std::string filename_p;
+    //! File descriptor, -1 if no file is open
+    int fd_p;
+    //! Start of the mapping of the complete file
+    char *map_p;
+    //! Size of the mapping in bytes
+    size_t mapSize_p;
+    //! Is the file mapped writable?
+    bool writable_p;
+    //! Header of the file
+    rmTiledCubeHeader header_p;
+    //! Values of the spectral axis
+    std::vector<double> axisValues_p;
+    //! Interval lengths of the spectral axis
+    std::vector<double> axisIntervals_p;
+
+  public:
+
+    // === Construction =========================================================
+
+    //! Default constructor, no file attached
+    rmTiledCube ();
+
+    // === Destruction ==========================================================
+
+    //! Destructor, unmaps and closes the file
+    ~rmTiledCube ();
+
+    // === Parameter access =====================================================
+
+    //! Get the name of the mapped file
+    inline std::string filename () const {
+      return filename_p;
+    }
+
+    //! Is a file mapped?
+    inline bool isOpen () const {
+      return map_p != NULL;
+    }
+
+    //! Is the file mapped writable?
+    inline bool writable () const {
+      return writable_p;
+    }
+
+    //! Get the number of pixels in x direction
+    inline unsigned int nx () const {
+      return header_p.nx;
+    }
+
+    //! Get the number of pixels in y direction
+    inline unsigned int ny () const {
+      return header_p.ny;
+    }
+
+    //! Get the number of channels
+    inline unsigned int nofChannels () const {
+      return header_p.nofChannels;
+    }
+
+    //! Get the type of the spectral axis (1 = frequencies, 2 = lambda squared, 3 = Faraday depths)
+    inline int axis () const {
+      return header_p.axis;
+    }
+
+    //! Get the number of pixels of a tile in x direction
+    inline unsigned int tileX () const {
+      return header_p.tileX;
+    }
+
+    //! Get the number of pixels of a tile in y direction
+    inline unsigned int tileY () const {
+      return header_p.tileY;
+    }
+
+    //! Get the number of tiles in x direction
+    inline unsigned int nofTilesX () const {
+      return (header_p.tileX > 0) ? (header_p.nx+header_p.tileX-1)/header_p.tileX : 0;
+    }
+
+    //! Get the number of tiles in y direction
+    inline unsigned int nofTilesY () const {
+      return (header_p.tileY > 0) ? (header_p.ny+header_p.tileY-1)/header_p.tileY : 0;
+    }
+
+    //! Get the number of tiles
+    inline unsigned int nofTiles () const {
+      return nofTilesX()*nofTilesY();
+    }
+
+    //! Get the number of values of a (padded) tile
+    inline size_t tileSize () const {
+      return header_p.tileX*header_p.tileY*header_p.nofChannels;
+    }
+
+    //! Get the values of the spectral axis
+    inline const std::vector<double>& axisValues () const {
+      return axisValues_p;
+    }
+
+    //! Get the interval lengths of the spectral axis
+    inline const std::vector<double>& axisIntervals () const {
+      return axisIntervals_p;
+    }
+
+    // === Methods ==============================================================
+
+    //! Create a new (zero filled) cube file and map it writable
+    void create (const std::string &filename,
+                 unsigned int nx,
+                 unsigned int ny,
+                 const std::vector<double> &axisValues,
+                 const std::vector<double> &axisIntervals,
+                 unsigned int tileX=32,
+                 unsigned int tileY=32,
+                 int axis=1);
+
+    //! Map an existing cube file
+    void open (const std::string &filename,
+               bool writable=false);
+
+    //! Write back modified pages of a writable mapping
+    void flush ();
+
+    //! Unmap and close the file
+    void close ();
+
+    //! Get the first pixel (x0,y0) of a tile
+    void tileOrigin (unsigned int tile,
+                     unsigned int &x0,
+                     unsigned int &y0) const;
+
+    //! Get the index of the tile containing pixel (x,y)
+    unsigned int tileIndex (unsigned int x,
+                            unsigned int y) const;
+
+    //! Get the values of a tile
+    const std::complex<float>* tile (unsigned int tile) const;
+
+    //! Get the values of a tile of a writable cube
+    std::complex<float>* writableTile (unsigned int tile);
+
+    //! Get the spectrum of pixel (x,y)
+    const std::complex<float>* lineOfSight (unsigned int x,
+                                            unsigned int y) const;
+
+    //! Get the spectrum of pixel (x,y) of a writable cube
+    std::complex<float>* writableLineOfSight (unsigned int x,
+                                              unsigned int y);
+
+    //! Copy the spectrum of pixel (x,y) into line
+    void getLineOfSight (unsigned int x,
+                         unsigned int y,
+                         std::vector<std::complex<double> > &line) const;
+
+    //! Set the spectrum of pixel (x,y)
+    void setLineOfSight (unsigned int x,
+                         unsigned int y,
+                         const std::vector<std::complex<double> > &line);
+
+    //! Ask the kernel to read ahead the pages of a tile
+    void prefetch (unsigned int tile) const;
+
+    //! Drop the pages of a tile from the mapping once it has been processed
+    void release (unsigned int tile) const;
+
+    //! Scatter a block of consecutive Q and U planes into the tiles
+    void cornerTurn (const float *q,
+                     const float *u,
+                     unsigned int firstChannel,
+                     unsigned int nofPlanes);
+
+    //! Provide a summary of the internal status
+    inline void summary () {
+      summary (std::cout);
+    }
+
+    //! Provide a summary of the internal status
+    void summary (std::ostream &os);
+
+  private:
+
+    //! Map the file fd_p of size bytes
+    void map (size_t size);
+
+    //! Check the header read from a file
+    void checkHeader (size_t fileSize) const;
+
+    //! Unassigned copy constructor
+    rmTiledCube (const rmTiledCube &other);
+
+    //! Unassigned copy operator
+    rmTiledCube& operator= (const rmTiledCube &other);
+
+  };  //  END -- class rmTiledCube
+
+}  // END -- namespace RM
+
+#endif
@@ -0,0 +1,299 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <WienerSolver.h>
+
+/*!
+  \file tWienerSolver.cpp
+  \ingroup RM
+  \brief A collection of tests for the RM::wienerSolver class
+
+  \date 2026-10-17
+*/
+
+using std::complex;
+using std::vector;
+
+const unsigned int nofChannels = 48;
+const unsigned int nofDepths   = 32;
+
+//_______________________________________________________________________________
+//                                                                        setup
+
+/*!
+  \brief Response of a Fourier sum, Gaussian signal covariance, channel noise
+*/
+void setup (vector<complex<double> > &response,
+            vector<double> &noise,
+            vector<complex<double> > &signal)
+{
+  response.resize (nofChannels*nofDepths);
+  for (unsigned int j=0; j<nofChannels; j++) {
+    double lambdaSq = 0.5 + 1.5*j/nofChannels;
+    for (unsigned int k=0; k<nofDepths; k++) {
+      double arg = 2.0*(-32.0 + 2.0*k)*lambdaSq;
+      response[j*nofDepths+k] = complex<double> (cos(arg), sin(arg))/double(nofChannels);
+    }
+  }
+
+  noise.resize (nofChannels);
+  for (unsigned int j=0; j<nofChannels; j++) {
+    noise[j] = 1e-3*(1.0 + 0.5*sin(0.3*j));
+  }
+
+  signal.resize (nofDepths*nofDepths);
+  for (unsigned int k=0; k<nofDepths; k++) {
+    for (unsigned int l=0; l<nofDepths; l++) {
+      double dist = (double(k)-double(l))/3.0;
+      signal[k*nofDepths+l] = exp(-0.5*dist*dist) + ((k==l) ? 1e-3 : 0.0);
+    }
+  }
+}
+
+//_______________________________________________________________________________
+//                                                                 test_cholesky
+
+/*!
+  \brief Check WF (R S R^H + N) = S R^H for diagonal and full noise matrices
+*/
+int test_cholesky ()
+{
+  std::cout << "\n[tWienerSolver::test_cholesky]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  vector<complex<double> > response, signal, op;
+  vector<double> noise;
+
+  setup (response, noise, signal);
+
+  /* the same noise as full matrix, plus a correlated variant */
+  vector<double> fullNoise (nofChannels*nofChannels, 0.0);
+  for (unsigned int j=0; j<nofChannels; j++) {
+    fullNoise[j*nofChannels+j] = noise[j];
+  }
+  vector<double> corrNoise (fullNoise);
+  for (unsigned int j=0; j+1<nofChannels; j++) {
+    corrNoise[j*nofChannels+j+1] = corrNoise[(j+1)*nofChannels+j] = 2e-4;
+  }
+
+  vector<double> *noises[3] = {&noise, &fullNoise, &corrNoise};
+
+  for (unsigned int n=0; n<3; n++) {
+    try {
+      RM::wienerSolver solver (nofChannels, nofDepths, response, *noises[n], signal);
+      solver.summary();
+      solver.filterOperator (op);
+
+      bool diagonal = noises[n]->size() == nofChannels;
+      double deviation = 0;
+      double scale = 0;
+      for (unsigned int k=0; k<nofDepths; k++) {
+        for (unsigned int i=0; i<nofChannels; i++) {
+          /* (WF R S R^H + WF N - S R^H)(k,i) */
+          complex<double> lhs = 0;
+          complex<double> rhs = 0;
+          for (unsigned int l=0; l<nofDepths; l++) {
+            complex<double> wrs = 0;
+            for (unsigned int j=0; j<nofChannels; j++) {
+              wrs += op[k*nofChannels+j]*response[j*nofDepths+l];
+            }
+            complex<double> srh = 0;
+            for (unsigned int m=0; m<nofDepths; m++) {
+              srh += signal[l*nofDepths+m]*conj(response[i*nofDepths+m]);
+            }
+            lhs += wrs*srh;
+            rhs += signal[k*nofDepths+l]*conj(response[i*nofDepths+l]);
+          }
+          for (unsigned int j=0; j<nofChannels; j++) {
+            double nji = diagonal ? ((i==j) ? noise[j] : 0.0) : (*noises[n])[j*nofChannels+i];
+            lhs += op[k*nofChannels+j]*nji;
+          }
+          deviation = std::max (deviation, std::abs(lhs-rhs));
+          scale     = std::max (scale, std::abs(rhs));
+        }
+      }
+
+      std::cout << "-- Relative deviation     = " << deviation/scale << std::endl;
+      if (deviation > 1e-9*scale) {
+        std::cerr << "-- Wiener filter equation not fulfilled" << std::endl;
+        ++nofFailedTests;
+      }
+      if (solver.noiseDiagonal() != (n < 2)) {
+        std::cerr << "-- Diagonal noise not detected" << std::endl;
+        ++nofFailedTests;
+      }
+    } catch (const char *message) {
+      std::cerr << message << std::endl;
+      ++nofFailedTests;
+    }
+  }
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                             test_leastSquares
+
+/*!
+  \brief Check WF R = 1 for a flat prior, with and without noise
+*/
+int test_leastSquares ()
+{
+  std::cout << "\n[tWienerSolver::test_leastSquares]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  vector<complex<double> > response, signal, op;
+  vector<double> noise;
+
+  setup (response, noise, signal);
+
+  for (unsigned int n=0; n<2; n++) {
+    try {
+      RM::wienerSolver solver (nofChannels, nofDepths, response,
+                               (n==0) ? noise : vector<double>(),
+                               vector<complex<double> >());
+      solver.summary();
+      solver.filterOperator (op);
+
+      double deviation = 0;
+      for (unsigned int k=0; k<nofDepths; k++) {
+        for (unsigned int l=0; l<nofDepths; l++) {
+          complex<double> sum = 0;
+          for (unsigned int j=0; j<nofChannels; j++) {
+            sum += op[k*nofChannels+j]*response[j*nofDepths+l];
+          }
+          deviation = std::max (deviation, std::abs(sum - ((k==l) ? 1.0 : 0.0)));
+        }
+      }
+
+      std::cout << "-- Deviation from unity   = " << deviation << std::endl;
+      if (deviation > 1e-8) {
+        std::cerr << "-- Least squares operator is not a left inverse" << std::endl;
+        ++nofFailedTests;
+      }
+    } catch (const char *message) {
+      std::cerr << message << std::endl;
+      ++nofFailedTests;
+    }
+  }
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                    test_apply
+
+/*!
+  \brief Filter lines of sight with two different patterns of flagged channels
+*/
+int test_apply ()
+{
+  std::cout << "\n[tWienerSolver::test_apply]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  unsigned int nofLines = 77;
+  vector<complex<double> > response, signal;
+  vector<double> noise;
+
+  setup (response, noise, signal);
+
+  srand (1);
+  vector<complex<double> > lines (nofChannels*nofLines);
+  for (unsigned int i=0; i<lines.size(); i++) {
+    lines[i] = complex<double> (rand()/double(RAND_MAX)-0.5, rand()/double(RAND_MAX)-0.5);
+  }
+  /* every third line has flagged channels */
+  vector<bool> flagged (nofChannels, true);
+  flagged[5] = flagged[6] = flagged[30] = false;
+  for (unsigned int p=0; p<nofLines; p+=3) {
+    for (unsigned int j=0; j<nofChannels; j++) {
+      if (!flagged[j]) {
+        lines[p*nofChannels+j] = std::numeric_limits<double>::quiet_NaN();
+      }
+    }
+  }
+
+  try {
+    RM::wienerSolver solver (nofChannels, nofDepths, response, noise, signal);
+    vector<complex<double> > result (nofDepths*nofLines);
+    unsigned int nofPatterns = solver.apply (&lines[0], &result[0], nofLines);
+
+    if (nofPatterns != 2) {
+      std::cerr << "-- Wrong number of channel patterns: " << nofPatterns << std::endl;
+      ++nofFailedTests;
+    }
+
+    vector<complex<double> > opAll, opFlagged;
+    solver.filterOperator (opAll);
+    solver.filterOperator (flagged, opFlagged);
+
+    double deviation = 0;
+    double scale = 0;
+    for (unsigned int p=0; p<nofLines; p++) {
+      bool hasFlags = (p%3 == 0);
+      vector<complex<double> > &op = hasFlags ? opFlagged : opAll;
+      unsigned int nc = hasFlags ? nofChannels-3 : nofChannels;
+      for (unsigned int k=0; k<nofDepths; k++) {
+        complex<double> expected = 0;
+        for (unsigned int j=0, c=0; j<nofChannels; j++) {
+          if (!hasFlags || flagged[j]) {
+            expected += op[k*nc+c]*lines[p*nofChannels+j];
+            c++;
+          }
+        }
+        deviation = std::max (deviation, std::abs(result[p*nofDepths+k]-expected));
+        scale     = std::max (scale, std::abs(expected));
+      }
+    }
+
+    std::cout << "-- Relative deviation     = " << deviation/scale << std::endl;
+    if (!(deviation <= 1e-12*scale)) {
+      std::cerr << "-- Deviation from the per line product too large" << std::endl;
+      ++nofFailedTests;
+    }
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+/*!
+  \brief Main routine of the test program
+
+  \return nofFailedTests -- The number of failed tests encountered within and
+          identified by this test program.
+*/
+int main ()
+{
+  int nofFailedTests (0);
+
+  nofFailedTests += test_cholesky ();
+  nofFailedTests += test_leastSquares ();
+  nofFailedTests += test_apply ();
+
+  return nofFailedTests;
+}
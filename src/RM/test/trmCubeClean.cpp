@@ -0,0 +1,261 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <rmCubeClean.h>
+
+/*!
+  \file trmCubeClean.cpp
+  \ingroup RM
+  \brief A collection of tests for the RM::rmCubeClean class
+
+  \date 2026-10-17
+*/
+
+using std::complex;
+using std::vector;
+
+const unsigned int nofChannels = 200;
+const unsigned int nofDepths   = 300;
+const double depthStep         = 0.5;
+
+//_______________________________________________________________________________
+//                                                                         rmsf
+
+/*!
+  \brief RMSF of nofChannels channels between 0.5 and 2 m^2 on 2*nofDepths-1
+         Faraday depth offsets
+*/
+vector<complex<double> > rmsf (double &fwhm)
+{
+  vector<complex<double> > result (2*nofDepths-1);
+  for (unsigned int k=0; k<result.size(); k++) {
+    double phi = depthStep*(double(k)-double(nofDepths-1));
+    for (unsigned int j=0; j<nofChannels; j++) {
+      double lambdaSq = 0.5 + 1.5*j/nofChannels;
+      result[k] += complex<double> (cos(2*phi*lambdaSq), -sin(2*phi*lambdaSq));
+    }
+    result[k] /= double(nofChannels);
+  }
+  /* |RMSF| = |sin(x)/x| with x = 1.5 phi, half maximum at x = 1.8955 */
+  fwhm = 2*1.8955/1.5/depthStep;
+  return result;
+}
+
+//_______________________________________________________________________________
+//                                                                   dirtyLines
+
+/*!
+  \brief Dirty spectra of one point source per line of sight
+*/
+void dirtyLines (const vector<complex<double> > &r,
+                 vector<complex<double> > &dirty,
+                 vector<unsigned int> &position,
+                 vector<complex<double> > &flux,
+                 unsigned int nofLines)
+{
+  dirty.assign (nofLines*nofDepths, 0.0);
+  position.resize (nofLines);
+  flux.resize (nofLines);
+  for (unsigned int line=0; line<nofLines; line++) {
+    position[line] = 20 + (line*37)%(nofDepths-40);
+    flux[line]     = complex<double> (1.0+0.1*line, 0.5-0.02*line);
+    for (unsigned int k=0; k<nofDepths; k++) {
+      dirty[line*nofDepths+k] = flux[line]*r[nofDepths-1+k-position[line]];
+    }
+  }
+}
+
+//_______________________________________________________________________________
+//                                                                   test_clean
+
+/*!
+  \brief CLEAN point sources and check components, residuals and statistics
+*/
+int test_clean ()
+{
+  std::cout << "\n[trmCubeClean::test_clean]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  const unsigned int nofLines = 50;
+  double fwhm;
+  vector<complex<double> > r = rmsf (fwhm);
+  vector<complex<double> > dirty, restored (nofLines*nofDepths), residual (nofLines*nofDepths), components (nofLines*nofDepths);
+  vector<unsigned int> position;
+  vector<complex<double> > flux;
+
+  dirtyLines (r, dirty, position, flux, nofLines);
+
+  try {
+    double threshold = 1e-3;
+    RM::rmCubeClean cleaner (r, fwhm, 0.2, threshold, 2000);
+    cleaner.summary();
+    cleaner.clean (&dirty[0], &restored[0], nofLines, true, &residual[0], &components[0]);
+
+    const vector<RM::rmCleanStatistics> &stats = cleaner.statistics();
+    if (stats.size() != nofLines) {
+      std::cerr << "-- Wrong number of statistics entries" << std::endl;
+      ++nofFailedTests;
+    }
+
+    double fluxDeviation = 0;
+    double maxResidual   = 0;
+    unsigned int misplaced = 0;
+    for (unsigned int line=0; line<nofLines; line++) {
+      /* the components are concentrated at the source position */
+      complex<double> sum = 0;
+      for (unsigned int k=0; k<nofDepths; k++) {
+        complex<double> c = components[line*nofDepths+k];
+        if (std::abs(double(k)-double(position[line])) > 1 && std::abs(c) > 1e-2*std::abs(flux[line])) {
+          misplaced++;
+        }
+        sum += c;
+        maxResidual = std::max (maxResidual, std::abs(residual[line*nofDepths+k]));
+      }
+      fluxDeviation = std::max (fluxDeviation, std::abs(sum-flux[line])/std::abs(flux[line]));
+      if (std::abs(stats[line].cleanFlux-sum) > 1e-12) {
+        std::cerr << "-- Statistics flux differs from the components" << std::endl;
+        ++nofFailedTests;
+      }
+    }
+
+    std::cout << "-- Relative flux deviation = " << fluxDeviation << std::endl;
+    std::cout << "-- Max. residual           = " << maxResidual   << std::endl;
+    std::cout << "-- Iterations of line 0    = " << stats[0].nofIterations << std::endl;
+
+    if (fluxDeviation > 1e-2) {
+      std::cerr << "-- CLEAN flux does not match the source flux" << std::endl;
+      ++nofFailedTests;
+    }
+    if (misplaced > 0) {
+      std::cerr << "-- " << misplaced << " CLEAN components away from the sources" << std::endl;
+      ++nofFailedTests;
+    }
+    if (maxResidual > threshold*(1+1e-12)) {
+      std::cerr << "-- Residual above the threshold" << std::endl;
+      ++nofFailedTests;
+    }
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                 test_restore
+
+/*!
+  \brief Compare the restored spectra (in place) with a direct convolution
+*/
+int test_restore ()
+{
+  std::cout << "\n[trmCubeClean::test_restore]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  const unsigned int nofLines = 16;
+  double fwhm;
+  vector<complex<double> > r = rmsf (fwhm);
+  vector<complex<double> > data, residual (nofLines*nofDepths), components (nofLines*nofDepths);
+  vector<unsigned int> position;
+  vector<complex<double> > flux;
+
+  dirtyLines (r, data, position, flux, nofLines);
+
+  try {
+    RM::rmCubeClean cleaner (r, fwhm, 0.1, 0, 100, 0.05);
+    cleaner.setRelativeThreshold (0.01);
+    cleaner.setNofThreads (3);
+    cleaner.clean (&data[0], &data[0], nofLines, true, &residual[0], &components[0]);
+
+    double sigma = fwhm/(2*sqrt(2*log(2.0)));
+    int width = std::min (int(ceil(4*sigma)), int(nofDepths-1));
+    double deviation = 0;
+    for (unsigned int line=0; line<nofLines; line++) {
+      for (int k=0; k<int(nofDepths); k++) {
+        complex<double> expected = residual[line*nofDepths+k];
+        for (int j=std::max(0,k-width); j<=std::min(int(nofDepths)-1,k+width); j++) {
+          expected += components[line*nofDepths+j]*exp(-0.5*(k-j)*(k-j)/(sigma*sigma));
+        }
+        deviation = std::max (deviation, std::abs(data[line*nofDepths+k]-expected));
+      }
+    }
+
+    double estimate = RM::rmCubeClean::estimateFWHM (r);
+    std::cout << "-- Estimated FWHM          = " << estimate << " (" << fwhm << ")" << std::endl;
+    if (std::abs(estimate-fwhm) > 0.02*fwhm) {
+      std::cerr << "-- FWHM estimate differs from the analytic FWHM" << std::endl;
+      ++nofFailedTests;
+    }
+
+    std::cout << "-- RMSF support            = " << cleaner.support() << std::endl;
+    std::cout << "-- Restoring deviation     = " << deviation << std::endl;
+    if (deviation > 1e-10) {
+      std::cerr << "-- Restored spectra differ from the direct convolution" << std::endl;
+      ++nofFailedTests;
+    }
+    if (cleaner.support() >= nofDepths-1) {
+      std::cerr << "-- RMSF cutoff not applied" << std::endl;
+      ++nofFailedTests;
+    }
+
+    /* side table: header plus one row per line of sight */
+    std::string filename ("trmCubeClean.stats");
+    cleaner.writeStatistics (filename, 4);
+    std::ifstream infile (filename.c_str());
+    std::string row;
+    unsigned int nofRows = 0;
+    while (std::getline (infile, row)) {
+      nofRows++;
+    }
+    infile.close();
+    remove (filename.c_str());
+    if (nofRows != nofLines+1) {
+      std::cerr << "-- Statistics table has " << nofRows << " rows" << std::endl;
+      ++nofFailedTests;
+    }
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+/*!
+  \brief Main routine of the test program
+
+  \return nofFailedTests -- The number of failed tests encountered within and
+          identified by this test program.
+*/
+int main ()
+{
+  int nofFailedTests (0);
+
+  nofFailedTests += test_clean ();
+  nofFailedTests += test_restore ();
+
+  return nofFailedTests;
+}
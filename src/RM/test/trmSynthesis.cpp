@@ -0,0 +1,176 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cmath>
+#include <cstdlib>
+#include <rmSynthesis.h>
+
+/*!
+  \file trmSynthesis.cpp
+  \ingroup RM
+  \brief A collection of tests for the RM::rmSynthesis class
+
+  \date 2026-10-17
+*/
+
+using std::complex;
+using std::vector;
+
+//_______________________________________________________________________________
+//                                                                    setupLines
+
+/*!
+  \brief Channels with a gap, equidistant Faraday depths and random lines of sight
+*/
+void setupLines (vector<double> &lambdaSqs,
+                 vector<unsigned int> &gaps,
+                 vector<double> &faradayDepths,
+                 vector<complex<double> > &lines,
+                 unsigned int nofLines)
+{
+  unsigned int nofChannels = 300;
+  unsigned int nofDepths   = 401;
+
+  lambdaSqs.resize (nofChannels);
+  for (unsigned int j=0; j<nofChannels; j++) {
+    lambdaSqs[j] = 0.5 + 1.5*j/nofChannels + ((j < nofChannels/2) ? 0.0 : 0.3);
+  }
+
+  gaps.clear();
+  gaps.push_back (0);
+  gaps.push_back (nofChannels/2);
+  gaps.push_back (nofChannels);
+
+  faradayDepths.resize (nofDepths);
+  for (unsigned int k=0; k<nofDepths; k++) {
+    faradayDepths[k] = -100.0 + 0.5*k;
+  }
+
+  srand (1);
+  lines.resize (nofChannels*nofLines);
+  for (unsigned int i=0; i<lines.size(); i++) {
+    lines[i] = complex<double> (rand()/double(RAND_MAX)-0.5, rand()/double(RAND_MAX)-0.5);
+  }
+}
+
+//_______________________________________________________________________________
+//                                                                     reference
+
+/*!
+  \brief Direct Fourier sum as in rmCube::integrateLamdaSq
+*/
+complex<double> reference (const complex<double> *QU,
+                           const vector<double> &lambdas,
+                           double faraday,
+                           const vector<unsigned int> &gaps)
+{
+  complex<double> erg = 0.0;
+
+  for (unsigned int i=0; i<gaps.size()-1; i++) {
+    unsigned int anf  = gaps[i];
+    unsigned int ende = gaps[i+1];
+    for (unsigned int j=anf; j<ende; j++) {
+      double lam_a = (j==anf) ? lambdas[anf] : 0.5*(lambdas[j-1]+lambdas[j]);
+      double lam_b = (j==ende-1) ? lambdas[ende-1] : 0.5*(lambdas[j]+lambdas[j+1]);
+      double arg = -2.0*faraday*lambdas[j];
+      erg += complex<double>(cos(arg), sin(arg))*QU[j]*(lam_b-lam_a);
+    }
+  }
+
+  return erg;
+}
+
+//_______________________________________________________________________________
+//                                                                     test_method
+
+/*!
+  \brief Compare a transform method with the direct Fourier sum
+
+  \param method    -- Method of the transform.
+  \param tolerance -- Maximum deviation relative to the largest result.
+*/
+int test_method (RM::rmSynthesis::Method method,
+                 double tolerance)
+{
+  std::cout << "\n[trmSynthesis::test_method]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  unsigned int nofLines = 70;
+  vector<double> lambdaSqs;
+  vector<unsigned int> gaps;
+  vector<double> faradayDepths;
+  vector<complex<double> > lines;
+
+  setupLines (lambdaSqs, gaps, faradayDepths, lines, nofLines);
+
+  try {
+    RM::rmSynthesis synthesis (lambdaSqs, faradayDepths, gaps, method);
+    synthesis.summary();
+
+    unsigned int nofChannels = synthesis.nofChannels();
+    unsigned int nofDepths   = synthesis.nofDepths();
+    vector<complex<double> > result (nofDepths*nofLines);
+
+    synthesis.transform (&lines[0], &result[0], nofLines);
+
+    double deviation = 0;
+    double scale     = 0;
+    for (unsigned int p=0; p<nofLines; p++) {
+      for (unsigned int k=0; k<nofDepths; k++) {
+        complex<double> expected = reference (&lines[p*nofChannels], lambdaSqs, faradayDepths[k], gaps);
+        deviation = std::max (deviation, std::abs(result[p*nofDepths+k]-expected));
+        scale     = std::max (scale, std::abs(expected));
+      }
+    }
+
+    std::cout << "-- Relative deviation     = " << deviation/scale << std::endl;
+
+    if (deviation > tolerance*scale) {
+      std::cerr << "-- Deviation from the direct Fourier sum too large" << std::endl;
+      ++nofFailedTests;
+    }
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+/*!
+  \brief Main routine of the test program
+
+  \return nofFailedTests -- The number of failed tests encountered within and
+          identified by this test program.
+*/
+int main ()
+{
+  int nofFailedTests (0);
+
+  nofFailedTests += test_method (RM::rmSynthesis::Direct, 1e-12);
+
+#ifdef HAVE_FFTW3
+  nofFailedTests += test_method (RM::rmSynthesis::NUFFT, 1e-9);
+#endif
+
+  return nofFailedTests;
+}
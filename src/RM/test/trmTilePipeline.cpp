@@ -0,0 +1,235 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <cstdio>
+#include <rmTilePipeline.h>
+
+/*!
+  \file trmTilePipeline.cpp
+  \ingroup RM
+  \brief A collection of tests for the RM::rmTilePipeline class
+
+  \date 2026-10-17
+*/
+
+using std::complex;
+using std::vector;
+
+const unsigned int nx          = 50;
+const unsigned int ny          = 30;
+const unsigned int nofChannels = 24;
+const unsigned int nofOutputs  = 3;
+
+//_______________________________________________________________________________
+//                                                                 sumProcessor
+
+/*!
+  \brief Output k of a line of sight is the sum of its channels times (k+1)
+*/
+class sumProcessor : public RM::rmTileProcessor
+{
+public:
+
+  //! Tile at which process() fails, -1 for none
+  int failAt;
+  //! Number of tiles processed
+  unsigned int nofProcessed;
+
+  sumProcessor () : failAt (-1), nofProcessed (0) {}
+
+  unsigned int nofInputValues () const { return nofChannels; }
+
+  unsigned int nofOutputValues () const { return nofOutputs; }
+
+  void process (unsigned int tile,
+                complex<double> *in,
+                complex<double> *out,
+                unsigned long nofLines)
+  {
+    if ((int)tile == failAt) {
+      throw "sumProcessor: requested failure";
+    }
+    for (unsigned long p=0; p<nofLines; p++) {
+      complex<double> sum = 0;
+      for (unsigned int c=0; c<nofChannels; c++) {
+        sum += in[p*nofChannels+c];
+      }
+      for (unsigned int k=0; k<nofOutputs; k++) {
+        out[p*nofOutputs+k] = double(k+1)*sum;
+      }
+    }
+    nofProcessed++;
+  }
+};
+
+//_______________________________________________________________________________
+//                                                                  createInput
+
+void createInput (RM::rmTiledCube &cube, const std::string &filename)
+{
+  vector<double> freqs (nofChannels);
+  for (unsigned int c=0; c<nofChannels; c++) {
+    freqs[c] = 1e8 + 1e6*c;
+  }
+  cube.create (filename, nx, ny, freqs, vector<double>(), 16, 16);
+  vector<complex<double> > line (nofChannels);
+  for (unsigned int y=0; y<ny; y++) {
+    for (unsigned int x=0; x<nx; x++) {
+      for (unsigned int c=0; c<nofChannels; c++) {
+        line[c] = complex<double> (x+0.25*c, y-0.5*c);
+      }
+      cube.setLineOfSight (x, y, line);
+    }
+  }
+  cube.close();
+  cube.open (filename);
+}
+
+//_______________________________________________________________________________
+//                                                                     test_run
+
+/*!
+  \brief Run the pipeline with a small budget and compare with the direct sums
+*/
+int test_run ()
+{
+  std::cout << "\n[trmTilePipeline::test_run]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  std::string inName ("trmTilePipeline.in.rmtc");
+  std::string outName ("trmTilePipeline.out.rmtc");
+
+  try {
+    RM::rmTiledCube in, out;
+    createInput (in, inName);
+    out.create (outName, nx, ny, vector<double>(nofOutputs, 0.0), vector<double>(),
+                in.tileX(), in.tileY(), 3);
+
+    sumProcessor processor;
+    /* two tile buffers for 8 tiles */
+    RM::rmTilePipeline pipeline (in, out, processor, 2*16*16*(nofChannels+nofOutputs)*sizeof(complex<double>)+100);
+    pipeline.summary();
+    pipeline.run();
+
+    if (pipeline.nofBuffers() != 2 || processor.nofProcessed != in.nofTiles()) {
+      std::cerr << "-- Wrong number of buffers or tiles processed" << std::endl;
+      ++nofFailedTests;
+    }
+
+    out.close();
+    out.open (outName);
+    double deviation = 0;
+    vector<complex<double> > line;
+    for (unsigned int y=0; y<ny; y++) {
+      for (unsigned int x=0; x<nx; x++) {
+        complex<double> sum = 0;
+        for (unsigned int c=0; c<nofChannels; c++) {
+          sum += complex<double> (x+0.25*c, y-0.5*c);
+        }
+        out.getLineOfSight (x, y, line);
+        for (unsigned int k=0; k<nofOutputs; k++) {
+          deviation = std::max (deviation, std::abs(line[k]-double(k+1)*sum)/std::abs(sum+1.0));
+        }
+      }
+    }
+    std::cout << "-- Relative deviation     = " << deviation << std::endl;
+    if (deviation > 1e-6) {
+      std::cerr << "-- Output differs from the direct sums" << std::endl;
+      ++nofFailedTests;
+    }
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  remove (inName.c_str());
+  remove (outName.c_str());
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                 test_failure
+
+/*!
+  \brief A failing stage stops the pipeline and the error reaches the caller
+*/
+int test_failure ()
+{
+  std::cout << "\n[trmTilePipeline::test_failure]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  std::string inName ("trmTilePipeline.in.rmtc");
+  std::string outName ("trmTilePipeline.out.rmtc");
+
+  try {
+    RM::rmTiledCube in, out;
+    createInput (in, inName);
+    out.create (outName, nx, ny, vector<double>(nofOutputs, 0.0), vector<double>(),
+                in.tileX(), in.tileY(), 3);
+
+    sumProcessor processor;
+
+    /* budget below one buffer */
+    try {
+      RM::rmTilePipeline pipeline (in, out, processor, 1000);
+      std::cerr << "-- Budget below one buffer accepted" << std::endl;
+      ++nofFailedTests;
+    } catch (const char *message) {
+      std::cout << "-- Expected exception: " << message << std::endl;
+    }
+
+    processor.failAt = 5;
+    RM::rmTilePipeline pipeline (in, out, processor, 1 << 30);
+    try {
+      pipeline.run();
+      std::cerr << "-- Failure of the processor not reported" << std::endl;
+      ++nofFailedTests;
+    } catch (const char *message) {
+      std::cout << "-- Expected exception: " << message << std::endl;
+    }
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  remove (inName.c_str());
+  remove (outName.c_str());
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+/*!
+  \brief Main routine of the test program
+
+  \return nofFailedTests -- The number of failed tests encountered within and
+          identified by this test program.
+*/
+int main ()
+{
+  int nofFailedTests (0);
+
+  nofFailedTests += test_run ();
+  nofFailedTests += test_failure ();
+
+  return nofFailedTests;
+}
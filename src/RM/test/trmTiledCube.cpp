@@ -0,0 +1,203 @@
+/***************************************************************************
+ *   Copyright (C) 2026                                                    *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <rmTiledCube.h>
+
+/*!
+  \file trmTiledCube.cpp
+  \ingroup RM
+  \brief A collection of tests for the RM::rmTiledCube class
+
+  \date 2026-10-17
+*/
+
+using std::complex;
+using std::vector;
+
+const unsigned int nx          = 37;
+const unsigned int ny          = 21;
+const unsigned int nofChannels = 45;
+
+//! Q value of pixel (x,y) in channel c
+inline float qValue (unsigned int x, unsigned int y, unsigned int c)
+{
+  return x + 100.0f*y + 10000.0f*c;
+}
+
+//! U value of pixel (x,y) in channel c
+inline float uValue (unsigned int x, unsigned int y, unsigned int c)
+{
+  return -qValue (x,y,c) - 0.5f;
+}
+
+//_______________________________________________________________________________
+//                                                              test_cornerTurn
+
+/*!
+  \brief Corner turn a plane stack in blocks and read back the lines of sight
+*/
+int test_cornerTurn ()
+{
+  std::cout << "\n[trmTiledCube::test_cornerTurn]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  std::string filename ("trmTiledCube.rmtc");
+  vector<double> freqs (nofChannels), freqsInterval (nofChannels, 1e5);
+  for (unsigned int c=0; c<nofChannels; c++) {
+    freqs[c] = 1.2e8 + 1e5*c;
+  }
+
+  try {
+    RM::rmTiledCube cube;
+    cube.create (filename, nx, ny, freqs, freqsInterval, 16, 8);
+    cube.summary();
+
+    if (cube.nofTiles() != 3*3) {
+      std::cerr << "-- Wrong number of tiles: " << cube.nofTiles() << std::endl;
+      ++nofFailedTests;
+    }
+
+    /* blocks of 10 planes, the last one shorter */
+    const unsigned int block = 10;
+    vector<float> q (block*nx*ny), u (block*nx*ny);
+    for (unsigned int c0=0; c0<nofChannels; c0+=block) {
+      unsigned int nofPlanes = std::min (block, nofChannels-c0);
+      for (unsigned int c=0; c<nofPlanes; c++) {
+        for (unsigned int y=0; y<ny; y++) {
+          for (unsigned int x=0; x<nx; x++) {
+            q[(c*ny+y)*nx+x] = qValue (x, y, c0+c);
+            u[(c*ny+y)*nx+x] = uValue (x, y, c0+c);
+          }
+        }
+      }
+      cube.cornerTurn (&q[0], &u[0], c0, nofPlanes);
+    }
+    cube.close();
+
+    /* read back */
+    cube.open (filename);
+    if (cube.nx() != nx || cube.ny() != ny || cube.nofChannels() != nofChannels
+        || cube.axisValues() != freqs || cube.axisIntervals() != freqsInterval) {
+      std::cerr << "-- Header not restored" << std::endl;
+      ++nofFailedTests;
+    }
+
+    unsigned int nofErrors = 0;
+    vector<complex<double> > line;
+    for (unsigned int y=0; y<ny; y++) {
+      for (unsigned int x=0; x<nx; x++) {
+        const complex<float> *values = cube.lineOfSight (x,y);
+        cube.getLineOfSight (x, y, line);
+        for (unsigned int c=0; c<nofChannels; c++) {
+          if (values[c] != complex<float> (qValue(x,y,c), uValue(x,y,c))
+              || line[c] != complex<double> (values[c].real(), values[c].imag())) {
+            nofErrors++;
+          }
+        }
+      }
+    }
+
+    /* a line of sight lies inside its tile */
+    unsigned int x0, y0;
+    unsigned int t = cube.tileIndex (35, 20);
+    cube.tileOrigin (t, x0, y0);
+    if (t != 8 || x0 != 32 || y0 != 16
+        || cube.lineOfSight (35,20) != cube.tile(t) + ((20-16)*16 + 3)*nofChannels) {
+      std::cerr << "-- Wrong tile layout" << std::endl;
+      ++nofFailedTests;
+    }
+
+    std::cout << "-- Wrong values            = " << nofErrors << std::endl;
+    if (nofErrors > 0) {
+      ++nofFailedTests;
+    }
+
+    /* read only mapping */
+    try {
+      cube.setLineOfSight (0, 0, line);
+      std::cerr << "-- Read only cube was written" << std::endl;
+      ++nofFailedTests;
+    } catch (const char *message) {
+      std::cout << "-- Expected exception: " << message << std::endl;
+    }
+    cube.close();
+  } catch (const char *message) {
+    std::cerr << message << std::endl;
+    ++nofFailedTests;
+  }
+
+  remove (filename.c_str());
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                   test_errors
+
+/*!
+  \brief Files which are not tiled cubes are rejected
+*/
+int test_errors ()
+{
+  std::cout << "\n[trmTiledCube::test_errors]\n" << std::endl;
+
+  int nofFailedTests = 0;
+  std::string filename ("trmTiledCube.txt");
+  FILE *file = fopen (filename.c_str(), "w");
+  fprintf (file, "This is not a tiled cube, but a text file long enough to hold a header.\n");
+  fclose (file);
+
+  RM::rmTiledCube cube;
+  try {
+    cube.open (filename);
+    std::cerr << "-- Text file accepted as tiled cube" << std::endl;
+    ++nofFailedTests;
+  } catch (const char *message) {
+    std::cout << "-- Expected exception: " << message << std::endl;
+  }
+  if (cube.isOpen()) {
+    std::cerr << "-- File left open after failure" << std::endl;
+    ++nofFailedTests;
+  }
+
+  remove (filename.c_str());
+
+  return nofFailedTests;
+}
+
+//_______________________________________________________________________________
+//                                                                           main
+
+/*!
+  \brief Main routine of the test program
+
+  \return nofFailedTests -- The number of failed tests encountered within and
+          identified by this test program.
+*/
+int main ()
+{
+  int nofFailedTests (0);
+
+  nofFailedTests += test_cornerTurn ();
+  nofFailedTests += test_errors ();
+
+  return nofFailedTests;
+}